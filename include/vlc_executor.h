@@ -31,6 +31,18 @@ extern "C" {
 /** Executor type (opaque) */
 typedef struct vlc_executor vlc_executor_t;
 
+/**
+ * Priority of a runnable.
+ *
+ * Queued runnables with a higher priority are run first. Runnables of the
+ * same priority are run in submission order.
+ */
+enum vlc_executor_priority {
+    VLC_EXECUTOR_PRIORITY_LOW,
+    VLC_EXECUTOR_PRIORITY_NORMAL,
+    VLC_EXECUTOR_PRIORITY_HIGH,
+};
+
 /**
  * A Runnable encapsulates a task to be run from an executor thread.
  */
@@ -60,6 +72,22 @@ struct vlc_runnable {
 
     /* Private data used by the vlc_executor_t (do not touch) */
     struct vlc_list node;
+    struct vlc_executor_thread *queue;
+    vlc_tick_t date;
+};
+
+/**
+ * Executor statistics, see vlc_executor_GetStats().
+ */
+struct vlc_executor_stats {
+    unsigned threads; /**< number of threads */
+    size_t queued; /**< number of runnables waiting to run */
+    size_t max_queued; /**< highest number of runnables waiting to run */
+    uint64_t started; /**< number of runnables started */
+    uint64_t stolen; /**< runnables started by another thread than queued on */
+    uint64_t canceled; /**< number of runnables canceled */
+    vlc_tick_t wait_total; /**< total time spent queued by started runnables */
+    vlc_tick_t wait_max; /**< longest time spent queued by a runnable */
 };
 
 /**
@@ -145,6 +173,26 @@ vlc_executor_Delete(vlc_executor_t *executor);
 VLC_API void
 vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable);
 
+/**
+ * Submit a runnable for execution with a given priority.
+ *
+ * This is the same as vlc_executor_Submit(), which uses
+ * VLC_EXECUTOR_PRIORITY_NORMAL, except that queued runnables with a higher
+ * priority are started first.
+ *
+ * Each executor thread has its own queue, and idle threads steal runnables
+ * from the others. The priority order is strict within a queue, but only
+ * approximate across the threads.
+ *
+ * \param executor the executor
+ * \param runnable the task to run
+ * \param priority the task priority
+ */
+VLC_API void
+vlc_executor_SubmitPriority(vlc_executor_t *executor,
+                            struct vlc_runnable *runnable,
+                            enum vlc_executor_priority priority);
+
 /**
  * Cancel a runnable previously submitted.
  *
@@ -176,6 +224,16 @@ vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable);
 VLC_API void
 vlc_executor_WaitIdle(vlc_executor_t *executor);
 
+/**
+ * Get the queue depth and latency statistics of an executor.
+ *
+ * \param executor the executor
+ * \param stats the statistics [OUT]
+ */
+VLC_API void
+vlc_executor_GetStats(vlc_executor_t *executor,
+                      struct vlc_executor_stats *stats);
+
 # ifdef __cplusplus
 }
 # endif
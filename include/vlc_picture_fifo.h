@@ -75,5 +75,12 @@ VLC_API void picture_fifo_Push( picture_fifo_t *, picture_t * );
  */
 VLC_API void picture_fifo_Flush( picture_fifo_t *, vlc_tick_t date, bool flush_before );
 
+/**
+ * It removes the pictures that picture_fifo_Flush would release, and appends
+ * them to the given chain instead, for the caller to release them.
+ */
+VLC_API void picture_fifo_Extract( picture_fifo_t *, vlc_tick_t date,
+                                   bool flush_before, vlc_picture_chain_t * );
+
 #endif /* VLC_PICTURE_FIFO_H */
 
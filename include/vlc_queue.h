@@ -178,6 +178,21 @@ VLC_USED static inline bool vlc_queue_IsEmpty(const vlc_queue_t *q)
     return q->first == NULL;
 }
 
+/**
+ * Peeks at the first entry of a queue (without locking).
+ *
+ * The entry is not dequeued and remains owned by the queue.
+ *
+ * @warning It is assumed that the caller already holds the queue lock;
+ * otherwise the behaviour is undefined.
+ *
+ * @return the first entry, or NULL if the queue is empty
+ */
+VLC_USED static inline void *vlc_queue_PeekUnlocked(const vlc_queue_t *q)
+{
+    return q->first;
+}
+
 /** @} */
 
 /**
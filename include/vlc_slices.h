@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * vlc_slices.h: slice threading for picture processing
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SLICES_H
+#define VLC_SLICES_H
+
+#include <vlc_common.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/**
+ * \defgroup slices Slice threading
+ * \ingroup misc
+ *
+ * Splits the rows of a picture into horizontal bands processed in parallel.
+ *
+ * The bands are run on a worker pool shared by all the users of the process,
+ * and by the calling thread itself, so that a busy pool never delays the
+ * caller more than doing the work alone.
+ *
+ * @{
+ */
+
+/** Slice threading context (opaque) */
+typedef struct vlc_slices vlc_slices_t;
+
+/**
+ * A band of rows to process.
+ */
+struct vlc_slice {
+    unsigned index; /**< index of the band, below vlc_slices_Count() */
+    unsigned first; /**< first row to read, to prime any vertical state */
+    unsigned start; /**< first row to write */
+    unsigned end; /**< row after the last one to write */
+};
+
+/**
+ * Band processing callback.
+ *
+ * It is called once per band, from any thread, and concurrently for
+ * different bands. It must only write the rows from start to end excluded.
+ *
+ * Rows from first to start excluded are the overlap requested by the caller,
+ * for filters carrying state from one row to the next.
+ *
+ * \param opaque the opaque pointer passed to vlc_slices_Run()
+ * \param slice the band to process
+ */
+typedef void (*vlc_slice_cb)(void *opaque, const struct vlc_slice *slice);
+
+/**
+ * Creates a slice threading context.
+ *
+ * The number of bands is set by the "filter-threads" option of the object,
+ * and defaults to the number of CPUs.
+ *
+ * \param obj the object owning the context
+ * \return a new context, or NULL on memory error
+ */
+VLC_API vlc_slices_t *vlc_slices_New(vlc_object_t *obj) VLC_USED;
+#define vlc_slices_New(o) vlc_slices_New(VLC_OBJECT(o))
+
+/**
+ * Deletes a slice threading context.
+ *
+ * \param slices the context
+ */
+VLC_API void vlc_slices_Delete(vlc_slices_t *slices);
+
+/**
+ * Gets the highest number of bands of a context.
+ *
+ * Band indexes are below this number, it is meant to size per-band scratch
+ * buffers.
+ *
+ * \param slices the context
+ */
+VLC_API unsigned vlc_slices_Count(const vlc_slices_t *slices) VLC_USED;
+
+/**
+ * Processes rows in parallel bands.
+ *
+ * The rows are split into at most vlc_slices_Count() bands. Band boundaries
+ * are multiples of the alignment, e.g. 2 for interlaced fields or chroma
+ * subsampling. This function returns when all bands are processed.
+ *
+ * \param slices the context
+ * \param rows the number of rows
+ * \param align the band height granularity (non-zero)
+ * \param overlap the number of rows before each band the callback reads
+ * \param cb the band processing callback
+ * \param opaque the opaque pointer for the callback
+ */
+VLC_API void vlc_slices_Run(vlc_slices_t *slices, unsigned rows,
+                            unsigned align, unsigned overlap,
+                            vlc_slice_cb cb, void *opaque);
+
+/**
+ * Scales a band to a plane.
+ *
+ * Converts the rows of a band, expressed for a reference height, to a plane
+ * of a different height, such as a subsampled chroma plane.
+ *
+ * \param slice the band for the reference height
+ * \param rows the reference height
+ * \param lines the plane height
+ * \param plane the band for the plane [OUT]
+ */
+static inline void vlc_slice_Scale(const struct vlc_slice *slice,
+                                   unsigned rows, unsigned lines,
+                                   struct vlc_slice *plane)
+{
+    plane->index = slice->index;
+    plane->first = (uint64_t)slice->first * lines / rows;
+    plane->start = (uint64_t)slice->start * lines / rows;
+    plane->end = slice->end >= rows ? lines
+               : (unsigned)((uint64_t)slice->end * lines / rows);
+}
+
+/** @} */
+
+# ifdef __cplusplus
+}
+# endif
+
+#endif
@@ -179,6 +179,41 @@ static inline void vlc_tracer_TracePCR( struct vlc_tracer *tracer, const char *t
                      VLC_TRACE("pcr", NS_FROM_VLC_TICK(pcr)), VLC_TRACE_END);
 }
 
+/**
+ * Trace the beginning or the end of a pipeline stage
+ *
+ * Spans of a given stage are keyed by the elementary stream identifier and
+ * the presentation time stamp of the data unit, so that the time spent in
+ * each stage can be matched per unit offline.
+ *
+ * \param span name of the stage
+ * \param phase "begin" or "end"
+ * \param id elementary stream identifier
+ * \param pts presentation time stamp of the data unit
+ */
+static inline void vlc_tracer_TraceSpan(struct vlc_tracer *tracer,
+                                        const char *span, const char *phase,
+                                        const char *id, vlc_tick_t pts)
+{
+    vlc_tracer_Trace(tracer, VLC_TRACE("type", "SPAN"), VLC_TRACE("span", span),
+                     VLC_TRACE("phase", phase), VLC_TRACE("id", id),
+                     VLC_TRACE("pts", NS_FROM_VLC_TICK(pts)), VLC_TRACE_END);
+}
+
+static inline void vlc_tracer_TraceSpanBegin(struct vlc_tracer *tracer,
+                                             const char *span, const char *id,
+                                             vlc_tick_t pts)
+{
+    vlc_tracer_TraceSpan(tracer, span, "begin", id, pts);
+}
+
+static inline void vlc_tracer_TraceSpanEnd(struct vlc_tracer *tracer,
+                                           const char *span, const char *id,
+                                           vlc_tick_t pts)
+{
+    vlc_tracer_TraceSpan(tracer, span, "end", id, pts);
+}
+
 /**
  * @}
  */
@@ -24,6 +24,7 @@
 
 #include <assert.h>
 #include <vlc_common.h>
+#include <vlc_list.h>
 #include <vlc_network.h>
 #include <vlc_tls.h>
 #include <vlc_url.h>
@@ -96,50 +97,118 @@ static char *vlc_http_proxy_find(const char *hostname, unsigned port,
 }
 
 
+/** Maximum number of pooled connections */
+#define VLC_HTTP_MGR_MAX_CONNS 8
+/** Time after which an unused pooled connection is closed */
+#define VLC_HTTP_MGR_IDLE_TIMEOUT VLC_TICK_FROM_SEC(30)
+
+/**
+ * Pooled connection, keyed by scheme and authority of the origin server
+ */
+struct vlc_http_mgr_conn
+{
+    struct vlc_list node;
+    struct vlc_http_conn *conn;
+    vlc_tick_t last_used;
+    unsigned port;
+    bool https;
+    char host[];
+};
+
 struct vlc_http_mgr
 {
     struct vlc_logger *logger;
     vlc_object_t *obj;
     vlc_tls_client_t *creds;
     struct vlc_http_cookie_jar_t *jar;
-    struct vlc_http_conn *conn;
+    struct vlc_list conns; /**< most recently used first */
+    unsigned conn_count;
 };
 
-static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
-                                               const char *host, unsigned port)
+static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
+                                 struct vlc_http_mgr_conn *entry)
 {
-    (void) host; (void) port;
-    return mgr->conn;
+    assert(mgr->conn_count > 0);
+    vlc_list_remove(&entry->node);
+    mgr->conn_count--;
+
+    vlc_http_conn_release(entry->conn);
+    free(entry);
 }
 
-static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
-                                 struct vlc_http_conn *conn)
+/** Closes connections that were not used for a while */
+static void vlc_http_mgr_prune(struct vlc_http_mgr *mgr)
 {
-    assert(mgr->conn == conn);
-    mgr->conn = NULL;
+    struct vlc_http_mgr_conn *entry;
+    vlc_tick_t deadline = vlc_tick_now() - VLC_HTTP_MGR_IDLE_TIMEOUT;
 
-    vlc_http_conn_release(conn);
+    vlc_list_foreach(entry, &mgr->conns, node)
+        if (entry->last_used < deadline)
+            vlc_http_mgr_release(mgr, entry);
+}
+
+static void vlc_http_mgr_add(struct vlc_http_mgr *mgr, bool https,
+                             const char *host, unsigned port,
+                             struct vlc_http_conn *conn)
+{
+    size_t len = strlen(host) + 1;
+    struct vlc_http_mgr_conn *entry = malloc(sizeof (*entry) + len);
+
+    if (unlikely(entry == NULL))
+    {   /* Cannot pool the connection, close it after its current stream */
+        vlc_http_conn_release(conn);
+        return;
+    }
+
+    if (mgr->conn_count >= VLC_HTTP_MGR_MAX_CONNS)
+    {   /* Evict the least recently used connection */
+        struct vlc_http_mgr_conn *lru =
+            vlc_list_last_entry_or_null(&mgr->conns, struct vlc_http_mgr_conn,
+                                        node);
+        vlc_http_mgr_release(mgr, lru);
+    }
+
+    entry->conn = conn;
+    entry->last_used = vlc_tick_now();
+    entry->port = port;
+    entry->https = https;
+    memcpy(entry->host, host, len);
+    vlc_list_prepend(&entry->node, &mgr->conns);
+    mgr->conn_count++;
 }
 
 static
-struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
+struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr, bool https,
                                         const char *host, unsigned port,
                                         const struct vlc_http_msg *req,
                                         bool payload)
 {
-    struct vlc_http_conn *conn = vlc_http_mgr_find(mgr, host, port);
-    if (conn == NULL)
-        return NULL;
+    struct vlc_http_mgr_conn *entry;
 
-    struct vlc_http_stream *stream = vlc_http_stream_open(conn, req, payload);
-    if (stream != NULL)
+    vlc_http_mgr_prune(mgr);
+
+    vlc_list_foreach(entry, &mgr->conns, node)
     {
-        struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
-        if (m != NULL)
-            return m;
+        if (entry->https != https || entry->port != port
+         || strcasecmp(entry->host, host) != 0)
+            continue;
+
+        struct vlc_http_stream *stream =
+            vlc_http_stream_open(entry->conn, req, payload);
+        if (stream != NULL)
+        {
+            struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
+            if (m != NULL)
+            {
+                entry->last_used = vlc_tick_now();
+                vlc_list_remove(&entry->node);
+                vlc_list_prepend(&entry->node, &mgr->conns);
+                return m;
+            }
+        }
+        /* Get rid of closing, reset or busy connection */
+        vlc_http_mgr_release(mgr, entry);
     }
-    /* Get rid of closing or reset connection */
-    vlc_http_mgr_release(mgr, conn);
     return NULL;
 }
 
@@ -151,9 +220,6 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
     vlc_tls_t *tls;
     bool http2 = true;
 
-    if (mgr->creds == NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTP to HTTPS not implemented */
-
     if (mgr->creds == NULL)
     {   /* First TLS connection: load x509 credentials */
         mgr->creds = vlc_tls_ClientCreate(mgr->obj);
@@ -167,8 +233,8 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
          * the nonidempotent request was processed if the connection fails
          * before the response is received.
          */
-        struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req,
-                                                       payload);
+        struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, true, host, port,
+                                                       req, payload);
         if (resp != NULL)
             return resp; /* existing connection reused */
     }
@@ -206,11 +272,8 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
-
-    mgr->conn = conn;
-    return vlc_http_mgr_reuse(mgr, host, port, req, payload);
+    vlc_http_mgr_add(mgr, true, host, port, conn);
+    return vlc_http_mgr_reuse(mgr, true, host, port, req, payload);
 }
 
 static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
@@ -218,13 +281,10 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
                                              const struct vlc_http_msg *req,
                                              bool idempotent, bool payload)
 {
-    if (mgr->creds != NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTPS to HTTP not implemented */
-
     if (idempotent)
     {
-        struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req,
-                                                       payload);
+        struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, false, host, port,
+                                                       req, payload);
         if (resp != NULL)
             return resp;
     }
@@ -263,10 +323,7 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
-
-    mgr->conn = conn;
+    vlc_http_mgr_add(mgr, false, host, port, conn);
     return resp;
 }
 
@@ -298,14 +355,17 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->obj = obj;
     mgr->creds = NULL;
     mgr->jar = jar;
-    mgr->conn = NULL;
+    vlc_list_init(&mgr->conns);
+    mgr->conn_count = 0;
     return mgr;
 }
 
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
 {
-    if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
+    struct vlc_http_mgr_conn *entry;
+
+    vlc_list_foreach(entry, &mgr->conns, node)
+        vlc_http_mgr_release(mgr, entry);
     if (mgr->creds != NULL)
         vlc_tls_ClientDelete(mgr->creds);
     free(mgr);
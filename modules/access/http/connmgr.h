@@ -40,6 +40,10 @@ struct vlc_http_cookie_jar_t;
  * establishing a new one. If successful, the initial HTTP response header is
  * returned.
  *
+ * The manager keeps a pool of connections, keyed by scheme, host and port,
+ * so that requests to different servers do not evict one another.
+ * Connections left unused for some time are closed.
+ *
  * @param mgr HTTP connection manager
  * @param https whether to use HTTPS (true) or unencrypted HTTP (false)
  * @param host name of authoritative HTTP server to send the request to
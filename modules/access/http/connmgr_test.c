@@ -0,0 +1,241 @@
+/*****************************************************************************
+ * connmgr_test.c: HTTP connection manager test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifndef SOCK_CLOEXEC
+# define SOCK_CLOEXEC 0
+# define accept4(a,b,c,d) accept(a,b,c)
+#endif
+#ifdef _WIN32
+# include <winsock2.h>
+#else
+# include <netinet/in.h>
+#endif
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_network.h>
+#include "connmgr.h"
+#include "message.h"
+
+const char vlc_module_name[] = "test_http_connmgr";
+
+#define REQUESTS 200
+
+struct server
+{
+    int fd;
+    unsigned port;
+    atomic_uint accepts;
+    vlc_thread_t thread;
+};
+
+/* Serves keep-alive HTTP/1.1 requests until the client closes */
+static void server_process(int fd)
+{
+    static const char resp[] = "HTTP/1.1 200 OK\r\n"
+                               "Content-Length: 5\r\n\r\nHello";
+    char buf[1024];
+    size_t buflen = 0;
+
+    for (;;)
+    {
+        char *end;
+
+        while ((end = strnstr(buf, "\r\n\r\n", buflen)) == NULL)
+        {
+            ssize_t val = recv(fd, buf + buflen, sizeof (buf) - buflen - 1, 0);
+            if (val <= 0)
+                return;
+            buflen += val;
+            buf[buflen] = '\0';
+        }
+
+        assert(strncmp(buf, "GET / HTTP/1.1\r\n", 16) == 0);
+        end += 4;
+        buflen -= end - buf;
+        memmove(buf, end, buflen);
+
+        ssize_t val = send(fd, resp, strlen(resp), 0);
+        assert((size_t)val == strlen(resp));
+    }
+}
+
+static void *server_thread(void *data)
+{
+    struct server *s = data;
+
+    for (;;)
+    {
+        int cfd = accept4(s->fd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd == -1)
+            continue;
+
+        int canc = vlc_savecancel();
+        atomic_fetch_add(&s->accepts, 1);
+        server_process(cfd);
+        vlc_close(cfd);
+        vlc_restorecancel(canc);
+    }
+    vlc_assert_unreachable();
+}
+
+static int server_start(struct server *s)
+{
+    s->fd = socket(PF_INET, SOCK_STREAM|SOCK_CLOEXEC, IPPROTO_TCP);
+    if (s->fd == -1)
+        return -1;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+#ifdef HAVE_SA_LEN
+        .sin_len = sizeof (addr),
+#endif
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+
+    if (bind(s->fd, (struct sockaddr *)&addr, addrlen)
+     || getsockname(s->fd, (struct sockaddr *)&addr, &addrlen)
+     || listen(s->fd, 255))
+    {
+        vlc_close(s->fd);
+        return -1;
+    }
+
+    s->port = ntohs(addr.sin_port);
+    atomic_init(&s->accepts, 0);
+
+    if (vlc_clone(&s->thread, server_thread, s, VLC_THREAD_PRIORITY_LOW))
+        assert(!"Thread error");
+    return 0;
+}
+
+static void server_stop(struct server *s)
+{
+    vlc_cancel(s->thread);
+    vlc_join(s->thread, NULL);
+    vlc_close(s->fd);
+}
+
+static void request(struct vlc_http_mgr *mgr, const struct server *s)
+{
+    char authority[32];
+
+    snprintf(authority, sizeof (authority), "127.0.0.1:%u", s->port);
+
+    struct vlc_http_msg *req = vlc_http_req_create("GET", "http", authority,
+                                                   "/");
+    assert(req != NULL);
+
+    struct vlc_http_msg *resp = vlc_http_mgr_request(mgr, false, "127.0.0.1",
+                                                     s->port, req, true,
+                                                     false);
+    assert(resp != NULL);
+    vlc_http_msg_destroy(req);
+
+    resp = vlc_http_msg_get_final(resp);
+    assert(resp != NULL);
+    assert(vlc_http_msg_get_status(resp) == 200);
+
+    size_t total = 0;
+    block_t *block;
+
+    while ((block = vlc_http_msg_read(resp)) != NULL)
+    {
+        assert(block != vlc_http_error);
+        total += block->i_buffer;
+        block_Release(block);
+    }
+    assert(total == 5);
+    vlc_http_msg_destroy(resp);
+}
+
+static vlc_object_t obj; /* only used for logging, i.e. not at all */
+
+int main(void)
+{
+    struct server servers[2];
+    struct vlc_http_mgr *mgr;
+
+    for (size_t i = 0; i < ARRAY_SIZE(servers); i++)
+        if (server_start(&servers[i]))
+            return 77;
+
+    /* Cold: a new connection for every request */
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < REQUESTS; i++)
+    {
+        mgr = vlc_http_mgr_create(&obj, NULL);
+        assert(mgr != NULL);
+        request(mgr, &servers[i % ARRAY_SIZE(servers)]);
+        vlc_http_mgr_destroy(mgr);
+    }
+
+    vlc_tick_t cold = vlc_tick_now() - start;
+
+    assert(atomic_load(&servers[0].accepts) == REQUESTS / 2);
+    assert(atomic_load(&servers[1].accepts) == REQUESTS / 2);
+
+    /* Warm: alternating servers keep one connection each */
+    mgr = vlc_http_mgr_create(&obj, NULL);
+    assert(mgr != NULL);
+    request(mgr, &servers[0]);
+    request(mgr, &servers[1]);
+    start = vlc_tick_now();
+
+    for (unsigned i = 0; i < REQUESTS; i++)
+        request(mgr, &servers[i % ARRAY_SIZE(servers)]);
+
+    vlc_tick_t warm = vlc_tick_now() - start;
+
+    assert(atomic_load(&servers[0].accepts) == REQUESTS / 2 + 1);
+    assert(atomic_load(&servers[1].accepts) == REQUESTS / 2 + 1);
+    vlc_http_mgr_destroy(mgr);
+
+    printf("cold pool: %6"PRId64" us/request\n",
+           US_FROM_VLC_TICK(cold) / REQUESTS);
+    printf("warm pool: %6"PRId64" us/request\n",
+           US_FROM_VLC_TICK(warm) / REQUESTS);
+
+    for (size_t i = 0; i < ARRAY_SIZE(servers); i++)
+        server_stop(&servers[i]);
+    return 0;
+}
@@ -24,6 +24,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <time.h>
 #ifdef HAVE_POLL_H
 #include <poll.h>
 #endif
@@ -36,9 +37,12 @@
 #define MSG_TRUNC 0
 #endif
 
+#define VLC_DGRAM_BATCH_MAX 64
+
 struct vlc_dgram_sock
 {
     int fd;
+    uint32_t overflows; /* last kernel drop counter */
     struct vlc_dtls s;
 };
 
@@ -77,6 +81,95 @@ static ssize_t vlc_datagram_Recv(struct vlc_dtls *dgs, struct iovec *iov,
     return ret;
 }
 
+#ifdef HAVE_RECVMMSG
+static vlc_tick_t vlc_datagram_Timestamp(const struct msghdr *msg,
+                                         struct vlc_dgram_sock *s,
+                                         unsigned *restrict dropped)
+{
+    vlc_tick_t ts = VLC_TICK_INVALID;
+
+    *dropped = 0;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR((struct msghdr *)msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+#ifdef SCM_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec rx;
+
+            memcpy(&rx, CMSG_DATA(cmsg), sizeof (rx));
+            ts = vlc_tick_from_timespec(&rx);
+        }
+#endif
+#ifdef SO_RXQ_OVFL
+        if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t overflows;
+
+            memcpy(&overflows, CMSG_DATA(cmsg), sizeof (overflows));
+            *dropped = overflows - s->overflows;
+            s->overflows = overflows;
+        }
+#endif
+    }
+    return ts;
+}
+
+static int vlc_datagram_RecvBatch(struct vlc_dtls *dgs,
+                                  struct vlc_dtls_msg *msgv, unsigned count)
+{
+    struct vlc_dgram_sock *s = container_of(dgs, struct vlc_dgram_sock, s);
+    struct mmsghdr mmsg[VLC_DGRAM_BATCH_MAX];
+    struct iovec iov[VLC_DGRAM_BATCH_MAX];
+    union {
+        char buf[CMSG_SPACE(sizeof (struct timespec))
+                 + CMSG_SPACE(sizeof (uint32_t))];
+        struct cmsghdr align;
+    } cmsg[VLC_DGRAM_BATCH_MAX];
+
+    if (count > VLC_DGRAM_BATCH_MAX)
+        count = VLC_DGRAM_BATCH_MAX;
+
+    for (unsigned i = 0; i < count; i++) {
+        iov[i].iov_base = msgv[i].buf;
+        iov[i].iov_len = msgv[i].len;
+        memset(&mmsg[i], 0, sizeof (mmsg[i]));
+        mmsg[i].msg_hdr.msg_iov = &iov[i];
+        mmsg[i].msg_hdr.msg_iovlen = 1;
+        mmsg[i].msg_hdr.msg_control = cmsg[i].buf;
+        mmsg[i].msg_hdr.msg_controllen = sizeof (cmsg[i].buf);
+    }
+
+    int n = recvmmsg(s->fd, mmsg, count, MSG_WAITFORONE, NULL);
+    if (n <= 0)
+        return n;
+
+    /* Kernel time stamps are from the real-time clock: convert them to the
+     * monotonic clock from their age. */
+    struct timespec now_rt;
+    vlc_tick_t now = vlc_tick_now();
+
+    clock_gettime(CLOCK_REALTIME, &now_rt);
+
+    for (int i = 0; i < n; i++) {
+        const struct msghdr *msg = &mmsg[i].msg_hdr;
+        vlc_tick_t ts = vlc_datagram_Timestamp(msg, s, &msgv[i].dropped);
+
+        if (ts != VLC_TICK_INVALID) {
+            vlc_tick_t age = vlc_tick_from_timespec(&now_rt) - ts;
+            ts = now - (age > 0 ? age : 0);
+        }
+        msgv[i].len = mmsg[i].msg_len;
+        msgv[i].truncated = (msg->msg_flags & MSG_TRUNC) != 0;
+        msgv[i].timestamp = ts;
+    }
+    return n;
+}
+#else
+# define vlc_datagram_RecvBatch NULL
+#endif
+
 static ssize_t vlc_datagram_Send(struct vlc_dtls *dgs,
                                  const struct iovec *iov, unsigned iovlen)
 {
@@ -94,6 +187,7 @@ static const struct vlc_dtls_operations vlc_datagram_ops = {
     vlc_datagram_GetPollFD,
     vlc_datagram_Recv,
     vlc_datagram_Send,
+    vlc_datagram_RecvBatch,
 };
 
 struct vlc_dtls *vlc_datagram_CreateFD(int fd)
@@ -102,7 +196,17 @@ struct vlc_dtls *vlc_datagram_CreateFD(int fd)
 
     if (likely(s != NULL)) {
         s->fd = fd;
+        s->overflows = 0;
         s->s.ops = &vlc_datagram_ops;
+#ifdef HAVE_RECVMMSG
+        /* Best effort: reception time and drop counters are optional */
+# ifdef SO_TIMESTAMPNS
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &(int){ 1 }, sizeof (int));
+# endif
+# ifdef SO_RXQ_OVFL
+        setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 }, sizeof (int));
+# endif
+#endif
     }
 
     return &s->s;
@@ -145,6 +249,7 @@ static const struct vlc_dtls_operations vlc_dccp_ops = {
     vlc_datagram_GetPollFD,
     vlc_dccp_Recv,
     vlc_datagram_Send,
+    NULL,
 };
 
 struct vlc_dtls *vlc_dccp_CreateFD(int fd)
@@ -153,6 +258,7 @@ struct vlc_dtls *vlc_dccp_CreateFD(int fd)
 
     if (likely(s != NULL)) {
         s->fd = fd;
+        s->overflows = 0;
         s->s.ops = &vlc_dccp_ops;
     }
 
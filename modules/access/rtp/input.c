@@ -51,7 +51,7 @@
 /**
  * Processes a packet received from the RTP socket.
  */
-static void rtp_process (demux_t *demux, block_t *block)
+static void rtp_process (demux_t *demux, block_t *block, vlc_tick_t received)
 {
     demux_sys_t *sys = demux->p_sys;
 
@@ -74,7 +74,7 @@ static void rtp_process (demux_t *demux, block_t *block)
     }
 #endif
 
-    rtp_queue (demux, sys->session, block);
+    rtp_queue (demux, sys->session, block, received);
     return;
 drop:
     block_Release (block);
@@ -95,6 +95,17 @@ static int rtp_timeout (vlc_tick_t deadline)
     return t;
 }
 
+#define RTP_BATCH 32
+
+static void rtp_ring_cleanup (void *data)
+{
+    block_t **ring = data;
+
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        if (ring[i] != NULL)
+            block_Release (ring[i]);
+}
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -104,7 +115,11 @@ void *rtp_dgram_thread (void *opaque)
     demux_sys_t *sys = demux->p_sys;
     vlc_tick_t deadline = VLC_TICK_INVALID;
     struct vlc_dtls *rtp_sock = sys->rtp_sock;
+    /* Receive buffers, kept across iterations until a datagram fills them */
+    block_t *ring[RTP_BATCH] = { NULL };
+    struct vlc_dtls_msg msgv[RTP_BATCH];
 
+    vlc_cleanup_push (rtp_ring_cleanup, ring);
     for (;;)
     {
         struct pollfd ufd[1];
@@ -122,31 +137,61 @@ void *rtp_dgram_thread (void *opaque)
 
         if (ufd[0].revents)
         {
-            block_t *block = block_Alloc(DEFAULT_MRU);
-            if (unlikely(block == NULL))
+            unsigned count;
+
+            for (count = 0; count < RTP_BATCH; count++)
+            {
+                if (ring[count] == NULL)
+                    ring[count] = block_Alloc(DEFAULT_MRU);
+                if (unlikely(ring[count] == NULL))
+                    break;
+                msgv[count].buf = ring[count]->p_buffer;
+                msgv[count].len = ring[count]->i_buffer;
+            }
+
+            if (unlikely(count == 0))
+            {
+                vlc_restorecancel (canc);
                 break; /* we are totallly screwed */
+            }
+
+            int val = vlc_dtls_RecvBatch(rtp_sock, msgv, count);
+            if (val < 0)
+            {
+                if (errno == EPIPE)
+                {
+                    vlc_restorecancel (canc);
+                    break; /* connection terminated */
+                }
+                msg_Warn (demux, "RTP network error: %s",
+                          vlc_strerror_c(errno));
+            }
 
-            bool truncated;
-            ssize_t len = vlc_dtls_Recv(rtp_sock, block->p_buffer,
-                                       block->i_buffer, &truncated);
-            if (len >= 0) {
-                if (truncated) {
+            for (int i = 0; i < val; i++)
+            {
+                block_t *block = ring[i];
+
+                ring[i] = NULL;
+                if (msgv[i].dropped > 0)
+                    msg_Warn(demux, "%u packet(s) dropped by the kernel",
+                             msgv[i].dropped);
+                if (msgv[i].truncated) {
                     msg_Err(demux, "packet truncated (MRU was %zu)",
                             block->i_buffer);
                     block->i_flags |= BLOCK_FLAG_CORRUPTED;
                 }
                 else
-                    block->i_buffer = len;
+                    block->i_buffer = msgv[i].len;
 
-                rtp_process (demux, block);
+                /* Kernel reception time, for jitter estimation */
+                rtp_process (demux, block, msgv[i].timestamp);
             }
-            else
+
+            /* Move the buffers left unused at the front */
+            if (val > 0)
             {
-                if (errno == EPIPE)
-                    break; /* connection terminated */
-                msg_Warn (demux, "RTP network error: %s",
-                          vlc_strerror_c(errno));
-                block_Release (block);
+                memmove (ring, ring + val, (RTP_BATCH - val) * sizeof (*ring));
+                memset (ring + (RTP_BATCH - val), 0, val * sizeof (*ring));
             }
 
             n--;
@@ -157,5 +202,7 @@ void *rtp_dgram_thread (void *opaque)
             deadline = VLC_TICK_INVALID;
         vlc_restorecancel (canc);
     }
+    vlc_cleanup_pop ();
+    rtp_ring_cleanup (ring);
     return NULL;
 }
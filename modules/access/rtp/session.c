@@ -199,9 +199,11 @@ static struct vlc_rtp_pt *rtp_find_ptype(const rtp_session_t *session,
  * @param demux VLC demux object
  * @param session RTP session receiving the packet
  * @param block RTP packet including the RTP header
+ * @param received reception time of the packet, or VLC_TICK_INVALID for now
  */
 void
-rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
+rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block,
+           vlc_tick_t received)
 {
     demux_sys_t *p_sys = demux->p_sys;
 
@@ -221,7 +223,9 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         block->i_buffer -= padding;
     }
 
-    vlc_tick_t     now = vlc_tick_now ();
+    /* Prefer the kernel reception time if the socket provided it */
+    vlc_tick_t     now = (received != VLC_TICK_INVALID) ? received
+                                                        : vlc_tick_now ();
     rtp_source_t  *src  = NULL;
     const uint16_t seq  = rtp_seq (block);
     const uint32_t ssrc = GetDWBE (block->p_buffer + 8);
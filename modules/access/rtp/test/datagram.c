@@ -0,0 +1,165 @@
+/**
+ * @file datagram.c
+ * @brief Loopback stress test for batched datagram reception
+ */
+/*****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+#include "../vlc_dtls.h"
+
+#define DGRAM_SIZE  1316
+#define DGRAM_COUNT 100000
+
+struct sender
+{
+    int fd;
+    unsigned count;
+};
+
+static void *Sender(void *data)
+{
+    struct sender *snd = data;
+    uint8_t buf[DGRAM_SIZE];
+
+    memset(buf, 0x47, sizeof (buf));
+    for (unsigned i = 0; i < snd->count; i++) {
+        SetDWBE(buf, i);
+        while (send(snd->fd, buf, sizeof (buf), 0) < 0)
+            assert(errno == ENOBUFS || errno == EAGAIN);
+    }
+    return NULL;
+}
+
+static int OpenPair(int *restrict tx)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(rx >= 0);
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &(int){ 4 << 20 }, sizeof (int));
+    assert(bind(rx, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(getsockname(rx, (struct sockaddr *)&addr, &addrlen) == 0);
+
+    *tx = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(*tx >= 0);
+    assert(connect(*tx, (struct sockaddr *)&addr, addrlen) == 0);
+    return rx;
+}
+
+static void Run(unsigned batch)
+{
+    struct sender snd = { .count = DGRAM_COUNT };
+    int rx = OpenPair(&snd.fd);
+    struct vlc_dtls *sock = vlc_datagram_CreateFD(rx);
+    assert(sock != NULL);
+
+    struct vlc_dtls_msg msgv[64];
+    uint8_t *bufs = malloc(batch * DGRAM_SIZE * 2);
+    assert(bufs != NULL);
+    assert(batch <= ARRAY_SIZE(msgv));
+
+    vlc_thread_t th;
+    unsigned received = 0, kernel_drops = 0, calls = 0, timestamped = 0;
+    uint32_t expected = 0, gaps = 0;
+    vlc_tick_t start = vlc_tick_now();
+
+    assert(vlc_clone(&th, Sender, &snd, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (;;) {
+        struct pollfd ufd = { .fd = rx, .events = POLLIN };
+
+        if (poll(&ufd, 1, 200) <= 0)
+            break; /* sender done and queue drained */
+
+        for (unsigned i = 0; i < batch; i++) {
+            msgv[i].buf = bufs + i * DGRAM_SIZE * 2;
+            msgv[i].len = DGRAM_SIZE * 2;
+        }
+
+        int n = vlc_dtls_RecvBatch(sock, msgv, batch);
+        calls++;
+        if (n < 0)
+            continue;
+
+        vlc_tick_t now = vlc_tick_now();
+
+        for (int i = 0; i < n; i++) {
+            uint32_t seq = GetDWBE(msgv[i].buf);
+
+            assert(msgv[i].len == DGRAM_SIZE);
+            assert(!msgv[i].truncated);
+            if (msgv[i].timestamp != VLC_TICK_INVALID) {
+                assert(msgv[i].timestamp <= now);
+                timestamped++;
+            }
+            kernel_drops += msgv[i].dropped;
+            if (seq != expected)
+                gaps += seq - expected;
+            expected = seq + 1;
+            received++;
+        }
+    }
+
+    vlc_tick_t elapsed = vlc_tick_now() - start - VLC_TICK_FROM_MS(200);
+    vlc_join(th, NULL);
+
+    double secs = secf_from_vlc_tick(elapsed > 0 ? elapsed : 1);
+    printf("batch %2u: %u/%u datagrams, %.0f pkt/s, %.2f pkt/call, "
+           "%u lost (%u reported by kernel), %u timestamped\n",
+           batch, received, DGRAM_COUNT, received / secs,
+           calls ? (double)received / calls : 0., gaps + DGRAM_COUNT - expected,
+           kernel_drops, timestamped);
+
+    /* Loopback delivery does not reorder */
+    assert(received + gaps + (DGRAM_COUNT - expected) == DGRAM_COUNT);
+    assert(received > 0);
+
+    free(bufs);
+    vlc_dtls_Close(sock);
+    net_Close(snd.fd);
+}
+
+int main(void)
+{
+    alarm(10);
+
+    Run(1);
+    Run(8);
+    Run(32);
+    Run(64);
+    return 0;
+}
@@ -23,6 +23,17 @@
 
 struct iovec;
 
+/**
+ * Received datagram
+ */
+struct vlc_dtls_msg {
+    void *buf; /**< Receive buffer [IN] */
+    size_t len; /**< Buffer size [IN], datagram length [OUT] */
+    bool truncated; /**< Whether the datagram did not fit the buffer [OUT] */
+    unsigned dropped; /**< Datagrams lost by the kernel before this one [OUT] */
+    vlc_tick_t timestamp; /**< Kernel reception time, or VLC_TICK_INVALID [OUT] */
+};
+
 /**
  * Datagram socket
  */
@@ -37,6 +48,9 @@ struct vlc_dtls_operations {
     ssize_t (*readv)(struct vlc_dtls *, struct iovec *iov, unsigned len,
                      bool *restrict truncated);
     ssize_t (*writev)(struct vlc_dtls *, const struct iovec *iov, unsigned len);
+    /* optional */
+    int (*readmmsg)(struct vlc_dtls *, struct vlc_dtls_msg *msgv,
+                    unsigned count);
 };
 
 static inline void vlc_dtls_Close(struct vlc_dtls *dgs)
@@ -57,6 +71,31 @@ static inline ssize_t vlc_dtls_Recv(struct vlc_dtls *dgs, void *buf, size_t len,
     return dgs->ops->readv(dgs, &iov, 1, truncated);
 }
 
+/**
+ * Receives several datagrams at once.
+ *
+ * Waits for at least one datagram, then receives as many as are already
+ * queued, up to \p count.
+ *
+ * \return the number of datagrams received, or -1 on error
+ */
+static inline int vlc_dtls_RecvBatch(struct vlc_dtls *dgs,
+                                     struct vlc_dtls_msg *msgv, unsigned count)
+{
+    if (dgs->ops->readmmsg != NULL)
+        return dgs->ops->readmmsg(dgs, msgv, count);
+
+    ssize_t val = vlc_dtls_Recv(dgs, msgv[0].buf, msgv[0].len,
+                                &msgv[0].truncated);
+    if (val < 0)
+        return -1;
+
+    msgv[0].len = val;
+    msgv[0].dropped = 0;
+    msgv[0].timestamp = VLC_TICK_INVALID;
+    return 1;
+}
+
 static inline ssize_t vlc_dtls_Send(struct vlc_dtls *dgs, const void *buf,
                                    size_t len)
 {
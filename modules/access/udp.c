@@ -59,6 +59,21 @@ typedef struct {
 
     size_t length;
     char *offset;
+
+#ifdef HAVE_RECVMMSG
+    /* Batched reception */
+    unsigned batch; /* datagrams per receive call */
+    unsigned count; /* datagrams received in the ring */
+    unsigned next; /* next datagram to return from the ring */
+    uint32_t overflows; /* kernel drop counter */
+    struct mmsghdr *msgv;
+    struct iovec *iov;
+    char *ring; /* batch * MRU bytes, only touched as far as datagrams go */
+    union {
+        char buf[CMSG_SPACE(sizeof (uint32_t))];
+        struct cmsghdr align;
+    } *cmsg;
+#endif
     char buf[MRU];
 } access_sys_t;
 
@@ -83,20 +98,9 @@ static int Control(stream_t *access, int query, va_list args)
     return VLC_SUCCESS;
 }
 
-static ssize_t Read(stream_t *access, void *buf, size_t len)
+static int Wait(stream_t *access)
 {
     access_sys_t *sys = access->p_sys;
-
-    if (sys->length > 0) {
-        if (len > sys->length)
-            len = sys->length;
-
-        memcpy(buf, sys->offset, len);
-        sys->offset += len;
-        sys->length -= len;
-        return len;
-    }
-
     struct pollfd ufd[1];
 
     ufd[0].fd = sys->fd;
@@ -109,6 +113,26 @@ static ssize_t Read(stream_t *access, void *buf, size_t len)
         case -1:
             return -1;
     }
+    return 1;
+}
+
+static ssize_t Read(stream_t *access, void *buf, size_t len)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->length > 0) {
+        if (len > sys->length)
+            len = sys->length;
+
+        memcpy(buf, sys->offset, len);
+        sys->offset += len;
+        sys->length -= len;
+        return len;
+    }
+
+    int ready = Wait(access);
+    if (ready <= 0)
+        return ready;
 
     struct iovec iov[] = {
         { .iov_base = buf,      .iov_len = len, },
@@ -132,6 +156,140 @@ static ssize_t Read(stream_t *access, void *buf, size_t len)
     return val;
 }
 
+#ifdef HAVE_RECVMMSG
+static void CheckOverflows(stream_t *access, const struct msghdr *msg)
+{
+#ifdef SO_RXQ_OVFL
+    access_sys_t *sys = access->p_sys;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR((struct msghdr *)msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET
+         && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t overflows;
+
+            memcpy(&overflows, CMSG_DATA(cmsg), sizeof (overflows));
+            if (overflows != sys->overflows)
+                msg_Warn(access, "%"PRIu32" datagram(s) dropped by the kernel",
+                         overflows - sys->overflows);
+            sys->overflows = overflows;
+        }
+    }
+#else
+    VLC_UNUSED(access); VLC_UNUSED(msg);
+#endif
+}
+
+/* Pops the next non-empty received datagram into offset/length */
+static bool NextDatagram(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+
+    while (sys->next < sys->count) {
+        unsigned i = sys->next++;
+
+        CheckOverflows(access, &sys->msgv[i].msg_hdr);
+        if (sys->msgv[i].msg_len == 0)
+            continue; /* empty payload does *not* mean EOF here */
+
+        sys->offset = sys->iov[i].iov_base;
+        sys->length = sys->msgv[i].msg_len;
+        return true;
+    }
+    return false;
+}
+
+static ssize_t ReadBatch(stream_t *access, void *buf, size_t len)
+{
+    access_sys_t *sys = access->p_sys;
+    size_t total = 0;
+
+    if (sys->length == 0 && !NextDatagram(access)) {
+        int val = Wait(access);
+        if (val <= 0)
+            return val;
+
+        /* The first datagram is received straight into the caller buffer,
+         * as Read() does, any excess and the next ones into the ring. These
+         * are copied out by the next reads, which costs less than the
+         * system calls they save. */
+        struct iovec direct[] = {
+            { .iov_base = buf, .iov_len = len, },
+            sys->iov[0],
+        };
+        struct msghdr *first = &sys->msgv[0].msg_hdr;
+
+        for (unsigned i = 0; i < sys->batch; i++)
+            sys->msgv[i].msg_hdr.msg_controllen = sizeof (sys->cmsg[i].buf);
+        first->msg_iov = direct;
+        first->msg_iovlen = ARRAY_SIZE(direct);
+
+        val = recvmmsg(sys->fd, sys->msgv, sys->batch, MSG_WAITFORONE, NULL);
+
+        first->msg_iov = &sys->iov[0];
+        first->msg_iovlen = 1;
+        if (val <= 0)
+            return -1;
+
+        CheckOverflows(access, first);
+        sys->count = val;
+        sys->next = 1;
+
+        total = __MIN(len, sys->msgv[0].msg_len);
+        sys->offset = sys->iov[0].iov_base;
+        sys->length = sys->msgv[0].msg_len - total;
+
+        /* empty (0 bytes) payload does *not* mean EOF here */
+        if (total == 0 && sys->length == 0 && !NextDatagram(access))
+            return -1;
+    }
+
+    /* Hand out as many already received datagrams as fit */
+    while (total < len && (sys->length > 0 || NextDatagram(access))) {
+        size_t copy = __MIN(len - total, sys->length);
+
+        memcpy((char *)buf + total, sys->offset, copy);
+        sys->offset += copy;
+        sys->length -= copy;
+        total += copy;
+    }
+
+    return total;
+}
+
+static int SetupBatch(stream_t *access, unsigned batch)
+{
+    access_sys_t *sys = access->p_sys;
+
+    sys->batch = batch;
+    sys->count = sys->next = 0;
+    sys->overflows = 0;
+    sys->msgv = vlc_obj_malloc(VLC_OBJECT(access), batch * sizeof (*sys->msgv));
+    sys->iov = vlc_obj_malloc(VLC_OBJECT(access), batch * sizeof (*sys->iov));
+    sys->cmsg = vlc_obj_malloc(VLC_OBJECT(access), batch * sizeof (*sys->cmsg));
+    sys->ring = vlc_obj_malloc(VLC_OBJECT(access), batch * MRU);
+    if (unlikely(sys->msgv == NULL || sys->iov == NULL || sys->cmsg == NULL
+              || sys->ring == NULL))
+        return VLC_ENOMEM;
+
+    for (unsigned i = 0; i < batch; i++) {
+        sys->iov[i].iov_base = sys->ring + i * MRU;
+        sys->iov[i].iov_len = MRU;
+        memset(&sys->msgv[i], 0, sizeof (sys->msgv[i]));
+        sys->msgv[i].msg_hdr.msg_iov = &sys->iov[i];
+        sys->msgv[i].msg_hdr.msg_iovlen = 1;
+        sys->msgv[i].msg_hdr.msg_control = sys->cmsg[i].buf;
+    }
+
+#ifdef SO_RXQ_OVFL
+    /* Best effort: only used to report drops */
+    setsockopt(sys->fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 }, sizeof (int));
+#endif
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -217,6 +375,19 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+#ifdef HAVE_RECVMMSG
+    unsigned batch = var_InheritInteger( p_access, "udp-batch" );
+    if( batch > 1 )
+    {
+        if( SetupBatch( p_access, batch ) )
+        {
+            net_Close( sys->fd );
+            return VLC_ENOMEM;
+        }
+        p_access->pf_read = ReadBatch;
+    }
+#endif
+
     return VLC_SUCCESS;
 }
 
@@ -232,6 +403,9 @@ static void Close( vlc_object_t *p_this )
 }
 
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Datagrams received at once")
+#define BATCH_LONGTEXT N_("Maximum number of queued datagrams received " \
+    "with a single system call. 1 receives datagrams one by one.")
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -240,6 +414,8 @@ vlc_module_begin()
 
     add_obsolete_integer("udp-buffer") /* since 3.0.0 */
     add_integer("udp-timeout", -1, TIMEOUT_TEXT, NULL)
+    add_integer_with_range("udp-batch", 32, 1, 1024,
+                           BATCH_TEXT, BATCH_LONGTEXT)
 
     set_capability("access", 0)
     add_shortcut("udp", "udpstream", "udp4", "udp6")
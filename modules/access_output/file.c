@@ -34,6 +34,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <limits.h>
 #include <unistd.h>
 #ifdef __OS2__
 #   include <io.h>      /* setmode() */
@@ -57,139 +58,250 @@
 
 #define SOUT_CFG_PREFIX "sout-file-"
 
+#ifdef O_DIRECT
+# define DIRECT_ALIGN       4096
+# define DIRECT_BUFFER_SIZE (1 << 20)
+#endif
+
+typedef struct
+{
+    int fd;
+#ifdef O_DIRECT
+    uint8_t *direct_buf; /* staging buffer for direct I/O, or NULL */
+    size_t direct_len;
+#endif
+} sout_access_out_sys_t;
+
+static void LeaveDirect( sout_access_out_t * );
+
 /*****************************************************************************
  * Read: standard read on a file descriptor.
  *****************************************************************************/
 static ssize_t Read( sout_access_out_t *p_access, block_t *p_buffer )
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int fd = p_sys->fd;
     ssize_t val;
 
+    LeaveDirect( p_access );
+
     do
         val = read(fd, p_buffer->p_buffer, p_buffer->i_buffer);
     while (val == -1 && errno == EINTR);
     return val;
 }
 
+/* Gathers as much of the chain as possible, skipping empty blocks */
+static int ChainToIov( const block_t *p_buffer, struct iovec *iov )
+{
+    int iovcnt = 0;
+
+    for( ; p_buffer != NULL && iovcnt < IOV_MAX; p_buffer = p_buffer->p_next )
+    {
+        if( p_buffer->i_buffer == 0 )
+            continue;
+        iov[iovcnt].iov_base = p_buffer->p_buffer;
+        iov[iovcnt].iov_len = p_buffer->i_buffer;
+        iovcnt++;
+    }
+    return iovcnt;
+}
+
+/* Releases the written blocks, and trims the partially written one */
+static block_t *ChainSkip( block_t *p_buffer, size_t i_len )
+{
+    while( p_buffer != NULL && p_buffer->i_buffer <= i_len )
+    {
+        block_t *p_next = p_buffer->p_next;
+
+        i_len -= p_buffer->i_buffer;
+        block_Release( p_buffer );
+        p_buffer = p_next;
+    }
+
+    if( p_buffer != NULL )
+    {
+        p_buffer->p_buffer += i_len;
+        p_buffer->i_buffer -= i_len;
+    }
+    return p_buffer;
+}
+
 /*****************************************************************************
- * Write: standard write on a file descriptor.
+ * Write: vectorized write on a file descriptor.
  *****************************************************************************/
 static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
-    size_t i_write = 0;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    int fd = p_sys->fd;
+    ssize_t i_write = 0;
 
-    while( p_buffer )
+    while( p_buffer != NULL )
     {
-        ssize_t val = write(fd, p_buffer->p_buffer, p_buffer->i_buffer);
-        if (val <= 0)
-        {
-            if (errno == EINTR)
+        struct iovec iov[IOV_MAX];
+        int iovcnt = ChainToIov( p_buffer, iov );
+
+        if( iovcnt == 0 )
+        {   /* only empty blocks left */
+            block_ChainRelease( p_buffer );
+            break;
+        }
+
+        ssize_t val = vlc_writev( fd, iov, iovcnt );
+        if( val <= 0 )
+        {   /* nothing written would loop forever, errno is meaningless */
+            if( val < 0 && errno == EINTR )
                 continue;
-            block_ChainRelease (p_buffer);
-            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
+            block_ChainRelease( p_buffer );
+            msg_Err( p_access, "cannot write: %s",
+                     val < 0 ? vlc_strerror_c(errno) : "no data written" );
             return -1;
         }
 
-        if ((size_t)val >= p_buffer->i_buffer)
-        {
-            block_t *p_next = p_buffer->p_next;
-            block_Release (p_buffer);
-            p_buffer = p_next;
-        }
-        else
-        {
-            p_buffer->p_buffer += val;
-            p_buffer->i_buffer -= val;
-        }
         i_write += val;
+        p_buffer = ChainSkip( p_buffer, val );
     }
     return i_write;
 }
 
-static ssize_t WritePipe(sout_access_out_t *access, block_t *block)
+#ifdef S_ISSOCK
+static ssize_t Send(sout_access_out_t *access, block_t *block)
 {
-    int *fdp = access->p_sys, fd = *fdp;
-    ssize_t total = 0;
+    sout_access_out_sys_t *sys = access->p_sys;
+    int fd = sys->fd;
+    size_t total = 0;
 
     while (block != NULL)
     {
-        if (block->i_buffer == 0)
+        struct iovec iov[IOV_MAX];
+        struct msghdr msg = {
+            .msg_iov = iov,
+            .msg_iovlen = ChainToIov(block, iov),
+        };
+
+        if (msg.msg_iovlen == 0)
         {
-            block_t *next = block->p_next;
-            block_Release(block);
-            block = next;
-            continue;
+            block_ChainRelease(block);
+            break;
         }
 
-        /* TODO: vectorized I/O with writev() */
-        ssize_t val = vlc_write(fd, block->p_buffer, block->i_buffer);
-        if (val < 0)
-        {
+        ssize_t val = vlc_sendmsg(fd, &msg, 0);
+        if (val <= 0)
+        {   /* FIXME: errno is meaningless if val is zero */
             if (errno == EINTR)
                 continue;
-
             block_ChainRelease(block);
             msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
-            total = -1;
-            break;
+            return -1;
         }
 
         total += val;
-
-        assert((size_t)val <= block->i_buffer);
-        block->p_buffer += val;
-        block->i_buffer -= val;
+        block = ChainSkip(block, val);
     }
-
     return total;
 }
+#endif
 
-#ifdef S_ISSOCK
-static ssize_t Send(sout_access_out_t *access, block_t *block)
+#ifdef O_DIRECT
+/* Writes out the staged data. Only whole aligned chunks can be written with
+ * direct I/O, so the tail is written by leaving direct I/O for good. */
+static int FlushDirect( sout_access_out_t *p_access, bool b_last )
 {
-    int *fdp = access->p_sys, fd = *fdp;
-    size_t total = 0;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    size_t i_len = p_sys->direct_len, i_done = 0;
 
-    while (block != NULL)
+    if( b_last )
+        fcntl( p_sys->fd, F_SETFL, fcntl( p_sys->fd, F_GETFL ) & ~O_DIRECT );
+    else
+        i_len &= ~(size_t)(DIRECT_ALIGN - 1);
+
+    while( i_done < i_len )
     {
-        if (block->i_buffer == 0)
+        ssize_t val = write( p_sys->fd, p_sys->direct_buf + i_done,
+                             i_len - i_done );
+        if( val <= 0 )
         {
-            block_t *next = block->p_next;
-            block_Release(block);
-            block = next;
-            continue;
-        }
-
-        /* TODO: vectorized I/O with sendmsg() */
-        ssize_t val = vlc_send(fd, block->p_buffer, block->i_buffer, 0);
-        if (val <= 0)
-        {   /* FIXME: errno is meaningless if val is zero */
-            if (errno == EINTR)
+            if( val < 0 && errno == EINTR )
                 continue;
-            block_ChainRelease(block);
-            msg_Err(access, "cannot write: %s", vlc_strerror_c(errno));
+            msg_Err( p_access, "cannot write: %s",
+                     val < 0 ? vlc_strerror_c(errno) : "no data written" );
             return -1;
         }
+        i_done += val;
+    }
 
-        total += val;
+    memmove( p_sys->direct_buf, p_sys->direct_buf + i_done,
+             p_sys->direct_len - i_done );
+    p_sys->direct_len -= i_done;
+    return 0;
+}
+
+/*****************************************************************************
+ * WriteDirect: coalesce the data into large aligned writes.
+ *****************************************************************************/
+static ssize_t WriteDirect( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    ssize_t i_write = 0;
+
+    for( block_t *p_block = p_buffer; p_block != NULL;
+         p_block = p_block->p_next )
+    {
+        const uint8_t *p = p_block->p_buffer;
+        size_t i_len = p_block->i_buffer;
 
-        assert((size_t)val <= block->i_buffer);
-        block->p_buffer += val;
-        block->i_buffer -= val;
+        while( i_len > 0 )
+        {
+            size_t i_copy = __MIN(i_len,
+                                  DIRECT_BUFFER_SIZE - p_sys->direct_len);
+
+            memcpy( p_sys->direct_buf + p_sys->direct_len, p, i_copy );
+            p_sys->direct_len += i_copy;
+            p += i_copy;
+            i_len -= i_copy;
+
+            if( p_sys->direct_len == DIRECT_BUFFER_SIZE
+             && FlushDirect( p_access, false ) )
+            {
+                block_ChainRelease( p_buffer );
+                return -1;
+            }
+        }
+        i_write += p_block->i_buffer;
     }
-    return total;
+
+    block_ChainRelease( p_buffer );
+    return i_write;
 }
 #endif
 
+/* Writes out any staged data, so that the file can be read or seeked. */
+static void LeaveDirect( sout_access_out_t *p_access )
+{
+#ifdef O_DIRECT
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->direct_buf == NULL )
+        return;
+
+    FlushDirect( p_access, true );
+    aligned_free( p_sys->direct_buf );
+    p_sys->direct_buf = NULL;
+    p_access->pf_write = Write;
+#else
+    VLC_UNUSED(p_access);
+#endif
+}
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
 static int Seek( sout_access_out_t *p_access, off_t i_pos )
 {
-    int *fdp = p_access->p_sys, fd = *fdp;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    return lseek(fd, i_pos, SEEK_SET);
+    LeaveDirect( p_access );
+    return lseek(p_sys->fd, i_pos, SEEK_SET);
 }
 
 static int Control( sout_access_out_t *p_access, int i_query, va_list args )
@@ -222,6 +334,9 @@ static const char *const ppsz_sout_options[] = {
     "overwrite",
 #ifdef O_SYNC
     "sync",
+#endif
+#ifdef O_DIRECT
+    "direct",
 #endif
     NULL
 };
@@ -233,10 +348,14 @@ static int Open( vlc_object_t *p_this )
 {
     sout_access_out_t   *p_access = (sout_access_out_t*)p_this;
     int fd;
-    int *fdp = vlc_obj_malloc(p_this, sizeof (*fdp));
+    sout_access_out_sys_t *p_sys = vlc_obj_malloc(p_this, sizeof (*p_sys));
 
-    if (unlikely(fdp == NULL))
+    if (unlikely(p_sys == NULL))
         return VLC_ENOMEM;
+#ifdef O_DIRECT
+    p_sys->direct_buf = NULL;
+    p_sys->direct_len = 0;
+#endif
 
     config_ChainParse( p_access, SOUT_CFG_PREFIX, ppsz_sout_options, p_access->p_cfg );
 
@@ -318,16 +437,33 @@ static int Open( vlc_object_t *p_this )
         free (buf);
         if (fd == -1)
             return VLC_EGENERIC;
+
+#ifdef O_DIRECT
+        if (var_GetBool (p_access, SOUT_CFG_PREFIX"direct"))
+        {
+            /* Not all file systems support direct I/O */
+            if (fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_DIRECT) == 0)
+                p_sys->direct_buf = aligned_alloc (DIRECT_ALIGN,
+                                                   DIRECT_BUFFER_SIZE);
+            else
+                msg_Warn (p_access, "cannot use direct I/O: %s",
+                          vlc_strerror_c(errno));
+
+            if (p_sys->direct_buf == NULL)
+                fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) & ~O_DIRECT);
+        }
+#endif
     }
 
-    *fdp = fd;
-    p_access->p_sys = fdp;
+    p_sys->fd = fd;
+    p_access->p_sys = p_sys;
 
     struct stat st;
 
     if (fstat (fd, &st))
     {
         msg_Err (p_access, "write error: %s", vlc_strerror_c(errno));
+        LeaveDirect (p_access);
         vlc_close (fd);
         return VLC_EGENERIC;
     }
@@ -338,6 +474,13 @@ static int Open( vlc_object_t *p_this )
     {
         p_access->pf_write = Write;
         p_access->pf_seek  = Seek;
+#ifdef O_DIRECT
+        if (p_sys->direct_buf != NULL)
+        {
+            msg_Dbg (p_access, "using direct I/O");
+            p_access->pf_write = WriteDirect;
+        }
+#endif
     }
 #ifdef S_ISSOCK
     else if (S_ISSOCK(st.st_mode))
@@ -348,14 +491,23 @@ static int Open( vlc_object_t *p_this )
 #endif
     else
     {
-        p_access->pf_write = WritePipe;
+        p_access->pf_write = Write;
         p_access->pf_seek = NULL;
     }
     p_access->pf_control = Control;
 
     msg_Dbg( p_access, "file access output opened (%s)", p_access->psz_path );
     if (append)
-        lseek (fd, 0, SEEK_END);
+    {
+        off_t end = lseek (fd, 0, SEEK_END);
+#ifdef O_DIRECT
+        /* Direct I/O needs aligned file offsets too */
+        if (end & (DIRECT_ALIGN - 1))
+            LeaveDirect (p_access);
+#else
+        (void) end;
+#endif
+    }
 
     return VLC_SUCCESS;
 }
@@ -366,9 +518,10 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
-    int *fdp = p_access->p_sys, fd = *fdp;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
 
-    vlc_close(fd);
+    LeaveDirect(p_access);
+    vlc_close(p_sys->fd);
     msg_Dbg( p_access, "file access output closed" );
 }
 
@@ -383,6 +536,10 @@ static void Close( vlc_object_t * p_this )
     "on the file path")
 #define SYNC_TEXT N_("Synchronous writing")
 #define SYNC_LONGTEXT N_( "Open the file with synchronous writing.")
+#define DIRECT_TEXT N_("Direct I/O")
+#define DIRECT_LONGTEXT N_( "Bypass the operating system page cache, " \
+    "writing the data in large aligned chunks. This reduces the memory " \
+    "pressure when recording many streams at once.")
 
 vlc_module_begin ()
     set_description( N_("File stream output") )
@@ -396,6 +553,9 @@ vlc_module_begin ()
     add_bool( SOUT_CFG_PREFIX "format", false, FORMAT_TEXT, FORMAT_LONGTEXT )
 #ifdef O_SYNC
     add_bool( SOUT_CFG_PREFIX "sync", false, SYNC_TEXT,SYNC_LONGTEXT )
+#endif
+#ifdef O_DIRECT
+    add_bool( SOUT_CFG_PREFIX "direct", false, DIRECT_TEXT, DIRECT_LONGTEXT )
 #endif
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -24,6 +24,7 @@
 
 #include "SegmentTracker.hpp"
 #include "SharedResources.hpp"
+#include "http/HTTPConnectionManager.h"
 #include "playlist/BasePlaylist.hpp"
 #include "playlist/BaseRepresentation.h"
 #include "playlist/BaseAdaptationSet.h"
@@ -250,7 +251,7 @@ bool SegmentTracker::ChunkEntry::isValid() const
 }
 
 SegmentTracker::ChunkEntry
-SegmentTracker::prepareChunk(bool switch_allowed, Position pos) const
+SegmentTracker::prepareChunk(Position pos, BaseRepresentation *wanted) const
 {
     if(!adaptationSet)
         return ChunkEntry();
@@ -264,30 +265,26 @@ SegmentTracker::prepareChunk(bool switch_allowed, Position pos) const
     }
     else /* continuing, or seek */
     {
-        if(!adaptationSet->isSegmentAligned() || !pos.init_sent || !pos.index_sent)
-            switch_allowed = false;
-
-        if(switch_allowed)
+        /* switch to the representation chosen by the logic, if any */
+        if(wanted && wanted != pos.rep)
         {
             Position temp;
-            temp.rep = logic->getNextRepresentation(adaptationSet, pos.rep);
-            if(temp.rep && temp.rep != pos.rep)
-            {
-                /* Convert our segment number if we need to */
-                temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
+            temp.rep = wanted;
+            /* Convert our segment number if we need to */
+            temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
 
-                /* Ensure ephemere content is updated/loaded */
-                if(temp.rep->needsUpdate(temp.number))
-                    temp.rep->scheduleNextUpdate(temp.number, temp.rep->runLocalUpdates(resources));
+            /* Ensure ephemere content is updated/loaded */
+            if(temp.rep->needsUpdate(temp.number))
+                temp.rep->scheduleNextUpdate(temp.number, temp.rep->runLocalUpdates(resources));
 
-                /* could have been std::numeric_limits<uint64_t>::max() if not found because not avail */
-                if(!temp.isValid()) /* try again */
-                    temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
+            /* could have been std::numeric_limits<uint64_t>::max() if not found because not avail */
+            if(!temp.isValid()) /* try again */
+                temp.number = temp.rep->translateSegmentNumber(pos.number, pos.rep);
+
+            /* cancel switch that would go past playlist */
+            if(temp.isValid() && temp.rep->getMinAheadTime(temp.number) == 0)
+                temp = Position();
 
-                /* cancel switch that would go past playlist */
-                if(temp.isValid() && temp.rep->getMinAheadTime(temp.number) == 0)
-                    temp = Position();
-            }
             if(temp.isValid())
                 pos = temp;
         }
@@ -344,14 +341,60 @@ void SegmentTracker::resetChunksSequence()
     }
 }
 
+/* Prefetched chunks stay on the representation of the chunk before them,
+ * switching is only decided when the next chunk is requested */
+void SegmentTracker::prefetchChunks()
+{
+    const BasePlaylist *playlist = adaptationSet->getPlaylist();
+    const unsigned depth = bufferingLogic->getPrefetchDepth(playlist);
+    /* Do not request more than what is needed to start playback */
+    const vlc_tick_t maxahead = bufferingLogic->getMinBuffering(playlist);
+    vlc_tick_t ahead = 0;
+    Position pos = next;
+
+    for(const ChunkEntry &entry : chunkssequence)
+    {
+        ahead += entry.duration;
+        pos = entry.pos;
+        ++pos;
+    }
+
+    /* Creating the chunks starts their download */
+    while(chunkssequence.size() < depth && ahead < maxahead)
+    {
+        ChunkEntry entry = prepareChunk(pos, nullptr);
+        if(!entry.isValid())
+        {
+            delete entry.chunk;
+            break;
+        }
+        chunkssequence.push_back(entry);
+        ahead += entry.duration;
+        pos = entry.pos;
+        ++pos;
+    }
+}
+
 ChunkInterface * SegmentTracker::getNextChunk(bool switch_allowed)
 {
     if(!adaptationSet || !next.isValid())
         return nullptr;
 
+    /* Query the logic once per chunk, as it can be stateful. The requested
+     * position, not the one of a prefetched chunk which is already past its
+     * init and index segments, tells whether switching is possible */
+    BaseRepresentation *wanted = nullptr;
+    if(switch_allowed && adaptationSet->isSegmentAligned() &&
+       next.init_sent && next.index_sent)
+        wanted = logic->getNextRepresentation(adaptationSet, next.rep);
+
+    /* Drop prefetched segments if the logic now wants another representation */
+    if(wanted && !chunkssequence.empty() && wanted != chunkssequence.front().pos.rep)
+        resetChunksSequence();
+
     if(chunkssequence.empty())
     {
-        ChunkEntry chunk = prepareChunk(switch_allowed, next);
+        ChunkEntry chunk = prepareChunk(next, wanted);
         chunkssequence.push_back(chunk);
     }
 
@@ -434,10 +477,13 @@ ChunkInterface * SegmentTracker::getNextChunk(bool switch_allowed)
     notify(SegmentChangedEvent(adaptationSet->getID(),
                                discontinuitySequenceNumber,
                                chunk.starttime, chunk.duration, chunk.displaytime));
+    resources->getConnManager()->updatePosition(adaptationSet->getID(), current.number);
 
     if(!b_gap)
         ++next;
 
+    prefetchChunks();
+
     return returnedChunk;
 }
 
@@ -25,6 +25,7 @@
 #include "http/AuthStorage.hpp"
 #include "http/HTTPConnectionManager.h"
 #include "http/HTTPConnection.hpp"
+#include "http/SegmentCache.hpp"
 #include "encryption/Keyring.hpp"
 
 using namespace adaptive;
@@ -64,7 +65,14 @@ SharedResources * SharedResources::createDefault(vlc_object_t *obj,
 {
     AuthStorage *auth = new AuthStorage(obj);
     Keyring *keyring = new Keyring(obj);
-    HTTPConnectionManager *m = new HTTPConnectionManager(obj);
+    unsigned workers = var_InheritInteger(obj, "adaptive-workers");
+    HTTPConnectionManager *m = new HTTPConnectionManager(obj, workers);
+    size_t cachesize = var_InheritInteger(obj, "adaptive-cache-size") << 20;
+    size_t disksize = var_InheritInteger(obj, "adaptive-cache-disk-size") << 20;
+    char *psz_dir = var_InheritString(obj, "adaptive-cache-dir");
+    /* 0 disables the memory tier, the disk one still works */
+    m->setCache(new SegmentCache(obj, cachesize, psz_dir ? psz_dir : "", disksize));
+    free(psz_dir);
     if(!var_InheritBool(obj, "adaptive-use-access")) /* only use http from access */
         m->addFactory(new LibVLCHTTPConnectionFactory(auth));
     m->addFactory(new StreamUrlConnectionFactory());
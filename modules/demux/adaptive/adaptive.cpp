@@ -39,7 +39,7 @@
 
 #include "../dash/DASHManager.h"
 #include "../dash/DASHStream.hpp"
-#include "../dash/mpd/IsoffMainParser.h"
+#include "../dash/mpd/IsoffStreamParser.h"
 
 #include "../hls/HLSManager.hpp"
 #include "../hls/HLSStreams.hpp"
@@ -85,10 +85,29 @@ static void Close   (vlc_object_t *);
 #define ADAPT_LOWLATENCY_TEXT N_("Low latency")
 #define ADAPT_LOWLATENCY_LONGTEXT N_("Overrides low latency parameters")
 
+#define ADAPT_WORKERS_TEXT N_("Concurrent downloads")
+#define ADAPT_WORKERS_LONGTEXT N_("Maximum number of segments downloaded " \
+    "at the same time, across all streams")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments prefetch")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of segments of each stream to " \
+    "request ahead of the one being demuxed")
+
+#define ADAPT_CACHE_TEXT N_("Segments cache size (MiB)")
+#define ADAPT_CACHE_LONGTEXT N_("Memory used to keep downloaded segments " \
+    "for seeking back, 0 to disable")
+
+#define ADAPT_CACHEDIR_TEXT N_("Segments cache directory")
+#define ADAPT_CACHEDIR_LONGTEXT N_("Keeps segments dropped from memory on " \
+    "disk, also for later playbacks")
+
+#define ADAPT_CACHEDISK_TEXT N_("Segments cache directory size (MiB)")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::LogicType::Default,
                                 AbstractAdaptationLogic::LogicType::Predictive,
                                 AbstractAdaptationLogic::LogicType::NearOptimal,
+                                AbstractAdaptationLogic::LogicType::Hybrid,
                                 AbstractAdaptationLogic::LogicType::RateBased,
                                 AbstractAdaptationLogic::LogicType::FixedRate,
                                 AbstractAdaptationLogic::LogicType::AlwaysLowest,
@@ -98,6 +117,7 @@ static const char *const ppsz_logics_values[] = {
                                 "",
                                 "predictive",
                                 "nearoptimal",
+                                "hybrid",
                                 "rate",
                                 "fixedrate",
                                 "lowest",
@@ -106,6 +126,7 @@ static const char *const ppsz_logics_values[] = {
 static const char *const ppsz_logics[] = { N_("Default"),
                                            N_("Predictive"),
                                            N_("Near Optimal"),
+                                           N_("Buffer and Throughput Hybrid"),
                                            N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
@@ -144,13 +165,23 @@ vlc_module_begin ()
                      ADAPT_MAXBUFFER_TEXT, nullptr );
         add_integer( "adaptive-lowlatency", -1, ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT );
             change_integer_list(rgi_latency, ppsz_latency)
+        add_integer_with_range( "adaptive-workers", 2, 1, 16,
+                                ADAPT_WORKERS_TEXT, ADAPT_WORKERS_LONGTEXT )
+        add_integer_with_range( "adaptive-prefetch", 1, 0, 8,
+                                ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT )
+        add_integer_with_range( "adaptive-cache-size", 32, 0, 1024,
+                                ADAPT_CACHE_TEXT, ADAPT_CACHE_LONGTEXT )
+        add_directory( "adaptive-cache-dir", nullptr,
+                       ADAPT_CACHEDIR_TEXT, ADAPT_CACHEDIR_LONGTEXT )
+        add_integer_with_range( "adaptive-cache-disk-size", 256, 0, 65536,
+                                ADAPT_CACHEDISK_TEXT, nullptr )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
-static PlaylistManager * HandleDash(demux_t *, DOMParser &,
+static PlaylistManager * HandleDash(demux_t *,
                                     const std::string &, AbstractAdaptationLogic::LogicType);
 static PlaylistManager * HandleSmooth(demux_t *, DOMParser &,
                                       const std::string &, AbstractAdaptationLogic::LogicType);
@@ -212,7 +243,7 @@ static int Open(vlc_object_t *p_obj)
         DOMParser xmlParser; /* Share that xml reader */
         if(dashmime)
         {
-            p_manager = HandleDash(p_demux, xmlParser, playlisturl, logic);
+            p_manager = HandleDash(p_demux, playlisturl, logic);
         }
         else if(smoothmime)
         {
@@ -232,7 +263,7 @@ static int Open(vlc_object_t *p_obj)
                     {
                         if(DASHManager::isDASH(xmlParser.getRootNode()))
                         {
-                            p_manager = HandleDash(p_demux, xmlParser, playlisturl, logic);
+                            p_manager = HandleDash(p_demux, playlisturl, logic);
                         }
                         else if(SmoothManager::isSmoothStreaming(xmlParser.getRootNode()))
                         {
@@ -279,21 +310,15 @@ static void Close(vlc_object_t *p_obj)
 /*****************************************************************************
  *
  *****************************************************************************/
-static PlaylistManager * HandleDash(demux_t *p_demux, DOMParser &xmlParser,
+static PlaylistManager * HandleDash(demux_t *p_demux,
                                     const std::string & playlisturl,
                                     AbstractAdaptationLogic::LogicType logic)
 {
-    if(!xmlParser.reset(p_demux->s) || !xmlParser.parse(true))
-    {
-        msg_Err(p_demux, "Cannot parse MPD");
-        return nullptr;
-    }
-    IsoffMainParser mpdparser(xmlParser.getRootNode(), VLC_OBJECT(p_demux),
-                              p_demux->s, playlisturl);
-    MPD *p_playlist = mpdparser.parse();
+    IsoffStreamParser mpdparser(VLC_OBJECT(p_demux), p_demux->s, playlisturl);
+    MPD *p_playlist = mpdparser.parse(true);
     if(p_playlist == nullptr)
     {
-        msg_Err( p_demux, "Cannot create/unknown MPD for profile");
+        msg_Err(p_demux, "Cannot parse MPD");
         return nullptr;
     }
 
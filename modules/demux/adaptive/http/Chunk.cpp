@@ -156,6 +156,7 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManag
     prepared = false;
     eof = false;
     sourceid = id;
+    sequence = 0;
     setUseAccess(access);
     setIdentifier(url, range);
     if(!init(url))
@@ -223,8 +224,18 @@ block_t * HTTPChunkSource::read(size_t readsize)
         return nullptr;
     }
 
-    ssize_t ret = connection->read(p_block->p_buffer, readsize);
-    if(ret < 0)
+    /* Connections can return less than available in the end */
+    size_t filled = 0;
+    ssize_t ret;
+    while((ret = connection->read(&p_block->p_buffer[filled],
+                                  readsize - filled)) > 0)
+    {
+        filled += ret;
+        if(filled == readsize)
+            break;
+    }
+
+    if(ret < 0 && filled == 0)
     {
         block_Release(p_block);
         p_block = nullptr;
@@ -233,9 +244,10 @@ block_t * HTTPChunkSource::read(size_t readsize)
     }
     else
     {
-        p_block->i_buffer = (size_t) ret;
+        ret = filled;
+        p_block->i_buffer = filled;
         consumed += p_block->i_buffer;
-        if((size_t)ret < readsize)
+        if(filled < readsize)
         {
             eof = true;
             downloadEndTime = vlc_tick_now();
@@ -340,9 +352,13 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
 {
     done = false;
     eof = false;
+    complete = false;
     held = false;
     p_read = nullptr;
     inblockreadoffset = 0;
+    activeBytes = 0;
+    activeTime = 0;
+    b_drained = true;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -384,6 +400,47 @@ void HTTPChunkBufferedSource::release()
     avail.signal();
 }
 
+/* Hands over the whole content, once completely downloaded */
+block_t * HTTPChunkBufferedSource::detach()
+{
+    mutex_locker locker {lock};
+    if(!done || !complete || !p_head)
+        return nullptr;
+    block_t *p_data = block_ChainGather(p_head);
+    p_head = nullptr;
+    p_read = nullptr;
+    pp_tail = &p_head;
+    inblockreadoffset = 0;
+    buffered = consumed = 0;
+    return p_data;
+}
+
+/* Chunked transfers of live segments stall whenever the origin has sent
+ * everything produced so far. Waiting for the next chunk says nothing of the
+ * throughput, and would lower the estimate down to the media bitrate.
+ * A read following one that drained the connection is considered idle when
+ * it takes much longer than the current throughput accounts for. */
+#define IDLE_GAP_MIN    VLC_TICK_FROM_MS(20)
+#define IDLE_GAP_FACTOR 4
+
+void HTTPChunkBufferedSource::accountRead(size_t size, vlc_tick_t time, bool b_drains)
+{
+    bool b_idle = false;
+    if(b_drained && time > IDLE_GAP_MIN)
+    {
+        b_idle = activeBytes == 0 ||
+                 time > IDLE_GAP_FACTOR * (vlc_tick_t)
+                        ((uint64_t) size * activeTime / activeBytes);
+    }
+
+    if(!b_idle)
+    {
+        activeBytes += size;
+        activeTime += time;
+    }
+    b_drained = b_drains;
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     {
@@ -417,35 +474,63 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_tick_t latency;
     } rate = {0,0,0};
 
+    /* Returns as soon as some data arrived, so that low latency chunks are
+     * handed over to the demuxer without waiting for the next ones */
+    const vlc_tick_t readStartTime = vlc_tick_now();
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
-    if(ret <= 0)
+    const vlc_tick_t readTime = vlc_tick_now() - readStartTime;
+
+    if(ret > 0 && (size_t) ret < readsize / 2)
     {
-        block_Release(p_block);
-        p_block = nullptr;
-        mutex_locker locker {lock};
-        done = true;
-        downloadEndTime = vlc_tick_now();
-        rate.size = buffered;
-        rate.time = downloadEndTime - requestStartTime;
-        rate.latency = responseTime - requestStartTime;
+        /* don't keep the whole allocation for a few packets */
+        block_t *p_fit = block_Alloc(ret);
+        if(p_fit)
+        {
+            memcpy(p_fit->p_buffer, p_block->p_buffer, ret);
+            block_Release(p_block);
+            p_block = p_fit;
+        }
     }
-    else
+
     {
-        p_block->i_buffer = (size_t) ret;
         mutex_locker locker {lock};
-        buffered += p_block->i_buffer;
-        block_ChainLastAppend(&pp_tail, p_block);
-        if(p_read == nullptr)
+        if(ret <= 0)
         {
-            p_read = p_block;
-            inblockreadoffset = 0;
+            block_Release(p_block);
+            p_block = nullptr;
+            done = true;
+            /* unknown length ends on a clean close */
+            complete = (ret == 0 && !contentLength);
         }
-        if((size_t) ret < readsize)
+        else
+        {
+            p_block->i_buffer = (size_t) ret;
+            buffered += p_block->i_buffer;
+            block_ChainLastAppend(&pp_tail, p_block);
+            if(p_read == nullptr)
+            {
+                p_read = p_block;
+                inblockreadoffset = 0;
+            }
+            accountRead(ret, readTime, (size_t) ret < readsize);
+            if(contentLength && buffered >= contentLength)
+                done = complete = true;
+        }
+
+        if(done)
         {
-            done = true;
             downloadEndTime = vlc_tick_now();
-            rate.size = buffered;
-            rate.time = downloadEndTime - requestStartTime;
+            if(!contentLength && activeTime)
+            {
+                /* chunked transfer, maybe produced as it was sent */
+                rate.size = activeBytes;
+                rate.time = activeTime;
+            }
+            else
+            {
+                rate.size = buffered;
+                rate.time = downloadEndTime - requestStartTime;
+            }
             rate.latency = responseTime - requestStartTime;
         }
     }
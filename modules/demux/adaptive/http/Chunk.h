@@ -145,6 +145,7 @@ namespace adaptive
                 bool                prepared;
                 bool                eof;
                 ID                  sourceid;
+                uint64_t            sequence; /* segment number */
                 vlc_tick_t          requestStartTime;
                 vlc_tick_t          responseTime;
                 vlc_tick_t          downloadEndTime;
@@ -174,8 +175,10 @@ namespace adaptive
                 bool               isDone() const;
                 void               hold();
                 void               release();
+                block_t *          detach();
 
             private:
+                void               accountRead(size_t, vlc_tick_t, bool);
                 block_t            *p_head; /* read cache buffer */
                 block_t           **pp_tail;
                 const block_t      *p_read;
@@ -183,8 +186,12 @@ namespace adaptive
                 size_t              buffered; /* read cache size */
                 bool                done;
                 bool                eof;
+                bool                complete; /* all content was received */
                 vlc::threads::condition_variable avail;
                 bool                held;
+                size_t              activeBytes; /* received while not idle */
+                vlc_tick_t          activeTime;
+                bool                b_drained; /* last read got all there was */
         };
 
         class HTTPChunk : public AbstractChunk
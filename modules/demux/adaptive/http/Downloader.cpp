@@ -25,27 +25,25 @@
 
 #include <vlc_threads.h>
 
-#include <atomic>
+#include <algorithm>
 
 using namespace adaptive::http;
 
 Downloader::Downloader()
 {
     killed = false;
-    thread_handle_valid = false;
-    current = nullptr;
-    cancel_current = false;
 }
 
-bool Downloader::start()
+bool Downloader::start(unsigned workers)
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(threads.size() < workers)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            return !threads.empty();
+        threads.push_back(thread_handle);
     }
-    thread_handle_valid = true;
     return true;
 }
 
@@ -53,7 +51,7 @@ Downloader::~Downloader()
 {
     kill();
 
-    if(thread_handle_valid)
+    for(vlc_thread_t thread_handle : threads)
         vlc_join(thread_handle, nullptr);
 }
 
@@ -61,7 +59,7 @@ void Downloader::kill()
 {
     vlc::threads::mutex_locker locker {lock};
     killed = true;
-    wait_cond.signal();
+    wait_cond.broadcast();
 }
 
 void Downloader::schedule(HTTPChunkBufferedSource *source)
@@ -75,13 +73,14 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc::threads::mutex_locker locker {lock};
-    while (current == source)
+    if(std::find(current.begin(), current.end(), source) != current.end())
     {
-        cancel_current = true;
-        updated_cond.wait(lock);
+        /* the worker releases it */
+        cancelled.push_back(source);
+        while(std::find(current.begin(), current.end(), source) != current.end())
+            updated_cond.wait(lock);
     }
-
-    if(!source->isDone())
+    else if(std::find(chunks.begin(), chunks.end(), source) != chunks.end())
     {
         chunks.remove(source);
         source->release();
@@ -95,33 +94,50 @@ void * Downloader::downloaderThread(void *opaque)
     return nullptr;
 }
 
+/* Streams are served in parallel before the segments of any single stream:
+ * pick the oldest chunk of a stream with no download in progress, if any. */
+HTTPChunkBufferedSource * Downloader::getNextChunk() const
+{
+    for(HTTPChunkBufferedSource *source : chunks)
+    {
+        if(std::none_of(current.begin(), current.end(),
+                        [source](const HTTPChunkBufferedSource *other)
+                        { return other->sourceid == source->sourceid; }))
+            return source;
+    }
+    return chunks.empty() ? nullptr : chunks.front();
+}
+
 void Downloader::Run()
 {
+    lock.lock();
     while(1)
     {
-        lock.lock();
+        HTTPChunkBufferedSource *source = nullptr;
 
-        while(chunks.empty() && !killed)
+        while(!killed && (source = getNextChunk()) == nullptr)
             wait_cond.wait(lock);
 
         if(killed)
-        {
-            lock.unlock();
             break;
-        }
 
-        current = chunks.front();
-        lock.unlock();
-        current->bufferize(HTTPChunkSource::CHUNK_SIZE);
-        lock.lock();
-        if(current->isDone() || cancel_current)
+        chunks.remove(source);
+        current.push_back(source);
+
+        bool b_cancel;
+        do
         {
-            chunks.pop_front();
-            current->release();
-        }
-        cancel_current = false;
-        current = nullptr;
-        updated_cond.signal();
-        lock.unlock();
+            lock.unlock();
+            source->bufferize(HTTPChunkSource::CHUNK_SIZE);
+            lock.lock();
+            b_cancel = std::find(cancelled.begin(), cancelled.end(),
+                                 source) != cancelled.end();
+        } while(!source->isDone() && !b_cancel && !killed);
+
+        current.remove(source);
+        cancelled.remove(source);
+        source->release();
+        updated_cond.broadcast();
     }
+    lock.unlock();
 }
@@ -29,10 +29,13 @@
 #include "HTTPConnection.hpp"
 #include "ConnectionParams.hpp"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 #include "tools/Debug.hpp"
 #include <vlc_url.h>
 #include <vlc_http.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
 AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
@@ -60,6 +63,11 @@ void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid,
     }
 }
 
+void AbstractConnectionManager::updatePosition(const adaptive::ID &, uint64_t)
+{
+
+}
+
 void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
 {
     rateObserver = obs;
@@ -70,23 +78,25 @@ void AbstractConnectionManager::deleteSource(AbstractChunkSource *source)
     delete source;
 }
 
-HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_)
+HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_,
+                                                 unsigned workers)
     : AbstractConnectionManager( p_object_ ),
       localAllowed(false)
 {
     vlc_mutex_init(&lock);
     downloader = new Downloader();
     downloaderhp = new Downloader();
-    downloader->start();
+    /* Segments of all streams share the workers pool */
+    downloader->start(std::max(workers, 1U));
     downloaderhp->start();
-    cache_total = 0;
-    cache_max = 1 << 19;
+    cache = new SegmentCache(p_object, DEFAULT_CACHE_SIZE);
 }
 
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     delete downloader;
     delete downloaderhp;
+    delete cache;
     this->closeAllConnections();
     while(!factories.empty())
     {
@@ -160,72 +170,51 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
     return conn;
 }
 
-AbstractChunkSource *HTTPConnectionManager::makeSource(const std::string &url,
-                                                       const ID &id, ChunkType type,
-                                                       const BytesRange &range)
+static bool IsCacheable(ChunkType type)
 {
-    StorageID storageid = HTTPChunkSource::makeStorageID(url, range);
     switch(type)
     {
         case ChunkType::Init:
         case ChunkType::Index:
-            for(HTTPChunkBufferedSource *s : cache)
-            {
-                if(s->getStorageID() == storageid)
-                {
-                    cache.remove(s);
-                    cache_total -= s->contentLength;
-                    CacheDebug(msg_Dbg(p_object, "Cache GET '%s' usage %u bytes",
-                                       storageid.c_str(), cache_total));
-                    return s;
-                }
-            }
-            // fallthrough
         case ChunkType::Segment:
+            return true;
         case ChunkType::Key:
         case ChunkType::Playlist:
         default:
-            return new HTTPChunkBufferedSource(url, this, id, type, range);
+            return false;
     }
 }
 
-void HTTPConnectionManager::recycleSource(AbstractChunkSource *source)
+AbstractChunkSource *HTTPConnectionManager::makeSource(const std::string &url,
+                                                       const ID &id, ChunkType type,
+                                                       const BytesRange &range,
+                                                       uint64_t sequence)
 {
-    bool b_cacheable;
-    switch(source->getChunkType())
+    if(IsCacheable(type))
     {
-        case ChunkType::Index:
-        case ChunkType::Init:
-            b_cacheable = true;
-            break;
-        case ChunkType::Key:
-        case ChunkType::Playlist:
-        case ChunkType::Segment:
-        default:
-            b_cacheable = false;
-            break;
+        StorageID storageid = HTTPChunkSource::makeStorageID(url, range);
+        AbstractChunkSource *cached = cache->get(this, storageid, id, sequence,
+                                                 type, range);
+        if(cached)
+            return cached;
     }
+    HTTPChunkBufferedSource *source = new HTTPChunkBufferedSource(url, this, id, type, range);
+    source->sequence = sequence;
+    return source;
+}
 
+void HTTPConnectionManager::recycleSource(AbstractChunkSource *source)
+{
     HTTPChunkBufferedSource *buf = dynamic_cast<HTTPChunkBufferedSource *>(source);
-    if(buf && b_cacheable && !buf->getStorageID().empty() &&
-       buf->contentLength < cache_max)
+    if(buf && IsCacheable(buf->getChunkType()) && !buf->getStorageID().empty())
     {
-        while(cache_max < cache_total + buf->contentLength)
-        {
-            HTTPChunkBufferedSource *purged = cache.back();
-            cache.pop_back();
-            cache_total -= purged->contentLength;
-            CacheDebug(msg_Dbg(p_object, "Cache DEL '%s' usage %u bytes",
-                               purged->getStorageID().c_str(), cache_total));
-            deleteSource(purged);
-        }
-        cache.push_front(buf);
-        cache_total += buf->contentLength;
-        CacheDebug(msg_Dbg(p_object, "Cache PUT '%s' usage %u bytes",
-                           buf->getStorageID().c_str(), cache_total));
+        const std::string contentType = buf->getContentType();
+        block_t *data = buf->detach();
+        if(data)
+            cache->put(buf->getStorageID(), buf->sourceid, buf->sequence,
+                       buf->getChunkType(), data, contentType);
     }
-    else
-        deleteSource(source);
+    deleteSource(source);
 }
 
 Downloader * HTTPConnectionManager::getDownloadQueue(const AbstractChunkSource *source) const
@@ -257,6 +246,11 @@ void HTTPConnectionManager::cancel(AbstractChunkSource *source)
         getDownloadQueue(src)->cancel(src);
 }
 
+void HTTPConnectionManager::updatePosition(const ID &id, uint64_t sequence)
+{
+    cache->updatePosition(id, sequence);
+}
+
 void HTTPConnectionManager::setLocalConnectionsAllowed()
 {
     localAllowed = true;
@@ -266,3 +260,14 @@ void HTTPConnectionManager::addFactory(AbstractConnectionFactory *factory)
 {
     factories.push_back(factory);
 }
+
+void HTTPConnectionManager::setCache(SegmentCache *c)
+{
+    delete cache;
+    cache = c;
+}
+
+SegmentCache * HTTPConnectionManager::getCache() const
+{
+    return cache;
+}
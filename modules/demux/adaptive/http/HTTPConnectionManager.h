@@ -44,6 +44,7 @@ namespace adaptive
         class Downloader;
         class AbstractChunkSource;
         class HTTPChunkBufferedSource;
+        class SegmentCache;
         enum class ChunkType;
 
         class AbstractConnectionManager : public IDownloadRateObserver
@@ -55,11 +56,13 @@ namespace adaptive
                 virtual AbstractConnection * getConnection(ConnectionParams &) = 0;
                 virtual AbstractChunkSource *makeSource(const std::string &,
                                                         const ID &, ChunkType,
-                                                        const BytesRange &) = 0;
+                                                        const BytesRange &,
+                                                        uint64_t = 0) = 0;
                 virtual void recycleSource(AbstractChunkSource *) = 0;
 
                 virtual void start(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
+                virtual void updatePosition(const ID &, uint64_t);
 
                 virtual void updateDownloadRate(const ID &, size_t,
                                                 vlc_tick_t, vlc_tick_t) override;
@@ -76,20 +79,27 @@ namespace adaptive
         class HTTPConnectionManager : public AbstractConnectionManager
         {
             public:
-                HTTPConnectionManager           (vlc_object_t *p_object);
+                HTTPConnectionManager           (vlc_object_t *p_object,
+                                                 unsigned workers = 1);
                 virtual ~HTTPConnectionManager  ();
 
                 virtual void    closeAllConnections ()  override;
                 virtual AbstractConnection * getConnection(ConnectionParams &)  override;
                 virtual AbstractChunkSource *makeSource(const std::string &,
                                                         const ID &, ChunkType,
-                                                        const BytesRange &) override;
+                                                        const BytesRange &,
+                                                        uint64_t = 0) override;
                 virtual void recycleSource(AbstractChunkSource *) override;
 
                 virtual void start(AbstractChunkSource *)  override;
                 virtual void cancel(AbstractChunkSource *)  override;
+                virtual void updatePosition(const ID &, uint64_t) override;
                 void         setLocalConnectionsAllowed();
                 void         addFactory(AbstractConnectionFactory *);
+                void         setCache(SegmentCache *);
+                SegmentCache *getCache() const;
+
+                static const size_t DEFAULT_CACHE_SIZE = 1 << 19;
 
             private:
                 void    releaseAllConnections ();
@@ -101,9 +111,7 @@ namespace adaptive
                 bool                                                localAllowed;
                 AbstractConnection * reuseConnection(ConnectionParams &);
                 Downloader * getDownloadQueue(const AbstractChunkSource *) const;
-                std::list<HTTPChunkBufferedSource *> cache;
-                unsigned cache_total;
-                unsigned cache_max;
+                SegmentCache                                       *cache;
         };
     }
 }
@@ -0,0 +1,472 @@
+/*
+ * SegmentCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SegmentCache.hpp"
+#include "HTTPConnectionManager.h"
+#include "../tools/Debug.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sys/stat.h>
+
+using namespace adaptive;
+using namespace adaptive::http;
+using vlc::threads::mutex_locker;
+
+#define DISK_MAGIC      "VLC adaptive segment 1"
+#define DISK_SUFFIX     ".seg"
+#define DISK_MAX_HEADER 65536
+
+CachedChunkSource::CachedChunkSource(AbstractConnectionManager *manager,
+                                     const StorageID &storageid,
+                                     ChunkType t, const BytesRange &range,
+                                     const std::shared_ptr<block_t> &block,
+                                     const std::string &type)
+    : AbstractChunkSource(t, range)
+    , connManager(manager)
+    , data(block)
+    , contentType(type)
+    , consumed(0)
+{
+    storeid = storageid;
+    contentLength = data->i_buffer;
+}
+
+block_t * CachedChunkSource::readBlock()
+{
+    return read(HTTPChunkSource::CHUNK_SIZE);
+}
+
+block_t * CachedChunkSource::read(size_t size)
+{
+    size = std::min(size, data->i_buffer - consumed);
+    if(size == 0)
+        return nullptr;
+    block_t *p_block = block_Alloc(size);
+    if(p_block)
+    {
+        memcpy(p_block->p_buffer, &data->p_buffer[consumed], size);
+        consumed += size;
+    }
+    return p_block;
+}
+
+bool CachedChunkSource::hasMoreData() const
+{
+    return consumed < data->i_buffer;
+}
+
+size_t CachedChunkSource::getBytesRead() const
+{
+    return consumed;
+}
+
+std::string CachedChunkSource::getContentType() const
+{
+    return contentType;
+}
+
+void CachedChunkSource::recycle()
+{
+    connManager->recycleSource(this);
+}
+
+SegmentCache::SegmentCache(vlc_object_t *obj, size_t memorysize,
+                           const std::string &dir, size_t disksize)
+    : p_obj(obj)
+    , memoryMax(memorysize)
+    , memoryTotal(0)
+    , directory(dir)
+    , diskMax(disksize)
+    , diskTotal(0)
+    , useCounter(0)
+    , stats()
+{
+    if(diskEnabled())
+        scanDisk();
+}
+
+SegmentCache::~SegmentCache()
+{
+    msg_Dbg(p_obj, "segment cache %u hits (%u from disk), %u misses, "
+                   "%zu KiB not downloaded again",
+            stats.hits, stats.diskHits, stats.misses, stats.served / 1024);
+}
+
+bool SegmentCache::diskEnabled() const
+{
+    return !directory.empty() && diskMax > 0;
+}
+
+/* Segments of a stream are compared against its own position, using the
+ * segments numbers which are shared by all its representations */
+uint64_t SegmentCache::distance(const Entry &entry) const
+{
+    std::map<ID, uint64_t>::const_iterator it = positions.find(entry.id);
+    if(it == positions.end())
+        return std::numeric_limits<uint64_t>::max();
+    return entry.sequence > (*it).second ? entry.sequence - (*it).second
+                                         : (*it).second - entry.sequence;
+}
+
+std::unordered_map<StorageID, SegmentCache::Entry>::iterator SegmentCache::victim()
+{
+    std::unordered_map<StorageID, Entry>::iterator ret = entries.end();
+    bool retpinned = true;
+    uint64_t retdistance = 0;
+    for(auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        const Entry &entry = (*it).second;
+        /* init and index segments are needed for every media segment */
+        const bool pinned = entry.type != ChunkType::Segment;
+        const uint64_t d = pinned ? 0 : distance(entry);
+        if(ret == entries.end() ||
+           (retpinned && !pinned) ||
+           (pinned == retpinned && (d > retdistance ||
+                                    (d == retdistance &&
+                                     entry.lastUse < (*ret).second.lastUse))))
+        {
+            ret = it;
+            retpinned = pinned;
+            retdistance = d;
+        }
+    }
+    return ret;
+}
+
+void SegmentCache::insert(const StorageID &storageid, Entry &entry,
+                          std::vector<Demoted> &demoted)
+{
+    const size_t size = entry.data->i_buffer;
+    if(size > memoryMax)
+    {
+        if(diskEnabled() && !entry.onDisk)
+            demoted.push_back(Demoted(storageid, entry));
+        return;
+    }
+
+    std::unordered_map<StorageID, Entry>::iterator it = entries.find(storageid);
+    if(it != entries.end())
+    {
+        memoryTotal -= (*it).second.data->i_buffer;
+        entries.erase(it);
+    }
+
+    while(memoryTotal + size > memoryMax)
+    {
+        it = victim();
+        Entry &purged = (*it).second;
+        /* do not drop nearer segments for a farther one */
+        if(entry.type == ChunkType::Segment && purged.type == ChunkType::Segment &&
+           distance(entry) > distance(purged))
+        {
+            if(diskEnabled() && !entry.onDisk)
+                demoted.push_back(Demoted(storageid, entry));
+            return;
+        }
+        CacheDebug(msg_Dbg(p_obj, "Cache DEL '%s' usage %zu bytes",
+                           (*it).first.c_str(), memoryTotal));
+        memoryTotal -= purged.data->i_buffer;
+        if(diskEnabled() && !purged.onDisk)
+            demoted.push_back(Demoted((*it).first, purged));
+        entries.erase(it);
+        stats.evictions++;
+    }
+
+    entry.lastUse = ++useCounter;
+    entries.insert(std::pair<StorageID, Entry>(storageid, entry));
+    memoryTotal += size;
+    CacheDebug(msg_Dbg(p_obj, "Cache PUT '%s' usage %zu bytes",
+                       storageid.c_str(), memoryTotal));
+}
+
+AbstractChunkSource * SegmentCache::get(AbstractConnectionManager *manager,
+                                        const StorageID &storageid, const ID &id,
+                                        uint64_t sequence, ChunkType type,
+                                        const BytesRange &range)
+{
+    Entry entry;
+    {
+        mutex_locker locker {lock};
+        std::unordered_map<StorageID, Entry>::iterator it = entries.find(storageid);
+        if(it != entries.end())
+        {
+            (*it).second.lastUse = ++useCounter;
+            entry = (*it).second;
+            stats.hits++;
+            stats.served += entry.data->i_buffer;
+            CacheDebug(msg_Dbg(p_obj, "Cache GET '%s'", storageid.c_str()));
+            return new CachedChunkSource(manager, storageid, type, range,
+                                         entry.data, entry.contentType);
+        }
+        if(!diskEnabled() || disk.find(diskPath(storageid)) == disk.end())
+        {
+            stats.misses++;
+            return nullptr;
+        }
+    }
+
+    /* read outside of the lock, the file can only be replaced atomically */
+    entry.id = id;
+    entry.sequence = sequence;
+    entry.type = type;
+    entry.onDisk = true;
+    const bool b_read = readDisk(storageid, entry);
+
+    std::vector<Demoted> demoted;
+    {
+        mutex_locker locker {lock};
+        if(!b_read)
+        {
+            stats.misses++;
+            return nullptr;
+        }
+        std::map<std::string, DiskEntry>::iterator it = disk.find(diskPath(storageid));
+        if(it != disk.end())
+            (*it).second.lastUse = ++useCounter;
+        stats.hits++;
+        stats.diskHits++;
+        stats.served += entry.data->i_buffer;
+        insert(storageid, entry, demoted);
+    }
+    storeDisk(demoted);
+
+    return new CachedChunkSource(manager, storageid, type, range,
+                                 entry.data, entry.contentType);
+}
+
+void SegmentCache::put(const StorageID &storageid, const ID &id, uint64_t sequence,
+                       ChunkType type, block_t *block, const std::string &contenttype)
+{
+    if(block->i_buffer == 0)
+    {
+        block_Release(block);
+        return;
+    }
+
+    Entry entry;
+    entry.data = std::shared_ptr<block_t>(block, block_Release);
+    entry.contentType = contenttype;
+    entry.id = id;
+    entry.sequence = sequence;
+    entry.type = type;
+    entry.onDisk = false;
+
+    std::vector<Demoted> demoted;
+    {
+        mutex_locker locker {lock};
+        insert(storageid, entry, demoted);
+    }
+    storeDisk(demoted);
+}
+
+void SegmentCache::updatePosition(const ID &id, uint64_t sequence)
+{
+    mutex_locker locker {lock};
+    positions[id] = sequence;
+}
+
+SegmentCacheStats SegmentCache::getStats() const
+{
+    mutex_locker locker {lock};
+    return stats;
+}
+
+size_t SegmentCache::getMemoryUsage() const
+{
+    mutex_locker locker {lock};
+    return memoryTotal;
+}
+
+size_t SegmentCache::getDiskUsage() const
+{
+    mutex_locker locker {lock};
+    return diskTotal;
+}
+
+std::string SegmentCache::diskPath(const StorageID &storageid) const
+{
+    /* FNV-1a, the file holds the full key against collisions */
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for(unsigned char c : storageid)
+    {
+        hash ^= c;
+        hash *= UINT64_C(0x100000001b3);
+    }
+    char name[16 + sizeof(DISK_SUFFIX)];
+    snprintf(name, sizeof(name), "%016" PRIx64 DISK_SUFFIX, hash);
+    return directory + DIR_SEP + name;
+}
+
+static bool ReadLine(FILE *f, std::string &line)
+{
+    line.clear();
+    int c;
+    while((c = getc(f)) != EOF && c != '\n')
+    {
+        if(line.size() >= DISK_MAX_HEADER)
+            return false;
+        line.push_back(c);
+    }
+    return c == '\n';
+}
+
+bool SegmentCache::readDisk(const StorageID &storageid, Entry &entry) const
+{
+    FILE *f = vlc_fopen(diskPath(storageid).c_str(), "rb");
+    if(!f)
+        return false;
+
+    bool b_ret = false;
+    std::string magic, key;
+    struct stat st;
+    if(ReadLine(f, magic) && magic == DISK_MAGIC &&
+       ReadLine(f, key) && key == storageid &&
+       ReadLine(f, entry.contentType) &&
+       fstat(fileno(f), &st) == 0)
+    {
+        long offset = ftell(f);
+        if(offset >= 0 && st.st_size > offset)
+        {
+            const size_t size = st.st_size - offset;
+            block_t *block = block_Alloc(size);
+            if(block)
+            {
+                if(fread(block->p_buffer, 1, size, f) == size)
+                {
+                    entry.data = std::shared_ptr<block_t>(block, block_Release);
+                    b_ret = true;
+                }
+                else block_Release(block);
+            }
+        }
+    }
+    fclose(f);
+    return b_ret;
+}
+
+size_t SegmentCache::writeDisk(const StorageID &storageid, const Entry &entry) const
+{
+    const std::string path = diskPath(storageid);
+    const std::string temp = path + ".tmp";
+    FILE *f = vlc_fopen(temp.c_str(), "wb");
+    if(!f)
+        return 0;
+
+    const std::string header = std::string(DISK_MAGIC "\n") + storageid + '\n' +
+                               entry.contentType + '\n';
+    bool b_ret = fwrite(header.data(), 1, header.size(), f) == header.size() &&
+                 fwrite(entry.data->p_buffer, 1, entry.data->i_buffer, f) == entry.data->i_buffer;
+    b_ret &= (fclose(f) == 0);
+    if(b_ret)
+        b_ret = vlc_rename(temp.c_str(), path.c_str()) == 0;
+    if(!b_ret)
+    {
+        vlc_unlink(temp.c_str());
+        return 0;
+    }
+    return header.size() + entry.data->i_buffer;
+}
+
+void SegmentCache::storeDisk(std::vector<Demoted> &demoted)
+{
+    for(Demoted &d : demoted)
+    {
+        const size_t size = writeDisk(d.first, d.second);
+        if(size == 0)
+        {
+            msg_Warn(p_obj, "can't store segment in cache directory %s", directory.c_str());
+            continue;
+        }
+
+        mutex_locker locker {lock};
+        const std::string path = diskPath(d.first);
+        DiskEntry &diskentry = disk[path];
+        diskTotal -= diskentry.size;
+        diskentry.size = size;
+        diskentry.lastUse = ++useCounter;
+        diskTotal += diskentry.size;
+        trimDisk();
+    }
+    demoted.clear();
+}
+
+void SegmentCache::trimDisk()
+{
+    while(diskTotal > diskMax)
+    {
+        auto lru = std::min_element(disk.begin(), disk.end(),
+                        [](const std::pair<const std::string, DiskEntry> &a,
+                           const std::pair<const std::string, DiskEntry> &b)
+                        { return a.second.lastUse < b.second.lastUse; });
+        vlc_unlink((*lru).first.c_str());
+        diskTotal -= (*lru).second.size;
+        disk.erase(lru);
+    }
+}
+
+/* Index what previous sessions left, oldest first */
+void SegmentCache::scanDisk()
+{
+    vlc_mkdir(directory.c_str(), 0700);
+    DIR *dir = vlc_opendir(directory.c_str());
+    if(!dir)
+    {
+        msg_Warn(p_obj, "can't open cache directory %s", directory.c_str());
+        directory.clear();
+        return;
+    }
+
+    std::vector<std::pair<time_t, std::string>> files;
+    const char *name;
+    while((name = vlc_readdir(dir)))
+    {
+        const size_t len = strlen(name);
+        if(len != 16 + strlen(DISK_SUFFIX) ||
+           strcmp(&name[16], DISK_SUFFIX))
+            continue;
+        const std::string path = directory + DIR_SEP + name;
+        struct stat st;
+        if(vlc_stat(path.c_str(), &st) || !S_ISREG(st.st_mode))
+            continue;
+        files.push_back(std::make_pair(st.st_mtime, path));
+        disk[path].size = st.st_size;
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end());
+    for(const auto &file : files)
+    {
+        DiskEntry &diskentry = disk[file.second];
+        diskentry.lastUse = ++useCounter;
+        diskTotal += diskentry.size;
+    }
+
+    trimDisk();
+}
@@ -0,0 +1,144 @@
+/*
+ * SegmentCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEGMENTCACHE_HPP
+#define SEGMENTCACHE_HPP
+
+#include "Chunk.h"
+#include "../ID.hpp"
+
+#include <vlc_common.h>
+#include <vlc_cxx_helpers.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace adaptive
+{
+    namespace http
+    {
+        /* Serves a cached download, without any connection */
+        class CachedChunkSource : public AbstractChunkSource
+        {
+            friend class SegmentCache;
+
+            public:
+                virtual ~CachedChunkSource() = default;
+                virtual block_t *   readBlock       () override;
+                virtual block_t *   read            (size_t) override;
+                virtual bool        hasMoreData     () const override;
+                virtual size_t      getBytesRead    () const override;
+                virtual std::string getContentType  () const override;
+                virtual void        recycle() override;
+
+            protected:
+                CachedChunkSource(AbstractConnectionManager *, const StorageID &,
+                                  ChunkType, const BytesRange &,
+                                  const std::shared_ptr<block_t> &, const std::string &);
+
+            private:
+                AbstractConnectionManager *connManager;
+                std::shared_ptr<block_t> data;
+                std::string contentType;
+                size_t consumed;
+        };
+
+        struct SegmentCacheStats
+        {
+            unsigned hits;      /* including disk ones */
+            unsigned diskHits;
+            unsigned misses;
+            unsigned evictions; /* from memory */
+            size_t   served;    /* bytes not downloaded again */
+        };
+
+        /* Completed downloads of init, index and media segments, keyed by
+         * URL and byte range, shared by all the streams of a manager.
+         * The memory tier drops the segments farthest from the position of
+         * their stream first, so that both seeking back and the segments
+         * ahead hit, and keeps init segments as long as it can.
+         * The optional disk tier receives what memory drops, and outlives
+         * the manager, so that restarting playback hits it as well. */
+        class SegmentCache
+        {
+            public:
+                SegmentCache(vlc_object_t *, size_t memorysize,
+                             const std::string &directory = std::string(),
+                             size_t disksize = 0);
+                ~SegmentCache();
+
+                AbstractChunkSource * get(AbstractConnectionManager *, const StorageID &,
+                                          const ID &, uint64_t, ChunkType,
+                                          const BytesRange &);
+                void put(const StorageID &, const ID &, uint64_t, ChunkType,
+                         block_t *, const std::string &);
+                void updatePosition(const ID &, uint64_t);
+                SegmentCacheStats getStats() const;
+                size_t getMemoryUsage() const;
+                size_t getDiskUsage() const;
+
+            private:
+                struct Entry
+                {
+                    std::shared_ptr<block_t> data;
+                    std::string contentType;
+                    ID id;
+                    ChunkType type;
+                    uint64_t sequence;
+                    uint64_t lastUse;
+                    bool onDisk;
+                };
+                struct DiskEntry
+                {
+                    size_t size;
+                    uint64_t lastUse;
+                };
+                using Demoted = std::pair<StorageID, Entry>;
+
+                bool diskEnabled() const;
+                void insert(const StorageID &, Entry &, std::vector<Demoted> &);
+                std::unordered_map<StorageID, Entry>::iterator victim();
+                uint64_t distance(const Entry &) const;
+                void scanDisk();
+                std::string diskPath(const StorageID &) const;
+                bool readDisk(const StorageID &, Entry &) const;
+                size_t writeDisk(const StorageID &, const Entry &) const;
+                void storeDisk(std::vector<Demoted> &);
+                void trimDisk();
+
+                vlc_object_t *p_obj;
+                mutable vlc::threads::mutex lock;
+                std::unordered_map<StorageID, Entry> entries;
+                std::map<ID, uint64_t> positions;
+                size_t memoryMax;
+                size_t memoryTotal;
+                std::string directory;
+                std::map<std::string, DiskEntry> disk; /* by path */
+                size_t diskMax;
+                size_t diskTotal;
+                uint64_t useCounter;
+                SegmentCacheStats stats;
+        };
+    }
+}
+
+#endif // SEGMENTCACHE_HPP
@@ -47,6 +47,7 @@ AbstractBufferingLogic::AbstractBufferingLogic()
     userMinBuffering = 0;
     userMaxBuffering = 0;
     userLiveDelay = 0;
+    userPrefetchDepth = 0;
 }
 
 void AbstractBufferingLogic::setLowDelay(bool b)
@@ -69,6 +70,11 @@ void AbstractBufferingLogic::setUserLiveDelay(vlc_tick_t v)
     userLiveDelay = v;
 }
 
+void AbstractBufferingLogic::setUserPrefetchDepth(unsigned v)
+{
+    userPrefetchDepth = v;
+}
+
 /* Try to never buffer up to really end */
 /* Enforce no overlap for demuxers segments 3.0.0 */
 /* FIXME: check duration instead ? */
@@ -152,6 +158,14 @@ vlc_tick_t DefaultBufferingLogic::getStableBuffering(const BasePlaylist *p) cons
     return std::min(getMinBuffering(p) * 2, max);
 }
 
+unsigned DefaultBufferingLogic::getPrefetchDepth(const BasePlaylist *p) const
+{
+    /* Segments past the live edge are not available yet */
+    if(isLowLatency(p))
+        return 0;
+    return userPrefetchDepth;
+}
+
 uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *rep) const
 {
     BasePlaylist *playlist = rep->getPlaylist();
@@ -163,6 +177,13 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
     SegmentBase *segmentBase = rep->inheritSegmentBase();
     SegmentTemplate *mediaSegmentTemplate = rep->inheritSegmentTemplate();
 
+    /* Chunked low latency segments are announced available before their
+     * completion, and delivered as they are produced: no need to stay a
+     * few segments behind the edge. */
+    const vlc_tick_t availabilityoffset = rep->inheritAvailabilityTimeOffset();
+    const unsigned edgeoffset = rep->inheritAvailabilityTimeComplete()
+                              ? SAFETY_BUFFERING_EDGE_OFFSET : 0;
+
     SegmentTimeline *timeline;
     if(mediaSegmentTemplate)
         timeline = mediaSegmentTemplate->inheritSegmentTimeline();
@@ -179,7 +200,7 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
         uint64_t safeMinElementNumber = timeline->minElementNumber();
         uint64_t safeMaxElementNumber = timeline->maxElementNumber();
         stime_t safeedgetime, safestarttime, duration;
-        for(unsigned i=0; i<SAFETY_BUFFERING_EDGE_OFFSET; i++)
+        for(unsigned i=0; i<edgeoffset; i++)
         {
             if(safeMinElementNumber == safeMaxElementNumber)
                 break;
@@ -242,7 +263,7 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
         {
             /* Compute playback offset and effective finished segment from wall time */
             vlc_tick_t now = vlc_tick_from_sec(time(nullptr));
-            vlc_tick_t playbacktime = now - i_buffering;
+            vlc_tick_t playbacktime = now + availabilityoffset - i_buffering;
             vlc_tick_t minavailtime = playlist->availabilityStartTime.Get() + rep->getPeriodStart();
             const uint64_t startnumber = mediaSegmentTemplate->inheritStartNumber();
             const Timescale timescale = mediaSegmentTemplate->inheritTimescale();
@@ -273,7 +294,7 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
             }
 
             const uint64_t max_safety_offset = playbacktime - minavailtime / duration;
-            const uint64_t safety_offset = std::min((uint64_t)SAFETY_BUFFERING_EDGE_OFFSET,
+            const uint64_t safety_offset = std::min((uint64_t)edgeoffset,
                                                     max_safety_offset);
             if(startnumber + safety_offset <= start)
                 start -= safety_offset;
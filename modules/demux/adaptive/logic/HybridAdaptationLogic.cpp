@@ -0,0 +1,379 @@
+/*
+ * HybridAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HybridAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../playlist/BasePeriod.h"
+#include "../tools/Debug.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+/*
+ * Throughput rule while the buffer is low, BOLA once it has built up,
+ * as in the DYNAMIC strategy of dash.js
+ * From Throughput Prediction to Rate Adaptation: BOLA-E / DYNAMIC
+ * https://arxiv.org/abs/1912.10016
+ */
+
+#define minimumBufferS      VLC_TICK_FROM_SEC(6)  /* Qmin */
+#define bufferPerLevelS     VLC_TICK_FROM_SEC(2)
+#define bufferBasedEnterS   VLC_TICK_FROM_SEC(10)
+#define bufferBasedLeaveS   VLC_TICK_FROM_SEC(6)
+#define throughputSafety    0.9
+
+ThroughputAverage::ThroughputAverage(vlc_tick_t h)
+    : halflife( h )
+    , estimate( 0.0 )
+    , weight( 0.0 )
+{ }
+
+void ThroughputAverage::push(unsigned bps, vlc_tick_t time)
+{
+    const double alpha = std::pow(0.5, (double) time / halflife);
+    estimate = alpha * estimate + (1.0 - alpha) * bps;
+    weight = alpha * weight + (1.0 - alpha);
+}
+
+unsigned ThroughputAverage::get() const
+{
+    /* zero bias correction of the first samples */
+    return weight > 0.0 ? estimate / weight : 0;
+}
+
+HybridContext::HybridContext()
+    : buffering_level( 0 )
+    , buffering_target( 0 )
+    , buffering_max( 0 )
+    , fast( VLC_TICK_FROM_SEC(3) )
+    , slow( VLC_TICK_FROM_SEC(8) )
+    , last_download_rate( 0 )
+    , b_buffer_based( false )
+    , placeholder( 0 )
+{ }
+
+HybridAdaptationLogic::HybridAdaptationLogic(vlc_object_t *obj)
+    : AbstractAdaptationLogic(obj)
+    , currentBps( 0 )
+    , usedBps( 0 )
+{
+    vlc_mutex_init(&lock);
+}
+
+HybridAdaptationLogic::~HybridAdaptationLogic()
+{
+}
+
+namespace
+{
+/* BOLA parameters, with utilities normalized to 1 for the lowest bitrate */
+class BolaParameters
+{
+    public:
+        BolaParameters(uint64_t lowestbw, uint64_t highestbw,
+                       unsigned levels, vlc_tick_t target)
+            : lowest( lowestbw )
+        {
+            const double Qmin = secf_from_vlc_tick(minimumBufferS);
+            const double Qmax = secf_from_vlc_tick(std::max(target,
+                                          minimumBufferS + bufferPerLevelS * levels));
+            gp = (utility(highestbw) - 1.0) / (Qmax / Qmin - 1.0);
+            Vp = Qmin / gp;
+        }
+
+        double utility(uint64_t bw) const
+        {
+            return std::log((double) bw / lowest) + 1.0;
+        }
+
+        double score(uint64_t bw, double Q) const
+        {
+            return (Vp * (utility(bw) + gp) - Q) / bw;
+        }
+
+        /* lowest buffer level at which bw is preferred to all lower ones */
+        double minimumLevel(BaseAdaptationSet *adaptSet, RepresentationSelector &selector,
+                            const BaseRepresentation *rep) const
+        {
+            double level = 0.0;
+            const uint64_t bw = rep->getBandwidth();
+            BaseRepresentation *prev = nullptr;
+            for(BaseRepresentation *lower = selector.lowest(adaptSet);
+                lower && lower != prev && lower->getBandwidth() < bw;
+                lower = selector.higher(adaptSet, lower))
+            {
+                const uint64_t lbw = lower->getBandwidth();
+                level = std::max(level, Vp * (gp + (bw * utility(lbw) - lbw * utility(bw))
+                                                   / (double)(bw - lbw)));
+                prev = lower;
+            }
+            return level;
+        }
+
+    private:
+        uint64_t lowest;
+        double gp;
+        double Vp;
+};
+}
+
+BaseRepresentation *
+HybridAdaptationLogic::getBufferBased(BaseAdaptationSet *adaptSet, RepresentationSelector &selector,
+                                      HybridContext &ctx, BaseRepresentation *prevRep) const
+{
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    unsigned levels = 0;
+    BaseRepresentation *prev = nullptr;
+    for(BaseRepresentation *rep = lowest; rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        levels++;
+        prev = rep;
+    }
+
+    const BolaParameters bola(lowest->getBandwidth(), highest->getBandwidth(),
+                              levels, ctx.buffering_max);
+
+    /* Switching from the throughput rule, make up for the missing buffer
+     * so that BOLA starts from the current quality instead of dropping */
+    if(ctx.placeholder < 0)
+    {
+        ctx.placeholder = 0;
+        if(prevRep)
+        {
+            vlc_tick_t level = vlc_tick_from_sec(bola.minimumLevel(adaptSet, selector, prevRep));
+            if(level > ctx.buffering_level)
+                ctx.placeholder = level - ctx.buffering_level;
+        }
+    }
+
+    vlc_tick_t virtuallevel = ctx.buffering_level + ctx.placeholder;
+    if(ctx.buffering_max && virtuallevel > ctx.buffering_max)
+        virtuallevel = std::max(ctx.buffering_level, ctx.buffering_max);
+    const double Q = secf_from_vlc_tick(virtuallevel);
+
+    BaseRepresentation *ret = nullptr;
+    double argmax = 0.0;
+    prev = nullptr;
+    for(BaseRepresentation *rep = lowest; rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        double arg = bola.score(rep->getBandwidth(), Q);
+        if(ret == nullptr || argmax <= arg)
+        {
+            ret = rep;
+            argmax = arg;
+        }
+        prev = rep;
+    }
+    return ret;
+}
+
+BaseRepresentation *HybridAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet, BaseRepresentation *prevRep)
+{
+    RepresentationSelector selector(maxwidth, maxheight);
+
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    if(lowest == nullptr || highest == nullptr)
+        return nullptr;
+
+    if(lowest == highest)
+        return lowest;
+
+    vlc_mutex_lock(&lock);
+
+    std::map<ID, HybridContext>::iterator it = streams.find(adaptSet->getID());
+    if(it == streams.end() || currentBps == 0)
+    {
+        vlc_mutex_unlock(&lock);
+        BaseRepresentation *m = lowest;
+        /* Handle HLS specific cases where the lowest is audio only. Try to pick first A+V */
+        BaseRepresentation *n = selector.higher(adaptSet, m);
+        if(m != n && m->getCodecs().size() == 1 && n->getCodecs().size() > 1)
+            m = n;
+        return m;
+    }
+    HybridContext &ctx = (*it).second;
+
+    const unsigned bps = getAvailableBw(currentBps, prevRep) * throughputSafety;
+    BaseRepresentation *m = selector.select(adaptSet, bps);
+
+    /* Hysteresis between the two rules, scaled down for short buffers */
+    vlc_tick_t enter = bufferBasedEnterS;
+    vlc_tick_t leave = bufferBasedLeaveS;
+    if(ctx.buffering_target)
+    {
+        enter = std::min(enter, ctx.buffering_target);
+        leave = std::min(leave, ctx.buffering_target / 2);
+    }
+
+    if(!ctx.b_buffer_based && ctx.buffering_level >= enter)
+    {
+        ctx.b_buffer_based = true;
+        ctx.placeholder = -1;
+    }
+    else if(ctx.b_buffer_based && ctx.buffering_level < leave)
+    {
+        ctx.b_buffer_based = false;
+        ctx.placeholder = 0;
+    }
+
+    if(ctx.b_buffer_based)
+    {
+        BaseRepresentation *b = getBufferBased(adaptSet, selector, ctx, prevRep);
+        /* BOLA-O: never step up beyond what the throughput can sustain */
+        if(b->getBandwidth() > m->getBandwidth())
+        {
+            if(prevRep && prevRep->getBandwidth() > m->getBandwidth() &&
+               prevRep->getBandwidth() < b->getBandwidth())
+                b = prevRep;
+            else if(!prevRep || prevRep->getBandwidth() <= m->getBandwidth())
+                b = m;
+        }
+        m = b;
+    }
+
+    BwDebug( msg_Info(p_obj, "%s buffering level %.2f%% rep %ld kBps %u kBps",
+             ctx.b_buffer_based ? "BOLA" : "throughput",
+             (float) 100 * ctx.buffering_level / ctx.buffering_target,
+             m->getBandwidth()/8000, bps / 8000); );
+
+    vlc_mutex_unlock(&lock);
+
+    return m;
+}
+
+unsigned HybridAdaptationLogic::getAvailableBw(unsigned i_bw, const BaseRepresentation *curRep) const
+{
+    unsigned i_remain = i_bw;
+    if(i_remain > usedBps)
+        i_remain -= usedBps;
+    else
+        i_remain = 0;
+    if(curRep)
+        i_remain += curRep->getBandwidth();
+    return i_remain > i_bw ? i_bw : i_remain;
+}
+
+unsigned HybridAdaptationLogic::getMaxCurrentBw() const
+{
+    unsigned i_max_bitrate = 0;
+    for(std::map<ID, HybridContext>::const_iterator it = streams.begin();
+                                                    it != streams.end(); ++it)
+        i_max_bitrate = std::max(i_max_bitrate, ((*it).second).last_download_rate);
+    return i_max_bitrate;
+}
+
+void HybridAdaptationLogic::updateDownloadRate(const ID &id, size_t dlsize,
+                                               vlc_tick_t time, vlc_tick_t)
+{
+    if(unlikely(time == 0))
+        return;
+    const unsigned bps = CLOCK_FREQ * dlsize * 8 / time;
+    vlc_mutex_lock(&lock);
+    std::map<ID, HybridContext>::iterator it = streams.find(id);
+    if(it != streams.end())
+    {
+        HybridContext &ctx = (*it).second;
+        ctx.fast.push(bps, time);
+        ctx.slow.push(bps, time);
+        /* react quickly to drops, slowly to increases */
+        ctx.last_download_rate = std::min(ctx.fast.get(), ctx.slow.get());
+    }
+    currentBps = getMaxCurrentBw();
+    vlc_mutex_unlock(&lock);
+}
+
+void HybridAdaptationLogic::trackerEvent(const TrackerEvent &ev)
+{
+    switch(ev.getType())
+    {
+    case TrackerEvent::Type::RepresentationSwitch:
+        {
+            const RepresentationSwitchEvent &event =
+                    static_cast<const RepresentationSwitchEvent &>(ev);
+            vlc_mutex_lock(&lock);
+            if(event.prev)
+                usedBps -= event.prev->getBandwidth();
+            if(event.next)
+                usedBps += event.next->getBandwidth();
+            BwDebug(msg_Info(p_obj, "New total bandwidth usage %u kBps", (usedBps / 8000)));
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case TrackerEvent::Type::BufferingStateUpdate:
+        {
+            const BufferingStateUpdatedEvent &event =
+                    static_cast<const BufferingStateUpdatedEvent &>(ev);
+            const ID &id = *event.id;
+            vlc_mutex_lock(&lock);
+            if(event.enabled)
+            {
+                if(streams.find(id) == streams.end())
+                {
+                    HybridContext ctx;
+                    streams.insert(std::pair<ID, HybridContext>(id, ctx));
+                }
+            }
+            else
+            {
+                std::map<ID, HybridContext>::iterator it = streams.find(id);
+                if(it != streams.end())
+                    streams.erase(it);
+                currentBps = getMaxCurrentBw();
+            }
+            vlc_mutex_unlock(&lock);
+            BwDebug(msg_Info(p_obj, "Stream %s is now known %sactive", id.str().c_str(),
+                         (event.enabled) ? "" : "in"));
+        }
+        break;
+
+    case TrackerEvent::Type::BufferingLevelChange:
+        {
+            const BufferingLevelChangedEvent &event =
+                    static_cast<const BufferingLevelChangedEvent &>(ev);
+            const ID &id = *event.id;
+            vlc_mutex_lock(&lock);
+            std::map<ID, HybridContext>::iterator it = streams.find(id);
+            if(it != streams.end())
+            {
+                HybridContext &ctx = (*it).second;
+                ctx.buffering_level = event.current;
+                ctx.buffering_target = event.target;
+                ctx.buffering_max = event.maximum;
+            }
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    default:
+            break;
+    }
+}
@@ -93,7 +93,7 @@ SegmentChunk* ISegment::toChunk(SharedResources *res, size_t index, BaseRepresen
     AbstractChunkSource *source = res->getConnManager()->makeSource(url,
                                                           rep->getAdaptationSet()->getID(),
                                                           chunkType,
-                                                          range);
+                                                          range, index);
     if(source)
     {
         SegmentChunk *chunk = createChunk(source, rep);
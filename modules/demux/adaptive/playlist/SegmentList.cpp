@@ -30,6 +30,7 @@
 #include "SegmentInformation.hpp"
 #include "SegmentTimeline.h"
 
+#include <algorithm>
 #include <limits>
 #include <cassert>
 
@@ -41,6 +42,7 @@ SegmentList::SegmentList( SegmentInformation *parent_, bool b_relative ):
 {
     totalLength = 0;
     b_relative_mediatimes = b_relative;
+    windowStart = std::numeric_limits<uint64_t>::max();
 }
 SegmentList::~SegmentList()
 {
@@ -65,19 +67,12 @@ Segment * SegmentList::getMediaSegment(uint64_t number) const
         return segments.at(listindex);
     }
 
-    std::vector<Segment *>::const_iterator it = segments.begin();
-    for(it = segments.begin(); it != segments.end(); ++it)
-    {
-        Segment *seg = *it;
-        if(seg->getSequenceNumber() == number)
-        {
-            return seg;
-        }
-        else if (seg->getSequenceNumber() > number)
-        {
-            break;
-        }
-    }
+    /* ordered by sequence number, with possible gaps */
+    auto it = std::lower_bound(segments.cbegin(), segments.cend(), number,
+                               [](const Segment *seg, uint64_t n)
+                               { return seg->getSequenceNumber() < n; });
+    if(it != segments.cend() && (*it)->getSequenceNumber() == number)
+        return *it;
     return nullptr;
 }
 
@@ -96,11 +91,29 @@ void SegmentList::updateWith(AbstractMultipleSegmentBaseType *updated_,
     AbstractMultipleSegmentBaseType::updateWith(updated_);
 
     SegmentList *updated = dynamic_cast<SegmentList *>(updated_);
-    if(!updated || updated->segments.empty())
+    if(!updated)
         return;
 
     b_restamp = b_relative_mediatimes;
 
+    /* Only the entries following ours were listed in the update */
+    if(updated->windowStart != std::numeric_limits<uint64_t>::max() &&
+       !segments.empty())
+    {
+        pruneBySegmentNumber(updated->windowStart);
+        if(!segments.empty() && !b_relative_mediatimes)
+        {
+            /* times are relative to the window start, as on a full update */
+            const stime_t offset = segments.front()->startTime.Get();
+            for(Segment *seg : segments)
+                seg->startTime.Set(seg->startTime.Get() - offset);
+        }
+        b_restamp = true;
+    }
+
+    if(updated->segments.empty())
+        return;
+
     if(!b_restamp || segments.empty())
     {
         if(!segments.empty())
@@ -113,7 +126,8 @@ void SegmentList::updateWith(AbstractMultipleSegmentBaseType *updated_,
     else
     {
         const Segment * prevSegment = segments.back();
-        const uint64_t oldest = updated->segments.front()->getSequenceNumber();
+        const uint64_t oldest = std::min(updated->windowStart,
+                                         updated->segments.front()->getSequenceNumber());
 
         /* filter out known segments from the update */
         updated->pruneBySegmentNumber(prevSegment->getSequenceNumber() + 1);
@@ -155,17 +169,22 @@ void SegmentList::pruneByPlaybackTime(vlc_tick_t time)
 void SegmentList::pruneBySegmentNumber(uint64_t tobelownum)
 {
     std::vector<Segment *>::iterator it = segments.begin();
-    while(it != segments.end())
+    for(; it != segments.end(); ++it)
     {
         Segment *seg = *it;
 
         if(seg->getSequenceNumber() >= tobelownum)
             break;
 
-        totalLength -= (*it)->duration.Get();
-        delete *it;
-        it = segments.erase(it);
+        totalLength -= seg->duration.Get();
+        delete seg;
     }
+    segments.erase(segments.begin(), it);
+}
+
+void SegmentList::setWindowStart(uint64_t number)
+{
+    windowStart = number;
 }
 
 bool SegmentList::getPlaybackTimeDurationBySegmentNumber(uint64_t number,
@@ -47,6 +47,9 @@ namespace adaptive
                                                    bool = false) override;
                 void                    pruneBySegmentNumber(uint64_t);
                 void                    pruneByPlaybackTime(vlc_tick_t);
+                /* first entry of the manifest, when known entries are
+                 * not listed again in an update */
+                void                    setWindowStart(uint64_t);
                 stime_t                 getTotalLength() const;
                 bool                    hasRelativeMediaTimes() const;
 
@@ -64,6 +67,7 @@ namespace adaptive
                 std::vector<Segment *>  segments;
                 stime_t totalLength;
                 bool b_relative_mediatimes;
+                uint64_t windowStart;
         };
     }
 }
@@ -53,16 +53,18 @@ using namespace hls::playlist;
 class DummyLogic : public AbstractAdaptationLogic
 {
     public:
-        DummyLogic() : AbstractAdaptationLogic(nullptr), repindex(0) {}
+        DummyLogic() : AbstractAdaptationLogic(nullptr), repindex(0), queries(0) {}
         virtual ~DummyLogic() = default;
         virtual BaseRepresentation* getNextRepresentation(BaseAdaptationSet *set,
                                                           BaseRepresentation *) override
         {
+            queries++;
             if(set->getRepresentations().size() <= repindex)
                 return nullptr;
             return set->getRepresentations().at(repindex);
         }
         unsigned repindex;
+        unsigned queries;
 };
 
 class DummyChunkSource : public AbstractChunkSource
@@ -120,7 +122,8 @@ class DummyConnectionManager : public AbstractConnectionManager
         virtual AbstractConnection * getConnection(ConnectionParams &) override { return nullptr; }
         virtual AbstractChunkSource *makeSource(const std::string &uri,
                                                 const ID &, ChunkType t,
-                                                const BytesRange &br) override
+                                                const BytesRange &br,
+                                                uint64_t) override
         {
             DummyChunkSource *d;
             auto it = data.find(uri);
@@ -581,11 +584,13 @@ static int SegmentTracker_check_switches(BaseAdaptationSet *adaptSet,
         delete currentChunk;
         currentChunk = nullptr;
 
-        /* ask logic to switch back */
+        /* ask logic to switch back, the logic being queried once per chunk */
         logic->repindex = 0;
         events.reset();
+        unsigned queries = logic->queries;
         currentChunk = tracker->getNextChunk(true);
         Expect(currentChunk);
+        Expect(logic->queries == queries + 1);
         Expect(events.occured(TrackerEvent::Type::RepresentationSwitch) == true);
         Expect(events.representationchanged.prev == rep1);
         Expect(events.representationchanged.next == rep0);
@@ -747,6 +752,7 @@ static int Prepare_test(testfunc func)
 
     SharedResources sharedRes(nullptr, nullptr, connManager);
     DefaultBufferingLogic bufLogic;
+    bufLogic.setUserPrefetchDepth(1); /* also run with prefetched chunks */
     SynchronizationReferences syncRefs;
 
     BaseAdaptationSet *adaptSet = CreatePlaylistPeriodAdaptationSet();
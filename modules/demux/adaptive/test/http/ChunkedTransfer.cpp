@@ -0,0 +1,174 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../http/HTTPConnectionManager.h"
+#include "../../http/HTTPConnection.hpp"
+#include "../../http/Chunk.h"
+#include "../../logic/IDownloadRateObserver.h"
+#include "../../ID.hpp"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+/* Stand-in for a low latency origin, sending a segment over chunked transfer
+ * while the encoder produces it, one CMAF chunk (moof/mdat pair) at a time.
+ * The link is much faster than the media bitrate. */
+#define CHUNKS         8
+#define CHUNK_BYTES    (16 * 1024)
+#define CHUNK_INTERVAL VLC_TICK_FROM_MS(50)
+#define PACKET_BYTES   1536
+#define LINK_BPS       (8 * 1024 * 1024) /* bytes per second */
+
+class LiveEncoderConnection : public AbstractConnection
+{
+    public:
+        LiveEncoderConnection()
+            : AbstractConnection(nullptr), start(0) {}
+        virtual ~LiveEncoderConnection() = default;
+
+        virtual bool canReuse(const ConnectionParams &) const override
+        {
+            return available;
+        }
+
+        virtual RequestStatus request(const std::string &,
+                                      const BytesRange &) override
+        {
+            /* the segment is being produced, its length is unknown */
+            start = vlc_tick_now();
+            contentLength = 0;
+            bytesRead = 0;
+            return RequestStatus::Success;
+        }
+
+        virtual ssize_t read(void *p_buffer, size_t len) override
+        {
+            if(bytesRead == CHUNKS * CHUNK_BYTES)
+                return 0;
+
+            /* wait for the encoder to output the chunk being sent */
+            const size_t chunk = bytesRead / CHUNK_BYTES;
+            vlc_tick_wait(start + chunk * CHUNK_INTERVAL);
+
+            len = std::min(len, (size_t) PACKET_BYTES);
+            len = std::min(len, (chunk + 1) * CHUNK_BYTES - bytesRead);
+            vlc_tick_sleep(vlc_tick_from_samples(len, LINK_BPS));
+            std::memset(p_buffer, chunk, len);
+            bytesRead += len;
+            return len;
+        }
+
+        virtual void setUsed(bool b) override
+        {
+            available = !b;
+        }
+
+    private:
+        vlc_tick_t start;
+};
+
+class LiveEncoderConnectionFactory : public AbstractConnectionFactory
+{
+    public:
+        virtual ~LiveEncoderConnectionFactory() = default;
+        virtual AbstractConnection * createConnection(vlc_object_t *,
+                                                      const ConnectionParams &) override
+        {
+            return new LiveEncoderConnection();
+        }
+};
+
+class RateRecorder : public IDownloadRateObserver
+{
+    public:
+        RateRecorder() : size(0), time(0) {}
+        virtual void updateDownloadRate(const ID &, size_t s,
+                                        vlc_tick_t t, vlc_tick_t) override
+        {
+            size += s;
+            time += t;
+        }
+        size_t size;
+        vlc_tick_t time;
+};
+
+int ChunkedTransfer_test()
+{
+    try
+    {
+        RateRecorder recorder;
+        HTTPConnectionManager manager(nullptr);
+        manager.addFactory(new LiveEncoderConnectionFactory());
+        manager.setDownloadRateObserver(&recorder);
+
+        vlc_tick_t start = vlc_tick_now();
+        AbstractChunkSource *source =
+            manager.makeSource("http://localhost/live/1.m4s", ID("video"),
+                               ChunkType::Segment, BytesRange());
+        Expect(source);
+        manager.start(source);
+
+        vlc_tick_t firstblock = 0;
+        size_t total = 0;
+        block_t *block;
+        while((block = source->readBlock()))
+        {
+            if(block->i_buffer && !firstblock)
+                firstblock = vlc_tick_now() - start;
+            for(size_t i = 0; i < block->i_buffer; i++)
+                Expect(block->p_buffer[i] == (total + i) / CHUNK_BYTES);
+            total += block->i_buffer;
+            block_Release(block);
+        }
+        vlc_tick_t elapsed = vlc_tick_now() - start;
+        manager.recycleSource(source);
+
+        Expect(total == CHUNKS * CHUNK_BYTES);
+        /* Chunks are handed over as they arrive, not at the segment end */
+        Expect(elapsed >= (CHUNKS - 1) * CHUNK_INTERVAL);
+        Expect(firstblock < CHUNK_INTERVAL);
+
+        /* The estimate is the link throughput, not the media bitrate */
+        Expect(recorder.time > 0);
+        const size_t estimate = CLOCK_FREQ * recorder.size / recorder.time;
+        const size_t mediarate = CLOCK_FREQ * CHUNK_BYTES / CHUNK_INTERVAL;
+        std::cerr << "  first chunk after " << MS_FROM_VLC_TICK(firstblock)
+                  << " ms, estimate " << estimate * 8 / 1000
+                  << " kb/s for media at " << mediarate * 8 / 1000
+                  << " kb/s" << std::endl;
+        Expect(estimate > 10 * mediarate);
+    } catch (...) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../http/HTTPConnectionManager.h"
+#include "../../http/HTTPConnection.hpp"
+#include "../../http/Chunk.h"
+#include "../../ID.hpp"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+/* Stand-in for a distant HTTP server: every request costs a round trip, and
+ * each connection is capped in throughput as TCP is on high latency links. */
+struct StandInServer
+{
+    vlc_tick_t rtt;
+    size_t bytesPerSecond;
+    size_t segmentSize;
+};
+
+class StandInConnection : public AbstractConnection
+{
+    public:
+        StandInConnection(const StandInServer &s)
+            : AbstractConnection(nullptr), server(s), fill(0) {}
+        virtual ~StandInConnection() = default;
+
+        virtual bool canReuse(const ConnectionParams &p) const override
+        {
+            return available && p.getHostname() == params.getHostname();
+        }
+
+        virtual RequestStatus request(const std::string &path,
+                                      const BytesRange &) override
+        {
+            vlc_tick_sleep(server.rtt);
+            /* path is /<stream>/<segment number> */
+            fill = std::stoul(path.substr(path.rfind('/') + 1));
+            contentLength = server.segmentSize;
+            bytesRead = 0;
+            return RequestStatus::Success;
+        }
+
+        virtual ssize_t read(void *p_buffer, size_t len) override
+        {
+            len = std::min(len, contentLength - bytesRead);
+            if(len)
+                vlc_tick_sleep(vlc_tick_from_samples(len, server.bytesPerSecond));
+            std::memset(p_buffer, fill, len);
+            bytesRead += len;
+            return len;
+        }
+
+        virtual void setUsed(bool b) override
+        {
+            available = !b;
+        }
+
+    private:
+        const StandInServer &server;
+        uint8_t fill;
+};
+
+class StandInConnectionFactory : public AbstractConnectionFactory
+{
+    public:
+        StandInConnectionFactory(const StandInServer &s) : server(s) {}
+        virtual ~StandInConnectionFactory() = default;
+        virtual AbstractConnection * createConnection(vlc_object_t *,
+                                                      const ConnectionParams &) override
+        {
+            return new StandInConnection(server);
+        }
+
+    private:
+        const StandInServer &server;
+};
+
+#define STREAMS  2
+#define SEGMENTS 6
+
+struct Results
+{
+    vlc_tick_t startup; /* until the first segment of every stream is read */
+    vlc_tick_t total;
+    size_t bytes;
+};
+
+/* Plays the streams as the demuxer would, one segment of each stream in turn,
+ * while keeping prefetch segments of each stream requested ahead. */
+static Results Download_run(const StandInServer &server, unsigned workers,
+                            unsigned prefetch)
+{
+    static const char *const names[STREAMS] = { "audio", "video" };
+    HTTPConnectionManager manager(nullptr, workers);
+    manager.addFactory(new StandInConnectionFactory(server));
+
+    std::deque<AbstractChunkSource *> queues[STREAMS];
+    unsigned requested[STREAMS] = { 0 };
+    Results results = { 0, 0, 0 };
+
+    vlc_tick_t start = vlc_tick_now();
+
+    for(unsigned segment = 0; segment < SEGMENTS; segment++)
+    {
+        /* All streams want their next segment at about the same time */
+        for(unsigned i = 0; i < STREAMS; i++)
+        {
+            while(requested[i] < SEGMENTS && queues[i].size() <= prefetch)
+            {
+                std::string url = std::string("http://localhost/") + names[i] +
+                                  "/" + std::to_string(requested[i]++);
+                AbstractChunkSource *source =
+                    manager.makeSource(url, ID(names[i]), ChunkType::Segment,
+                                       BytesRange());
+                Expect(source);
+                manager.start(source);
+                queues[i].push_back(source);
+            }
+        }
+
+        for(unsigned i = 0; i < STREAMS; i++)
+        {
+            AbstractChunkSource *source = queues[i].front();
+            queues[i].pop_front();
+
+            block_t *block;
+            while((block = source->readBlock()))
+            {
+                for(size_t j = 0; j < block->i_buffer; j++)
+                    Expect(block->p_buffer[j] == segment);
+                results.bytes += block->i_buffer;
+                block_Release(block);
+            }
+            manager.recycleSource(source);
+        }
+
+        if(segment == 0)
+            results.startup = vlc_tick_now() - start;
+    }
+
+    results.total = vlc_tick_now() - start;
+    Expect(results.bytes == STREAMS * SEGMENTS * server.segmentSize);
+    return results;
+}
+
+static void Download_print(const char *name, const Results &results)
+{
+    std::cerr << "  " << name << ": startup "
+              << MS_FROM_VLC_TICK(results.startup) << " ms, sustained "
+              << results.bytes * 8 / (1 + MS_FROM_VLC_TICK(results.total))
+              << " kb/s" << std::endl;
+}
+
+int Downloader_test()
+{
+    StandInServer server;
+    server.rtt = VLC_TICK_FROM_MS(20);
+    server.bytesPerSecond = 2 * 1024 * 1024;
+    server.segmentSize = 20 * 1024;
+
+    try
+    {
+        Results serial = Download_run(server, 1, 0);
+        Results pool = Download_run(server, 4, 1);
+
+        Download_print("serial", serial);
+        Download_print("pool", pool);
+
+        /* Both streams are fetched at once, and the next segments are
+         * requested while the current ones are read. */
+        Expect(pool.startup < serial.startup);
+        Expect(pool.total < serial.total);
+    } catch (...) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../http/HTTPConnectionManager.h"
+#include "../../http/HTTPConnection.hpp"
+#include "../../http/SegmentCache.hpp"
+#include "../../http/Chunk.h"
+#include "../../ID.hpp"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_fs.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+#define SEGMENT_SIZE (100 * 1024)
+#define INIT_SIZE    (1024)
+
+/* Stand-in for an origin counting the requests it serves. Content only
+ * depends on the path, a truncated path closes the connection midway. */
+struct CountingOrigin
+{
+    unsigned requests;
+};
+
+static uint8_t ContentByte(const std::string &path, size_t offset)
+{
+    return (path.size() * 31 + offset * 7 + path.back()) & 0xFF;
+}
+
+class CountingConnection : public AbstractConnection
+{
+    public:
+        CountingConnection(CountingOrigin &o)
+            : AbstractConnection(nullptr), origin(o), truncated(false) {}
+        virtual ~CountingConnection() = default;
+
+        virtual bool canReuse(const ConnectionParams &) const override
+        {
+            return available;
+        }
+
+        virtual RequestStatus request(const std::string &p,
+                                      const BytesRange &) override
+        {
+            origin.requests++;
+            path = p;
+            truncated = path.find("truncated") != std::string::npos;
+            contentLength = path.find("init") != std::string::npos ? INIT_SIZE
+                                                                  : SEGMENT_SIZE;
+            bytesRead = 0;
+            return RequestStatus::Success;
+        }
+
+        virtual ssize_t read(void *p_buffer, size_t len) override
+        {
+            size_t end = truncated ? contentLength / 2 : contentLength;
+            len = std::min(len, end - bytesRead);
+            uint8_t *p = static_cast<uint8_t *>(p_buffer);
+            for(size_t i = 0; i < len; i++)
+                p[i] = ContentByte(path, bytesRead + i);
+            bytesRead += len;
+            return len;
+        }
+
+        virtual void setUsed(bool b) override
+        {
+            available = !b;
+        }
+
+    private:
+        CountingOrigin &origin;
+        std::string path;
+        bool truncated;
+};
+
+class CountingConnectionFactory : public AbstractConnectionFactory
+{
+    public:
+        CountingConnectionFactory(CountingOrigin &o) : origin(o) {}
+        virtual ~CountingConnectionFactory() = default;
+        virtual AbstractConnection * createConnection(vlc_object_t *,
+                                                      const ConnectionParams &) override
+        {
+            return new CountingConnection(origin);
+        }
+
+    private:
+        CountingOrigin &origin;
+};
+
+static std::string SegmentUrl(unsigned i)
+{
+    return "http://origin/video/" + std::to_string(i) + ".m4s";
+}
+
+/* Reads the whole content, checking it, as the demuxer would */
+static size_t Fetch(HTTPConnectionManager &manager, const std::string &url,
+                    ChunkType type, uint64_t sequence = 0)
+{
+    const std::string path = url.substr(url.find('/', 7));
+    AbstractChunkSource *source = manager.makeSource(url, ID("video"), type,
+                                                     BytesRange(), sequence);
+    Expect(source);
+    manager.start(source);
+    size_t total = 0;
+    block_t *block;
+    while((block = source->readBlock()))
+    {
+        for(size_t i = 0; i < block->i_buffer; i++)
+            Expect(block->p_buffer[i] == ContentByte(path, total + i));
+        total += block->i_buffer;
+        block_Release(block);
+    }
+    manager.recycleSource(source);
+    return total;
+}
+
+static int Manager_test()
+{
+    CountingOrigin origin = { 0 };
+    HTTPConnectionManager manager(nullptr);
+    manager.addFactory(new CountingConnectionFactory(origin));
+    manager.setCache(new SegmentCache(nullptr, 20 * SEGMENT_SIZE));
+
+    Expect(Fetch(manager, "http://origin/video/init.mp4", ChunkType::Init) == INIT_SIZE);
+    for(unsigned i = 0; i < 10; i++)
+    {
+        manager.updatePosition(ID("video"), i);
+        Expect(Fetch(manager, SegmentUrl(i), ChunkType::Segment, i) == SEGMENT_SIZE);
+    }
+    Expect(origin.requests == 11);
+
+    /* Seeking back and restarting the stream are served from memory */
+    Expect(Fetch(manager, SegmentUrl(2), ChunkType::Segment, 2) == SEGMENT_SIZE);
+    Expect(Fetch(manager, "http://origin/video/init.mp4", ChunkType::Init) == INIT_SIZE);
+    Expect(origin.requests == 11);
+
+    /* Only complete downloads are kept, playlists never */
+    Fetch(manager, "http://origin/video/truncated.m4s", ChunkType::Segment);
+    Fetch(manager, "http://origin/video/truncated.m4s", ChunkType::Segment);
+    Fetch(manager, "http://origin/video.m3u8", ChunkType::Playlist);
+    Fetch(manager, "http://origin/video.m3u8", ChunkType::Playlist);
+    Expect(origin.requests == 15);
+
+    SegmentCacheStats stats = manager.getCache()->getStats();
+    Expect(stats.hits == 2);
+    Expect(stats.served == SEGMENT_SIZE + INIT_SIZE);
+    Expect(manager.getCache()->getMemoryUsage() == 10 * SEGMENT_SIZE + INIT_SIZE);
+
+    return 0;
+}
+
+static void Put(SegmentCache &cache, const std::string &url, ChunkType type,
+                size_t size, uint64_t sequence = 0)
+{
+    block_t *block = block_Alloc(size);
+    Expect(block);
+    memset(block->p_buffer, 0, size);
+    cache.put(HTTPChunkSource::makeStorageID(url, BytesRange()), ID("video"),
+              sequence, type, block, "video/mp4");
+}
+
+static bool Has(SegmentCache &cache, const std::string &url, ChunkType type,
+                uint64_t sequence = 0)
+{
+    AbstractChunkSource *source = cache.get(nullptr, HTTPChunkSource::makeStorageID(url, BytesRange()),
+                                            ID("video"), sequence, type, BytesRange());
+    if(!source)
+        return false;
+    block_t *block;
+    size_t total = 0;
+    while((block = source->readBlock()))
+    {
+        total += block->i_buffer;
+        block_Release(block);
+    }
+    Expect(!source->hasMoreData());
+    Expect(source->getContentType() == "video/mp4");
+    delete static_cast<CachedChunkSource *>(source);
+    return total > 0;
+}
+
+static int Eviction_test()
+{
+    {
+        /* a zero size disables the memory tier */
+        SegmentCache cache(nullptr, 0);
+        Put(cache, "http://origin/video/init.mp4", ChunkType::Init, INIT_SIZE);
+        Expect(cache.getMemoryUsage() == 0);
+        Expect(!Has(cache, "http://origin/video/init.mp4", ChunkType::Init));
+    }
+
+    /* room for the init segment and four media segments */
+    SegmentCache cache(nullptr, 4 * SEGMENT_SIZE + INIT_SIZE);
+    Put(cache, "http://origin/video/init.mp4", ChunkType::Init, INIT_SIZE);
+    for(unsigned i = 0; i < 10; i++)
+    {
+        cache.updatePosition(ID("video"), i);
+        Put(cache, SegmentUrl(i), ChunkType::Segment, SEGMENT_SIZE, i);
+    }
+    Expect(cache.getMemoryUsage() == 4 * SEGMENT_SIZE + INIT_SIZE);
+
+    /* Seek back to 2: the segment farthest from it goes, not the oldest */
+    cache.updatePosition(ID("video"), 2);
+    Put(cache, SegmentUrl(2), ChunkType::Segment, SEGMENT_SIZE, 2);
+    Expect(!Has(cache, SegmentUrl(9), ChunkType::Segment, 9));
+    Expect(Has(cache, SegmentUrl(6), ChunkType::Segment, 6));
+    Expect(Has(cache, SegmentUrl(2), ChunkType::Segment, 2));
+    Expect(Has(cache, "http://origin/video/init.mp4", ChunkType::Init));
+    Expect(!Has(cache, SegmentUrl(0), ChunkType::Segment, 0));
+
+    SegmentCacheStats stats = cache.getStats();
+    Expect(stats.hits == 3);
+    Expect(stats.misses == 2);
+    Expect(stats.evictions == 7);
+
+    return 0;
+}
+
+static int Prefetch_test()
+{
+    /* Segments downloaded ahead of the position are ranked by their own
+     * number: the ones right after the position stay */
+    SegmentCache cache(nullptr, 4 * SEGMENT_SIZE);
+    cache.updatePosition(ID("video"), 0);
+    for(unsigned i = 0; i < 8; i++)
+        Put(cache, SegmentUrl(i), ChunkType::Segment, SEGMENT_SIZE, i);
+    for(unsigned i = 0; i < 8; i++)
+        Expect(Has(cache, SegmentUrl(i), ChunkType::Segment, i) == (i < 4));
+
+    return 0;
+}
+
+static void RemoveDirectory(const std::string &dir)
+{
+    DIR *d = vlc_opendir(dir.c_str());
+    if(d)
+    {
+        const char *name;
+        while((name = vlc_readdir(d)))
+        {
+            if(strcmp(name, ".") && strcmp(name, ".."))
+                vlc_unlink((dir + DIR_SEP + name).c_str());
+        }
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+static int Disk_test(const std::string &dir)
+{
+    {
+        /* memory only holds one segment, the others are moved to disk */
+        SegmentCache cache(nullptr, SEGMENT_SIZE, dir, 20 * SEGMENT_SIZE);
+        for(unsigned i = 0; i < 5; i++)
+        {
+            cache.updatePosition(ID("video"), i);
+            Put(cache, SegmentUrl(i), ChunkType::Segment, SEGMENT_SIZE, i);
+        }
+        Expect(cache.getMemoryUsage() == SEGMENT_SIZE);
+        Expect(cache.getDiskUsage() > 4 * SEGMENT_SIZE);
+        Expect(Has(cache, SegmentUrl(0), ChunkType::Segment));
+        Expect(cache.getStats().diskHits == 1);
+    }
+
+    {
+        /* playback restarts */
+        SegmentCache cache(nullptr, SEGMENT_SIZE, dir, 20 * SEGMENT_SIZE);
+        Expect(Has(cache, SegmentUrl(3), ChunkType::Segment));
+        Expect(!Has(cache, SegmentUrl(7), ChunkType::Segment));
+        SegmentCacheStats stats = cache.getStats();
+        Expect(stats.diskHits == 1);
+        Expect(stats.misses == 1);
+    }
+
+    {
+        /* a smaller directory size drops what exceeds it */
+        SegmentCache cache(nullptr, SEGMENT_SIZE, dir, 2 * SEGMENT_SIZE + 4096);
+        Expect(cache.getDiskUsage() <= 2 * SEGMENT_SIZE + 4096);
+        Expect(cache.getDiskUsage() > SEGMENT_SIZE);
+    }
+
+    return 0;
+}
+
+int SegmentCache_test()
+{
+    const std::string dir = "segment-cache-test-" + std::to_string(getpid());
+    try
+    {
+        Manager_test();
+        Eviction_test();
+        Prefetch_test();
+        Disk_test(dir);
+    } catch (...) {
+        RemoveDirectory(dir);
+        return 1;
+    }
+    RemoveDirectory(dir);
+
+    return 0;
+}
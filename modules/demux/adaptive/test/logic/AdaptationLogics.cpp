@@ -0,0 +1,156 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "AdaptationSimulator.hpp"
+
+#include "../../logic/AlwaysLowestAdaptationLogic.hpp"
+#include "../../logic/RateBasedAdaptationLogic.h"
+#include "../../logic/PredictiveAdaptationLogic.hpp"
+#include "../../logic/NearOptimalAdaptationLogic.hpp"
+#include "../../logic/HybridAdaptationLogic.hpp"
+
+#include "../test.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+using namespace adaptive::logic;
+
+#define SEGMENT_DURATION VLC_TICK_FROM_SEC(4)
+#define SEGMENTS         150 /* 10 minutes */
+
+static const std::vector<unsigned> ladder = { 300000, 750000, 1200000, 2400000, 4800000 };
+
+static BandwidthTrace StableTrace()
+{
+    return { { VLC_TICK_FROM_SEC(60), 8000000 } };
+}
+
+/* Long drop below the second representation */
+static BandwidthTrace DropTrace()
+{
+    return { { VLC_TICK_FROM_SEC(120), 8000000 },
+             { VLC_TICK_FROM_SEC(120), 1000000 },
+             { VLC_TICK_FROM_SEC(120), 8000000 } };
+}
+
+/* Short bursts and outages around a mean, as on a mobile network */
+static BandwidthTrace MobileTrace()
+{
+    BandwidthTrace trace;
+    uint32_t seed = 0x2545F491;
+    for(unsigned i = 0; i < 300; i++)
+    {
+        seed = seed * 1664525 + 1013904223; /* deterministic LCG */
+        const unsigned r = seed >> 16;
+        unsigned bps = 500000 + (r % 5500) * 1000;
+        if(r % 16 == 0)
+            bps = 100000;
+        trace.push_back({ VLC_TICK_FROM_MS(500) * (1 + (r >> 8) % 6), bps });
+    }
+    return trace;
+}
+
+static AbstractAdaptationLogic * CreateLogic(unsigned i)
+{
+    switch(i)
+    {
+        case 0:  return new AlwaysLowestAdaptationLogic(nullptr);
+        case 1:  return new RateBasedAdaptationLogic(nullptr);
+        case 2:  return new PredictiveAdaptationLogic(nullptr);
+        case 3:  return new NearOptimalAdaptationLogic(nullptr);
+        case 4:  return new HybridAdaptationLogic(nullptr);
+        default: return nullptr;
+    }
+}
+
+static const char * const LogicNames[] = {
+    "lowest", "rate", "predictive", "nearoptimal", "hybrid",
+};
+
+static SimulationResults Simulate(unsigned logicidx, const BandwidthTrace &trace)
+{
+    AdaptationSimulator simulator(ladder, SEGMENT_DURATION, SEGMENTS);
+    simulator.setLatency(VLC_TICK_FROM_MS(50));
+    std::unique_ptr<AbstractAdaptationLogic> logic(CreateLogic(logicidx));
+    return simulator.run(logic.get(), trace);
+}
+
+int AdaptationLogics_test()
+{
+    try
+    {
+        const struct
+        {
+            const char *name;
+            BandwidthTrace trace;
+        } traces[] = {
+            { "stable", StableTrace() },
+            { "drop", DropTrace() },
+            { "mobile", MobileTrace() },
+        };
+
+        SimulationResults results[ARRAY_SIZE(traces)][ARRAY_SIZE(LogicNames)];
+        for(size_t t = 0; t < ARRAY_SIZE(traces); t++)
+        {
+            for(size_t l = 0; l < ARRAY_SIZE(LogicNames); l++)
+            {
+                results[t][l] = Simulate(l, traces[t].trace);
+                std::cerr << "  " << std::setw(7) << std::left << traces[t].name
+                          << std::setw(12) << LogicNames[l] << results[t][l] << std::endl;
+            }
+        }
+
+        /* Replays do not depend on the host */
+        SimulationResults again = Simulate(4, traces[2].trace);
+        Expect(again.averagebps == results[2][4].averagebps);
+        Expect(again.rebuffering == results[2][4].rebuffering);
+        Expect(again.switches == results[2][4].switches);
+
+        /* The lowest quality always fits */
+        for(size_t t = 0; t < 2; t++)
+        {
+            Expect(results[t][0].rebuffering == 0);
+            Expect(results[t][0].switches == 0);
+        }
+
+        const SimulationResults &stable = results[0][4];
+        Expect(stable.rebuffering == 0);
+        Expect(stable.averagebps > 4000000);
+        Expect(stable.switches <= 4);
+
+        const SimulationResults &drop = results[1][4];
+        Expect(drop.rebuffering == 0);
+        Expect(drop.averagebps > 2 * results[1][0].averagebps);
+
+        const SimulationResults &mobile = results[2][4];
+        Expect(mobile.rebuffering <= results[2][1].rebuffering);
+        Expect(mobile.switches <= results[2][1].switches);
+        Expect(mobile.averagebps > 2 * results[2][0].averagebps);
+    } catch (...) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "AdaptationSimulator.hpp"
+
+#include "../../playlist/BasePlaylist.hpp"
+#include "../../playlist/BasePeriod.h"
+#include "../../playlist/BaseAdaptationSet.h"
+#include "../../playlist/BaseRepresentation.h"
+#include "../../logic/AbstractAdaptationLogic.h"
+#include "../../logic/BufferingLogic.hpp"
+#include "../../SegmentTracker.hpp"
+#include "../../ID.hpp"
+
+#include <stdexcept>
+
+using namespace adaptive;
+using namespace adaptive::playlist;
+using namespace adaptive::logic;
+
+std::ostream & operator<<(std::ostream &os, const SimulationResults &r)
+{
+    os << "bitrate " << r.averagebps / 1000 << " kb/s, "
+       << r.switches << " switches, startup " << MS_FROM_VLC_TICK(r.startup)
+       << " ms, rebuffering " << MS_FROM_VLC_TICK(r.rebuffering)
+       << " ms in " << r.stalls << " stalls";
+    return os;
+}
+
+AdaptationSimulator::AdaptationSimulator(const std::vector<unsigned> &bitrates,
+                                         vlc_tick_t duration, unsigned count)
+    : segmentduration(duration), segmentcount(count), latency(0)
+{
+    playlist = new BasePlaylist(nullptr);
+    BasePeriod *period = new BasePeriod(playlist);
+    set = new BaseAdaptationSet(period);
+    set->setID(ID("simulated"));
+    for(unsigned bps : bitrates)
+    {
+        BaseRepresentation *rep = new BaseRepresentation(set);
+        rep->setBandwidth(bps);
+        set->addRepresentation(rep);
+    }
+    period->addAdaptationSet(set);
+    playlist->addPeriod(period);
+}
+
+AdaptationSimulator::~AdaptationSimulator()
+{
+    delete playlist;
+}
+
+void AdaptationSimulator::setLatency(vlc_tick_t l)
+{
+    latency = l;
+}
+
+/* Time to receive size bytes from the start date */
+vlc_tick_t AdaptationSimulator::transfer(const BandwidthTrace &trace,
+                                         vlc_tick_t start, size_t size) const
+{
+    vlc_tick_t period = 0;
+    uint64_t periodbits = 0;
+    for(const TraceStep &step : trace)
+    {
+        period += step.duration;
+        periodbits += (uint64_t) step.bps * step.duration / CLOCK_FREQ;
+    }
+    if(period == 0 || periodbits == 0)
+        throw std::invalid_argument("empty trace");
+
+    uint64_t bits = (uint64_t) size * 8;
+    vlc_tick_t elapsed = 0;
+
+    /* whole loops of the trace */
+    elapsed += period * (bits / periodbits);
+    bits %= periodbits;
+
+    vlc_tick_t offset = start % period;
+    for(size_t i = 0; bits > 0; i = (i + 1) % trace.size())
+    {
+        const TraceStep &step = trace[i];
+        if(offset >= step.duration)
+        {
+            offset -= step.duration;
+            continue;
+        }
+        const vlc_tick_t remain = step.duration - offset;
+        offset = 0;
+        const uint64_t stepbits = (uint64_t) step.bps * remain / CLOCK_FREQ;
+        if(stepbits >= bits)
+        {
+            elapsed += vlc_tick_from_samples(bits, step.bps);
+            bits = 0;
+        }
+        else
+        {
+            elapsed += remain;
+            bits -= stepbits;
+        }
+    }
+    return elapsed;
+}
+
+SimulationResults AdaptationSimulator::run(AbstractAdaptationLogic *logic,
+                                           const BandwidthTrace &trace)
+{
+    SimulationResults results = {};
+    DefaultBufferingLogic bufferinglogic;
+    const vlc_tick_t minbuffering = bufferinglogic.getMinBuffering(playlist);
+    const vlc_tick_t maxbuffering = bufferinglogic.getMaxBuffering(playlist);
+    const vlc_tick_t targetbuffering = bufferinglogic.getStableBuffering(playlist);
+    const ID &id = set->getID();
+
+    vlc_tick_t now = 0;
+    vlc_tick_t buffered = 0;
+    bool playing = false;
+    uint64_t totalbps = 0;
+    BaseRepresentation *current = nullptr;
+
+    logic->trackerEvent(BufferingStateUpdatedEvent(id, true));
+    logic->trackerEvent(BufferingLevelChangedEvent(id, minbuffering, maxbuffering,
+                                                   buffered, targetbuffering));
+
+    for(unsigned i = 0; i < segmentcount; i++)
+    {
+        /* the demuxer stops fetching once the buffer is full */
+        if(playing && buffered + segmentduration > maxbuffering)
+        {
+            const vlc_tick_t idle = buffered + segmentduration - maxbuffering;
+            now += idle;
+            buffered -= idle;
+        }
+
+        BaseRepresentation *rep = logic->getNextRepresentation(set, current);
+        if(rep == nullptr)
+            throw std::runtime_error("no representation");
+        if(rep != current)
+        {
+            logic->trackerEvent(RepresentationSwitchEvent(current, rep));
+            if(current)
+                results.switches++;
+            current = rep;
+        }
+
+        const size_t size = rep->getBandwidth() * segmentduration / CLOCK_FREQ / 8;
+        const vlc_tick_t time = latency + transfer(trace, now + latency, size);
+        now += time;
+        if(playing)
+        {
+            if(time > buffered)
+            {
+                /* playback resumes as soon as the segment is there */
+                results.rebuffering += time - buffered;
+                results.stalls++;
+                buffered = 0;
+            }
+            else buffered -= time;
+        }
+        buffered += segmentduration;
+        totalbps += rep->getBandwidth();
+
+        logic->updateDownloadRate(id, size, time, latency);
+
+        if(!playing && (buffered >= minbuffering || i + 1 == segmentcount))
+        {
+            playing = true;
+            results.startup = now;
+        }
+
+        logic->trackerEvent(BufferingLevelChangedEvent(id, minbuffering, maxbuffering,
+                                                       buffered, targetbuffering));
+    }
+
+    logic->trackerEvent(RepresentationSwitchEvent(current, nullptr));
+    logic->trackerEvent(BufferingStateUpdatedEvent(id, false));
+
+    results.averagebps = segmentcount ? totalbps / segmentcount : 0;
+    results.duration = now + buffered;
+    return results;
+}
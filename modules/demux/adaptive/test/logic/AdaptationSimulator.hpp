@@ -0,0 +1,89 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef ADAPTATION_SIMULATOR_HPP
+#define ADAPTATION_SIMULATOR_HPP
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include <ostream>
+#include <vector>
+
+namespace adaptive
+{
+    namespace playlist
+    {
+        class BasePlaylist;
+        class BaseAdaptationSet;
+    }
+    namespace logic
+    {
+        class AbstractAdaptationLogic;
+    }
+}
+
+/* Link throughput, as constant rate steps. Replayed in a loop. */
+struct TraceStep
+{
+    vlc_tick_t duration;
+    unsigned bps;
+};
+
+using BandwidthTrace = std::vector<TraceStep>;
+
+struct SimulationResults
+{
+    vlc_tick_t startup;     /* before playback starts */
+    vlc_tick_t rebuffering; /* stalled once started */
+    unsigned stalls;
+    unsigned switches;
+    uint64_t averagebps;    /* of the downloaded segments */
+    vlc_tick_t duration;    /* of the whole session */
+};
+
+std::ostream & operator<<(std::ostream &, const SimulationResults &);
+
+/* Replays a bandwidth trace against an adaptation logic, on a virtual clock,
+ * as the segment tracker and the downloader would drive it: one stream of
+ * constant bitrate segments, buffering bounds from the default buffering
+ * logic, playback starting once the minimum buffering is reached.
+ * Results only depend on the trace, never on the host. */
+class AdaptationSimulator
+{
+    public:
+        AdaptationSimulator(const std::vector<unsigned> &bitrates,
+                            vlc_tick_t segmentduration, unsigned segmentcount);
+        ~AdaptationSimulator();
+
+        void setLatency(vlc_tick_t);
+        SimulationResults run(adaptive::logic::AbstractAdaptationLogic *,
+                              const BandwidthTrace &);
+
+    private:
+        vlc_tick_t transfer(const BandwidthTrace &, vlc_tick_t, size_t) const;
+
+        adaptive::playlist::BasePlaylist *playlist;
+        adaptive::playlist::BaseAdaptationSet *set;
+        vlc_tick_t segmentduration;
+        unsigned segmentcount;
+        vlc_tick_t latency;
+};
+
+#endif
@@ -0,0 +1,352 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../playlist/Segment.h"
+#include "../../playlist/SegmentList.h"
+#include "../../playlist/BasePeriod.h"
+#include "../../playlist/BaseAdaptationSet.h"
+#include "../../http/HTTPConnectionManager.h"
+#include "../../http/HTTPConnection.hpp"
+#include "../../SharedResources.hpp"
+#include "../../tools/Retrieve.hpp"
+#include "../../../hls/playlist/Parser.hpp"
+#include "../../../hls/playlist/M3U8.hpp"
+#include "../../../hls/playlist/HLSRepresentation.hpp"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_stream.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace adaptive;
+using namespace adaptive::http;
+using namespace adaptive::playlist;
+using namespace hls::playlist;
+
+#define DVR_SEGMENTS (6 * 3600 / 4) /* 6 hours of 4s segments */
+#define SKIP_UNTIL   60 /* seconds listed in delta updates */
+#define UPDATES      20
+
+/* Durations alternate, so that they sum up exactly in milliseconds */
+static const char * Duration(uint64_t msn)
+{
+    return msn % 2 ? "4.000" : "3.960";
+}
+
+static std::string ProgramDateTime(uint64_t msn)
+{
+    const uint64_t ms = msn / 2 * 7960 + msn % 2 * 3960;
+    const time_t t = 1704067200 /* 2024-01-01 */ + ms / 1000;
+    struct tm tm;
+    char buf[32];
+    gmtime_r(&t, &tm);
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::ostringstream os;
+    os << buf << "." << std::setfill('0') << std::setw(3) << ms % 1000 << "Z";
+    return os.str();
+}
+
+/* Stand-in for a live origin with a long DVR window, which can answer
+ * with delta updates. Every playlist request publishes a new segment. */
+class DVROrigin
+{
+    public:
+        DVROrigin(bool skip, bool pdt) : b_skip(skip), b_pdt(pdt), next(DVR_SEGMENTS + 1000)
+        {
+            deltaRequests = 0;
+        }
+
+        std::string playlist(bool delta) const
+        {
+            const uint64_t first = next - DVR_SEGMENTS;
+            std::ostringstream os;
+            os << "#EXTM3U\n"
+                  "#EXT-X-VERSION:9\n"
+                  "#EXT-X-TARGETDURATION:4\n";
+            if(b_skip)
+                os << "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=" << SKIP_UNTIL << "\n";
+            os << "#EXT-X-MEDIA-SEQUENCE:" << first << "\n";
+            uint64_t msn = first;
+            if(delta)
+            {
+                msn = next - SKIP_UNTIL / 4;
+                os << "#EXT-X-SKIP:SKIPPED-SEGMENTS=" << msn - first << "\n";
+            }
+            if(b_pdt)
+                os << "#EXT-X-PROGRAM-DATE-TIME:" << ProgramDateTime(msn) << "\n";
+            for(; msn < next; msn++)
+                os << "#EXTINF:" << Duration(msn) << ",\n"
+                      "media_" << msn << ".ts\n";
+            return os.str();
+        }
+
+        bool serve(const std::string &path, std::string &body)
+        {
+            if(path.compare(0, 10, "/live.m3u8"))
+                return false;
+            bool delta = b_skip && path.find("_HLS_skip=YES") != std::string::npos;
+            if(delta)
+                deltaRequests++;
+            next++;
+            body = playlist(delta);
+            return true;
+        }
+
+        unsigned deltaRequests;
+
+    private:
+        bool b_skip;
+        bool b_pdt;
+        uint64_t next;
+};
+
+class DVRConnection : public AbstractConnection
+{
+    public:
+        DVRConnection(DVROrigin &o)
+            : AbstractConnection(nullptr), origin(o) {}
+        virtual ~DVRConnection() = default;
+
+        virtual bool canReuse(const ConnectionParams &) const override
+        {
+            return available;
+        }
+
+        virtual RequestStatus request(const std::string &path,
+                                      const BytesRange &) override
+        {
+            if(!origin.serve(path, body))
+                return RequestStatus::NotFound;
+            contentLength = body.size();
+            bytesRead = 0;
+            return RequestStatus::Success;
+        }
+
+        virtual ssize_t read(void *p_buffer, size_t len) override
+        {
+            len = std::min(len, contentLength - bytesRead);
+            std::memcpy(p_buffer, body.data() + bytesRead, len);
+            bytesRead += len;
+            return len;
+        }
+
+        virtual void setUsed(bool b) override
+        {
+            available = !b;
+        }
+
+    private:
+        DVROrigin &origin;
+        std::string body;
+};
+
+class DVRConnectionFactory : public AbstractConnectionFactory
+{
+    public:
+        DVRConnectionFactory(DVROrigin &o) : origin(o) {}
+        virtual ~DVRConnectionFactory() = default;
+        virtual AbstractConnection * createConnection(vlc_object_t *,
+                                                      const ConnectionParams &) override
+        {
+            return new DVRConnection(origin);
+        }
+
+    private:
+        DVROrigin &origin;
+};
+
+static M3U8 * ParseM3U8(SharedResources *res, const std::string &body)
+{
+    vlc_object_t *obj = static_cast<vlc_object_t*>(nullptr);
+    stream_t *substream = vlc_stream_MemoryNew(obj, (uint8_t *)body.data(), body.size(), true);
+    if(!substream)
+        return nullptr;
+    M3U8Parser parser(res);
+    M3U8 *m3u = parser.parse(obj, substream, "http://origin/live.m3u8");
+    vlc_stream_Delete(substream);
+    return m3u;
+}
+
+static HLSRepresentation * GetRepresentation(M3U8 *m3u)
+{
+    return static_cast<HLSRepresentation *>(
+        m3u->getFirstPeriod()->getAdaptationSets().front()->getRepresentations().front());
+}
+
+/* Same segments and timings, whatever the times origin */
+static void CompareLists(const SegmentList *list, const SegmentList *ref)
+{
+    const std::vector<Segment *> &a = list->getSegments();
+    const std::vector<Segment *> &b = ref->getSegments();
+    Expect(a.size() == b.size());
+    for(size_t i = 0; i < a.size(); i++)
+    {
+        Expect(a[i]->getSequenceNumber() == b[i]->getSequenceNumber());
+        Expect(a[i]->duration.Get() == b[i]->duration.Get());
+        Expect(a[i]->startTime.Get() - a[0]->startTime.Get() ==
+               b[i]->startTime.Get() - b[0]->startTime.Get());
+        Expect(a[i]->getDisplayTime() == b[i]->getDisplayTime());
+    }
+}
+
+struct Timings
+{
+    vlc_tick_t full; /* initial parse */
+    vlc_tick_t update; /* average refresh */
+};
+
+static Timings Refresh_run(bool skip, bool pdt)
+{
+    DVROrigin origin(skip, pdt);
+    HTTPConnectionManager *manager = new HTTPConnectionManager(nullptr);
+    manager->addFactory(new DVRConnectionFactory(origin));
+    SharedResources resources(nullptr, nullptr, manager);
+    Timings timings = { 0, 0 };
+
+    vlc_tick_t start = vlc_tick_now();
+    M3U8 *m3u = ParseM3U8(&resources, origin.playlist(false));
+    timings.full = vlc_tick_now() - start;
+
+    M3U8 *ref = nullptr;
+    try
+    {
+        Expect(m3u);
+        Expect(m3u->isLive());
+        HLSRepresentation *rep = GetRepresentation(m3u);
+        rep->scheduleNextUpdate(std::numeric_limits<uint64_t>::max(), true);
+        Expect(rep->inheritSegmentList()->getSegments().size() == DVR_SEGMENTS);
+
+        for(unsigned i = 0; i < UPDATES; i++)
+        {
+            start = vlc_tick_now();
+            Expect(rep->runLocalUpdates(&resources));
+            timings.update += vlc_tick_now() - start;
+            rep->scheduleNextUpdate(std::numeric_limits<uint64_t>::max(), true);
+        }
+        timings.update /= UPDATES;
+
+        /* Delta updates were requested once we had a recent playlist */
+        Expect(origin.deltaRequests == (skip ? UPDATES : 0));
+
+        /* Same window as a full parse of the last playlist */
+        ref = ParseM3U8(&resources, origin.playlist(false));
+        Expect(ref);
+        CompareLists(rep->inheritSegmentList(), GetRepresentation(ref)->inheritSegmentList());
+
+        delete ref;
+        delete m3u;
+    }
+    catch(...)
+    {
+        delete ref;
+        delete m3u;
+        throw;
+    }
+
+    return timings;
+}
+
+/* A delta update without any playlist to complete it with */
+static void Skip_without_previous()
+{
+    DVROrigin origin(true, false);
+    HTTPConnectionManager *manager = new HTTPConnectionManager(nullptr);
+    manager->addFactory(new DVRConnectionFactory(origin));
+    SharedResources resources(nullptr, nullptr, manager);
+
+    M3U8 *m3u = ParseM3U8(&resources, origin.playlist(true));
+    M3U8 *ref = nullptr;
+    try
+    {
+        Expect(m3u);
+        HLSRepresentation *rep = GetRepresentation(m3u);
+        rep->scheduleNextUpdate(std::numeric_limits<uint64_t>::max(), true);
+
+        /* Listed segments keep their numbers past the skipped ones */
+        const std::vector<Segment *> &list = rep->inheritSegmentList()->getSegments();
+        Expect(list.size() == SKIP_UNTIL / 4);
+        Expect(list.front()->getSequenceNumber() == DVR_SEGMENTS + 1000 - SKIP_UNTIL / 4);
+
+        /* The next reload is a full one, right away */
+        Expect(rep->getPlaylistUpdateUrl().find("_HLS_skip") == std::string::npos);
+        Expect(rep->needsUpdate(std::numeric_limits<uint64_t>::max()));
+        Expect(rep->runLocalUpdates(&resources));
+        rep->scheduleNextUpdate(std::numeric_limits<uint64_t>::max(), true);
+        Expect(origin.deltaRequests == 0);
+
+        /* Then back to delta updates, continuing the same numbering */
+        Expect(rep->runLocalUpdates(&resources));
+        Expect(origin.deltaRequests == 1);
+        ref = ParseM3U8(&resources, origin.playlist(false));
+        Expect(ref);
+        const std::vector<Segment *> &updated = rep->inheritSegmentList()->getSegments();
+        const std::vector<Segment *> &full = GetRepresentation(ref)->inheritSegmentList()->getSegments();
+        Expect(updated.back()->getSequenceNumber() == full.back()->getSequenceNumber());
+        Expect(updated.back()->getSequenceNumber() - updated.front()->getSequenceNumber()
+               == updated.size() - 1);
+
+        delete ref;
+        delete m3u;
+    }
+    catch(...)
+    {
+        delete ref;
+        delete m3u;
+        throw;
+    }
+}
+
+int M3U8DeltaUpdate_test()
+{
+    try
+    {
+        Skip_without_previous();
+
+        for(int pdt = 0; pdt < 2; pdt++)
+        {
+            Timings incremental = Refresh_run(false, pdt);
+            Timings delta = Refresh_run(true, pdt);
+
+            std::cerr << "  " << DVR_SEGMENTS << " segments" << (pdt ? " with PDT" : "")
+                      << ": full parse " << US_FROM_VLC_TICK(incremental.full)
+                      << " us, refresh " << US_FROM_VLC_TICK(incremental.update)
+                      << " us, delta refresh " << US_FROM_VLC_TICK(delta.update)
+                      << " us" << std::endl;
+
+            Expect(incremental.update < incremental.full);
+            Expect(delta.update < incremental.update);
+        }
+    } catch (...) {
+        return 1;
+    }
+
+    return 0;
+}
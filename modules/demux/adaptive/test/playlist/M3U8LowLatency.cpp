@@ -0,0 +1,380 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../playlist/Segment.h"
+#include "../../playlist/SegmentList.h"
+#include "../../playlist/SegmentChunk.hpp"
+#include "../../playlist/BasePeriod.h"
+#include "../../playlist/BaseAdaptationSet.h"
+#include "../../http/HTTPConnectionManager.h"
+#include "../../http/HTTPConnection.hpp"
+#include "../../logic/BufferingLogic.hpp"
+#include "../../SharedResources.hpp"
+#include "../../tools/Retrieve.hpp"
+#include "../../../hls/playlist/Parser.hpp"
+#include "../../../hls/playlist/M3U8.hpp"
+#include "../../../hls/playlist/HLSSegment.hpp"
+#include "../../../hls/playlist/HLSRepresentation.hpp"
+
+#include "../test.hpp"
+
+#include <vlc_block.h>
+#include <vlc_stream.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace adaptive;
+using namespace adaptive::http;
+using namespace adaptive::logic;
+using namespace adaptive::playlist;
+using namespace hls::playlist;
+
+#define PARTS_PER_SEGMENT 4
+
+/* Stand-in for a low latency origin, serving the files written by a packager.
+ * Time only advances when a request waits for a part which is not published
+ * yet, as a real origin would hold the request until then. */
+class StandInOrigin
+{
+    public:
+        /* Starts with the given count of parts of segment msn published */
+        StandInOrigin(uint64_t msn, unsigned part) : published(0, 0)
+        {
+            blockingReloads = reloads = 0;
+            while(published.first != msn || published.second != part)
+                publish();
+        }
+
+        bool serve(const std::string &path, std::string &body)
+        {
+            std::string file = path.substr(0, path.find('?'));
+            if(file == "/live.m3u8")
+            {
+                reloads++;
+                uint64_t msn;
+                unsigned part;
+                if(parseBlockingRequest(path, &msn, &part))
+                {
+                    blockingReloads++;
+                    while(!isPublished(msn, part))
+                        publish();
+                }
+            }
+            else if(files.find(file) == files.end() && file.find(".ts") != std::string::npos)
+            {
+                /* preload hint, held until the part is complete */
+                uint64_t msn;
+                unsigned part;
+                if(std::sscanf(file.c_str(), "/seg%" SCNu64 ".%u.ts", &msn, &part) != 2 ||
+                   msn > published.first + 1)
+                    return false;
+                while(!isPublished(msn, part))
+                    publish();
+            }
+
+            auto it = files.find(file);
+            if(it == files.end())
+                return false;
+            body = it->second;
+            return true;
+        }
+
+        /* live edge, in parts */
+        uint64_t edge() const
+        {
+            return published.first * PARTS_PER_SEGMENT + published.second;
+        }
+
+        unsigned blockingReloads;
+        unsigned reloads;
+
+    private:
+        static bool parseBlockingRequest(const std::string &path, uint64_t *msn, unsigned *part)
+        {
+            std::size_t pos = path.find("?_HLS_msn=");
+            if(pos == std::string::npos)
+                return false;
+            *part = 0;
+            return std::sscanf(path.c_str() + pos, "?_HLS_msn=%" SCNu64 "&_HLS_part=%u",
+                               msn, part) >= 1;
+        }
+
+        bool isPublished(uint64_t msn, unsigned part) const
+        {
+            return msn < published.first ||
+                   (msn == published.first && part < published.second);
+        }
+
+        static std::string partName(uint64_t msn, unsigned part)
+        {
+            return "seg" + std::to_string(msn) + "." + std::to_string(part) + ".ts";
+        }
+
+        void publish()
+        {
+            if(published.second == PARTS_PER_SEGMENT)
+                published = std::make_pair(published.first + 1, 0U);
+            files["/" + partName(published.first, published.second)] =
+                    std::string(1, (char) published.second);
+            if(++published.second == PARTS_PER_SEGMENT)
+                files["/seg" + std::to_string(published.first) + ".ts"] = "segment";
+            writePlaylist();
+        }
+
+        void writePlaylist()
+        {
+            uint64_t current = published.first;
+            unsigned parts = published.second;
+            if(parts == PARTS_PER_SEGMENT)
+            {
+                current++;
+                parts = 0;
+            }
+            const uint64_t first = current > 4 ? current - 4 : 0;
+
+            std::ostringstream os;
+            os << "#EXTM3U\n"
+                  "#EXT-X-TARGETDURATION:2\n"
+                  "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.5\n"
+                  "#EXT-X-PART-INF:PART-TARGET=0.5\n"
+                  "#EXT-X-MEDIA-SEQUENCE:" << first << "\n";
+            for(uint64_t msn = first; msn < current; msn++)
+            {
+                if(msn + 2 >= current)
+                    for(unsigned p = 0; p < PARTS_PER_SEGMENT; p++)
+                        os << "#EXT-X-PART:DURATION=0.5,URI=\"" << partName(msn, p) << "\"\n";
+                os << "#EXTINF:2.0,\nseg" << msn << ".ts\n";
+            }
+            for(unsigned p = 0; p < parts; p++)
+                os << "#EXT-X-PART:DURATION=0.5,URI=\"" << partName(current, p) << "\"\n";
+            os << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << partName(current, parts) << "\"\n";
+            files["/live.m3u8"] = os.str();
+        }
+
+        std::map<std::string, std::string> files;
+        std::pair<uint64_t, unsigned> published;
+};
+
+class OriginConnection : public AbstractConnection
+{
+    public:
+        OriginConnection(StandInOrigin &o)
+            : AbstractConnection(nullptr), origin(o) {}
+        virtual ~OriginConnection() = default;
+
+        virtual bool canReuse(const ConnectionParams &) const override
+        {
+            return available;
+        }
+
+        virtual RequestStatus request(const std::string &path,
+                                      const BytesRange &) override
+        {
+            if(!origin.serve(path, body))
+                return RequestStatus::NotFound;
+            contentLength = body.size();
+            bytesRead = 0;
+            return RequestStatus::Success;
+        }
+
+        virtual ssize_t read(void *p_buffer, size_t len) override
+        {
+            len = std::min(len, contentLength - bytesRead);
+            std::memcpy(p_buffer, body.data() + bytesRead, len);
+            bytesRead += len;
+            return len;
+        }
+
+        virtual void setUsed(bool b) override
+        {
+            available = !b;
+        }
+
+    private:
+        StandInOrigin &origin;
+        std::string body;
+};
+
+class OriginConnectionFactory : public AbstractConnectionFactory
+{
+    public:
+        OriginConnectionFactory(StandInOrigin &o) : origin(o) {}
+        virtual ~OriginConnectionFactory() = default;
+        virtual AbstractConnection * createConnection(vlc_object_t *,
+                                                      const ConnectionParams &) override
+        {
+            return new OriginConnection(origin);
+        }
+
+    private:
+        StandInOrigin &origin;
+};
+
+static M3U8 * ParseM3U8(vlc_object_t *obj, SharedResources *res, const std::string &url)
+{
+    block_t *p_block = Retrieve::HTTP(res, ChunkType::Playlist, url);
+    if(!p_block)
+        return nullptr;
+    M3U8 *m3u = nullptr;
+    stream_t *substream = vlc_stream_MemoryNew(obj, p_block->p_buffer, p_block->i_buffer, true);
+    if(substream)
+    {
+        M3U8Parser parser(res);
+        m3u = parser.parse(obj, substream, url);
+        vlc_stream_Delete(substream);
+    }
+    block_Release(p_block);
+    return m3u;
+}
+
+static size_t ReadSegment(SharedResources *res, Segment *seg, uint64_t number,
+                          BaseRepresentation *rep, uint8_t *first)
+{
+    SegmentChunk *chunk = seg->toChunk(res, number, rep);
+    if(!chunk)
+        return 0;
+    size_t size = 0;
+    block_t *block;
+    while((block = chunk->readBlock()))
+    {
+        if(size == 0 && block->i_buffer)
+            *first = block->p_buffer[0];
+        size += block->i_buffer;
+        block_Release(block);
+    }
+    delete chunk;
+    return size;
+}
+
+#define PLAYED_PARTS 24
+
+int M3U8LowLatency_test()
+{
+    vlc_object_t *obj = static_cast<vlc_object_t*>(nullptr);
+    StandInOrigin origin(13, 1);
+    HTTPConnectionManager *manager = new HTTPConnectionManager(nullptr);
+    manager->addFactory(new OriginConnectionFactory(origin));
+    SharedResources resources(nullptr, nullptr, manager);
+    DefaultBufferingLogic bufferingLogic;
+
+    M3U8 *m3u = ParseM3U8(obj, &resources, "http://origin/live.m3u8");
+    try
+    {
+        Expect(m3u);
+        Expect(m3u->isLive());
+        Expect(m3u->isLowLatency());
+        HLSRepresentation *rep = static_cast<HLSRepresentation *>(
+            m3u->getFirstPeriod()->getAdaptationSets().front()->getRepresentations().front());
+        Expect(rep->isLowLatency());
+
+        /* Older segments whole, last ones as parts, then the hint */
+        const std::vector<Segment *> &list = rep->inheritSegmentList()->getSegments();
+        Expect(list.size() == 2 + 2 * PARTS_PER_SEGMENT + 2);
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            const HLSSegment *seg = static_cast<const HLSSegment *>(list.at(i));
+            Expect(seg->getSequenceNumber() == 9 + i);
+            Expect(seg->isPart() == (i >= 2));
+            Expect(seg->isPreloadHint() == (i == list.size() - 1));
+        }
+        const HLSSegment *hint = static_cast<const HLSSegment *>(list.back());
+        Expect(hint->getMediaSequenceNumber() == 13);
+        Expect(hint->getPartIndex() == 1);
+        Expect(hint->duration.Get() == vlc_tick_from_sec(0.5));
+        Expect(rep->getPlaylistUpdateUrl() == "http://origin/live.m3u8?_HLS_msn=13&_HLS_part=1");
+
+        /* Start at low latency distance from the edge, then follow it */
+        bufferingLogic.setLowDelay(true);
+        uint64_t number = bufferingLogic.getStartSegmentNumber(rep);
+        Expect(number != std::numeric_limits<uint64_t>::max());
+        const unsigned initialReloads = origin.reloads;
+        uint64_t expectedmsn = 0;
+        unsigned expectedpart = 0;
+        uint64_t distance = 0;
+
+        for(unsigned i = 0; i < PLAYED_PARTS; i++)
+        {
+            if(rep->needsUpdate(number))
+            {
+                bool b_updated = rep->runLocalUpdates(&resources);
+                rep->scheduleNextUpdate(number, b_updated);
+                Expect(b_updated);
+            }
+
+            bool b_gap;
+            HLSSegment *seg = static_cast<HLSSegment *>(
+                        rep->getNextMediaSegment(number, &number, &b_gap));
+            Expect(seg);
+            Expect(!b_gap);
+            Expect(seg->isPart());
+            /* parts follow each other, without skips or repeats */
+            if(i > 0)
+            {
+                Expect(seg->getMediaSequenceNumber() == expectedmsn);
+                Expect(seg->getPartIndex() == expectedpart);
+            }
+
+            uint8_t first;
+            Expect(ReadSegment(&resources, seg, number, rep, &first) == 1);
+            Expect(first == seg->getPartIndex());
+
+            distance = origin.edge() - (seg->getMediaSequenceNumber() * PARTS_PER_SEGMENT +
+                                        seg->getPartIndex() + 1);
+
+            expectedmsn = seg->getMediaSequenceNumber();
+            expectedpart = seg->getPartIndex() + 1;
+            if(expectedpart == PARTS_PER_SEGMENT)
+            {
+                expectedmsn++;
+                expectedpart = 0;
+            }
+            number++;
+        }
+
+        std::cerr << "  live edge distance " << distance << " parts, "
+                  << origin.blockingReloads << "/" << origin.reloads - initialReloads
+                  << " blocking reloads" << std::endl;
+
+        /* Caught up with the edge, and never polled */
+        Expect(distance <= 1);
+        Expect(origin.blockingReloads == origin.reloads - initialReloads);
+        Expect(origin.blockingReloads > 0);
+        Expect(origin.blockingReloads <= PLAYED_PARTS);
+
+        delete m3u;
+    }
+    catch(...)
+    {
+        delete m3u;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,444 @@
+/*****************************************************************************
+ *
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../playlist/Segment.h"
+#include "../../playlist/SegmentList.h"
+#include "../../playlist/SegmentTemplate.h"
+#include "../../playlist/SegmentTimeline.h"
+#include "../../playlist/BasePeriod.h"
+#include "../../playlist/BaseAdaptationSet.h"
+#include "../../playlist/BaseRepresentation.h"
+#include "../../xml/DOMParser.h"
+#include "../../../dash/mpd/IsoffStreamParser.h"
+#include "../../../dash/mpd/MPD.h"
+#include "../../../dash/mpd/ProgramInformation.h"
+
+#include "../test.hpp"
+
+#include <vlc_xml.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace adaptive;
+using namespace adaptive::playlist;
+using namespace adaptive::xml;
+using namespace dash::mpd;
+
+#define SEGMENTS (6 * 3600 / 2) /* 6 hours of 2s segments */
+#define RUNS     3
+
+/* Stand-in for the xml module: a pull parser over a document in memory,
+ * which is enough for the generated MPD below (no entities, no CDATA). */
+class InMemoryXmlReader
+{
+    public:
+        InMemoryXmlReader(const std::string &doc) : buffer(doc)
+        {
+            std::memset(&reader, 0, sizeof(reader));
+            reader.p_sys = this;
+            reader.pf_next_node = NextNode;
+            reader.pf_next_attr = NextAttr;
+            reader.pf_is_empty = IsEmpty;
+            pos = 0;
+            attr = nullptr;
+            empty = false;
+        }
+
+        xml_reader_t *get()
+        {
+            return &reader;
+        }
+
+    private:
+        static InMemoryXmlReader *self(xml_reader_t *r)
+        {
+            return static_cast<InMemoryXmlReader *>(r->p_sys);
+        }
+
+        static int NextNode(xml_reader_t *r, const char **pval)
+        {
+            InMemoryXmlReader *sys = self(r);
+            std::string &buf = sys->buffer;
+            while(sys->pos < buf.size())
+            {
+                if(buf[sys->pos] != '<')
+                {
+                    size_t end = buf.find('<', sys->pos);
+                    if(end == std::string::npos)
+                        end = buf.size();
+                    size_t start = sys->pos;
+                    sys->pos = end;
+                    if(buf.find_first_not_of(" \t\r\n", start) >= end)
+                        continue; /* blanks */
+                    sys->text.assign(buf, start, end - start);
+                    *pval = sys->text.c_str();
+                    return XML_READER_TEXT;
+                }
+
+                if(!buf.compare(sys->pos, 2, "<?"))
+                {
+                    sys->pos = buf.find("?>", sys->pos) + 2;
+                    continue;
+                }
+                if(!buf.compare(sys->pos, 4, "<!--"))
+                {
+                    sys->pos = buf.find("-->", sys->pos) + 3;
+                    continue;
+                }
+
+                size_t end = buf.find('>', sys->pos);
+                if(end == std::string::npos)
+                    return 0;
+                char *tag = &buf[sys->pos];
+                sys->pos = end + 1;
+                buf[end] = '\0';
+
+                if(tag[1] == '/')
+                {
+                    *pval = tag + 2;
+                    return XML_READER_ENDELEM;
+                }
+
+                sys->empty = (buf[end - 1] == '/');
+                if(sys->empty)
+                    buf[end - 1] = '\0';
+                char *name = tag + 1;
+                char *p = name + strcspn(name, " \t\r\n");
+                sys->attr = *p ? p + 1 : p;
+                *p = '\0';
+                *pval = name;
+                return XML_READER_STARTELEM;
+            }
+            return 0;
+        }
+
+        static const char *NextAttr(xml_reader_t *r, const char **pval)
+        {
+            InMemoryXmlReader *sys = self(r);
+            char *p = sys->attr;
+            if(!p)
+                return nullptr;
+            p += strspn(p, " \t\r\n");
+            char *eq = strchr(p, '=');
+            if(!*p || !eq || eq[1] != '"')
+                return nullptr;
+            *eq = '\0';
+            char *value = eq + 2;
+            char *quote = strchr(value, '"');
+            *quote = '\0';
+            sys->attr = quote + 1;
+            *pval = value;
+            return p;
+        }
+
+        static int IsEmpty(xml_reader_t *r)
+        {
+            return self(r)->empty;
+        }
+
+        xml_reader_t reader;
+        std::string buffer;
+        std::string text;
+        size_t pos;
+        char *attr;
+        bool empty;
+};
+
+/* A 6 hours live DVR window with per segment timeline entries, as encoders
+ * with drifting durations produce, plus a segment list and an on demand
+ * period for the other code paths. */
+static std::string LargeMPD()
+{
+    std::ostringstream os;
+    os << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+          "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"dynamic\""
+          " profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+          " availabilityStartTime=\"2024-01-01T00:00:00Z\""
+          " minimumUpdatePeriod=\"PT2S\" minBufferTime=\"PT4S\""
+          " timeShiftBufferDepth=\"PT6H\" suggestedPresentationDelay=\"PT6S\">\n"
+          "<!-- generated -->\n"
+          "<ProgramInformation moreInformationURL=\"http://example.com/\">"
+          "<Title>Large MPD</Title><Copyright>VideoLAN</Copyright></ProgramInformation>\n"
+          "<BaseURL>http://cdn.example.com/live/</BaseURL>\n"
+          "<Period id=\"live\" start=\"PT0S\">\n"
+          " <AdaptationSet mimeType=\"video/mp4\" segmentAlignment=\"true\">\n"
+          "  <Role schemeIdUri=\"urn:mpeg:dash:role:2011\" value=\"main\"/>\n"
+          "  <SegmentTemplate timescale=\"90000\" startNumber=\"100\""
+          " media=\"$RepresentationID$/$Time$.m4s\" initialization=\"$RepresentationID$/init.mp4\">\n"
+          "   <SegmentTimeline>\n";
+    uint64_t t = 0;
+    for(unsigned i = 0; i < SEGMENTS; i++)
+    {
+        const unsigned d = 180000 - 90 + (i * 37) % 180;
+        if(i == 0)
+            os << "    <S t=\"" << t << "\" d=\"" << d << "\"/>\n";
+        else
+            os << "    <S d=\"" << d << "\"/>\n";
+        t += d;
+    }
+    os << "   </SegmentTimeline>\n"
+          "  </SegmentTemplate>\n";
+    for(unsigned i = 0; i < 5; i++)
+        os << "  <Representation id=\"v" << i << "\" bandwidth=\"" << 500000 * (i + 1)
+           << "\" width=\"" << 384 * (i + 1) << "\" height=\"" << 216 * (i + 1)
+           << "\" codecs=\"avc1.64001f\"/>\n";
+    os << " </AdaptationSet>\n"
+          " <AdaptationSet mimeType=\"audio/mp4\" lang=\"en\">\n"
+          "  <SegmentTemplate timescale=\"48000\" media=\"$RepresentationID$/$Number$.m4s\">\n"
+          "   <SegmentTimeline><S t=\"0\" d=\"96256\" r=\"" << SEGMENTS - 1 << "\"/></SegmentTimeline>\n"
+          "  </SegmentTemplate>\n"
+          "  <Representation id=\"a0\" bandwidth=\"128000\" codecs=\"mp4a.40.2\""
+          " availabilityTimeOffset=\"1.5\" availabilityTimeComplete=\"false\"/>\n"
+          " </AdaptationSet>\n"
+          " <AdaptationSet mimeType=\"application/mp4\" lang=\"fr\">\n"
+          "  <Role schemeIdUri=\"urn:mpeg:dash:role:2011\" value=\"subtitle\"/>\n"
+          "  <Representation id=\"s0\" bandwidth=\"2000\" codecs=\"stpp\">\n"
+          "   <BaseURL>subs/</BaseURL>\n"
+          "   <SegmentList timescale=\"1000\" duration=\"2000\">\n"
+          "    <Initialization sourceURL=\"init.mp4\"/>\n";
+    for(unsigned i = 0; i < SEGMENTS; i++)
+        os << "    <SegmentURL media=\"" << i << ".m4s\" mediaRange=\""
+           << i * 1000 << "-" << i * 1000 + 999 << "\"/>\n";
+    os << "   </SegmentList>\n"
+          "  </Representation>\n"
+          " </AdaptationSet>\n"
+          "</Period>\n"
+          "<Period id=\"vod\" duration=\"PT10M\">\n"
+          " <BaseURL availabilityTimeOffset=\"2\">vod/</BaseURL>\n"
+          " <AdaptationSet mimeType=\"video/mp4\">\n"
+          "  <Representation id=\"o0\" bandwidth=\"800000\">\n"
+          "   <BaseURL>o0.mp4</BaseURL>\n"
+          "   <SegmentBase indexRange=\"800-2000\" timescale=\"1000\"/>\n"
+          "  </Representation>\n"
+          "  <Representation id=\"o1\" bandwidth=\"1600000\">\n"
+          "   <BaseURL>o1.mp4</BaseURL>\n"
+          "   <SegmentBase indexRange=\"900-2100\"><Initialization range=\"0-899\"/></SegmentBase>\n"
+          "  </Representation>\n"
+          " </AdaptationSet>\n"
+          "</Period>\n"
+          "</MPD>\n";
+    return os.str();
+}
+
+/* Rough heap footprint of the DOM tree, which the streaming parser avoids */
+static size_t DOMSize(const Node *node, size_t *count)
+{
+    size_t size = sizeof(*node) + node->getName().capacity() + node->getText().capacity();
+    for(const auto &attr : node->getAttributes())
+        size += 4 * sizeof(void *) + sizeof(attr) +
+                attr.first.capacity() + attr.second.capacity();
+    size += node->getSubNodes().capacity() * sizeof(Node *);
+    (*count)++;
+    for(const Node *sub : node->getSubNodes())
+        size += DOMSize(sub, count);
+    return size;
+}
+
+/* Builds the DOM tree alone, which is what the streaming parser avoids */
+static bool DOMParse(const std::string &doc, size_t *domsize, size_t *count)
+{
+    InMemoryXmlReader reader(doc);
+    DOMParser parser;
+    if(!parser.parse(reader.get(), true))
+        return false;
+    *domsize = DOMSize(parser.getRootNode(), count);
+    return true;
+}
+
+static MPD * StreamParse(const std::string &doc, bool b_strict)
+{
+    InMemoryXmlReader reader(doc);
+    IsoffStreamParser mpdparser(nullptr, nullptr, "http://origin/live/manifest.mpd");
+    return mpdparser.parse(reader.get(), b_strict);
+}
+
+/* Adaptation sets are sorted by role, look them up by type */
+static BaseAdaptationSet * FindSet(BasePeriod *period, const std::string &mime)
+{
+    for(BaseAdaptationSet *set : period->getAdaptationSets())
+        if(set->getMimeType() == mime)
+            return set;
+    throw 1;
+}
+
+static void CheckLivePeriod(BasePeriod *period)
+{
+    Expect(period->getID() == ID("live"));
+    Expect(period->getAdaptationSets().size() == 3);
+    BaseAdaptationSet *sets[3] = {
+        FindSet(period, "video/mp4"),
+        FindSet(period, "audio/mp4"),
+        FindSet(period, "application/mp4"),
+    };
+
+    /* video: one timeline entry per segment, shared by all representations */
+    stime_t total = 0;
+    for(unsigned i = 0; i < SEGMENTS; i++)
+        total += 180000 - 90 + (i * 37) % 180;
+    Expect(sets[0]->isSegmentAligned());
+    const std::vector<BaseRepresentation *> &video = sets[0]->getRepresentations();
+    Expect(video.size() == 5);
+    for(unsigned i = 0; i < video.size(); i++)
+    {
+        BaseRepresentation *rep = video[i];
+        Expect(rep->getID() == ID("v" + std::to_string(i)));
+        Expect(rep->getBandwidth() == 500000 * (i + 1));
+        Expect(rep->getWidth() == (int) (384 * (i + 1)));
+        Expect(rep->getHeight() == (int) (216 * (i + 1)));
+        Expect(rep->getCodecs().size() == 1 && rep->getCodecs().front() == "avc1.64001f");
+        const SegmentTemplate *templ = rep->inheritSegmentTemplate();
+        Expect(templ);
+        const SegmentTimeline *timeline = templ->inheritSegmentTimeline();
+        Expect(timeline);
+        Expect(timeline->getTotalLength() == total);
+        Expect(timeline->minElementNumber() == 100);
+        Expect(timeline->maxElementNumber() == 100 + SEGMENTS - 1);
+        Expect(rep->getInitSegment());
+        Expect(rep->getInitSegment()->getUrlSegment().toString(0, rep) ==
+               "http://cdn.example.com/live/v" + std::to_string(i) + "/init.mp4");
+    }
+    vlc_tick_t time, duration;
+    Expect(video[0]->getPlaybackTimeDurationBySegmentNumber(100, &time, &duration));
+    Expect(time == 0 && duration == vlc_tick_from_samples(180000 - 90, 90000));
+    Expect(!video[0]->getPlaybackTimeDurationBySegmentNumber(100 + SEGMENTS, &time, &duration));
+
+    /* audio: a single repeated timeline entry */
+    Expect(sets[1]->getLang() == "en");
+    const std::vector<BaseRepresentation *> &audio = sets[1]->getRepresentations();
+    Expect(audio.size() == 1);
+    Expect(audio[0]->getID() == ID("a0"));
+    Expect(audio[0]->inheritAvailabilityTimeOffset() == VLC_TICK_FROM_MS(1500));
+    Expect(!audio[0]->inheritAvailabilityTimeComplete());
+    Expect(audio[0]->inheritSegmentTemplate());
+    const SegmentTimeline *timeline = audio[0]->inheritSegmentTemplate()->inheritSegmentTimeline();
+    Expect(timeline && timeline->getTotalLength() == (stime_t) 96256 * SEGMENTS);
+
+    /* subtitles: a segment list with its own base URL */
+    Expect(sets[2]->getLang() == "fr");
+    const std::vector<BaseRepresentation *> &subs = sets[2]->getRepresentations();
+    Expect(subs.size() == 1);
+    const SegmentList *list = subs[0]->inheritSegmentList();
+    Expect(list);
+    Expect(list->getSegments().size() == SEGMENTS);
+    const ISegment *segment = list->getSegments().at(5);
+    Expect(segment->getUrlSegment().toString() == "http://cdn.example.com/live/subs/5.m4s");
+    Expect(segment->getOffset() == 5000);
+    Expect(segment->getSequenceNumber() == 5);
+    Expect(subs[0]->getInitSegment());
+    Expect(subs[0]->getInitSegment()->getUrlSegment().toString() ==
+           "http://cdn.example.com/live/subs/init.mp4");
+}
+
+static void CheckMPD(MPD *mpd)
+{
+    Expect(mpd);
+    Expect(mpd->getProfile() == Profile::Name::ISOLive);
+    Expect(mpd->isLive());
+    Expect(mpd->isLowLatency());
+    Expect(mpd->getMinBuffering() == VLC_TICK_FROM_SEC(4));
+    Expect(mpd->minUpdatePeriod.Get() == VLC_TICK_FROM_SEC(2));
+    Expect(mpd->timeShiftBufferDepth.Get() == VLC_TICK_FROM_SEC(6 * 3600));
+    Expect(mpd->suggestedPresentationDelay.Get() == VLC_TICK_FROM_SEC(6));
+    Expect(mpd->availabilityStartTime.Get() == VLC_TICK_FROM_SEC(1704067200));
+    Expect(mpd->programInfo.Get());
+    Expect(mpd->programInfo.Get()->getTitle() == "Large MPD");
+    Expect(mpd->programInfo.Get()->getCopyright() == "VideoLAN");
+    Expect(mpd->programInfo.Get()->getMoreInformationUrl() == "http://example.com/");
+
+    const std::vector<BasePeriod *> &periods = mpd->getPeriods();
+    Expect(periods.size() == 2);
+    CheckLivePeriod(periods[0]);
+
+    /* on demand: index and init ranges of a single file */
+    BasePeriod *vod = periods[1];
+    Expect(vod->getID() == ID("vod"));
+    Expect(vod->duration.Get() == VLC_TICK_FROM_SEC(600));
+    Expect(vod->inheritAvailabilityTimeOffset() == VLC_TICK_FROM_SEC(2));
+    Expect(vod->getAdaptationSets().size() == 1);
+    const std::vector<BaseRepresentation *> &reps =
+            vod->getAdaptationSets().front()->getRepresentations();
+    Expect(reps.size() == 2);
+    Expect(reps[0]->getIndexSegment());
+    Expect(reps[0]->getIndexSegment()->getOffset() == 800);
+    Expect(reps[1]->getInitSegment());
+    Expect(reps[1]->getUrlSegment().toString() == "http://cdn.example.com/live/vod/o1.mp4");
+}
+
+int MPDStreamParser_test()
+{
+    MPD *mpd = nullptr;
+
+    try
+    {
+        const std::string doc = LargeMPD();
+        vlc_tick_t domtime = VLC_TICK_MAX;
+        vlc_tick_t streamtime = VLC_TICK_MAX;
+        size_t domsize = 0, nodes = 0;
+
+        for(unsigned i = 0; i < RUNS; i++)
+        {
+            delete mpd;
+            nodes = 0;
+
+            vlc_tick_t start = vlc_tick_now();
+            Expect(DOMParse(doc, &domsize, &nodes));
+            domtime = std::min(domtime, vlc_tick_now() - start);
+
+            start = vlc_tick_now();
+            mpd = StreamParse(doc, true);
+            streamtime = std::min(streamtime, vlc_tick_now() - start);
+        }
+
+        CheckMPD(mpd);
+
+        std::cerr << "  " << doc.size() / 1024 << " KiB MPD, " << nodes
+                  << " elements: DOM tree alone " << MS_FROM_VLC_TICK(domtime)
+                  << " ms for " << domsize / 1024 << " KiB, streaming MPD "
+                  << MS_FROM_VLC_TICK(streamtime) << " ms" << std::endl;
+
+        delete mpd;
+        mpd = nullptr;
+
+        /* Truncated documents are only accepted when not strict */
+        const std::string truncated = doc.substr(0, doc.size() * 3 / 4);
+        Expect(StreamParse(truncated, true) == nullptr);
+        mpd = StreamParse(truncated, false);
+        Expect(mpd);
+        Expect(mpd->getPeriods().size() == 1);
+        Expect(mpd->getPeriods().front()->getAdaptationSets().size() == 3);
+        Expect(FindSet(mpd->getPeriods().front(), "application/mp4")
+                  ->getRepresentations().front()->inheritSegmentList()
+                  ->getSegments().size() < SEGMENTS);
+
+        delete mpd;
+    } catch (...) {
+        delete mpd;
+        return 1;
+    }
+
+    return 0;
+}
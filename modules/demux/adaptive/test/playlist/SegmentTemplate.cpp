@@ -96,6 +96,14 @@ int SegmentTemplate_test()
         Expect(templ->getLiveTemplateNumber(now + timescale.ToTime(100) * 2 + 1, true) ==
                templ->getStartSegmentNumber() + 1);
 
+        /* segments announced available before their completion */
+        pl->availabilityStartTime.Set(vlc_tick_from_sec(::time(nullptr) - 100));
+        vlc_tick_t ahead = templ->getMinAheadTime(11);
+        rep->addAttribute(new AvailabilityTimeOffsetAttr(timescale.ToTime(100)));
+        vlc_tick_t earlyahead = templ->getMinAheadTime(11);
+        Expect(earlyahead >= ahead + timescale.ToTime(100));
+        Expect(earlyahead <= ahead + timescale.ToTime(100) * 2); /* clock tick */
+
         /* reset */
         pl->availabilityStartTime.Set(0);
         pl->availabilityEndTime.Set(0);
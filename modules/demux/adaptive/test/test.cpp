@@ -46,9 +46,16 @@ int main()
     TEST(Conversions) ||
     TEST(TemplatedUri) ||
     TEST(BufferingLogic) ||
+    TEST(AdaptationLogics) ||
     TEST(CommandsQueue) ||
     TEST(M3U8MasterPlaylist) ||
     TEST(M3U8Playlist) ||
-    TEST(SegmentTracker)
+    TEST(M3U8LowLatency) ||
+    TEST(M3U8DeltaUpdate) ||
+    TEST(MPDStreamParser) ||
+    TEST(SegmentTracker) ||
+    TEST(Downloader) ||
+    TEST(ChunkedTransfer) ||
+    TEST(SegmentCache)
     ;
 }
@@ -45,9 +45,16 @@ int Timeline_test();
 int Conversions_test();
 int M3U8MasterPlaylist_test();
 int M3U8Playlist_test();
+int M3U8LowLatency_test();
+int M3U8DeltaUpdate_test();
+int MPDStreamParser_test();
 int CommandsQueue_test();
 int BufferingLogic_test();
+int AdaptationLogics_test();
 int FakeEsOut_test();
 int SegmentTracker_test();
+int Downloader_test();
+int ChunkedTransfer_test();
+int SegmentCache_test();
 
 #endif
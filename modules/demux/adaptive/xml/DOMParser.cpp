@@ -69,7 +69,7 @@ bool    DOMParser::parse                    (bool b)
     struct vlc_logger *const logger = vlc_reader->obj.logger;
     if(!b)
         vlc_reader->obj.logger = nullptr;
-    root = processNode(b);
+    root = processNode(vlc_reader, b);
     vlc_reader->obj.logger = logger;
     if ( root == nullptr )
         return false;
@@ -77,6 +77,13 @@ bool    DOMParser::parse                    (bool b)
     return true;
 }
 
+bool    DOMParser::parse                    (xml_reader_t *reader, bool b)
+{
+    delete root;
+    root = processNode(reader, b);
+    return root != nullptr;
+}
+
 bool DOMParser::reset(stream_t *s)
 {
     stream = s;
@@ -90,19 +97,19 @@ bool DOMParser::reset(stream_t *s)
     return !!vlc_reader;
 }
 
-Node* DOMParser::processNode(bool b_strict)
+Node* DOMParser::processNode(xml_reader_t *reader, bool b_strict)
 {
     const char *data;
     int type;
     std::stack<Node *> lifo;
 
-    while( (type = xml_ReaderNextNode(vlc_reader, &data)) > 0 )
+    while( (type = xml_ReaderNextNode(reader, &data)) > 0 )
     {
         switch(type)
         {
             case XML_READER_STARTELEM:
             {
-                bool empty = xml_ReaderIsEmptyElement(vlc_reader);
+                bool empty = xml_ReaderIsEmptyElement(reader);
                 Node *node = new (std::nothrow) Node();
                 if(node)
                 {
@@ -111,7 +118,7 @@ Node* DOMParser::processNode(bool b_strict)
                     lifo.push(node);
 
                     node->setName(std::string(data));
-                    addAttributesToNode(node);
+                    addAttributesToNode(reader, node);
                 }
 
                 if(empty && lifo.size() > 1)
@@ -156,12 +163,12 @@ Node* DOMParser::processNode(bool b_strict)
     return node;
 }
 
-void    DOMParser::addAttributesToNode      (Node *node)
+void    DOMParser::addAttributesToNode      (xml_reader_t *reader, Node *node)
 {
     const char *attrValue;
     const char *attrName;
 
-    while((attrName = xml_ReaderNextAttr(this->vlc_reader, &attrValue)) != nullptr)
+    while((attrName = xml_ReaderNextAttr(reader, &attrValue)) != nullptr)
     {
         std::string key     = attrName;
         std::string value   = attrValue;
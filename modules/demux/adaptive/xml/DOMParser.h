@@ -42,6 +42,7 @@ namespace adaptive
                 virtual ~DOMParser  ();
 
                 bool                parse       (bool);
+                bool                parse       (xml_reader_t *, bool);
                 bool                reset       (stream_t *);
                 Node*               getRootNode ();
                 void                print       ();
@@ -52,8 +53,8 @@ namespace adaptive
 
                 xml_reader_t        *vlc_reader;
 
-                Node*   processNode             (bool);
-                void    addAttributesToNode     (Node *node);
+                Node*   processNode             (xml_reader_t *, bool);
+                void    addAttributesToNode     (xml_reader_t *, Node *node);
                 void    print                   (Node *node, int offset);
         };
     }
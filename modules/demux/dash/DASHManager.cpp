@@ -30,8 +30,7 @@
 
 #include "DASHManager.h"
 #include "mpd/ProgramInformation.h"
-#include "mpd/IsoffMainParser.h"
-#include "xml/DOMParser.h"
+#include "mpd/IsoffStreamParser.h"
 #include "xml/Node.h"
 #include "../adaptive/SharedResources.hpp"
 #include "../adaptive/tools/Helper.h"
@@ -104,24 +103,16 @@ bool DASHManager::updatePlaylist()
             return false;
         }
 
-        xml::DOMParser parser(mpdstream);
-        if(!parser.parse(true))
-        {
-            vlc_stream_Delete(mpdstream);
-            block_Release(p_block);
-            return false;
-        }
-
-        IsoffMainParser mpdparser(parser.getRootNode(), VLC_OBJECT(p_demux),
-                                  mpdstream, Helper::getDirectoryPath(url).append("/"));
-        MPD *newmpd = mpdparser.parse();
-        if(newmpd)
-        {
-            playlist->updateWith(newmpd);
-            delete newmpd;
-        }
+        IsoffStreamParser mpdparser(VLC_OBJECT(p_demux), mpdstream,
+                                    Helper::getDirectoryPath(url).append("/"));
+        MPD *newmpd = mpdparser.parse(true);
         vlc_stream_Delete(mpdstream);
         block_Release(p_block);
+        if(!newmpd)
+            return false;
+
+        playlist->updateWith(newmpd);
+        delete newmpd;
     }
 
     return true;
@@ -0,0 +1,1004 @@
+/*
+ * IsoffStreamParser.cpp
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "IsoffStreamParser.h"
+#include "../../adaptive/playlist/SegmentTemplate.h"
+#include "../../adaptive/playlist/Segment.h"
+#include "../../adaptive/playlist/SegmentBase.h"
+#include "../../adaptive/playlist/SegmentList.h"
+#include "../../adaptive/playlist/SegmentTimeline.h"
+#include "../../adaptive/playlist/SegmentInformation.hpp"
+#include "../../adaptive/playlist/BasePeriod.h"
+#include "MPD.h"
+#include "Representation.h"
+#include "AdaptationSet.h"
+#include "ProgramInformation.h"
+#include "DASHSegment.h"
+#include "Profile.hpp"
+#include "../../adaptive/tools/Helper.h"
+#include "../../adaptive/tools/Conversions.hpp"
+#include <vlc_stream.h>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+using namespace dash::mpd;
+using namespace adaptive::playlist;
+
+#define ELEMENT_BIT(e) (1U << static_cast<unsigned>(e))
+
+IsoffStreamParser::Attributes::Attributes()
+{
+    count = 0;
+}
+
+void IsoffStreamParser::Attributes::clear()
+{
+    count = 0;
+}
+
+void IsoffStreamParser::Attributes::add(const char *key, const char *value)
+{
+    /* keep the strings around, so their storage gets reused */
+    if(count == entries.size())
+        entries.emplace_back();
+    entries[count].first.assign(key);
+    entries[count].second.assign(value);
+    count++;
+}
+
+const std::string * IsoffStreamParser::Attributes::get(const char *key) const
+{
+    for(size_t i = 0; i < count; i++)
+        if(entries[i].first == key)
+            return &entries[i].second;
+    return nullptr;
+}
+
+IsoffStreamParser::IsoffStreamParser(vlc_object_t *p_object_, stream_t *stream,
+                                     const std::string &streambaseurl_)
+{
+    p_object = p_object_;
+    p_stream = stream;
+    playlisturl = streambaseurl_;
+    mpd = nullptr;
+}
+
+IsoffStreamParser::~IsoffStreamParser()
+{
+    clear();
+}
+
+MPD * IsoffStreamParser::parse(bool b_strict)
+{
+    if(!p_stream)
+        return nullptr;
+
+    xml_reader_t *reader = xml_ReaderCreate(p_stream, p_stream);
+    if(!reader)
+        return nullptr;
+
+    struct vlc_logger *const logger = reader->obj.logger;
+    if(!b_strict)
+        reader->obj.logger = nullptr;
+    MPD *ret = parse(reader, b_strict);
+    reader->obj.logger = logger;
+
+    xml_ReaderDelete(reader);
+    return ret;
+}
+
+MPD * IsoffStreamParser::parse(xml_reader_t *reader, bool b_strict)
+{
+    const char *data;
+    int type;
+    bool b_done = false;
+
+    clear();
+
+    while(!b_done && (type = xml_ReaderNextNode(reader, &data)) > 0)
+    {
+        switch(type)
+        {
+            case XML_READER_STARTELEM:
+            {
+                bool empty = xml_ReaderIsEmptyElement(reader);
+                Element element = stack.empty() ? Element::MPD
+                                                : classify(stack.back(), data);
+                attrs.clear();
+                if(element != Element::Unknown)
+                {
+                    const char *name, *value;
+                    while((name = xml_ReaderNextAttr(reader, &value)) != nullptr)
+                        attrs.add(name, value);
+                }
+                if(!startElement(element))
+                {
+                    clear();
+                    return nullptr;
+                }
+                if(empty)
+                {
+                    endElement();
+                    b_done = stack.empty();
+                }
+                break;
+            }
+
+            case XML_READER_TEXT:
+            {
+                if(!stack.empty())
+                {
+                    Context &ctx = stack.back();
+                    switch(ctx.element)
+                    {
+                        case Element::BaseURL:
+                        case Element::Title:
+                        case Element::Source:
+                        case Element::Copyright:
+                            ctx.text.assign(data);
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                break;
+            }
+
+            case XML_READER_ENDELEM:
+            {
+                if(stack.empty())
+                {
+                    clear();
+                    return nullptr;
+                }
+                endElement();
+                b_done = stack.empty();
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if(!b_done)
+    {
+        if(b_strict || stack.empty())
+        {
+            clear();
+            return nullptr;
+        }
+        /* keep what was read, as the DOM parser does on truncated documents */
+        while(!stack.empty())
+            endElement();
+    }
+
+    MPD *ret = mpd;
+    mpd = nullptr;
+    if(ret)
+        ret->debug();
+    return ret;
+}
+
+IsoffStreamParser::Element IsoffStreamParser::classify(const Context &parent,
+                                                       const char *name) const
+{
+    Element element = Element::Unknown;
+    bool b_multiple = false;
+
+    switch(parent.element)
+    {
+        case Element::MPD:
+            if(!strcmp(name, "Period"))
+            {
+                element = Element::Period;
+                b_multiple = true;
+            }
+            else if(!strcmp(name, "BaseURL"))
+            {
+                element = Element::BaseURL;
+                b_multiple = true;
+            }
+            else if(!strcmp(name, "ProgramInformation"))
+                element = Element::ProgramInformation;
+            break;
+
+        case Element::ProgramInformation:
+            if(!strcmp(name, "Title"))
+                element = Element::Title;
+            else if(!strcmp(name, "Source"))
+                element = Element::Source;
+            else if(!strcmp(name, "Copyright"))
+                element = Element::Copyright;
+            break;
+
+        case Element::Period:
+        case Element::AdaptationSet:
+        case Element::Representation:
+            if(!strcmp(name, "Representation"))
+            {
+                if(parent.element == Element::AdaptationSet)
+                {
+                    element = Element::Representation;
+                    b_multiple = true;
+                }
+            }
+            else if(!strcmp(name, "AdaptationSet"))
+            {
+                if(parent.element == Element::Period)
+                {
+                    element = Element::AdaptationSet;
+                    b_multiple = true;
+                }
+            }
+            else if(!strcmp(name, "SegmentTemplate"))
+                element = Element::SegmentTemplate;
+            else if(!strcmp(name, "SegmentList"))
+                element = Element::SegmentList;
+            else if(!strcmp(name, "SegmentBase"))
+                element = Element::SegmentBase;
+            else if(!strcmp(name, "BaseURL"))
+                element = Element::BaseURL;
+            else if(!strcmp(name, "Role") && parent.element == Element::AdaptationSet)
+                element = Element::Role;
+            break;
+
+        case Element::SegmentTimeline:
+            if(!strcmp(name, "S"))
+            {
+                element = Element::S;
+                b_multiple = true;
+            }
+            break;
+
+        case Element::SegmentList:
+            if(!strcmp(name, "SegmentURL"))
+            {
+                element = Element::SegmentURL;
+                b_multiple = true;
+                break;
+            }
+            /* fallthrough */
+        case Element::SegmentTemplate:
+            if(!strcmp(name, "SegmentTimeline"))
+            {
+                element = Element::SegmentTimeline;
+                break;
+            }
+            /* fallthrough */
+        case Element::SegmentBase:
+            if(!strcmp(name, "Initialization"))
+                element = Element::Initialization;
+            break;
+
+        default:
+            break;
+    }
+
+    /* Only the first of those is used */
+    if(!b_multiple && (parent.children & ELEMENT_BIT(element)))
+        element = Element::Unknown;
+
+    return element;
+}
+
+bool IsoffStreamParser::startElement(Element element)
+{
+    if(!stack.empty())
+        stack.back().children |= ELEMENT_BIT(element);
+
+    Context ctx;
+    if(!stack.empty())
+    {
+        const Context &parent = stack.back();
+        ctx.period = parent.period;
+        ctx.adaptationSet = parent.adaptationSet;
+        ctx.representation = parent.representation;
+        ctx.info = parent.info;
+        ctx.base = parent.base;
+        ctx.timeline = parent.timeline;
+        ctx.programInfo = parent.programInfo;
+    }
+    else
+    {
+        ctx.period = nullptr;
+        ctx.adaptationSet = nullptr;
+        ctx.representation = nullptr;
+        ctx.info = nullptr;
+        ctx.base = nullptr;
+        ctx.timeline = nullptr;
+        ctx.programInfo = nullptr;
+    }
+    ctx.element = element;
+    ctx.children = 0;
+    ctx.nextid = 0;
+    ctx.number = 0;
+    ctx.time = 0;
+    ctx.duration = 0;
+    ctx.total = 0;
+    stack.push_back(std::move(ctx));
+
+    Context &current = stack.back();
+    Context *parent = stack.size() > 1 ? &stack[stack.size() - 2] : nullptr;
+
+    switch(element)
+    {
+        case Element::MPD:
+            startMPD();
+            return mpd != nullptr;
+        case Element::ProgramInformation:
+            startProgramInformation(current);
+            break;
+        case Element::BaseURL:
+            startBaseURL(current, *parent);
+            break;
+        case Element::Period:
+            startPeriod(current, *parent);
+            break;
+        case Element::AdaptationSet:
+            startAdaptationSet(current, *parent);
+            break;
+        case Element::Role:
+            parseRole(current);
+            break;
+        case Element::Representation:
+            startRepresentation(current, *parent);
+            break;
+        case Element::SegmentBase:
+            startSegmentBase(current);
+            break;
+        case Element::SegmentList:
+            startSegmentList(current);
+            break;
+        case Element::SegmentTemplate:
+            startSegmentTemplate(current);
+            break;
+        case Element::SegmentTimeline:
+            startSegmentTimeline(current);
+            break;
+        case Element::S:
+            parseTimelineEntry(current);
+            break;
+        case Element::SegmentURL:
+            parseSegmentURL(current);
+            break;
+        case Element::Initialization:
+            parseInitialization(current);
+            break;
+        default:
+            break;
+    }
+
+    /* could not create the element, ignore its content */
+    if(current.element == Element::Unknown)
+        discard(current);
+
+    return true;
+}
+
+void IsoffStreamParser::endElement()
+{
+    Context &ctx = stack.back();
+    Context *parent = stack.size() > 1 ? &stack[stack.size() - 2] : nullptr;
+
+    switch(ctx.element)
+    {
+        case Element::MPD:
+            mpd->addAttribute(new StartnumberAttr(1));
+            break;
+
+        case Element::ProgramInformation:
+            mpd->programInfo.Set(ctx.programInfo);
+            ctx.programInfo = nullptr;
+            break;
+
+        case Element::Title:
+            ctx.programInfo->setTitle(ctx.text);
+            break;
+
+        case Element::Source:
+            ctx.programInfo->setSource(ctx.text);
+            break;
+
+        case Element::Copyright:
+            ctx.programInfo->setCopyright(ctx.text);
+            break;
+
+        case Element::BaseURL:
+            switch(parent->element)
+            {
+                case Element::MPD:
+                    mpd->addBaseUrl(ctx.text);
+                    break;
+                case Element::Period:
+                    ctx.period->baseUrl.Set(new Url(ctx.text));
+                    break;
+                case Element::AdaptationSet:
+                    ctx.adaptationSet->baseUrl.Set(new Url(ctx.text));
+                    break;
+                case Element::Representation:
+                    ctx.representation->baseUrl.Set(new Url(ctx.text));
+                    break;
+                default:
+                    break;
+            }
+            break;
+
+        case Element::Period:
+            for(AbstractAttr *attr : ctx.pending)
+                ctx.period->addAttribute(attr);
+            ctx.pending.clear();
+            mpd->addPeriod(ctx.period);
+            break;
+
+        case Element::AdaptationSet:
+            for(AbstractAttr *attr : ctx.pending)
+                ctx.adaptationSet->addAttribute(attr);
+            ctx.pending.clear();
+#ifdef ADAPTATIVE_ADVANCED_DEBUG
+            if(ctx.adaptationSet->description.Get().empty())
+                ctx.adaptationSet->description.Set(ctx.adaptationSet->getID().str());
+#endif
+            if(!ctx.adaptationSet->getRepresentations().empty())
+                ctx.period->addAdaptationSet(ctx.adaptationSet);
+            else
+                delete ctx.adaptationSet;
+            break;
+
+        case Element::Representation:
+        {
+            Representation *rep = ctx.representation;
+            for(AbstractAttr *attr : ctx.pending)
+                rep->addAttribute(attr);
+            ctx.pending.clear();
+            /* Empty Representation with just baseurl (ex: subtitles) */
+            if(ctx.total == 0 &&
+               (rep->baseUrl.Get() && !rep->baseUrl.Get()->empty()) &&
+                ctx.adaptationSet->getMediaSegment(0) == nullptr)
+            {
+                SegmentBase *base = new (std::nothrow) SegmentBase(rep);
+                if(base)
+                    rep->addAttribute(base);
+            }
+            ctx.adaptationSet->addRepresentation(rep);
+            break;
+        }
+
+        case Element::SegmentBase:
+        {
+            SegmentBase *base = static_cast<SegmentBase *>(ctx.base);
+            if(!base->initialisationSegment.Get() && base->indexSegment.Get() &&
+               base->indexSegment.Get()->getOffset())
+            {
+                InitSegment *initSeg = new InitSegment(ctx.info);
+                initSeg->setSourceUrl(base->getUrlSegment().toString());
+                initSeg->setByteRange(0, base->indexSegment.Get()->getOffset() - 1);
+                base->initialisationSegment.Set(initSeg);
+            }
+            ctx.info->addAttribute(base);
+            parent->total += 1;
+            break;
+        }
+
+        case Element::SegmentList:
+        {
+            SegmentList *list = static_cast<SegmentList *>(ctx.base);
+            parent->total += list->getSegments().size();
+            ctx.info->updateSegmentList(list, true);
+            break;
+        }
+
+        case Element::SegmentTemplate:
+        {
+            SegmentTemplate *mediaTemplate = static_cast<SegmentTemplate *>(ctx.base);
+            /* /!\ initialization attribute overrides the Initialization element */
+            SegmentTemplateInit *initTemplate;
+            if(!ctx.text.empty() &&
+               (initTemplate = new (std::nothrow) SegmentTemplateInit(mediaTemplate, ctx.info)))
+            {
+                initTemplate->setSourceUrl(ctx.text);
+                delete mediaTemplate->initialisationSegment.Get();
+                mediaTemplate->initialisationSegment.Set(initTemplate);
+            }
+            if(ctx.total == 0) /* no media url */
+                parent->total += 1;
+            ctx.info->setSegmentTemplate(mediaTemplate);
+            break;
+        }
+
+        case Element::SegmentTimeline:
+            ctx.base->addAttribute(ctx.timeline);
+            break;
+
+        default:
+            break;
+    }
+
+    stack.pop_back();
+}
+
+/* Releases the objects not yet handed over to their parent */
+void IsoffStreamParser::discard(Context &ctx)
+{
+    for(AbstractAttr *attr : ctx.pending)
+        delete attr;
+    ctx.pending.clear();
+
+    switch(ctx.element)
+    {
+        case Element::MPD:
+            delete mpd;
+            mpd = nullptr;
+            break;
+        case Element::ProgramInformation:
+            delete ctx.programInfo;
+            break;
+        case Element::Period:
+            delete ctx.period;
+            break;
+        case Element::AdaptationSet:
+            delete ctx.adaptationSet;
+            break;
+        case Element::Representation:
+            delete ctx.representation;
+            break;
+        case Element::SegmentBase:
+        case Element::SegmentList:
+        case Element::SegmentTemplate:
+            delete ctx.base;
+            break;
+        case Element::SegmentTimeline:
+            delete ctx.timeline;
+            break;
+        default:
+            break;
+    }
+    ctx.element = Element::Unknown;
+}
+
+void IsoffStreamParser::clear()
+{
+    while(!stack.empty())
+    {
+        discard(stack.back());
+        stack.pop_back();
+    }
+    delete mpd;
+    mpd = nullptr;
+}
+
+void IsoffStreamParser::startMPD()
+{
+    Profile profile(Profile::Name::Unknown);
+    const std::string *urn = attrs.get("profiles");
+    if(!urn || urn->empty())
+        urn = attrs.get("profile"); //The standard spells it the both ways...
+    if(urn)
+    {
+        size_t pos;
+        size_t nextpos = std::string::npos;
+        do
+        {
+            pos = nextpos + 1;
+            nextpos = urn->find_first_of(",", pos);
+            profile = Profile(urn->substr(pos, nextpos - pos));
+        }
+        while (nextpos != std::string::npos && profile == Profile::Name::Unknown);
+    }
+
+    mpd = new (std::nothrow) MPD(p_object, profile);
+    if(!mpd)
+        return;
+
+    const std::string *value;
+    if((value = attrs.get("mediaPresentationDuration")))
+        mpd->duration.Set(IsoTime(*value));
+
+    if((value = attrs.get("minBufferTime")))
+        mpd->setMinBuffering(IsoTime(*value));
+
+    if((value = attrs.get("minimumUpdatePeriod")))
+    {
+        mpd->b_needsUpdates = true;
+        vlc_tick_t minupdate = IsoTime(*value);
+        if(minupdate > 0)
+            mpd->minUpdatePeriod.Set(minupdate);
+    }
+    else mpd->b_needsUpdates = false;
+
+    if((value = attrs.get("maxSegmentDuration")))
+        mpd->maxSegmentDuration.Set(IsoTime(*value));
+
+    if((value = attrs.get("type")))
+        mpd->setType(*value);
+
+    if((value = attrs.get("availabilityStartTime")))
+        mpd->availabilityStartTime.Set(UTCTime(*value).mtime());
+
+    if((value = attrs.get("availabilityEndTime")))
+        mpd->availabilityEndTime.Set(UTCTime(*value).mtime());
+
+    if((value = attrs.get("timeShiftBufferDepth")))
+        mpd->timeShiftBufferDepth.Set(IsoTime(*value));
+
+    if((value = attrs.get("suggestedPresentationDelay")))
+        mpd->suggestedPresentationDelay.Set(IsoTime(*value));
+
+    mpd->setPlaylistUrl( Helper::getDirectoryPath(playlisturl).append("/") );
+}
+
+void IsoffStreamParser::startProgramInformation(Context &ctx)
+{
+    ctx.programInfo = new (std::nothrow) ProgramInformation();
+    if(!ctx.programInfo)
+    {
+        ctx.element = Element::Unknown;
+        return;
+    }
+
+    const std::string *value = attrs.get("moreInformationURL");
+    if(value)
+        ctx.programInfo->setMoreInformationUrl(*value);
+}
+
+void IsoffStreamParser::startBaseURL(Context &ctx, Context &parent)
+{
+    /* BaseURL availability applies to its parent element; the last
+     * one wins when set in several places */
+    switch(parent.element)
+    {
+        case Element::Period:
+            parseAvailability(ctx.period, &parent.pending);
+            break;
+        case Element::AdaptationSet:
+            parseAvailability(ctx.adaptationSet, nullptr);
+            break;
+        case Element::Representation:
+            parseAvailability(ctx.representation, nullptr);
+            break;
+        default:
+            break;
+    }
+}
+
+void IsoffStreamParser::startPeriod(Context &ctx, Context &parent)
+{
+    ctx.period = new (std::nothrow) BasePeriod(mpd);
+    if(!ctx.period)
+    {
+        ctx.element = Element::Unknown;
+        return;
+    }
+    ctx.info = ctx.period;
+
+    parseSegmentInformation(ctx, parent);
+
+    const std::string *value;
+    if((value = attrs.get("start")))
+        ctx.period->startTime.Set(IsoTime(*value));
+    if((value = attrs.get("duration")))
+        ctx.period->duration.Set(IsoTime(*value));
+}
+
+void IsoffStreamParser::startAdaptationSet(Context &ctx, Context &parent)
+{
+    AdaptationSet *adaptationSet = new AdaptationSet(ctx.period);
+    ctx.adaptationSet = adaptationSet;
+    ctx.info = adaptationSet;
+
+    parseCommonAttributesElements(adaptationSet);
+
+    const std::string *value;
+    if((value = attrs.get("lang")))
+        adaptationSet->setLang(*value);
+
+    if((value = attrs.get("bitstreamSwitching")))
+        adaptationSet->setBitswitchAble(*value == "true");
+
+    if((value = attrs.get("segmentAlignment")))
+        adaptationSet->setSegmentAligned(*value == "true");
+
+    parseSegmentInformation(ctx, parent);
+}
+
+void IsoffStreamParser::parseRole(Context &ctx)
+{
+    const std::string *uri = attrs.get("schemeIdUri");
+    const std::string *rolevalue = attrs.get("value");
+    if(!uri || !rolevalue || *uri != "urn:mpeg:dash:role:2011")
+        return;
+
+    AdaptationSet *adaptationSet = ctx.adaptationSet;
+    adaptationSet->description.Set(*rolevalue);
+    if(*rolevalue == "main")
+        adaptationSet->setRole(Role::Value::Main);
+    else if(*rolevalue == "alternate")
+        adaptationSet->setRole(Role::Value::Alternate);
+    else if(*rolevalue == "supplementary")
+        adaptationSet->setRole(Role::Value::Supplementary);
+    else if(*rolevalue == "commentary")
+        adaptationSet->setRole(Role::Value::Commentary);
+    else if(*rolevalue == "dub")
+        adaptationSet->setRole(Role::Value::Dub);
+    else if(*rolevalue == "caption")
+        adaptationSet->setRole(Role::Value::Caption);
+    else if(*rolevalue == "subtitle")
+        adaptationSet->setRole(Role::Value::Subtitle);
+}
+
+void IsoffStreamParser::startRepresentation(Context &ctx, Context &parent)
+{
+    Representation *rep = new Representation(ctx.adaptationSet);
+    ctx.representation = rep;
+    ctx.info = rep;
+
+    parseCommonAttributesElements(rep);
+
+    const std::string *value;
+    if((value = attrs.get("bandwidth")))
+        rep->setBandwidth(atoi(value->c_str()));
+
+    if((value = attrs.get("codecs")))
+        rep->addCodecs(*value);
+
+    parseSegmentInformation(ctx, parent);
+}
+
+void IsoffStreamParser::parseCommonAttributesElements(CommonAttributesElements *commonAttrElements)
+{
+    const std::string *value;
+    if((value = attrs.get("width")))
+        commonAttrElements->setWidth(atoi(value->c_str()));
+
+    if((value = attrs.get("height")))
+        commonAttrElements->setHeight(atoi(value->c_str()));
+
+    if((value = attrs.get("mimeType")))
+        commonAttrElements->setMimeType(*value);
+}
+
+/* Own attributes are only added once the Segment* children have been,
+ * so that they take precedence over the inherited ones */
+void IsoffStreamParser::parseSegmentInformation(Context &ctx, Context &parent)
+{
+    const std::string *value;
+    if((value = attrs.get("timescale")))
+        ctx.pending.push_back(new TimescaleAttr(Timescale(Integer<uint64_t>(*value))));
+
+    parseAvailability(ctx.info, &ctx.pending);
+
+    if((value = attrs.get("id")))
+        ctx.info->setID(ID(*value));
+    else
+        ctx.info->setID(ID(parent.nextid++));
+}
+
+void IsoffStreamParser::parseAvailability(AttrsNode *node, std::vector<AbstractAttr *> *pending)
+{
+    AbstractAttr *created[2];
+    size_t count = 0;
+
+    const std::string *value;
+    if((value = attrs.get("availabilityTimeOffset")))
+    {
+        double val = Integer<double>(*value);
+        created[count++] = new AvailabilityTimeOffsetAttr(val * CLOCK_FREQ);
+    }
+    if((value = attrs.get("availabilityTimeComplete")))
+    {
+        bool b = (*value == "false");
+        created[count++] = new AvailabilityTimeCompleteAttr(!b);
+        if(b)
+            mpd->setLowLatency(b);
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(pending)
+            pending->push_back(created[i]);
+        else
+            node->addAttribute(created[i]);
+    }
+}
+
+void IsoffStreamParser::parseSegmentBaseType(Context &ctx)
+{
+    const std::string *value;
+    if((value = attrs.get("indexRange")))
+    {
+        size_t start = 0, end = 0;
+        if (std::sscanf(value->c_str(), "%zu-%zu", &start, &end) == 2)
+        {
+            IndexSegment *index = new (std::nothrow) DashIndexSegment(ctx.info);
+            if(index)
+            {
+                index->setByteRange(start, end);
+                ctx.base->indexSegment.Set(index);
+                /* index must be before data, so data starts at index end */
+                if(ctx.element == Element::SegmentBase)
+                    static_cast<SegmentBase *>(ctx.base)->setByteRange(end + 1, 0);
+            }
+        }
+    }
+
+    if((value = attrs.get("timescale")))
+        ctx.base->addAttribute(new TimescaleAttr(Timescale(Integer<uint64_t>(*value))));
+}
+
+void IsoffStreamParser::parseMultipleSegmentBaseType(Context &ctx)
+{
+    parseSegmentBaseType(ctx);
+
+    const std::string *value;
+    if((value = attrs.get("duration")))
+        ctx.base->addAttribute(new DurationAttr(Integer<stime_t>(*value)));
+
+    if((value = attrs.get("startNumber")))
+        ctx.base->addAttribute(new StartnumberAttr(Integer<uint64_t>(*value)));
+}
+
+void IsoffStreamParser::startSegmentBase(Context &ctx)
+{
+    SegmentBase *base = new (std::nothrow) SegmentBase(ctx.info);
+    if(!base)
+    {
+        ctx.element = Element::Unknown;
+        return;
+    }
+    ctx.base = base;
+
+    parseSegmentBaseType(ctx);
+
+    parseAvailability(ctx.info, nullptr);
+}
+
+void IsoffStreamParser::startSegmentList(Context &ctx)
+{
+    SegmentList *list = new (std::nothrow) SegmentList(ctx.info);
+    if(!list)
+    {
+        ctx.element = Element::Unknown;
+        return;
+    }
+    ctx.base = list;
+
+    parseMultipleSegmentBaseType(ctx);
+
+    parseAvailability(ctx.info, nullptr);
+
+    ctx.number = ctx.info->inheritStartNumber();
+    if(ctx.number == std::numeric_limits<uint64_t>::max())
+        ctx.number = 0;
+    ctx.duration = list->inheritDuration();
+    ctx.time = ctx.number * ctx.duration;
+}
+
+void IsoffStreamParser::parseSegmentURL(Context &ctx)
+{
+    Context &list = stack[stack.size() - 2];
+
+    Segment *seg = new (std::nothrow) Segment(ctx.info);
+    if(!seg)
+        return;
+
+    const std::string *value = attrs.get("media");
+    if(value && !value->empty())
+        seg->setSourceUrl(*value);
+
+    if((value = attrs.get("mediaRange")))
+    {
+        size_t pos = value->find("-");
+        seg->setByteRange(atoi(value->substr(0, pos).c_str()),
+                          atoi(value->substr(pos + 1, value->size()).c_str()));
+    }
+
+    seg->startTime.Set(list.time);
+    seg->duration.Set(list.duration);
+    list.time += list.duration;
+
+    seg->setSequenceNumber(list.number++);
+
+    static_cast<SegmentList *>(ctx.base)->addSegment(seg);
+}
+
+void IsoffStreamParser::startSegmentTemplate(Context &ctx)
+{
+    const std::string *mediaurl = attrs.get("media");
+
+    SegmentTemplate *mediaTemplate =
+            new (std::nothrow) SegmentTemplate(new SegmentTemplateSegment(), ctx.info);
+    if(!mediaTemplate)
+    {
+        ctx.element = Element::Unknown;
+        return;
+    }
+    ctx.base = mediaTemplate;
+    mediaTemplate->setSourceUrl(mediaurl ? *mediaurl : std::string());
+    ctx.total = (mediaurl && !mediaurl->empty()) ? 1 : 0;
+
+    parseMultipleSegmentBaseType(ctx);
+
+    parseAvailability(ctx.info, nullptr);
+
+    const std::string *initurl = attrs.get("initialization");
+    if(initurl)
+        ctx.text = *initurl;
+}
+
+void IsoffStreamParser::startSegmentTimeline(Context &ctx)
+{
+    const std::string *value = attrs.get("startNumber");
+    if(value)
+        ctx.number = Integer<uint64_t>(*value);
+    else if(ctx.base->inheritStartNumber())
+        ctx.number = ctx.base->inheritStartNumber();
+
+    ctx.timeline = new (std::nothrow) SegmentTimeline(
+                static_cast<AbstractMultipleSegmentBaseType *>(ctx.base));
+    if(!ctx.timeline)
+        ctx.element = Element::Unknown;
+}
+
+void IsoffStreamParser::parseTimelineEntry(Context &ctx)
+{
+    Context &timeline = stack[stack.size() - 2];
+
+    const std::string *value = attrs.get("d");
+    if(!value) /* Mandatory */
+        return;
+    stime_t d = Integer<stime_t>(*value);
+    int64_t r = 0; // never repeats by default
+    if((value = attrs.get("r")))
+    {
+        r = Integer<int64_t>(*value);
+        if(r < 0)
+            r = std::numeric_limits<unsigned>::max();
+    }
+
+    if((value = attrs.get("t")))
+    {
+        stime_t t = Integer<stime_t>(*value);
+        ctx.timeline->addElement(timeline.number, d, r, t);
+    }
+    else ctx.timeline->addElement(timeline.number, d, r);
+
+    timeline.number += (1 + r);
+}
+
+void IsoffStreamParser::parseInitialization(Context &ctx)
+{
+    InitSegment *seg = new InitSegment(ctx.info);
+    const std::string *value = attrs.get("sourceURL");
+    seg->setSourceUrl(value ? *value : std::string());
+
+    if((value = attrs.get("range")))
+    {
+        size_t pos = value->find("-");
+        seg->setByteRange(atoi(value->substr(0, pos).c_str()),
+                          atoi(value->substr(pos + 1, value->size()).c_str()));
+    }
+
+    ctx.base->initialisationSegment.Set(seg);
+}
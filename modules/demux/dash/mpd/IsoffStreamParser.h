@@ -0,0 +1,168 @@
+/*
+ * IsoffStreamParser.h
+ *****************************************************************************
+ * Copyright (C) 2024 VideoLabs, VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef ISOFFSTREAMPARSER_H_
+#define ISOFFSTREAMPARSER_H_
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../adaptive/playlist/SegmentBaseType.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vlc_common.h>
+#include <vlc_xml.h>
+
+namespace adaptive
+{
+    namespace playlist
+    {
+        class AbstractAttr;
+        class AttrsNode;
+        class CommonAttributesElements;
+        class SegmentInformation;
+        class SegmentTimeline;
+        class SegmentList;
+        class BasePeriod;
+    }
+}
+
+namespace dash
+{
+    namespace mpd
+    {
+        class AdaptationSet;
+        class Representation;
+        class ProgramInformation;
+        class MPD;
+
+        using namespace adaptive::playlist;
+        using namespace adaptive;
+
+        /* Builds the MPD straight from the xml reader events, without going
+         * through a DOM tree: only the path to the current element is kept,
+         * so that memory does not grow with timelines or segment lists. */
+        class IsoffStreamParser
+        {
+            public:
+                IsoffStreamParser           (vlc_object_t *p_object, stream_t *p_stream,
+                                             const std::string &);
+                ~IsoffStreamParser          ();
+                MPD *   parse               (bool b_strict);
+                MPD *   parse               (xml_reader_t *, bool b_strict);
+
+            private:
+                enum class Element
+                {
+                    Unknown,
+                    MPD,
+                    ProgramInformation,
+                    Title,
+                    Source,
+                    Copyright,
+                    BaseURL,
+                    Period,
+                    AdaptationSet,
+                    Role,
+                    Representation,
+                    SegmentBase,
+                    SegmentList,
+                    SegmentTemplate,
+                    SegmentTimeline,
+                    S,
+                    SegmentURL,
+                    Initialization,
+                };
+
+                /* Current element and the objects it inherits from its parents */
+                struct Context
+                {
+                    Element                 element;
+                    unsigned                children; /* seen elements, by bit */
+                    BasePeriod             *period;
+                    AdaptationSet          *adaptationSet;
+                    Representation         *representation;
+                    SegmentInformation     *info;
+                    AbstractSegmentBaseType *base;
+                    SegmentTimeline        *timeline;
+                    ProgramInformation     *programInfo;
+                    uint64_t                nextid;   /* for children without id */
+                    uint64_t                number;   /* next timeline or list entry */
+                    stime_t                 time;     /* next list entry start */
+                    stime_t                 duration; /* of list entries */
+                    size_t                  total;    /* segments, for Representation */
+                    std::vector<AbstractAttr *> pending; /* own attributes */
+                    std::string             text;
+                };
+
+                class Attributes
+                {
+                    public:
+                        Attributes();
+                        void                clear();
+                        void                add(const char *, const char *);
+                        const std::string * get(const char *) const;
+
+                    private:
+                        std::vector<std::pair<std::string, std::string>> entries;
+                        size_t count;
+                };
+
+                Element classify            (const Context &, const char *) const;
+                bool    startElement        (Element);
+                void    endElement          ();
+                void    discard             (Context &);
+                void    clear               ();
+
+                void    startMPD            ();
+                void    startProgramInformation(Context &);
+                void    startBaseURL        (Context &, Context &);
+                void    startPeriod         (Context &, Context &);
+                void    startAdaptationSet  (Context &, Context &);
+                void    startRepresentation (Context &, Context &);
+                void    startSegmentBase    (Context &);
+                void    startSegmentList    (Context &);
+                void    startSegmentTemplate(Context &);
+                void    startSegmentTimeline(Context &);
+                void    parseRole           (Context &);
+                void    parseTimelineEntry  (Context &);
+                void    parseSegmentURL     (Context &);
+                void    parseInitialization (Context &);
+                void    parseCommonAttributesElements(CommonAttributesElements *);
+                void    parseSegmentInformation(Context &, Context &);
+                void    parseSegmentBaseType(Context &);
+                void    parseMultipleSegmentBaseType(Context &);
+                void    parseAvailability   (AttrsNode *, std::vector<AbstractAttr *> *);
+
+                vlc_object_t        *p_object;
+                stream_t            *p_stream;
+                std::string          playlisturl;
+                MPD                 *mpd;
+                std::vector<Context> stack;
+                Attributes           attrs;
+        };
+    }
+}
+
+#endif /* ISOFFSTREAMPARSER_H_ */
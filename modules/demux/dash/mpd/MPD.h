@@ -40,7 +40,7 @@ namespace dash
 
         class MPD : public BasePlaylist
         {
-            friend class IsoffMainParser;
+            friend class IsoffStreamParser;
 
             public:
                 MPD(vlc_object_t *, Profile);
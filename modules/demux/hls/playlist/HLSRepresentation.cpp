@@ -34,6 +34,7 @@
 #include <ctime>
 #include <limits>
 #include <cassert>
+#include <sstream>
 
 using namespace hls;
 using namespace hls::playlist;
@@ -43,9 +44,15 @@ HLSRepresentation::HLSRepresentation  ( BaseAdaptationSet *set ) :
 {
     b_live = true;
     b_loaded = false;
+    b_canblockreload = false;
+    canSkipUntil = 0;
+    b_fullreload = false;
+    nextMediaSequence = 0;
+    nextPartIndex = 0;
     updateFailureCount = 0;
     lastUpdateTime = 0;
     targetDuration = 0;
+    partTarget = 0;
     streamFormat = StreamFormat::Type::Unknown;
 }
 
@@ -63,6 +70,11 @@ bool HLSRepresentation::isLive() const
     return b_live;
 }
 
+bool HLSRepresentation::isLowLatency() const
+{
+    return b_live && partTarget > 0;
+}
+
 bool HLSRepresentation::initialized() const
 {
     return b_loaded;
@@ -88,6 +100,33 @@ Url HLSRepresentation::getPlaylistUrl() const
     }
 }
 
+std::string HLSRepresentation::getPlaylistUpdateUrl() const
+{
+    std::string url = getPlaylistUrl().toString();
+    if(!b_loaded || !b_live)
+        return url;
+
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    char sep = url.find('?') == std::string::npos ? '?' : '&';
+    if(b_canblockreload)
+    {
+        /* Blocking reload, server responds once the next segment or part
+         * is available */
+        os << sep << "_HLS_msn=" << nextMediaSequence;
+        if(partTarget)
+            os << "&_HLS_part=" << nextPartIndex;
+        sep = '&';
+    }
+    /* Delta update, older segments we already have are skipped. Our copy
+     * must not be older than half the skip boundary. */
+    if(canSkipUntil && lastUpdateTime && !b_fullreload &&
+       vlc_tick_now() - lastUpdateTime < canSkipUntil / 2)
+        os << sep << "_HLS_skip=YES";
+    url.append(os.str());
+    return url;
+}
+
 void HLSRepresentation::debug(vlc_object_t *obj, int indent) const
 {
     BaseRepresentation::debug(obj, indent);
@@ -100,7 +139,7 @@ void HLSRepresentation::debug(vlc_object_t *obj, int indent) const
     }
 }
 
-void HLSRepresentation::scheduleNextUpdate(uint64_t, bool b_updated)
+void HLSRepresentation::scheduleNextUpdate(uint64_t number, bool b_updated)
 {
     if(!isLive())
         return;
@@ -121,6 +160,10 @@ void HLSRepresentation::scheduleNextUpdate(uint64_t, bool b_updated)
 
     lastUpdateTime = now;
 
+    if(isLowLatency() && number != std::numeric_limits<uint64_t>::max())
+        msg_Dbg(playlist->getVLCObject(), "Live edge distance for ID %s is %" PRId64 "ms",
+                getID().str().c_str(), MS_FROM_VLC_TICK(getMinAheadTime(number)));
+
     debug(playlist->getVLCObject(), 0);
 }
 
@@ -128,7 +171,7 @@ bool HLSRepresentation::needsUpdate(uint64_t number) const
 {
     if(updateFailureCount > MAX_UPDATE_FAILED_UPDATE_COUNT)
         return false;
-    if(!b_loaded)
+    if(!b_loaded || b_fullreload)
         return true;
     if(isLive())
     {
@@ -137,6 +180,19 @@ bool HLSRepresentation::needsUpdate(uint64_t number) const
         vlc_tick_t duration = targetDuration
                             ? vlc_tick_from_sec(targetDuration)
                             : VLC_TICK_FROM_SEC(2);
+        if(isLowLatency())
+        {
+            duration = partTarget;
+            /* Server holds the request until there's something new,
+             * so reload as soon as we run out of parts instead of polling */
+            if(b_canblockreload && !updateFailureCount &&
+               number != std::numeric_limits<uint64_t>::max())
+            {
+                uint64_t next;
+                bool b_gap;
+                return !getNextMediaSegment(number, &next, &b_gap);
+            }
+        }
         if(updateFailureCount)
             duration /= 2;
         if(elapsed < duration)
@@ -179,7 +235,27 @@ bool HLSRepresentation::canNoLongerUpdate() const
 
 uint64_t HLSRepresentation::translateSegmentNumber(uint64_t num, const BaseRepresentation *from) const
 {
-    if(targetDuration == static_cast<const HLSRepresentation *>(from)->targetDuration)
+    /* Low latency numbering is local to each playlist */
+    if(isLowLatency())
+    {
+        const HLSSegment *fromSeg = dynamic_cast<const HLSSegment *>(from->getMediaSegment(num));
+        const SegmentList *segmentList = inheritSegmentList();
+        if(fromSeg && segmentList)
+        {
+            const Segment *match = nullptr;
+            for(const Segment *seg : segmentList->getSegments())
+            {
+                const HLSSegment *hlsseg = static_cast<const HLSSegment *>(seg);
+                if(hlsseg->isSameMedia(fromSeg))
+                    return hlsseg->getSequenceNumber();
+                if(!match && hlsseg->getMediaSequenceNumber() == fromSeg->getMediaSequenceNumber())
+                    match = hlsseg;
+            }
+            if(match)
+                return match->getSequenceNumber();
+        }
+    }
+    else if(targetDuration == static_cast<const HLSRepresentation *>(from)->targetDuration)
         return num;
 
     ISegment *fromSeg = from->getMediaSegment(num);
@@ -45,7 +45,9 @@ namespace hls
 
                 void setPlaylistUrl(const std::string &);
                 Url getPlaylistUrl() const;
+                std::string getPlaylistUpdateUrl() const;
                 bool isLive() const;
+                bool isLowLatency() const;
                 bool initialized() const;
                 virtual void scheduleNextUpdate(uint64_t, bool) override;
                 virtual bool needsUpdate(uint64_t) const override;
@@ -57,6 +59,7 @@ namespace hls
 
             protected:
                 time_t targetDuration;
+                vlc_tick_t partTarget;
                 Url playlistUrl;
 
             private:
@@ -64,6 +67,11 @@ namespace hls
                 StreamFormat streamFormat;
                 bool b_live;
                 bool b_loaded;
+                bool b_canblockreload;
+                vlc_tick_t canSkipUntil;
+                bool b_fullreload;
+                uint64_t nextMediaSequence;
+                unsigned nextPartIndex;
                 unsigned updateFailureCount;
                 vlc_tick_t lastUpdateTime;
         };
@@ -31,19 +31,60 @@ HLSSegment::HLSSegment( ICanonicalUrl *parent, uint64_t seq ) :
     Segment( parent )
 {
     setSequenceNumber(seq);
+    mediaSequence = seq;
+    partIndex = 0;
+    b_part = false;
+    b_preloadhint = false;
 }
 
 HLSSegment::~HLSSegment()
 {
 }
 
+void HLSSegment::setPart(uint64_t msn, unsigned index, bool b_hint)
+{
+    mediaSequence = msn;
+    partIndex = index;
+    b_part = true;
+    b_preloadhint = b_hint;
+    debugName = b_hint ? "PreloadHint" : "Part";
+}
+
+bool HLSSegment::isPart() const
+{
+    return b_part;
+}
+
+bool HLSSegment::isPreloadHint() const
+{
+    return b_preloadhint;
+}
+
+bool HLSSegment::isSameMedia(const HLSSegment *other) const
+{
+    return mediaSequence == other->mediaSequence &&
+           b_part == other->b_part &&
+           (!b_part || partIndex == other->partIndex);
+}
+
+uint64_t HLSSegment::getMediaSequenceNumber() const
+{
+    return mediaSequence;
+}
+
+unsigned HLSSegment::getPartIndex() const
+{
+    return partIndex;
+}
+
 bool HLSSegment::prepareChunk(SharedResources *res, SegmentChunk *chunk, BaseRepresentation *rep)
 {
     if(encryption.method == CommonEncryption::Method::AES_128)
     {
         if (encryption.iv.size() != 16)
         {
-            uint64_t sequence = getSequenceNumber();
+            /* Parts share the IV of their media segment */
+            uint64_t sequence = mediaSequence;
             encryption.iv.clear();
             encryption.iv.resize(16);
             encryption.iv[15] = (sequence >> 0) & 0xff;
@@ -38,10 +38,23 @@ namespace hls
             public:
                 HLSSegment( ICanonicalUrl *parent, uint64_t sequence );
                 virtual ~HLSSegment();
+                /* Low latency partial segment or preload hint of media segment */
+                void setPart(uint64_t, unsigned, bool = false);
+                bool isPart() const;
+                bool isPreloadHint() const;
+                bool isSameMedia(const HLSSegment *) const;
+                uint64_t getMediaSequenceNumber() const;
+                unsigned getPartIndex() const;
 
             protected:
                 virtual bool prepareChunk(SharedResources *, SegmentChunk *,
                                           BaseRepresentation *) override;
+
+            private:
+                uint64_t mediaSequence;
+                unsigned partIndex;
+                bool b_part;
+                bool b_preloadhint;
         };
     }
 }
@@ -163,7 +163,7 @@ void M3U8Parser::createAndFillRepresentation(vlc_object_t *p_obj, BaseAdaptation
 
 bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, HLSRepresentation *rep)
 {
-    block_t *p_block = Retrieve::HTTP(resources, ChunkType::Playlist, rep->getPlaylistUrl().toString());
+    block_t *p_block = Retrieve::HTTP(resources, ChunkType::Playlist, rep->getPlaylistUpdateUrl());
     if(p_block)
     {
         stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
@@ -217,17 +217,75 @@ static bool parseEncryption(const AttributesTag *keytag, const Url &playlistUrl,
     }
 }
 
+/* Numbers the entries of a low latency playlist. As parts are only listed
+ * for the last segments, numbering is dense over segments and parts, and
+ * carried over from the previous playlist through the latest media in both. */
+static void numberParts(const SegmentList *previous, std::list<HLSSegment *> &entries)
+{
+    if(entries.empty())
+        return;
+
+    uint64_t number = entries.front()->getMediaSequenceNumber();
+    for(HLSSegment *seg : entries)
+        seg->setSequenceNumber(number++);
+
+    if(!previous || previous->getSegments().empty())
+        return;
+
+    const std::vector<Segment *> &list = previous->getSegments();
+    uint64_t delta = list.back()->getSequenceNumber() + 1 -
+                     entries.front()->getSequenceNumber();
+    for(auto it = entries.crbegin(); it != entries.crend(); ++it)
+    {
+        const HLSSegment *seg = *it;
+        auto match = std::find_if(list.crbegin(), list.crend(), [seg](const Segment *s)
+                        { return static_cast<const HLSSegment *>(s)->isSameMedia(seg); });
+        if(match != list.crend())
+        {
+            delta = (*match)->getSequenceNumber() - seg->getSequenceNumber();
+            break;
+        }
+    }
+
+    for(HLSSegment *seg : entries)
+        seg->setSequenceNumber(seg->getSequenceNumber() + delta);
+}
+
+/* Entry of a previous playlist for a whole media segment */
+static const HLSSegment * findMediaSegment(const SegmentList *list, uint64_t msn)
+{
+    for(const Segment *seg : list->getSegments())
+    {
+        const HLSSegment *hlsseg = static_cast<const HLSSegment *>(seg);
+        if(hlsseg->getMediaSequenceNumber() == msn && !hlsseg->isPart())
+            return hlsseg;
+    }
+    return nullptr;
+}
+
 void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std::list<Tag *> &tagslist)
 {
     bool b_pdt = tagslist.cend() != std::find_if(tagslist.cbegin(), tagslist.cend(),
                     [](const Tag *t){return t->getType() == SingleValueTag::EXTXPROGRAMDATETIME;});
     bool b_vod = tagslist.size() && tagslist.back()->getType() == SingleValueTag::EXTXENDLIST;
+    bool b_parts = tagslist.cend() != std::find_if(tagslist.cbegin(), tagslist.cend(),
+                    [](const Tag *t){return t->getType() == AttributesTag::EXTXPARTINF;});
+
+    /* Live updates only need the entries following the ones we have */
+    const SegmentList *previous = (rep->b_loaded && rep->b_live) ? rep->inheritSegmentList()
+                                                                 : nullptr;
+    if(previous && previous->getSegments().empty())
+        previous = nullptr;
 
     SegmentList *segmentList = new SegmentList(rep, !b_vod && !b_pdt);
     const Timescale timescale = rep->inheritTimescale();
 
     rep->b_loaded = true;
     rep->b_live = !b_vod;
+    rep->partTarget = 0;
+    rep->b_canblockreload = false;
+    rep->canSkipUntil = 0;
+    rep->b_fullreload = false;
 
     vlc_tick_t totalduration = 0;
     vlc_tick_t nzStartTime = 0;
@@ -236,12 +294,50 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
     uint64_t discontinuitySequence = 0;
     bool discontinuity = false;
     std::size_t prevbyterangeoffset = 0;
+    std::size_t prevpartbyterangeoffset = 0;
+    unsigned partIndex = 0;
+    uint64_t windowStart = std::numeric_limits<uint64_t>::max();
+    bool b_incremental = false;
+    bool b_skipped = false;
     const SingleValueTag *ctx_byterange = nullptr;
+    const AttributesTag *ctx_preloadhint = nullptr;
     CommonEncryption encryption;
     const ValuesListTag *ctx_extinf = nullptr;
 
     std::list<HLSSegment *> segmentstoappend;
 
+    auto appendSegment = [&](HLSSegment *segment, vlc_tick_t nzDuration)
+    {
+        segment->duration.Set(timescale.ToScaled(nzDuration));
+        segment->startTime.Set(timescale.ToScaled(nzStartTime));
+        nzStartTime += nzDuration;
+        totalduration += nzDuration;
+        if(absReferenceTime != VLC_TICK_INVALID)
+        {
+            segment->setDisplayTime(absReferenceTime);
+            absReferenceTime += nzDuration;
+        }
+
+        segmentstoappend.push_back(segment);
+
+        segment->setDiscontinuitySequenceNumber(discontinuitySequence);
+        segment->discontinuity = discontinuity;
+        discontinuity = false;
+
+        if(encryption.method != CommonEncryption::Method::None)
+            segment->setEncryption(encryption);
+    };
+
+    /* Advances over an entry we already have */
+    auto skipSegment = [&](vlc_tick_t nzDuration)
+    {
+        nzStartTime += nzDuration;
+        totalduration += nzDuration;
+        if(absReferenceTime != VLC_TICK_INVALID)
+            absReferenceTime += nzDuration;
+        discontinuity = false;
+    };
+
     std::list<Tag *>::const_iterator it;
     for(it = tagslist.begin(); it != tagslist.end(); ++it)
     {
@@ -264,18 +360,26 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
             case SingleValueTag::URI:
             {
                 const SingleValueTag *uritag = static_cast<const SingleValueTag *>(tag);
-                if(uritag->getValue().value.empty())
+                if(uritag->getValue().value.empty() || partIndex)
                 {
+                    /* Segment already listed as parts */
+                    if(partIndex)
+                    {
+                        sequenceNumber++;
+                        partIndex = 0;
+                    }
                     ctx_extinf = nullptr;
                     ctx_byterange = nullptr;
                     break;
                 }
 
-                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
-                if(!segment)
-                    break;
-
-                segment->setSourceUrl(uritag->getValue().value);
+                if(windowStart == std::numeric_limits<uint64_t>::max())
+                {
+                    windowStart = sequenceNumber;
+                    /* unless the sequence was reset */
+                    b_incremental = previous && !b_parts &&
+                        windowStart >= previous->getSegments().front()->getSequenceNumber();
+                }
 
                 /* Need to use EXTXTARGETDURATION as default as some can't properly set segment one */
                 vlc_tick_t nzDuration = vlc_tick_from_sec(rep->targetDuration);
@@ -286,33 +390,131 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
                         nzDuration = vlc_tick_from_sec(durAttribute->floatingPoint());
                     ctx_extinf = nullptr;
                 }
-                segment->duration.Set(timescale.ToScaled(nzDuration));
-                segment->startTime.Set(timescale.ToScaled(nzStartTime));
-                nzStartTime += nzDuration;
-                totalduration += nzDuration;
-                if(absReferenceTime != VLC_TICK_INVALID)
-                {
-                    segment->setDisplayTime(absReferenceTime);
-                    absReferenceTime += nzDuration;
-                }
-
-                segmentstoappend.push_back(segment);
 
+                std::pair<std::size_t,std::size_t> range(0, 0);
                 if(ctx_byterange)
                 {
-                    std::pair<std::size_t,std::size_t> range = ctx_byterange->getValue().getByteRange();
+                    range = ctx_byterange->getValue().getByteRange();
                     if(range.first == 0) /* first == size, second = offset */
                         range.first = prevbyterangeoffset;
                     prevbyterangeoffset = range.first + range.second;
+                }
+
+                if(b_incremental &&
+                   sequenceNumber <= previous->getSegments().back()->getSequenceNumber())
+                {
+                    sequenceNumber++;
+                    ctx_byterange = nullptr;
+                    skipSegment(nzDuration);
+                    break;
+                }
+
+                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
+                if(!segment)
+                    break;
+
+                segment->setSourceUrl(uritag->getValue().value);
+
+                if(ctx_byterange)
+                {
                     segment->setByteRange(range.first, prevbyterangeoffset - 1);
                     ctx_byterange = nullptr;
                 }
-                segment->setDiscontinuitySequenceNumber(discontinuitySequence);
-                segment->discontinuity = discontinuity;
-                discontinuity = false;
 
-                if(encryption.method != CommonEncryption::Method::None)
-                    segment->setEncryption(encryption);
+                appendSegment(segment, nzDuration);
+            }
+            break;
+
+            case AttributesTag::EXTXPART:
+            {
+                const AttributesTag *parttag = static_cast<const AttributesTag *>(tag);
+                const Attribute *uriAttr = parttag->getAttributeByName("URI");
+                const Attribute *durAttr = parttag->getAttributeByName("DURATION");
+                if(!b_parts || !uriAttr || !durAttr)
+                    break;
+
+                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber);
+                if(!segment)
+                    break;
+
+                segment->setPart(sequenceNumber, partIndex++);
+                segment->setSourceUrl(uriAttr->quotedString());
+
+                const Attribute *byterangeAttr = parttag->getAttributeByName("BYTERANGE");
+                if(byterangeAttr)
+                {
+                    std::pair<std::size_t,std::size_t> range = byterangeAttr->unescapeQuotes().getByteRange();
+                    if(range.first == 0) /* continues previous part */
+                        range.first = prevpartbyterangeoffset;
+                    prevpartbyterangeoffset = range.first + range.second;
+                    segment->setByteRange(range.first, prevpartbyterangeoffset - 1);
+                }
+                else prevpartbyterangeoffset = 0;
+
+                appendSegment(segment, vlc_tick_from_sec(durAttr->floatingPoint()));
+            }
+            break;
+
+            case AttributesTag::EXTXPARTINF:
+            {
+                const Attribute *targetAttr = static_cast<const AttributesTag *>(tag)->
+                                              getAttributeByName("PART-TARGET");
+                if(targetAttr)
+                    rep->partTarget = vlc_tick_from_sec(targetAttr->floatingPoint());
+            }
+            break;
+
+            case AttributesTag::EXTXPRELOADHINT:
+            {
+                const Attribute *typeAttr = static_cast<const AttributesTag *>(tag)->
+                                            getAttributeByName("TYPE");
+                if(typeAttr && typeAttr->value == "PART")
+                    ctx_preloadhint = static_cast<const AttributesTag *>(tag);
+            }
+            break;
+
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                const AttributesTag *controltag = static_cast<const AttributesTag *>(tag);
+                const Attribute *attr = controltag->getAttributeByName("CAN-BLOCK-RELOAD");
+                rep->b_canblockreload = attr && attr->value == "YES";
+                attr = controltag->getAttributeByName("CAN-SKIP-UNTIL");
+                if(attr)
+                    rep->canSkipUntil = vlc_tick_from_sec(attr->floatingPoint());
+                attr = controltag->getAttributeByName("HOLD-BACK");
+                if(attr)
+                    rep->getPlaylist()->suggestedPresentationDelay.Set(
+                                vlc_tick_from_sec(attr->floatingPoint()));
+            }
+            break;
+
+            case AttributesTag::EXTXSKIP:
+            {
+                /* Delta update, the oldest segments are the ones we have */
+                const Attribute *attr = static_cast<const AttributesTag *>(tag)->
+                                        getAttributeByName("SKIPPED-SEGMENTS");
+                if(!attr || windowStart != std::numeric_limits<uint64_t>::max())
+                    break;
+                windowStart = sequenceNumber;
+                sequenceNumber += attr->decimal();
+                if(!previous)
+                {
+                    /* Nothing to complete the list with: keep the listed
+                     * segments, and get the whole playlist next time */
+                    rep->b_fullreload = true;
+                    break;
+                }
+                b_skipped = true;
+
+                const HLSSegment *last = findMediaSegment(previous, sequenceNumber - 1);
+                if(last)
+                {
+                    vlc_tick_t nzDuration = timescale.ToTime(last->duration.Get());
+                    nzStartTime = timescale.ToTime(last->startTime.Get()) + nzDuration;
+                    discontinuitySequence = last->getDiscontinuitySequenceNumber();
+                    if(last->getDisplayTime() != VLC_TICK_INVALID)
+                        absReferenceTime = last->getDisplayTime() + nzDuration;
+                }
             }
             break;
 
@@ -389,10 +591,53 @@ void M3U8Parser::parseSegments(vlc_object_t *, HLSRepresentation *rep, const std
         }
     }
 
+    /* Blocking reloads wait for the playlist listing the part being
+     * produced, which is the preload hinted one if any */
+    const unsigned nextPartIndex = partIndex;
+
+    /* Next part being produced, which the server lets us request early */
+    if(b_parts && ctx_preloadhint && ctx_preloadhint->getAttributeByName("URI"))
+    {
+        const Attribute *startAttr = ctx_preloadhint->getAttributeByName("BYTERANGE-START");
+        const Attribute *lengthAttr = ctx_preloadhint->getAttributeByName("BYTERANGE-LENGTH");
+        const std::size_t start = startAttr ? startAttr->decimal() : 0;
+        /* open ended ranges can't be requested */
+        if(start == 0 || lengthAttr)
+        {
+            HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber);
+            if(segment)
+            {
+                segment->setPart(sequenceNumber, partIndex++, true);
+                segment->setSourceUrl(ctx_preloadhint->getAttributeByName("URI")->quotedString());
+                if(lengthAttr)
+                    segment->setByteRange(start, start + lengthAttr->decimal() - 1);
+                appendSegment(segment, rep->partTarget);
+            }
+        }
+    }
+
+    if(b_parts)
+        numberParts(rep->inheritSegmentList(), segmentstoappend);
+
+    rep->nextMediaSequence = sequenceNumber;
+    rep->nextPartIndex = nextPartIndex;
+
     for(HLSSegment *seg : segmentstoappend)
         segmentList->addSegment(seg);
     segmentstoappend.clear();
 
+    if(b_skipped)
+    {
+        /* numbering of parts playlists is our own */
+        const HLSSegment *first = findMediaSegment(previous, windowStart);
+        if(first)
+            segmentList->setWindowStart(first->getSequenceNumber());
+    }
+    else if(b_incremental)
+    {
+        segmentList->setWindowStart(windowStart);
+    }
+
     if(rep->isLive())
     {
         rep->getPlaylist()->duration.Set(0);
@@ -20,6 +20,8 @@
 #ifndef VLC_TS_H
 #define VLC_TS_H
 
+#include "ts_batch.h"
+
 #ifdef HAVE_ARIBB24
     typedef struct arib_instance_t arib_instance_t;
 #endif
@@ -71,6 +73,9 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* batched reads from the stream */
+    ts_batch_reader_t batch;
+
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
 
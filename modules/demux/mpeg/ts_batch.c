@@ -0,0 +1,284 @@
+/*****************************************************************************
+ * ts_batch.c: Transport Stream batched packet reader
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_stream.h>
+#include <vlc_atomic.h>
+
+#include "ts_batch.h"
+
+#include <assert.h>
+
+#define TS_BATCH_ALIGN 32
+
+typedef struct
+{
+    block_t self;
+    ts_batch_buffer_t *p_owner;
+} ts_batch_view_t;
+
+struct ts_batch_buffer_t
+{
+    vlc_atomic_rc_t rc;
+    size_t      i_size;
+    uint8_t    *p_data;
+    unsigned    i_views;     /* next free view */
+    unsigned    i_max_views;
+    ts_batch_view_t views[];
+};
+
+static void BufferRelease( ts_batch_buffer_t *p_buf )
+{
+    if( vlc_atomic_rc_dec( &p_buf->rc ) )
+        free( p_buf );
+}
+
+static void ViewRelease( block_t *p_block )
+{
+    ts_batch_view_t *p_view = container_of( p_block, ts_batch_view_t, self );
+    BufferRelease( p_view->p_owner );
+}
+
+static const struct vlc_block_callbacks ts_batch_view_cbs =
+{
+    ViewRelease,
+};
+
+static ts_batch_buffer_t * BufferNew( const ts_batch_reader_t *p_batch )
+{
+    /* One spare packet for leftovers of the previous read and resync */
+    const unsigned i_views = p_batch->i_count + 1;
+    const size_t i_size = (size_t) i_views * p_batch->i_packet_size;
+
+    ts_batch_buffer_t *p_buf = malloc( sizeof(*p_buf) +
+                                       i_views * sizeof(ts_batch_view_t) +
+                                       TS_BATCH_ALIGN - 1 + i_size );
+    if( unlikely(p_buf == NULL) )
+        return NULL;
+
+    vlc_atomic_rc_init( &p_buf->rc );
+    p_buf->i_size = i_size;
+    p_buf->i_views = 0;
+    p_buf->i_max_views = i_views;
+    uintptr_t i_data = (uintptr_t) &p_buf->views[i_views];
+    i_data = (i_data + TS_BATCH_ALIGN - 1) & ~(uintptr_t)(TS_BATCH_ALIGN - 1);
+    p_buf->p_data = (uint8_t *) i_data;
+    return p_buf;
+}
+
+void ts_batch_Init( ts_batch_reader_t *p_batch, unsigned i_count,
+                    unsigned i_packet_size, unsigned i_packet_header_size )
+{
+    p_batch->p_buffer = NULL;
+    p_batch->i_pos = 0;
+    p_batch->i_end = 0;
+    p_batch->i_synced = 0;
+    p_batch->i_count = __MAX(i_count, 1);
+    p_batch->i_packet_size = i_packet_size;
+    p_batch->i_packet_header_size = i_packet_header_size;
+    p_batch->pf_detach = NULL;
+    p_batch->p_detach_opaque = NULL;
+}
+
+void ts_batch_Flush( ts_batch_reader_t *p_batch )
+{
+    /* Packets still in use keep their buffer alive */
+    if( p_batch->p_buffer )
+        BufferRelease( p_batch->p_buffer );
+    p_batch->p_buffer = NULL;
+    p_batch->i_pos = 0;
+    p_batch->i_end = 0;
+    p_batch->i_synced = 0;
+}
+
+void ts_batch_Clean( ts_batch_reader_t *p_batch )
+{
+    ts_batch_Flush( p_batch );
+}
+
+/* Ensures at least i_need bytes are pending, reading as much as available */
+static bool Refill( ts_batch_reader_t *p_batch, stream_t *s, size_t i_need )
+{
+    ts_batch_buffer_t *p_buf = p_batch->p_buffer;
+    const size_t i_left = ts_batch_Pending( p_batch );
+
+    if( p_buf == NULL || p_batch->i_pos + i_need > p_buf->i_size )
+    {
+        if( p_buf != NULL && vlc_atomic_rc_get( &p_buf->rc ) > 1 &&
+            p_batch->pf_detach != NULL )
+            p_batch->pf_detach( p_batch->p_detach_opaque );
+
+        if( p_buf != NULL && vlc_atomic_rc_get( &p_buf->rc ) == 1 )
+        {
+            /* No packet view is alive anymore: recycle the buffer */
+            memmove( p_buf->p_data, &p_buf->p_data[p_batch->i_pos], i_left );
+            p_buf->i_views = 0;
+        }
+        else
+        {
+            ts_batch_buffer_t *p_new = BufferNew( p_batch );
+            if( unlikely(p_new == NULL) )
+                return false;
+            if( p_buf != NULL )
+            {
+                memcpy( p_new->p_data, &p_buf->p_data[p_batch->i_pos], i_left );
+                BufferRelease( p_buf );
+            }
+            p_batch->p_buffer = p_buf = p_new;
+        }
+        p_batch->i_pos = 0;
+        p_batch->i_end = i_left;
+    }
+
+    assert( p_batch->i_pos + i_need <= p_buf->i_size );
+    while( ts_batch_Pending( p_batch ) < i_need )
+    {
+        ssize_t i_read = vlc_stream_ReadPartial( s, &p_buf->p_data[p_batch->i_end],
+                                                 p_buf->i_size - p_batch->i_end );
+        if( i_read <= 0 )
+            return false;
+        p_batch->i_end += i_read;
+    }
+    return true;
+}
+
+/* Counts the pending packets starting with a sync byte */
+static unsigned CheckSync( const ts_batch_reader_t *p_batch )
+{
+    const unsigned i_packet_size = p_batch->i_packet_size;
+    const unsigned i_avail = ts_batch_Pending( p_batch ) / i_packet_size;
+    const uint8_t *p = &p_batch->p_buffer->p_data[p_batch->i_pos +
+                                                  p_batch->i_packet_header_size];
+    unsigned i = 0;
+    while( i < i_avail && p[i * i_packet_size] == 0x47 )
+        i++;
+    return i;
+}
+
+static bool Resync( ts_batch_reader_t *p_batch, vlc_object_t *p_obj, stream_t *s )
+{
+    const unsigned i_packet_size = p_batch->i_packet_size;
+    const unsigned i_header_size = p_batch->i_packet_header_size;
+
+    for( ;; )
+    {
+        /* Two sync bytes one packet apart are needed */
+        if( !Refill( p_batch, s, i_header_size + i_packet_size + 1 ) )
+        {
+            msg_Dbg( p_obj, "eof ?" );
+            return false;
+        }
+
+        const uint8_t *p_peek = &p_batch->p_buffer->p_data[p_batch->i_pos];
+        const size_t i_peek = ts_batch_Pending( p_batch );
+        size_t i_skip = 0;
+
+        while( i_skip + i_header_size + i_packet_size < i_peek )
+        {
+            if( p_peek[i_skip + i_header_size] == 0x47 &&
+                p_peek[i_skip + i_header_size + i_packet_size] == 0x47 )
+                break;
+            i_skip++;
+        }
+        const bool b_found = i_skip + i_header_size + i_packet_size < i_peek;
+
+        msg_Dbg( p_obj, "skipping %zu bytes of garbage at %"PRIu64, i_skip,
+                 vlc_stream_Tell( s ) - i_peek );
+        p_batch->i_pos += i_skip;
+
+        if( b_found )
+            break;
+    }
+    msg_Dbg( p_obj, "resynced at %"PRIu64,
+             vlc_stream_Tell( s ) - ts_batch_Pending( p_batch ) );
+    return true;
+}
+
+block_t * ts_batch_Read( ts_batch_reader_t *p_batch, vlc_object_t *p_obj,
+                         stream_t *s )
+{
+    const unsigned i_packet_size = p_batch->i_packet_size;
+
+    if( p_batch->i_synced == 0 )
+    {
+        if( ts_batch_Pending( p_batch ) < i_packet_size &&
+            !Refill( p_batch, s, i_packet_size ) )
+        {
+            int64_t size = stream_Size( s );
+            if( size >= 0 && (uint64_t)size == vlc_stream_Tell( s ) )
+                msg_Dbg( p_obj, "EOF at %"PRIu64, vlc_stream_Tell( s ) );
+            else
+                msg_Dbg( p_obj, "Can't read TS packet at %"PRIu64, vlc_stream_Tell( s ) );
+            return NULL;
+        }
+
+        p_batch->i_synced = CheckSync( p_batch );
+        if( p_batch->i_synced == 0 )
+        {
+            msg_Warn( p_obj, "lost synchro" );
+            if( !Resync( p_batch, p_obj, s ) )
+                return NULL;
+            p_batch->i_synced = CheckSync( p_batch );
+            assert( p_batch->i_synced > 0 );
+        }
+    }
+
+    ts_batch_buffer_t *p_buf = p_batch->p_buffer;
+    assert( p_buf->i_views < p_buf->i_max_views );
+    ts_batch_view_t *p_view = &p_buf->views[p_buf->i_views++];
+
+    /* The view only spans its own packet, so that in-place processing or
+     * reallocation never touches the neighbouring ones */
+    block_t *p_pkt = block_Init( &p_view->self, &ts_batch_view_cbs,
+                                 &p_buf->p_data[p_batch->i_pos], i_packet_size );
+    p_view->p_owner = p_buf;
+    vlc_atomic_rc_inc( &p_buf->rc );
+
+    p_pkt->p_buffer += p_batch->i_packet_header_size;
+    p_pkt->i_buffer -= p_batch->i_packet_header_size;
+
+    p_batch->i_pos += i_packet_size;
+    p_batch->i_synced--;
+    return p_pkt;
+}
+
+bool ts_batch_IsView( const block_t *p_block )
+{
+    return p_block->cbs == &ts_batch_view_cbs;
+}
+
+block_t * ts_batch_Detach( block_t *p_pkt )
+{
+    if( p_pkt == NULL || !ts_batch_IsView( p_pkt ) )
+        return p_pkt;
+
+    block_t *p_copy = block_Alloc( p_pkt->i_buffer );
+    if( unlikely(p_copy == NULL) )
+        return p_pkt;
+
+    block_CopyProperties( p_copy, p_pkt );
+    memcpy( p_copy->p_buffer, p_pkt->p_buffer, p_pkt->i_buffer );
+    block_Release( p_pkt );
+    return p_copy;
+}
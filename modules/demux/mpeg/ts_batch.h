@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * ts_batch.h: Transport Stream batched packet reader
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_BATCH_H
+#define VLC_TS_BATCH_H
+
+#define TS_BATCH_DEFAULT 64
+#define TS_BATCH_MAX     1024
+
+typedef struct ts_batch_buffer_t ts_batch_buffer_t;
+
+/*
+ * Reads many TS packets from the stream at once and hands them out as
+ * block views on a single refcounted buffer: there is no allocation nor
+ * copy per packet. Sync bytes of the whole batch are checked up front.
+ */
+typedef struct
+{
+    ts_batch_buffer_t *p_buffer; /* current buffer, NULL if none */
+    size_t      i_pos;           /* first unconsumed byte */
+    size_t      i_end;           /* end of data read into the buffer */
+    unsigned    i_synced;        /* packets from i_pos with a checked sync byte */
+
+    unsigned    i_count;         /* packets per read */
+    unsigned    i_packet_size;
+    unsigned    i_packet_header_size;
+
+    /* Called before reading into a new buffer while packets still reference
+     * the current one, so that the owner can detach the packets it keeps
+     * (see ts_batch_Detach), and let the buffer be recycled. Optional. */
+    void      (*pf_detach)( void * );
+    void       *p_detach_opaque;
+} ts_batch_reader_t;
+
+void ts_batch_Init( ts_batch_reader_t *, unsigned i_count,
+                    unsigned i_packet_size, unsigned i_packet_header_size );
+void ts_batch_Clean( ts_batch_reader_t * );
+
+/* Drops any read ahead data. Must be called when the stream is seeked. */
+void ts_batch_Flush( ts_batch_reader_t * );
+
+/* Number of bytes read from the stream but not yet returned as packets */
+static inline size_t ts_batch_Pending( const ts_batch_reader_t *p_batch )
+{
+    return p_batch->i_end - p_batch->i_pos;
+}
+
+/*
+ * Returns the next packet with its optional prefix header already skipped,
+ * resynchronizing on garbage, or NULL on end of stream.
+ */
+block_t * ts_batch_Read( ts_batch_reader_t *, vlc_object_t *, stream_t * );
+
+/* Whether the block is a packet view on a batch buffer */
+bool ts_batch_IsView( const block_t * );
+
+/*
+ * Copies a packet view to a block of its own, so that it does not keep its
+ * whole batch buffer alive. Other blocks, or on allocation failure, the
+ * packet itself, are returned as is.
+ */
+block_t * ts_batch_Detach( block_t * );
+
+#endif
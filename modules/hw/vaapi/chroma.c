@@ -388,8 +388,8 @@ vlc_vaapi_OpenChroma(filter_t *filter)
         filter_sys->dest_pics = NULL;
     }
 
-    if (CopyInitCache(&filter_sys->cache, filter->fmt_in.video.i_width
-                      * pixel_bytes))
+    if (CopyInitThreadedCache(&filter_sys->cache, filter->fmt_in.video.i_width
+                              * pixel_bytes, VLC_OBJECT(filter)))
     {
         if (is_upload)
         {
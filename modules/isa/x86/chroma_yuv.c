@@ -0,0 +1,382 @@
+/*****************************************************************************
+ * chroma_yuv.c : x86 SSE4.1 and AVX2 YUV packing and semiplanar conversions
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#include "x86.h"
+
+static int Open (filter_t *);
+
+vlc_module_begin ()
+    set_description (N_(X86_ISA " video chroma conversions"))
+#if defined (PLUGIN_AVX2)
+    set_callback_video_converter(Open, 270)
+#else
+    set_callback_video_converter(Open, 260)
+#endif
+vlc_module_end ()
+
+/* Same as the ARM NEON conversions: the swapped variants only exchange the
+ * chroma planes. The vector loops run over 2 * VSIZE pixels, the remaining
+ * pixels of each line go through the C loops. */
+
+static unsigned Width (const filter_t *filter)
+{
+    return filter->fmt_in.video.i_x_offset
+         + filter->fmt_in.video.i_visible_width;
+}
+
+static unsigned Height (const filter_t *filter)
+{
+    return filter->fmt_in.video.i_y_offset
+         + filter->fmt_in.video.i_visible_height;
+}
+
+/*
+ * Planar YUV to packed YUV 4:2:2
+ */
+VLC_TARGET static inline
+void PackLine (uint8_t *restrict dst, const uint8_t *restrict y,
+               const uint8_t *restrict u, const uint8_t *restrict v,
+               unsigned width, bool uyvy)
+{
+    unsigned x = 0;
+
+    for (; x + 2 * VSIZE <= width; x += 2 * VSIZE)
+    {
+        vint cu = v_loadu (u + x / 2), cv = v_loadu (v + x / 2);
+        vint uv0 = v_zip8_lo (cu, cv), uv1 = v_zip8_hi (cu, cv);
+        vint y0 = v_loadu (y + x), y1 = v_loadu (y + x + VSIZE);
+        uint8_t *out = dst + 2 * x;
+
+        if (uyvy)
+        {
+            v_storeu (out, v_zip8_lo (uv0, y0));
+            v_storeu (out + VSIZE, v_zip8_hi (uv0, y0));
+            v_storeu (out + 2 * VSIZE, v_zip8_lo (uv1, y1));
+            v_storeu (out + 3 * VSIZE, v_zip8_hi (uv1, y1));
+        }
+        else
+        {
+            v_storeu (out, v_zip8_lo (y0, uv0));
+            v_storeu (out + VSIZE, v_zip8_hi (y0, uv0));
+            v_storeu (out + 2 * VSIZE, v_zip8_lo (y1, uv1));
+            v_storeu (out + 3 * VSIZE, v_zip8_hi (y1, uv1));
+        }
+    }
+
+    for (; x < width; x += 2)
+    {
+        uint8_t *out = dst + 2 * x;
+
+        if (uyvy)
+        {
+            out[0] = u[x / 2];
+            out[1] = y[x];
+            out[2] = v[x / 2];
+            out[3] = y[x + 1];
+        }
+        else
+        {
+            out[0] = y[x];
+            out[1] = u[x / 2];
+            out[2] = y[x + 1];
+            out[3] = v[x / 2];
+        }
+    }
+}
+
+VLC_TARGET static inline
+void Pack (filter_t *filter, picture_t *src, picture_t *dst,
+           bool swap, bool uyvy, unsigned vsub)
+{
+    const plane_t *py = &src->p[Y_PLANE];
+    const plane_t *pu = &src->p[swap ? V_PLANE : U_PLANE];
+    const plane_t *pv = &src->p[swap ? U_PLANE : V_PLANE];
+    const unsigned width = Width (filter), height = Height (filter);
+
+    for (unsigned i = 0; i < height; i++)
+        PackLine (&dst->p->p_pixels[i * dst->p->i_pitch],
+                  &py->p_pixels[i * py->i_pitch],
+                  &pu->p_pixels[(i / vsub) * pu->i_pitch],
+                  &pv->p_pixels[(i / vsub) * pv->i_pitch], width, uyvy);
+}
+
+#define PACK_FILTERS(name, swap, uyvy, vsub) \
+VLC_TARGET \
+static void name (filter_t *filter, picture_t *src, picture_t *dst) \
+{ \
+    Pack (filter, src, dst, swap, uyvy, vsub); \
+} \
+VIDEO_FILTER_WRAPPER (name)
+
+PACK_FILTERS (I420_YUYV, false, false, 2)
+PACK_FILTERS (I420_YVYU, true,  false, 2)
+PACK_FILTERS (I420_UYVY, false, true,  2)
+PACK_FILTERS (I420_VYUY, true,  true,  2)
+PACK_FILTERS (I422_YUYV, false, false, 1)
+PACK_FILTERS (I422_YVYU, true,  false, 1)
+PACK_FILTERS (I422_UYVY, false, true,  1)
+PACK_FILTERS (I422_VYUY, true,  true,  1)
+
+/*
+ * Packed YUV 4:2:2 to planar YUV 4:2:2
+ */
+VLC_TARGET static inline
+void UnpackLine (uint8_t *restrict y, uint8_t *restrict u,
+                 uint8_t *restrict v, const uint8_t *restrict src,
+                 unsigned width, bool uyvy)
+{
+    unsigned x = 0;
+
+    for (; x + 2 * VSIZE <= width; x += 2 * VSIZE)
+    {
+        const uint8_t *in = src + 2 * x;
+        vint a = v_loadu (in), b = v_loadu (in + VSIZE);
+        vint c = v_loadu (in + 2 * VSIZE), d = v_loadu (in + 3 * VSIZE);
+        vint y0, y1, uv0, uv1;
+
+        if (uyvy)
+        {
+            y0 = v_unzip8_odd (a, b);
+            y1 = v_unzip8_odd (c, d);
+            uv0 = v_unzip8_even (a, b);
+            uv1 = v_unzip8_even (c, d);
+        }
+        else
+        {
+            y0 = v_unzip8_even (a, b);
+            y1 = v_unzip8_even (c, d);
+            uv0 = v_unzip8_odd (a, b);
+            uv1 = v_unzip8_odd (c, d);
+        }
+        v_storeu (y + x, y0);
+        v_storeu (y + x + VSIZE, y1);
+        v_storeu (u + x / 2, v_unzip8_even (uv0, uv1));
+        v_storeu (v + x / 2, v_unzip8_odd (uv0, uv1));
+    }
+
+    for (; x < width; x += 2)
+    {
+        const uint8_t *in = src + 2 * x;
+
+        if (uyvy)
+        {
+            u[x / 2] = in[0];
+            y[x] = in[1];
+            v[x / 2] = in[2];
+            y[x + 1] = in[3];
+        }
+        else
+        {
+            y[x] = in[0];
+            u[x / 2] = in[1];
+            y[x + 1] = in[2];
+            v[x / 2] = in[3];
+        }
+    }
+}
+
+VLC_TARGET static inline
+void Unpack (filter_t *filter, picture_t *src, picture_t *dst,
+             bool swap, bool uyvy)
+{
+    plane_t *py = &dst->p[Y_PLANE];
+    plane_t *pu = &dst->p[swap ? V_PLANE : U_PLANE];
+    plane_t *pv = &dst->p[swap ? U_PLANE : V_PLANE];
+    const unsigned width = Width (filter), height = Height (filter);
+
+    for (unsigned i = 0; i < height; i++)
+        UnpackLine (&py->p_pixels[i * py->i_pitch],
+                    &pu->p_pixels[i * pu->i_pitch],
+                    &pv->p_pixels[i * pv->i_pitch],
+                    &src->p->p_pixels[i * src->p->i_pitch], width, uyvy);
+}
+
+#define UNPACK_FILTERS(name, swap, uyvy) \
+VLC_TARGET \
+static void name (filter_t *filter, picture_t *src, picture_t *dst) \
+{ \
+    Unpack (filter, src, dst, swap, uyvy); \
+} \
+VIDEO_FILTER_WRAPPER (name)
+
+UNPACK_FILTERS (YUYV_I422, false, false)
+UNPACK_FILTERS (YVYU_I422, true,  false)
+UNPACK_FILTERS (UYVY_I422, false, true)
+UNPACK_FILTERS (VYUY_I422, true,  true)
+
+/*
+ * Semiplanar to planar
+ */
+VLC_TARGET static inline
+void DeinterleaveLine (uint8_t *restrict u, uint8_t *restrict v,
+                       const uint8_t *restrict src, unsigned width)
+{
+    unsigned x = 0;
+
+    for (; x + VSIZE <= width; x += VSIZE)
+    {
+        vint a = v_loadu (src + 2 * x), b = v_loadu (src + 2 * x + VSIZE);
+
+        v_storeu (u + x, v_unzip8_even (a, b));
+        v_storeu (v + x, v_unzip8_odd (a, b));
+    }
+
+    for (; x < width; x++)
+    {
+        u[x] = src[2 * x];
+        v[x] = src[2 * x + 1];
+    }
+}
+
+VLC_TARGET static inline
+void Deinterleave (filter_t *filter, picture_t *src, picture_t *dst,
+                   bool swap, unsigned hsub, unsigned vsub)
+{
+    const plane_t *in = &src->p[1];
+    plane_t *pu = &dst->p[swap ? V_PLANE : U_PLANE];
+    plane_t *pv = &dst->p[swap ? U_PLANE : V_PLANE];
+    const unsigned width = (Width (filter) + hsub - 1) / hsub;
+    const unsigned height = (Height (filter) + vsub - 1) / vsub;
+
+    plane_CopyPixels (&dst->p[Y_PLANE], &src->p[Y_PLANE]);
+
+    for (unsigned i = 0; i < height; i++)
+        DeinterleaveLine (&pu->p_pixels[i * pu->i_pitch],
+                          &pv->p_pixels[i * pv->i_pitch],
+                          &in->p_pixels[i * in->i_pitch], width);
+}
+
+#define SEMIPLANAR_FILTERS(name, swap, hsub, vsub) \
+VLC_TARGET \
+static void name (filter_t *filter, picture_t *src, picture_t *dst) \
+{ \
+    Deinterleave (filter, src, dst, swap, hsub, vsub); \
+} \
+VIDEO_FILTER_WRAPPER (name)
+
+SEMIPLANAR_FILTERS (Semiplanar_Planar_420, false, 2, 2)
+SEMIPLANAR_FILTERS (Semiplanar_Planar_420_Swap, true, 2, 2)
+SEMIPLANAR_FILTERS (Semiplanar_Planar_422, false, 2, 1)
+SEMIPLANAR_FILTERS (Semiplanar_Planar_444, false, 1, 1)
+
+static const struct vlc_filter_operations *
+GetOperations (vlc_fourcc_t in, vlc_fourcc_t out)
+{
+    switch (in)
+    {
+        /* Planar to packed */
+        case VLC_CODEC_I420:
+            switch (out)
+            {
+                case VLC_CODEC_YUYV: return &I420_YUYV_ops;
+                case VLC_CODEC_YVYU: return &I420_YVYU_ops;
+                case VLC_CODEC_UYVY: return &I420_UYVY_ops;
+                case VLC_CODEC_VYUY: return &I420_VYUY_ops;
+            }
+            break;
+        case VLC_CODEC_YV12:
+            switch (out)
+            {
+                case VLC_CODEC_YUYV: return &I420_YVYU_ops;
+                case VLC_CODEC_YVYU: return &I420_YUYV_ops;
+                case VLC_CODEC_UYVY: return &I420_VYUY_ops;
+                case VLC_CODEC_VYUY: return &I420_UYVY_ops;
+            }
+            break;
+        case VLC_CODEC_I422:
+            switch (out)
+            {
+                case VLC_CODEC_YUYV: return &I422_YUYV_ops;
+                case VLC_CODEC_YVYU: return &I422_YVYU_ops;
+                case VLC_CODEC_UYVY: return &I422_UYVY_ops;
+                case VLC_CODEC_VYUY: return &I422_VYUY_ops;
+            }
+            break;
+
+        /* Semiplanar to planar */
+        case VLC_CODEC_NV12:
+            switch (out)
+            {
+                case VLC_CODEC_I420: return &Semiplanar_Planar_420_ops;
+                case VLC_CODEC_YV12: return &Semiplanar_Planar_420_Swap_ops;
+            }
+            break;
+        case VLC_CODEC_NV21:
+            switch (out)
+            {
+                case VLC_CODEC_I420: return &Semiplanar_Planar_420_Swap_ops;
+                case VLC_CODEC_YV12: return &Semiplanar_Planar_420_ops;
+            }
+            break;
+        case VLC_CODEC_NV16:
+            if (out == VLC_CODEC_I422)
+                return &Semiplanar_Planar_422_ops;
+            break;
+        case VLC_CODEC_NV24:
+            if (out == VLC_CODEC_I444)
+                return &Semiplanar_Planar_444_ops;
+            break;
+
+        /* Packed to planar */
+        case VLC_CODEC_YUYV:
+            if (out == VLC_CODEC_I422)
+                return &YUYV_I422_ops;
+            break;
+        case VLC_CODEC_YVYU:
+            if (out == VLC_CODEC_I422)
+                return &YVYU_I422_ops;
+            break;
+        case VLC_CODEC_UYVY:
+            if (out == VLC_CODEC_I422)
+                return &UYVY_I422_ops;
+            break;
+        case VLC_CODEC_VYUY:
+            if (out == VLC_CODEC_I422)
+                return &VYUY_I422_ops;
+            break;
+    }
+    return NULL;
+}
+
+static int Open (filter_t *filter)
+{
+    if (!vlc_CPU_capable ())
+        return VLC_EGENERIC;
+    if ((filter->fmt_in.video.i_width != filter->fmt_out.video.i_width)
+     || (filter->fmt_in.video.i_height != filter->fmt_out.video.i_height)
+     || (filter->fmt_in.video.orientation != filter->fmt_out.video.orientation))
+        return VLC_EGENERIC;
+    if ((Width (filter) & 1) || (Height (filter) & 1))
+        return VLC_EGENERIC;
+
+    filter->ops = GetOperations (filter->fmt_in.video.i_chroma,
+                                 filter->fmt_out.video.i_chroma);
+    return (filter->ops != NULL) ? VLC_SUCCESS : VLC_EGENERIC;
+}
@@ -0,0 +1,391 @@
+/*****************************************************************************
+ * mixer.c : x86 SSE4.1 and AVX2 simple channel mixer
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_cpu.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+
+#include "x86.h"
+
+static int OpenFilter(vlc_object_t *);
+
+vlc_module_begin()
+    set_description(N_(X86_ISA " simple channel mixer"))
+    set_subcategory(SUBCAT_AUDIO_AFILTER)
+#if defined (PLUGIN_AVX2)
+    set_capability("audio converter", 12)
+#else
+    set_capability("audio converter", 11)
+#endif
+    set_callback(OpenFilter)
+vlc_module_end()
+
+/*
+ * The mixing formulas are those of the simple channel mixer, evaluated in the
+ * same order. The results may still differ in the last bit, as the C version
+ * is built with unsafe math optimizations and may be reassociated. Each kernel
+ * processes VFLOATS frames: the channels are loaded one vector each, and the
+ * output vectors are interleaved back.
+ */
+
+/* Strided load of one channel out of VFLOATS frames */
+#if defined (PLUGIN_AVX2)
+typedef __m256i vstride;
+
+VLC_TARGET static inline vstride vf_stride(unsigned stride)
+{
+    return _mm256_mullo_epi32(_mm256_set1_epi32(stride),
+                              _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+VLC_TARGET static inline vfloat vf_load_ch(const float *src, vstride idx)
+{
+    return _mm256_i32gather_ps(src, idx, sizeof (float));
+}
+
+VLC_TARGET static inline void vf_store2(float *dst, vfloat a, vfloat b)
+{
+    vfloat lo = _mm256_unpacklo_ps(a, b), hi = _mm256_unpackhi_ps(a, b);
+
+    _mm256_storeu_ps(dst, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+VLC_TARGET static inline void vf_store4(float *dst, vfloat a, vfloat b,
+                                        vfloat c, vfloat d)
+{
+    vfloat ab0 = _mm256_unpacklo_ps(a, b), ab1 = _mm256_unpackhi_ps(a, b);
+    vfloat cd0 = _mm256_unpacklo_ps(c, d), cd1 = _mm256_unpackhi_ps(c, d);
+    /* frames 0 and 4, 1 and 5, 2 and 6, 3 and 7 */
+    vfloat f04 = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0));
+    vfloat f15 = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2));
+    vfloat f26 = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0));
+    vfloat f37 = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _mm256_storeu_ps(dst,      _mm256_permute2f128_ps(f04, f15, 0x20));
+    _mm256_storeu_ps(dst + 8,  _mm256_permute2f128_ps(f26, f37, 0x20));
+    _mm256_storeu_ps(dst + 16, _mm256_permute2f128_ps(f04, f15, 0x31));
+    _mm256_storeu_ps(dst + 24, _mm256_permute2f128_ps(f26, f37, 0x31));
+}
+
+#else
+typedef unsigned vstride;
+
+static inline vstride vf_stride(unsigned stride)
+{
+    return stride;
+}
+
+VLC_TARGET static inline vfloat vf_load_ch(const float *src, vstride stride)
+{
+    return _mm_setr_ps(src[0], src[stride], src[2 * stride],
+                       src[3 * stride]);
+}
+
+VLC_TARGET static inline void vf_store2(float *dst, vfloat a, vfloat b)
+{
+    _mm_storeu_ps(dst, _mm_unpacklo_ps(a, b));
+    _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(a, b));
+}
+
+VLC_TARGET static inline void vf_store4(float *dst, vfloat a, vfloat b,
+                                        vfloat c, vfloat d)
+{
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(dst, a);
+    _mm_storeu_ps(dst + 4, b);
+    _mm_storeu_ps(dst + 8, c);
+    _mm_storeu_ps(dst + 12, d);
+}
+#endif
+
+#define CH(n) vf_load_ch(src + (n), idx)
+
+VLC_TARGET static inline
+void Mix_7_x_to_2_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat k = vf_set1(0.7071f), q = vf_set1(0.25f);
+    vfloat ctr = vf_mul(CH(6), k);
+    vfloat l = vf_add(vf_add(vf_add(ctr, CH(0)), vf_mul(CH(2), q)),
+                      vf_mul(CH(4), q));
+    vfloat r = vf_add(vf_add(vf_add(ctr, CH(1)), vf_mul(CH(3), q)),
+                      vf_mul(CH(5), q));
+    vf_store2(dst, l, r);
+}
+
+VLC_TARGET static inline
+void Mix_6_1_to_2_0(float *dst, const float *src, vstride idx)
+{
+    vfloat ctr = vf_mul(vf_add(CH(2), CH(5)), vf_set1(0.7071f));
+    vfloat l = vf_add(vf_add(CH(0), CH(3)), ctr);
+    vfloat r = vf_add(vf_add(CH(1), CH(4)), ctr);
+    vf_store2(dst, l, r);
+}
+
+VLC_TARGET static inline
+void Mix_5_x_to_2_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat k = vf_set1(0.7071f);
+    vfloat l = vf_add(CH(0), vf_mul(k, vf_add(CH(4), CH(2))));
+    vfloat r = vf_add(CH(1), vf_mul(k, vf_add(CH(4), CH(3))));
+    vf_store2(dst, l, r);
+}
+
+VLC_TARGET static inline
+void Mix_4_0_to_2_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat h = vf_set1(0.5f);
+    vfloat rear = vf_add(CH(2), CH(3));
+    vfloat l = vf_add(rear, vf_mul(h, CH(0)));
+    vfloat r = vf_add(rear, vf_mul(h, CH(1)));
+    vf_store2(dst, l, r);
+}
+
+VLC_TARGET static inline
+void Mix_3_x_to_2_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat h = vf_set1(0.5f);
+    vfloat l = vf_add(CH(2), vf_mul(h, CH(0)));
+    vfloat r = vf_add(CH(2), vf_mul(h, CH(1)));
+    vf_store2(dst, l, r);
+}
+
+VLC_TARGET static inline
+void Mix_7_x_to_1_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat q = vf_set1(0.25f), e = vf_set1(0.125f);
+    vfloat c = vf_add(CH(6), vf_mul(CH(0), q));
+    c = vf_add(c, vf_mul(CH(1), q));
+    c = vf_add(c, vf_mul(CH(2), e));
+    c = vf_add(c, vf_mul(CH(3), e));
+    c = vf_add(c, vf_mul(CH(4), e));
+    c = vf_add(c, vf_mul(CH(5), e));
+    vf_storeu(dst, c);
+}
+
+VLC_TARGET static inline
+void Mix_5_x_to_1_0(float *dst, const float *src, vstride idx)
+{
+    vfloat c = vf_mul(vf_set1(0.7071f), vf_add(CH(0), CH(1)));
+    c = vf_add(c, CH(4));
+    c = vf_add(c, vf_mul(vf_set1(0.5f), vf_add(CH(2), CH(3))));
+    vf_storeu(dst, c);
+}
+
+VLC_TARGET static inline
+void Mix_4_0_to_1_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat q = vf_set1(0.25f);
+    vfloat c = vf_add(vf_add(CH(2), CH(3)), vf_mul(CH(0), q));
+    vf_storeu(dst, vf_add(c, vf_mul(CH(1), q)));
+}
+
+VLC_TARGET static inline
+void Mix_3_x_to_1_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat q = vf_set1(0.25f);
+    vfloat c = vf_add(CH(2), vf_mul(CH(0), q));
+    vf_storeu(dst, vf_add(c, vf_mul(CH(1), q)));
+}
+
+VLC_TARGET static inline
+void Mix_2_x_to_1_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat h = vf_set1(0.5f);
+    vf_storeu(dst, vf_add(vf_mul(CH(0), h), vf_mul(CH(1), h)));
+}
+
+VLC_TARGET static inline
+void Mix_7_x_to_4_0(float *dst, const float *src, vstride idx)
+{
+    const vfloat h = vf_set1(0.5f), s = vf_set1(6.f);
+    vfloat ls = vf_div(CH(2), s), rs = vf_div(CH(3), s);
+    vfloat l = vf_add(vf_add(CH(6), vf_mul(h, CH(0))), ls);
+    vfloat r = vf_add(vf_add(CH(6), vf_mul(h, CH(1))), rs);
+    vf_store4(dst, l, r, vf_add(ls, CH(4)), vf_add(rs, CH(5)));
+}
+
+VLC_TARGET static inline
+void Mix_5_x_to_4_0(float *dst, const float *src, vstride idx)
+{
+    vfloat ctr = vf_mul(CH(4), vf_set1(0.7071f));
+    vf_store4(dst, vf_add(CH(0), ctr), vf_add(CH(1), ctr), CH(2), CH(3));
+}
+
+#undef CH
+
+/* Runs a kernel over a block, the last frames are padded with zeroes */
+#define MIXER(in, out, nout) \
+VLC_TARGET \
+static void DoWork_##in##_to_##out(const float *src, float *dst, \
+                                   size_t frames, unsigned stride) \
+{ \
+    const vstride idx = vf_stride(stride); \
+\
+    for (; frames >= VFLOATS; frames -= VFLOATS) \
+    { \
+        Mix_##in##_to_##out(dst, src, idx); \
+        src += VFLOATS * stride; \
+        dst += VFLOATS * nout; \
+    } \
+\
+    if (frames > 0) \
+    { \
+        float inbuf[VFLOATS * AOUT_CHAN_MAX] = { 0.f }; \
+        float outbuf[VFLOATS * 4]; \
+\
+        memcpy(inbuf, src, frames * stride * sizeof (float)); \
+        Mix_##in##_to_##out(outbuf, inbuf, idx); \
+        memcpy(dst, outbuf, frames * nout * sizeof (float)); \
+    } \
+}
+
+MIXER(7_x, 2_0, 2)
+MIXER(6_1, 2_0, 2)
+MIXER(5_x, 2_0, 2)
+MIXER(4_0, 2_0, 2)
+MIXER(3_x, 2_0, 2)
+MIXER(7_x, 1_0, 1)
+MIXER(5_x, 1_0, 1)
+MIXER(4_0, 1_0, 1)
+MIXER(3_x, 1_0, 1)
+MIXER(2_x, 1_0, 1)
+MIXER(7_x, 4_0, 4)
+MIXER(5_x, 4_0, 4)
+
+typedef void (*mix_fn)(const float *, float *, size_t, unsigned);
+
+static block_t *Filter(filter_t *filter, block_t *block)
+{
+    mix_fn work = (mix_fn)filter->p_sys;
+
+    if (!block || !block->i_nb_samples)
+    {
+        if (block)
+            block_Release(block);
+        return NULL;
+    }
+
+    unsigned in_nb = aout_FormatNbChannels(&filter->fmt_in.audio);
+    unsigned out_nb = aout_FormatNbChannels(&filter->fmt_out.audio);
+    block_t *out = block_Alloc(block->i_nb_samples * out_nb * sizeof (float));
+    if (unlikely(out == NULL))
+    {
+        msg_Warn(filter, "can't get output buffer");
+        block_Release(block);
+        return NULL;
+    }
+
+    out->i_nb_samples = block->i_nb_samples;
+    out->i_dts = block->i_dts;
+    out->i_pts = block->i_pts;
+    out->i_length = block->i_length;
+
+    work((const float *)block->p_buffer, (float *)out->p_buffer,
+         block->i_nb_samples, in_nb);
+
+    block_Release(block);
+    return out;
+}
+
+/* Same layouts as the simple channel mixer, except the 5.x outputs, and the
+ * mono downmix of inputs with more than two channels (the C version only
+ * reads the first two channels of each frame there). */
+static int OpenFilter(vlc_object_t *obj)
+{
+    filter_t *filter = (filter_t *)obj;
+    mix_fn work = NULL;
+
+    if (!vlc_CPU_capable())
+        return VLC_EGENERIC;
+
+    if (filter->fmt_in.audio.i_format != VLC_CODEC_FL32 ||
+        filter->fmt_in.audio.i_format != filter->fmt_out.audio.i_format ||
+        filter->fmt_in.audio.i_rate != filter->fmt_out.audio.i_rate ||
+        aout_FormatNbChannels(&filter->fmt_in.audio) < 2)
+        return VLC_EGENERIC;
+
+    uint32_t input = filter->fmt_in.audio.i_physical_channels;
+    uint32_t output = filter->fmt_out.audio.i_physical_channels;
+
+    if (input == output)
+        return VLC_EGENERIC;
+
+    const bool b_input_6_1 = input == AOUT_CHANS_6_1_MIDDLE;
+    const bool b_input_4_center_rear = input == AOUT_CHANS_4_CENTER_REAR;
+
+    input &= ~AOUT_CHAN_LFE;
+
+    const bool b_input_7_x = input == AOUT_CHANS_7_0;
+    const bool b_input_5_x = input == AOUT_CHANS_5_0
+                          || input == AOUT_CHANS_5_0_MIDDLE;
+    const bool b_input_3_x = input == AOUT_CHANS_3_0;
+
+    if (output == AOUT_CHAN_CENTER)
+    {
+        if (b_input_7_x)
+            work = DoWork_7_x_to_1_0;
+        else if (b_input_5_x)
+            work = DoWork_5_x_to_1_0;
+        else if (b_input_4_center_rear)
+            work = DoWork_4_0_to_1_0;
+        else if (b_input_3_x)
+            work = DoWork_3_x_to_1_0;
+        else if (aout_FormatNbChannels(&filter->fmt_in.audio) == 2)
+            work = DoWork_2_x_to_1_0;
+    }
+    else if (output == AOUT_CHANS_2_0)
+    {
+        if (b_input_7_x)
+            work = DoWork_7_x_to_2_0;
+        else if (b_input_6_1)
+            work = DoWork_6_1_to_2_0;
+        else if (b_input_5_x)
+            work = DoWork_5_x_to_2_0;
+        else if (b_input_4_center_rear)
+            work = DoWork_4_0_to_2_0;
+        else if (b_input_3_x)
+            work = DoWork_3_x_to_2_0;
+    }
+    else if (output == AOUT_CHANS_4_0)
+    {
+        if (b_input_7_x)
+            work = DoWork_7_x_to_4_0;
+        else if (b_input_5_x)
+            work = DoWork_5_x_to_4_0;
+    }
+
+    if (work == NULL)
+        return VLC_EGENERIC;
+
+    static const struct vlc_filter_operations filter_ops =
+        { .filter_audio = Filter };
+
+    filter->ops = &filter_ops;
+    filter->p_sys = (void *)work;
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/*****************************************************************************
+ * volume.c : x86 SSE4.1 and AVX2 audio volume
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_cpu.h>
+#include <vlc_aout.h>
+#include <vlc_aout_volume.h>
+
+#include "x86.h"
+
+static int Probe(vlc_object_t *);
+
+vlc_module_begin()
+    set_subcategory(SUBCAT_AUDIO_AFILTER)
+    set_description(N_(X86_ISA " audio volume"))
+#if defined (PLUGIN_AVX2)
+    set_capability("audio volume", 25)
+#else
+    set_capability("audio volume", 20)
+#endif
+    set_callback(Probe)
+vlc_module_end()
+
+/* The results are identical to the float_mixer and integer_mixer modules. */
+
+VLC_TARGET
+static void AmplifyFloat(audio_volume_t *volume, block_t *block, float amp)
+{
+    float *buf = (float *)block->p_buffer;
+    size_t n = block->i_buffer / sizeof (*buf);
+
+    if (amp == 1.f)
+        return;
+
+    const vfloat vamp = vf_set1(amp);
+
+    for (; n >= VFLOATS; n -= VFLOATS, buf += VFLOATS)
+        vf_storeu(buf, vf_mul(vf_loadu(buf), vamp));
+    while (n-- > 0)
+        *(buf++) *= amp;
+
+    (void) volume;
+}
+
+VLC_TARGET
+static void AmplifyDouble(audio_volume_t *volume, block_t *block, float amp)
+{
+    double *buf = (double *)block->p_buffer;
+    size_t n = block->i_buffer / sizeof (*buf);
+    double mult = amp;
+
+    if (mult == 1.)
+        return;
+
+    const vdouble vamp = vd_set1(mult);
+
+    for (; n >= VDOUBLES; n -= VDOUBLES, buf += VDOUBLES)
+        vd_storeu(buf, vd_mul(vd_loadu(buf), vamp));
+    while (n-- > 0)
+        *(buf++) *= mult;
+
+    (void) volume;
+}
+
+VLC_TARGET
+static void AmplifyShort(audio_volume_t *volume, block_t *block, float amp)
+{
+    int16_t *buf = (int16_t *)block->p_buffer;
+    size_t n = block->i_buffer / sizeof (*buf);
+    int_fast16_t mult = lroundf(amp * 0x1.p8f);
+
+    if (mult == (1 << 8))
+        return;
+
+    const vint vmult = v_set1_32(mult);
+    const size_t step = VSIZE / sizeof (*buf);
+
+    /* 32-bits products, shifted then saturated back to 16-bits. Larger
+     * gains would overflow the products, those are left to the C loop. */
+    if (likely(mult <= INT16_MAX))
+    {
+        for (; n >= step; n -= step, buf += step)
+        {
+            vint lo = v_load_s16_32(buf);
+            vint hi = v_load_s16_32(buf + step / 2);
+
+            lo = v_srai32(v_mullo32(lo, vmult), 8);
+            hi = v_srai32(v_mullo32(hi, vmult), 8);
+            v_storeu(buf, v_packs32(lo, hi));
+        }
+    }
+
+    while (n-- > 0)
+    {
+        int_fast32_t s = (*buf * (int_fast32_t)mult) >> 8;
+
+        *(buf++) = VLC_CLIP(s, INT16_MIN, INT16_MAX);
+    }
+
+    (void) volume;
+}
+
+static int Probe(vlc_object_t *obj)
+{
+    audio_volume_t *volume = (audio_volume_t *)obj;
+
+    if (!vlc_CPU_capable())
+        return VLC_ENOTSUP;
+
+    switch (volume->format)
+    {
+        case VLC_CODEC_FL32:
+            volume->amplify = AmplifyFloat;
+            break;
+        case VLC_CODEC_FL64:
+            volume->amplify = AmplifyDouble;
+            break;
+        case VLC_CODEC_S16N:
+            volume->amplify = AmplifyShort;
+            break;
+        default:
+            return VLC_ENOTSUP;
+    }
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,213 @@
+/*****************************************************************************
+ * x86.h : x86 SIMD helpers shared by the SSE4.1 and AVX2 plugins
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Each x86 plugin source is built twice, with PLUGIN_SSE4_1 and PLUGIN_AVX2.
+ * The kernels are written once against the vector helpers below, which
+ * expand to 128-bits or 256-bits instructions.
+ *
+ * Only the functions marked with VLC_TARGET use the instruction set, so that
+ * the module descriptor and the probing code run on any x86 CPU. */
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#if defined (PLUGIN_AVX2)
+# define VLC_TARGET __attribute__ ((__target__ ("avx2")))
+# define vlc_CPU_capable() vlc_CPU_AVX2()
+# define X86_ISA "AVX2"
+
+typedef __m256i vint;
+typedef __m256 vfloat;
+typedef __m256d vdouble;
+
+#elif defined (PLUGIN_SSE4_1)
+# define VLC_TARGET __attribute__ ((__target__ ("sse4.1")))
+# define vlc_CPU_capable() vlc_CPU_SSE4_1()
+# define X86_ISA "SSE4.1"
+
+typedef __m128i vint;
+typedef __m128 vfloat;
+typedef __m128d vdouble;
+
+#else
+# error Unknown x86 instruction set
+#endif
+
+/** Vector size in bytes */
+#define VSIZE sizeof (vint)
+/** Number of single precision floats per vector */
+#define VFLOATS (VSIZE / sizeof (float))
+/** Number of double precision floats per vector */
+#define VDOUBLES (VSIZE / sizeof (double))
+
+/*
+ * Integer vectors
+ *
+ * The zip, unzip and pack helpers return elements in memory order: the
+ * AVX2 versions undo the per 128-bits lane behaviour of the instructions.
+ */
+#if defined (PLUGIN_AVX2)
+# define v_loadu(p)      _mm256_loadu_si256((const __m256i *)(p))
+# define v_storeu(p, v)  _mm256_storeu_si256((__m256i *)(p), v)
+# define v_zero()        _mm256_setzero_si256()
+# define v_set1_8(x)     _mm256_set1_epi8(x)
+# define v_set1_16(x)    _mm256_set1_epi16(x)
+# define v_set1_32(x)    _mm256_set1_epi32(x)
+# define v_add16(a, b)   _mm256_add_epi16(a, b)
+# define v_sub16(a, b)   _mm256_sub_epi16(a, b)
+# define v_or(a, b)      _mm256_or_si256(a, b)
+# define v_and(a, b)     _mm256_and_si256(a, b)
+# define v_add32(a, b)   _mm256_add_epi32(a, b)
+# define v_mullo32(a, b) _mm256_mullo_epi32(a, b)
+# define v_srai32(a, n)  _mm256_srai_epi32(a, n)
+# define v_srl16(a, n)   _mm256_srl_epi16(a, n)
+# define v_sll16(a, n)   _mm256_sll_epi16(a, n)
+# define v_shuffle8(a, m) _mm256_shuffle_epi8(a, m)
+
+/* Repeats a 16-bytes pattern in each lane */
+# define v_broadcast16(p) \
+    _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(p)))
+
+/* Loads VSIZE/2 bytes, zero-extended to 16-bits */
+# define v_load_u8_16(p) \
+    _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+/* Loads VSIZE/4 bytes, zero-extended to 32-bits */
+# define v_load_u8_32(p) \
+    _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p)))
+/* Loads VSIZE/4 signed 16-bits samples, sign-extended to 32-bits */
+# define v_load_s16_32(p) \
+    _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+
+# define v_inorder(v)    _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0))
+
+VLC_TARGET static inline vint v_zip8_lo(vint a, vint b)
+{
+    return _mm256_unpacklo_epi8(v_inorder(a), v_inorder(b));
+}
+
+VLC_TARGET static inline vint v_zip8_hi(vint a, vint b)
+{
+    return _mm256_unpackhi_epi8(v_inorder(a), v_inorder(b));
+}
+
+VLC_TARGET static inline vint v_zip16_lo(vint a, vint b)
+{
+    return _mm256_unpacklo_epi16(v_inorder(a), v_inorder(b));
+}
+
+VLC_TARGET static inline vint v_zip16_hi(vint a, vint b)
+{
+    return _mm256_unpackhi_epi16(v_inorder(a), v_inorder(b));
+}
+
+VLC_TARGET static inline vint v_packus16(vint a, vint b)
+{
+    return v_inorder(_mm256_packus_epi16(a, b));
+}
+
+VLC_TARGET static inline vint v_packs32(vint a, vint b)
+{
+    return v_inorder(_mm256_packs_epi32(a, b));
+}
+
+#else
+# define v_loadu(p)      _mm_loadu_si128((const __m128i *)(p))
+# define v_storeu(p, v)  _mm_storeu_si128((__m128i *)(p), v)
+# define v_zero()        _mm_setzero_si128()
+# define v_set1_8(x)     _mm_set1_epi8(x)
+# define v_set1_16(x)    _mm_set1_epi16(x)
+# define v_set1_32(x)    _mm_set1_epi32(x)
+# define v_add16(a, b)   _mm_add_epi16(a, b)
+# define v_sub16(a, b)   _mm_sub_epi16(a, b)
+# define v_or(a, b)      _mm_or_si128(a, b)
+# define v_and(a, b)     _mm_and_si128(a, b)
+# define v_add32(a, b)   _mm_add_epi32(a, b)
+# define v_mullo32(a, b) _mm_mullo_epi32(a, b)
+# define v_srai32(a, n)  _mm_srai_epi32(a, n)
+# define v_srl16(a, n)   _mm_srl_epi16(a, n)
+# define v_sll16(a, n)   _mm_sll_epi16(a, n)
+# define v_shuffle8(a, m) _mm_shuffle_epi8(a, m)
+# define v_broadcast16(p) _mm_loadu_si128((const __m128i *)(p))
+
+# define v_load_u8_16(p) \
+    _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(p)))
+# define v_load_s16_32(p) \
+    _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)(p)))
+
+VLC_TARGET static inline vint v_load_u8_32(const void *p)
+{
+    int32_t x;
+
+    memcpy(&x, p, sizeof (x));
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(x));
+}
+
+# define v_zip8_lo(a, b)    _mm_unpacklo_epi8(a, b)
+# define v_zip8_hi(a, b)    _mm_unpackhi_epi8(a, b)
+# define v_zip16_lo(a, b)   _mm_unpacklo_epi16(a, b)
+# define v_zip16_hi(a, b)   _mm_unpackhi_epi16(a, b)
+# define v_packus16(a, b)   _mm_packus_epi16(a, b)
+# define v_packs32(a, b)    _mm_packs_epi32(a, b)
+#endif
+
+/* Even bytes of a then b */
+VLC_TARGET static inline vint v_unzip8_even(vint a, vint b)
+{
+    const vint mask = v_set1_16(0x00FF);
+    return v_packus16(v_and(a, mask), v_and(b, mask));
+}
+
+/* Odd bytes of a then b */
+VLC_TARGET static inline vint v_unzip8_odd(vint a, vint b)
+{
+#if defined (PLUGIN_AVX2)
+    return v_packus16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+#else
+    return v_packus16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+#endif
+}
+
+/*
+ * Floating point vectors
+ */
+#if defined (PLUGIN_AVX2)
+# define vf_loadu(p)     _mm256_loadu_ps(p)
+# define vf_storeu(p, v) _mm256_storeu_ps(p, v)
+# define vf_set1(x)      _mm256_set1_ps(x)
+# define vf_add(a, b)    _mm256_add_ps(a, b)
+# define vf_mul(a, b)    _mm256_mul_ps(a, b)
+# define vf_div(a, b)    _mm256_div_ps(a, b)
+# define vd_loadu(p)     _mm256_loadu_pd(p)
+# define vd_storeu(p, v) _mm256_storeu_pd(p, v)
+# define vd_set1(x)      _mm256_set1_pd(x)
+# define vd_mul(a, b)    _mm256_mul_pd(a, b)
+#else
+# define vf_loadu(p)     _mm_loadu_ps(p)
+# define vf_storeu(p, v) _mm_storeu_ps(p, v)
+# define vf_set1(x)      _mm_set1_ps(x)
+# define vf_add(a, b)    _mm_add_ps(a, b)
+# define vf_mul(a, b)    _mm_mul_ps(a, b)
+# define vf_div(a, b)    _mm_div_ps(a, b)
+# define vd_loadu(p)     _mm_loadu_pd(p)
+# define vd_storeu(p, v) _mm_storeu_pd(p, v)
+# define vd_set1(x)      _mm_set1_pd(x)
+# define vd_mul(a, b)    _mm_mul_pd(a, b)
+#endif
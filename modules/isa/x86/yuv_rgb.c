@@ -0,0 +1,391 @@
+/*****************************************************************************
+ * yuv_rgb.c : x86 SSE4.1 and AVX2 YUV 4:2:0 to RGB conversions
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#include "x86.h"
+#include "../../video_chroma/i420_rgb_c.h"
+
+static int Open (filter_t *);
+static void Close (filter_t *);
+
+vlc_module_begin ()
+    set_description (N_(X86_ISA " I420,IYUV,YV12,NV12,NV21 to RV15,RV16,RV32 conversions"))
+#if defined (PLUGIN_AVX2)
+    set_callback_video_converter(Open, 270)
+#else
+    set_callback_video_converter(Open, 260)
+#endif
+vlc_module_end ()
+
+/* The conversion is the one of the plain C i420_rgb module, without its
+ * lookup tables: each component is the luma plus a chroma term, saturated to
+ * 8-bits, then shifted in place according to the output masks. */
+
+#define RED_BIAS   ((V_RED_COEF * 128) >> SHIFT)
+#define GREEN_BIAS (((U_GREEN_COEF + V_GREEN_COEF) * 128) >> SHIFT)
+#define BLUE_BIAS  ((U_BLUE_COEF * 128) >> SHIFT)
+
+typedef struct
+{
+    unsigned rshift[3]; /**< right shifts of the 8-bits red, green, blue */
+    unsigned lshift[3]; /**< left shifts of the red, green, blue */
+    uint8_t shuffle[16]; /**< R,G,B,0 to output bytes order, 4 pixels */
+} filter_sys_t;
+
+static inline uint8_t Clip (int x)
+{
+    return (x < 0) ? 0 : (x > 255) ? 255 : x;
+}
+
+/* Chroma terms of VSIZE / 2 chroma samples, each one duplicated so as to
+ * match VSIZE pixels, returned as two vectors of 16-bits */
+VLC_TARGET static inline
+void ChromaTerm (vint *lo, vint *hi, const uint8_t *u, const uint8_t *v,
+                 int ucoef, int vcoef, int bias)
+{
+    const vint vu = v_set1_32(ucoef), vv = v_set1_32(vcoef);
+    vint a = v_add32 (v_mullo32 (v_load_u8_32 (u), vu),
+                      v_mullo32 (v_load_u8_32 (v), vv));
+    vint b = v_add32 (v_mullo32 (v_load_u8_32 (u + VSIZE / 4), vu),
+                      v_mullo32 (v_load_u8_32 (v + VSIZE / 4), vv));
+    vint term = v_sub16 (v_packs32 (v_srai32 (a, SHIFT), v_srai32 (b, SHIFT)),
+                         v_set1_16 (bias));
+
+    *lo = v_zip16_lo (term, term);
+    *hi = v_zip16_hi (term, term);
+}
+
+/* Converts VSIZE pixels to 8-bits R, G and B vectors */
+VLC_TARGET static inline
+void ConvertBlock (vint *r, vint *g, vint *b, const uint8_t *y,
+                   const uint8_t *u, const uint8_t *v)
+{
+    vint y0 = v_load_u8_16 (y), y1 = v_load_u8_16 (y + VSIZE / 2);
+    vint lo, hi;
+
+    ChromaTerm (&lo, &hi, u, v, 0, V_RED_COEF, RED_BIAS);
+    *r = v_packus16 (v_add16 (y0, lo), v_add16 (y1, hi));
+    ChromaTerm (&lo, &hi, u, v, U_GREEN_COEF, V_GREEN_COEF, GREEN_BIAS);
+    *g = v_packus16 (v_add16 (y0, lo), v_add16 (y1, hi));
+    ChromaTerm (&lo, &hi, u, v, U_BLUE_COEF, 0, BLUE_BIAS);
+    *b = v_packus16 (v_add16 (y0, lo), v_add16 (y1, hi));
+}
+
+static inline
+uint32_t ConvertPixel (const filter_sys_t *sys, int y, int u, int v)
+{
+    int r = (V_RED_COEF * v) >> SHIFT;
+    int g = (U_GREEN_COEF * u + V_GREEN_COEF * v) >> SHIFT;
+    int b = (U_BLUE_COEF * u) >> SHIFT;
+
+    return ((uint32_t)(Clip (y + r - RED_BIAS) >> sys->rshift[0]) << sys->lshift[0])
+         | ((uint32_t)(Clip (y + g - GREEN_BIAS) >> sys->rshift[1]) << sys->lshift[1])
+         | ((uint32_t)(Clip (y + b - BLUE_BIAS) >> sys->rshift[2]) << sys->lshift[2]);
+}
+
+/* Stores VSIZE pixels as 32-bits R,G,B,0 reordered by the shuffle */
+VLC_TARGET static inline
+void StoreRGB32 (uint8_t *p, vint r, vint g, vint b, vint shuffle)
+{
+    const vint zero = v_zero ();
+    vint rg0 = v_zip8_lo (r, g), rg1 = v_zip8_hi (r, g);
+    vint b0 = v_zip8_lo (b, zero), b1 = v_zip8_hi (b, zero);
+
+    v_storeu (p, v_shuffle8 (v_zip16_lo (rg0, b0), shuffle));
+    v_storeu (p + VSIZE, v_shuffle8 (v_zip16_hi (rg0, b0), shuffle));
+    v_storeu (p + 2 * VSIZE, v_shuffle8 (v_zip16_lo (rg1, b1), shuffle));
+    v_storeu (p + 3 * VSIZE, v_shuffle8 (v_zip16_hi (rg1, b1), shuffle));
+}
+
+VLC_TARGET
+static void I420_RGB32 (filter_t *filter, picture_t *src, picture_t *dst)
+{
+    const filter_sys_t *sys = filter->p_sys;
+    const unsigned width = filter->fmt_in.video.i_x_offset
+                         + filter->fmt_in.video.i_visible_width;
+    const unsigned height = filter->fmt_in.video.i_y_offset
+                          + filter->fmt_in.video.i_visible_height;
+    const vint shuffle = v_broadcast16 (sys->shuffle);
+
+    for (unsigned i = 0; i < height; i++)
+    {
+        const uint8_t *y = &src->p[Y_PLANE].p_pixels[i * src->p[Y_PLANE].i_pitch];
+        const uint8_t *u = &src->p[U_PLANE].p_pixels[(i / 2) * src->p[U_PLANE].i_pitch];
+        const uint8_t *v = &src->p[V_PLANE].p_pixels[(i / 2) * src->p[V_PLANE].i_pitch];
+        uint8_t *out = &dst->p->p_pixels[i * dst->p->i_pitch];
+        unsigned x = 0;
+
+        for (; x + VSIZE <= width; x += VSIZE)
+        {
+            vint r, g, b;
+
+            ConvertBlock (&r, &g, &b, y + x, u + x / 2, v + x / 2);
+            StoreRGB32 (out + 4 * x, r, g, b, shuffle);
+        }
+
+        for (; x < width; x++)
+        {
+            uint32_t pixel = ConvertPixel (sys, y[x], u[x / 2], v[x / 2]);
+
+            memcpy (out + 4 * x, &pixel, sizeof (pixel));
+        }
+    }
+}
+VIDEO_FILTER_WRAPPER_CLOSE (I420_RGB32, Close)
+
+/* Same as I420_RGB32 with the chroma samples deinterleaved block by block
+ * from the semi-planar UV (or VU if swapped) plane */
+VLC_TARGET static inline
+void SemiPlanar_RGB32 (filter_t *filter, picture_t *src, picture_t *dst,
+                       bool swapped)
+{
+    const filter_sys_t *sys = filter->p_sys;
+    const unsigned width = filter->fmt_in.video.i_x_offset
+                         + filter->fmt_in.video.i_visible_width;
+    const unsigned height = filter->fmt_in.video.i_y_offset
+                          + filter->fmt_in.video.i_visible_height;
+    const vint shuffle = v_broadcast16 (sys->shuffle);
+    uint8_t chroma[2][VSIZE];
+    uint8_t *u = chroma[swapped], *v = chroma[!swapped];
+
+    for (unsigned i = 0; i < height; i++)
+    {
+        const uint8_t *y = &src->p[Y_PLANE].p_pixels[i * src->p[Y_PLANE].i_pitch];
+        const uint8_t *uv = &src->p[1].p_pixels[(i / 2) * src->p[1].i_pitch];
+        uint8_t *out = &dst->p->p_pixels[i * dst->p->i_pitch];
+        unsigned x = 0;
+
+        for (; x + VSIZE <= width; x += VSIZE)
+        {
+            vint c = v_loadu (uv + x);
+            vint r, g, b;
+
+            /* VSIZE / 2 samples of each, in the lower half */
+            v_storeu (chroma[0], v_unzip8_even (c, c));
+            v_storeu (chroma[1], v_unzip8_odd (c, c));
+            ConvertBlock (&r, &g, &b, y + x, u, v);
+            StoreRGB32 (out + 4 * x, r, g, b, shuffle);
+        }
+
+        for (; x < width; x++)
+        {
+            const uint8_t *c = uv + (x & ~1u);
+            uint32_t pixel = ConvertPixel (sys, y[x], c[swapped], c[!swapped]);
+
+            memcpy (out + 4 * x, &pixel, sizeof (pixel));
+        }
+    }
+}
+
+VLC_TARGET
+static void NV12_RGB32 (filter_t *filter, picture_t *src, picture_t *dst)
+{
+    SemiPlanar_RGB32 (filter, src, dst, false);
+}
+VIDEO_FILTER_WRAPPER_CLOSE (NV12_RGB32, Close)
+
+VLC_TARGET
+static void NV21_RGB32 (filter_t *filter, picture_t *src, picture_t *dst)
+{
+    SemiPlanar_RGB32 (filter, src, dst, true);
+}
+VIDEO_FILTER_WRAPPER_CLOSE (NV21_RGB32, Close)
+
+VLC_TARGET static inline
+vint Place16 (vint c, const __m128i rshift, const __m128i lshift)
+{
+    return v_sll16 (v_srl16 (c, rshift), lshift);
+}
+
+VLC_TARGET
+static void I420_RGB16 (filter_t *filter, picture_t *src, picture_t *dst)
+{
+    const filter_sys_t *sys = filter->p_sys;
+    const unsigned width = filter->fmt_in.video.i_x_offset
+                         + filter->fmt_in.video.i_visible_width;
+    const unsigned height = filter->fmt_in.video.i_y_offset
+                          + filter->fmt_in.video.i_visible_height;
+    __m128i rshift[3], lshift[3];
+    const vint zero = v_zero ();
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        rshift[i] = _mm_cvtsi32_si128 (sys->rshift[i]);
+        lshift[i] = _mm_cvtsi32_si128 (sys->lshift[i]);
+    }
+
+    for (unsigned i = 0; i < height; i++)
+    {
+        const uint8_t *y = &src->p[Y_PLANE].p_pixels[i * src->p[Y_PLANE].i_pitch];
+        const uint8_t *u = &src->p[U_PLANE].p_pixels[(i / 2) * src->p[U_PLANE].i_pitch];
+        const uint8_t *v = &src->p[V_PLANE].p_pixels[(i / 2) * src->p[V_PLANE].i_pitch];
+        uint8_t *out = &dst->p->p_pixels[i * dst->p->i_pitch];
+        unsigned x = 0;
+
+        for (; x + VSIZE <= width; x += VSIZE)
+        {
+            vint r, g, b;
+
+            ConvertBlock (&r, &g, &b, y + x, u + x / 2, v + x / 2);
+
+            vint lo = v_or (v_or (Place16 (v_zip8_lo (r, zero), rshift[0], lshift[0]),
+                                  Place16 (v_zip8_lo (g, zero), rshift[1], lshift[1])),
+                            Place16 (v_zip8_lo (b, zero), rshift[2], lshift[2]));
+            vint hi = v_or (v_or (Place16 (v_zip8_hi (r, zero), rshift[0], lshift[0]),
+                                  Place16 (v_zip8_hi (g, zero), rshift[1], lshift[1])),
+                            Place16 (v_zip8_hi (b, zero), rshift[2], lshift[2]));
+
+            v_storeu (out + 2 * x, lo);
+            v_storeu (out + 2 * x + VSIZE, hi);
+        }
+
+        for (; x < width; x++)
+        {
+            uint16_t pixel = ConvertPixel (sys, y[x], u[x / 2], v[x / 2]);
+
+            memcpy (out + 2 * x, &pixel, sizeof (pixel));
+        }
+    }
+}
+VIDEO_FILTER_WRAPPER_CLOSE (I420_RGB16, Close)
+
+/* Bit position and width of a component mask, false if it cannot be made
+ * from an 8-bits component */
+static bool GetMaskShifts (uint32_t mask, unsigned *rshift, unsigned *lshift)
+{
+    unsigned bits = vlc_popcount (mask);
+
+    if (mask == 0 || bits > 8)
+        return false;
+    *lshift = ctz (mask);
+    *rshift = 8 - bits;
+    return true;
+}
+
+static int Open (filter_t *filter)
+{
+    if (!vlc_CPU_capable ())
+        return VLC_EGENERIC;
+
+    switch (filter->fmt_in.video.i_chroma)
+    {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_YV12:
+        case VLC_CODEC_NV12:
+        case VLC_CODEC_NV21:
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    const video_format_t *in = &filter->fmt_in.video;
+    const video_format_t *out = &filter->fmt_out.video;
+
+    /* No scaling, unlike the C module */
+    if (in->i_x_offset + in->i_visible_width
+         != out->i_x_offset + out->i_visible_width
+     || in->i_y_offset + in->i_visible_height
+         != out->i_y_offset + out->i_visible_height
+     || in->orientation != out->orientation)
+        return VLC_EGENERIC;
+    if (((in->i_x_offset + in->i_visible_width) & 1)
+     || ((in->i_y_offset + in->i_visible_height) & 1))
+        return VLC_EGENERIC;
+
+    const struct vlc_filter_operations *ops;
+    const bool semiplanar = in->i_chroma == VLC_CODEC_NV12
+                         || in->i_chroma == VLC_CODEC_NV21;
+
+    switch (out->i_chroma)
+    {
+        case VLC_CODEC_RGB15:
+        case VLC_CODEC_RGB16:
+            if (semiplanar)
+                return VLC_EGENERIC;
+            ops = &I420_RGB16_ops;
+            break;
+        case VLC_CODEC_RGB32:
+            if (in->i_chroma == VLC_CODEC_NV12)
+                ops = &NV12_RGB32_ops;
+            else if (in->i_chroma == VLC_CODEC_NV21)
+                ops = &NV21_RGB32_ops;
+            else
+                ops = &I420_RGB32_ops;
+            break;
+        default:
+            return VLC_EGENERIC;
+    }
+
+    video_format_t vfmt;
+    video_format_Copy (&vfmt, out);
+    video_format_FixRgb (&vfmt);
+
+    filter_sys_t *sys = malloc (sizeof (*sys));
+    if (unlikely(sys == NULL))
+    {
+        video_format_Clean (&vfmt);
+        return VLC_ENOMEM;
+    }
+
+    const uint32_t masks[3] = { vfmt.i_rmask, vfmt.i_gmask, vfmt.i_bmask };
+    bool ok = true;
+
+    video_format_Clean (&vfmt);
+
+    /* The unused byte of each 32-bits pixel is the fourth one of R,G,B,0 */
+    for (unsigned p = 0; p < 4; p++)
+        for (unsigned k = 0; k < 4; k++)
+            sys->shuffle[4 * p + k] = 4 * p + 3;
+
+    for (unsigned i = 0; i < 3 && ok; i++)
+    {
+        ok = GetMaskShifts (masks[i], &sys->rshift[i], &sys->lshift[i]);
+        if (!ok || out->i_chroma != VLC_CODEC_RGB32)
+            continue;
+        /* Whole bytes only */
+        ok = sys->rshift[i] == 0 && (sys->lshift[i] % 8) == 0;
+        for (unsigned p = 0; p < 4 && ok; p++)
+            sys->shuffle[4 * p + sys->lshift[i] / 8] = 4 * p + i;
+    }
+
+    if (!ok)
+    {
+        free (sys);
+        return VLC_EGENERIC;
+    }
+
+    filter->p_sys = sys;
+    filter->ops = ops;
+    return VLC_SUCCESS;
+}
+
+static void Close (filter_t *filter)
+{
+    free (filter->p_sys);
+}
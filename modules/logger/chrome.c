@@ -0,0 +1,554 @@
+/*****************************************************************************
+ * chrome.c: binary ring buffer tracer with Chrome trace output
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Traces are recorded in binary form, with their time stamp, in a ring buffer
+ * owned by the calling thread. Recording takes no lock and does no
+ * formatting, so that tracing does not distort the timings being traced.
+ * A background thread drains the buffers and writes the traces as instant
+ * events in the Chrome trace event format (JSON array), which can be viewed
+ * with chrome://tracing or https://ui.perfetto.dev. Span traces are written
+ * as asynchronous begin/end events instead, one track per stream.
+ *
+ * Traces are dropped, rather than blocking the caller, if a buffer is full.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_fs.h>
+#include <vlc_list.h>
+#include <vlc_tracer.h>
+
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <assert.h>
+
+#define CHROME_FILENAME "vlc-trace.json"
+
+/* Drain interval of the thread buffers */
+#define CHROME_DRAIN_INTERVAL VLC_TICK_FROM_MS(100)
+/* Longest recorded trace, longer ones are truncated */
+#define CHROME_RECORD_MAX 1024
+
+/**
+ * Single producer, single consumer byte ring buffer of one tracing thread.
+ */
+struct trace_ring
+{
+    struct vlc_list node;
+    unsigned long tid;
+    atomic_size_t head; /**< written by the producer */
+    atomic_size_t tail; /**< written by the consumer */
+    atomic_bool orphan; /**< the thread has exited */
+    atomic_uint dropped;
+    size_t size; /**< power of two */
+    uint8_t data[];
+};
+
+/* Record header, followed by the entries */
+struct trace_record
+{
+    vlc_tick_t date;
+    uint16_t size; /**< including this header */
+    uint8_t count; /**< number of entries */
+};
+
+/*
+ * Entries are encoded as:
+ *  - the type (1 byte),
+ *  - the key length (1 byte) and characters,
+ *  - the 64-bits integer value, or the string length (1 byte) and characters.
+ */
+
+typedef struct
+{
+    vlc_object_t *obj;
+    FILE *stream;
+    size_t ring_size;
+    vlc_threadvar_t key;
+
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    struct vlc_list rings;
+    unsigned dropped;
+    bool closing;
+    vlc_thread_t thread;
+} vlc_tracer_sys_t;
+
+static void RingWrite(struct trace_ring *ring, size_t pos, const void *data,
+                      size_t len)
+{
+    size_t offset = pos & (ring->size - 1);
+    size_t n = __MIN(len, ring->size - offset);
+
+    memcpy(ring->data + offset, data, n);
+    memcpy(ring->data, (const uint8_t *)data + n, len - n);
+}
+
+static void RingRead(const struct trace_ring *ring, size_t pos, void *data,
+                     size_t len)
+{
+    size_t offset = pos & (ring->size - 1);
+    size_t n = __MIN(len, ring->size - offset);
+
+    memcpy(data, ring->data + offset, n);
+    memcpy((uint8_t *)data + n, ring->data, len - n);
+}
+
+static void RingOrphan(void *data)
+{
+    struct trace_ring *ring = data;
+
+    /* The last traces are still drained before the buffer is freed */
+    atomic_store_explicit(&ring->orphan, true, memory_order_release);
+}
+
+static struct trace_ring *RingGet(vlc_tracer_sys_t *sys)
+{
+    struct trace_ring *ring = vlc_threadvar_get(sys->key);
+    if (likely(ring != NULL))
+        return ring;
+
+    ring = malloc(sizeof (*ring) + sys->ring_size);
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    ring->tid = vlc_thread_id();
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->orphan, false);
+    atomic_init(&ring->dropped, 0);
+    ring->size = sys->ring_size;
+
+    if (vlc_threadvar_set(sys->key, ring)) {
+        free(ring);
+        return NULL;
+    }
+
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_append(&ring->node, &sys->rings);
+    vlc_mutex_unlock(&sys->lock);
+    return ring;
+}
+
+/* Appends a length-prefixed string, truncated at a character boundary */
+static size_t PutString(uint8_t *p, size_t room, const char *str)
+{
+    size_t len = strlen(str);
+
+    if (len > 255)
+        len = 255;
+    if (len > room - 1)
+        len = room - 1;
+    /* Do not cut UTF-8 sequences */
+    if (len < strlen(str))
+        while (len > 0 && (str[len] & 0xC0) == 0x80)
+            len--;
+
+    p[0] = len;
+    memcpy(p + 1, str, len);
+    return 1 + len;
+}
+
+static void TraceRecord(void *opaque, va_list entries)
+{
+    vlc_tracer_sys_t *sys = opaque;
+    struct trace_ring *ring = RingGet(sys);
+    if (unlikely(ring == NULL))
+        return;
+
+    uint8_t buf[CHROME_RECORD_MAX];
+    struct trace_record rec = { .date = vlc_tick_now(), .count = 0 };
+    size_t len = sizeof (rec);
+
+    for (struct vlc_tracer_entry entry = va_arg(entries, struct vlc_tracer_entry);
+         entry.key != NULL;
+         entry = va_arg(entries, struct vlc_tracer_entry))
+    {
+        size_t keylen = strlen(entry.key);
+        size_t need = 2 + keylen + ((entry.type == VLC_TRACER_INT) ? 8 : 2);
+
+        if (keylen > 255 || len + need > sizeof (buf) || rec.count == 255)
+            break; /* truncated */
+
+        buf[len++] = entry.type;
+        len += PutString(buf + len, 256, entry.key);
+
+        switch (entry.type)
+        {
+            case VLC_TRACER_INT:
+                memcpy(buf + len, &entry.value.integer, 8);
+                len += 8;
+                break;
+            case VLC_TRACER_STRING:
+                len += PutString(buf + len, sizeof (buf) - len,
+                                 entry.value.string);
+                break;
+            default:
+                vlc_assert_unreachable();
+        }
+        rec.count++;
+    }
+
+    rec.size = len;
+    memcpy(buf, &rec, sizeof (rec));
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (ring->size - (head - tail) < len) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    RingWrite(ring, head, buf, len);
+    atomic_store_explicit(&ring->head, head + len, memory_order_release);
+}
+
+static void JsonPutChars(FILE *stream, const uint8_t *str, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = str[i];
+
+        if (c == '"' || c == '\\')
+            fprintf(stream, "\\%c", c);
+        else if (c < 0x20 || c == 0x7F)
+            fprintf(stream, "\\u%04x", c);
+        else
+            fputc(c, stream);
+    }
+}
+
+/* Prints a length-prefixed string */
+static void JsonPutString(FILE *stream, const uint8_t *str)
+{
+    fputc('"', stream);
+    JsonPutChars(stream, str + 1, str[0]);
+    fputc('"', stream);
+}
+
+/* Looks up an entry of a record, returns a pointer to its value */
+static const uint8_t *FindEntry(const uint8_t *p, unsigned count,
+                                const char *key, enum vlc_tracer_value type)
+{
+    size_t keylen = strlen(key);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint8_t entry_type = *(p++);
+        bool match = p[0] == keylen && !memcmp(p + 1, key, keylen);
+
+        p += 1 + p[0];
+        if (entry_type == type && match)
+            return p;
+        p += (entry_type == VLC_TRACER_INT) ? 8 : 1 + p[0];
+    }
+    return NULL;
+}
+
+static const uint8_t *FindString(const uint8_t *p, unsigned count,
+                                 const char *key)
+{
+    return FindEntry(p, count, key, VLC_TRACER_STRING);
+}
+
+/* Prints the header of a span trace as an asynchronous event, so that the
+ * begin and end of a stage for a given stream and time stamp are paired. */
+static bool PrintSpan(FILE *stream, const uint8_t *p, unsigned count)
+{
+    const uint8_t *span = FindString(p, count, "span");
+    const uint8_t *phase = FindString(p, count, "phase");
+    const uint8_t *id = FindString(p, count, "id");
+    const uint8_t *pts = FindEntry(p, count, "pts", VLC_TRACER_INT);
+
+    if (span == NULL || phase == NULL || id == NULL || pts == NULL)
+        return false;
+
+    int64_t value;
+    memcpy(&value, pts, 8);
+
+    fputs("{\"name\":", stream);
+    JsonPutString(stream, span);
+    fputs(",\"cat\":", stream);
+    JsonPutString(stream, id);
+    fputs(",\"id\":\"", stream);
+    JsonPutChars(stream, id + 1, id[0]);
+    fprintf(stream, "/%"PRId64"\",\"ph\":\"%c\"", value,
+            (phase[0] == 3 && !memcmp(phase + 1, "end", 3)) ? 'e' : 'b');
+    return true;
+}
+
+/* Prints the header of any other trace as an instant event */
+static void PrintInstant(FILE *stream, const uint8_t *p, unsigned count)
+{
+    const uint8_t *type = FindString(p, count, "type");
+    const uint8_t *sub = FindString(p, count, "stream");
+    if (sub == NULL)
+        sub = FindString(p, count, "id");
+
+    /* The event is named after the trace type, and the stream direction
+     * or else the identifier */
+    fputs("{\"name\":\"", stream);
+    if (type != NULL)
+        JsonPutChars(stream, type + 1, type[0]);
+    else
+        fputs("trace", stream);
+    if (sub != NULL) {
+        fputc(' ', stream);
+        JsonPutChars(stream, sub + 1, sub[0]);
+    }
+    fputs("\",\"cat\":", stream);
+    if (type != NULL)
+        JsonPutString(stream, type);
+    else
+        fputs("\"trace\"", stream);
+    fputs(",\"ph\":\"i\",\"s\":\"t\"", stream);
+}
+
+static void PrintRecord(vlc_tracer_sys_t *sys, unsigned long tid,
+                        const uint8_t *buf)
+{
+    FILE *stream = sys->stream;
+    struct trace_record rec;
+    memcpy(&rec, buf, sizeof (rec));
+
+    const uint8_t *p = buf + sizeof (rec);
+
+    if (!PrintSpan(stream, p, rec.count))
+        PrintInstant(stream, p, rec.count);
+    fprintf(stream, ",\"ts\":%"PRId64",\"pid\":1,\"tid\":%lu,\"args\":{",
+            US_FROM_VLC_TICK(rec.date), tid);
+
+    for (unsigned i = 0; i < rec.count; i++)
+    {
+        uint8_t entry_type = *(p++);
+
+        if (i > 0)
+            fputc(',', stream);
+        JsonPutString(stream, p);
+        fputc(':', stream);
+        p += 1 + p[0];
+
+        if (entry_type == VLC_TRACER_INT) {
+            int64_t value;
+
+            memcpy(&value, p, 8);
+            fprintf(stream, "%"PRId64, value);
+            p += 8;
+        } else {
+            JsonPutString(stream, p);
+            p += 1 + p[0];
+        }
+    }
+    fputs("}},\n", stream);
+}
+
+static void Drain(vlc_tracer_sys_t *sys)
+{
+    struct vlc_list rings;
+    struct trace_ring *ring;
+    uint8_t buf[CHROME_RECORD_MAX];
+    unsigned dropped = 0;
+
+    /* Detach the buffers, so that the records are formatted and written
+     * without holding the lock needed by the threads tracing a first time */
+    vlc_mutex_lock(&sys->lock);
+    if (vlc_list_is_empty(&sys->rings))
+        vlc_list_init(&rings);
+    else {
+        vlc_list_replace(&sys->rings, &rings);
+        vlc_list_init(&sys->rings);
+    }
+    vlc_mutex_unlock(&sys->lock);
+
+    vlc_list_foreach(ring, &rings, node)
+    {
+        /* Read the flag first, not to miss the last traces */
+        bool orphan = atomic_load_explicit(&ring->orphan,
+                                           memory_order_acquire);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+        while (tail != head)
+        {
+            struct trace_record rec;
+
+            RingRead(ring, tail, &rec, sizeof (rec));
+            assert(rec.size >= sizeof (rec) && rec.size <= sizeof (buf));
+            RingRead(ring, tail, buf, rec.size);
+            PrintRecord(sys, ring->tid, buf);
+            tail += rec.size;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+        dropped += atomic_exchange_explicit(&ring->dropped, 0,
+                                            memory_order_relaxed);
+        if (orphan) {
+            vlc_list_remove(&ring->node);
+            free(ring);
+        }
+    }
+    fflush(sys->stream);
+
+    /* Put the remaining buffers back along the ones created meanwhile */
+    vlc_mutex_lock(&sys->lock);
+    vlc_list_foreach(ring, &rings, node)
+    {
+        vlc_list_remove(&ring->node);
+        vlc_list_append(&ring->node, &sys->rings);
+    }
+    sys->dropped += dropped;
+    vlc_mutex_unlock(&sys->lock);
+}
+
+static void *Thread(void *data)
+{
+    vlc_tracer_sys_t *sys = data;
+
+    vlc_mutex_lock(&sys->lock);
+    while (!sys->closing)
+    {
+        vlc_tick_t deadline = vlc_tick_now() + CHROME_DRAIN_INTERVAL;
+
+        while (!sys->closing
+            && vlc_cond_timedwait(&sys->wait, &sys->lock, deadline) == 0);
+        vlc_mutex_unlock(&sys->lock);
+        Drain(sys);
+        vlc_mutex_lock(&sys->lock);
+    }
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+static void Close(void *opaque)
+{
+    vlc_tracer_sys_t *sys = opaque;
+
+    vlc_mutex_lock(&sys->lock);
+    sys->closing = true;
+    vlc_cond_signal(&sys->wait);
+    vlc_mutex_unlock(&sys->lock);
+    vlc_join(sys->thread, NULL);
+
+    /* No more traces can be recorded at this point */
+    struct trace_ring *ring;
+
+    Drain(sys);
+    vlc_list_foreach(ring, &sys->rings, node)
+        free(ring);
+    vlc_threadvar_delete(&sys->key);
+
+    if (sys->dropped > 0)
+        msg_Warn(sys->obj, "%u traces dropped (buffers full)", sys->dropped);
+
+    /* Terminate the array with a process name event (no trailing comma) */
+    fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"VLC\"}}\n]\n", sys->stream);
+    fclose(sys->stream);
+    free(sys);
+}
+
+static const struct vlc_tracer_operations chrome_ops =
+{
+    TraceRecord,
+    Close
+};
+
+static const struct vlc_tracer_operations *Open(vlc_object_t *obj,
+                                               void **restrict sysp)
+{
+    vlc_tracer_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return NULL;
+
+    sys->obj = obj;
+    /* Round the buffer size up to a power of two */
+    size_t size = var_InheritInteger(obj, "chrome-tracer-buffer") * 1024;
+    sys->ring_size = CHROME_RECORD_MAX;
+    while (sys->ring_size < size)
+        sys->ring_size *= 2;
+
+    const char *filename = CHROME_FILENAME;
+    char *path = var_InheritString(obj, "chrome-tracer-file");
+    if (path != NULL)
+        filename = path;
+
+    msg_Dbg(obj, "opening trace file `%s'", filename);
+    sys->stream = vlc_fopen(filename, "wt");
+    if (sys->stream == NULL)
+    {
+        msg_Err(obj, "error opening trace file `%s': %s", filename,
+                vlc_strerror_c(errno));
+        free(path);
+        free(sys);
+        return NULL;
+    }
+    free(path);
+    fputs("[\n", sys->stream);
+
+    if (vlc_threadvar_create(&sys->key, RingOrphan))
+        goto error;
+
+    vlc_mutex_init(&sys->lock);
+    vlc_cond_init(&sys->wait);
+    vlc_list_init(&sys->rings);
+    sys->dropped = 0;
+    sys->closing = false;
+
+    if (vlc_clone(&sys->thread, Thread, sys, VLC_THREAD_PRIORITY_LOW))
+    {
+        vlc_threadvar_delete(&sys->key);
+        goto error;
+    }
+
+    *sysp = sys;
+    return &chrome_ops;
+
+error:
+    fclose(sys->stream);
+    free(sys);
+    return NULL;
+}
+
+#define FILE_TEXT N_("Trace file")
+#define FILE_LONGTEXT N_("Chrome trace (JSON) file to write the traces to.")
+
+#define BUFFER_TEXT N_("Trace buffer size (kB)")
+#define BUFFER_LONGTEXT N_( \
+    "Size of the trace buffer of each thread. Traces are dropped if the " \
+    "buffer fills up before it is written to the file.")
+
+vlc_module_begin()
+    set_shortname(N_("Chrome tracer"))
+    set_description(N_("Chrome trace event tracer"))
+    set_subcategory(SUBCAT_ADVANCED_MISC)
+    set_capability("tracer", 0)
+    set_callback(Open)
+
+    add_savefile("chrome-tracer-file", NULL, FILE_TEXT, FILE_LONGTEXT)
+    add_integer("chrome-tracer-buffer", 256, BUFFER_TEXT, BUFFER_LONGTEXT)
+        change_integer_range(4, 65536)
+vlc_module_end()
@@ -47,6 +47,10 @@ typedef struct vlc_tls_gnutls
     vlc_tls_t tls;
     gnutls_session_t session;
     vlc_object_t *obj;
+    struct vlc_tls_client_sys *client; /**< client credentials or NULL */
+    char *key; /**< session cache key (client only) */
+    bool started; /**< handshake started (client only) */
+    bool verified; /**< peer authenticated by a CA (client only) */
 } vlc_tls_gnutls_t;
 
 static void gnutls_Banner(vlc_object_t *obj)
@@ -208,6 +212,7 @@ static void gnutls_Close (vlc_tls_t *tls)
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
 
     gnutls_deinit(priv->session);
+    free(priv->key);
     free(priv);
 }
 
@@ -293,8 +298,13 @@ static vlc_tls_gnutls_t *gnutls_SessionOpen(vlc_object_t *obj, int type,
     gnutls_transport_set_vec_push_function(session, vlc_gnutls_writev);
     gnutls_transport_set_pull_function(session, vlc_gnutls_read);
 
+    gnutls_session_set_ptr(session, priv);
     priv->session = session;
     priv->obj = obj;
+    priv->client = NULL;
+    priv->key = NULL;
+    priv->started = false;
+    priv->verified = false;
 
     vlc_tls_t *tls = &priv->tls;
 
@@ -373,12 +383,118 @@ static int gnutls_Handshake(vlc_tls_t *tls, char **restrict alp)
     return 0;
 }
 
+#define GNUTLS_SESSION_CACHE_SIZE 16
+
+/**
+ * Client-side TLS credentials private data
+ */
+typedef struct vlc_tls_client_sys
+{
+    gnutls_certificate_credentials_t x509;
+    vlc_mutex_t lock; /**< protects the session cache */
+    unsigned count;
+    struct
+    {
+        char *key;
+        gnutls_datum_t data;
+    } cache[GNUTLS_SESSION_CACHE_SIZE]; /**< most recently saved first */
+} vlc_tls_client_sys_t;
+
+/* Sessions are cached per host and service, as the stored public keys */
+static char *gnutls_SessionKey(const char *host, const char *service)
+{
+    char *key;
+
+    if (asprintf(&key, "%s\n%s", host, (service != NULL) ? service : "") < 0)
+        key = NULL;
+    return key;
+}
+
+static unsigned gnutls_SessionFind(const vlc_tls_client_sys_t *sys,
+                                   const char *key)
+{
+    unsigned i = 0;
+
+    while (i < sys->count && strcmp(sys->cache[i].key, key) != 0)
+        i++;
+    return i;
+}
+
+/**
+ * Saves the resumption data of an authenticated client session.
+ *
+ * This is called after the handshake for TLS 1.2, and whenever the server
+ * sends a new session ticket for TLS 1.3, which may be on any thread
+ * receiving data from the session.
+ */
+static void gnutls_SessionSave(vlc_tls_gnutls_t *priv)
+{
+    vlc_tls_client_sys_t *sys = priv->client;
+    gnutls_datum_t data;
+
+    assert(sys != NULL);
+
+    if (priv->key == NULL
+     || gnutls_session_get_data2(priv->session, &data) != 0)
+        return;
+
+    vlc_mutex_lock(&sys->lock);
+
+    unsigned i = gnutls_SessionFind(sys, priv->key);
+    char *key;
+
+    if (i < sys->count)
+    {
+        key = sys->cache[i].key;
+        gnutls_free(sys->cache[i].data.data);
+    }
+    else
+    {
+        key = strdup(priv->key);
+        if (unlikely(key == NULL))
+        {
+            vlc_mutex_unlock(&sys->lock);
+            gnutls_free(data.data);
+            return;
+        }
+
+        if (sys->count < GNUTLS_SESSION_CACHE_SIZE)
+            i = sys->count++;
+        else
+        {   /* Evict the oldest session */
+            i = sys->count - 1;
+            free(sys->cache[i].key);
+            gnutls_free(sys->cache[i].data.data);
+        }
+    }
+
+    memmove(sys->cache + 1, sys->cache, i * sizeof (sys->cache[0]));
+    sys->cache[0].key = key;
+    sys->cache[0].data = data;
+    vlc_mutex_unlock(&sys->lock);
+}
+
+static int gnutls_TicketHook(gnutls_session_t session, unsigned type,
+                             unsigned when, unsigned incoming,
+                             const gnutls_datum_t *msg)
+{
+    vlc_tls_gnutls_t *priv = gnutls_session_get_ptr(session);
+
+    (void) type; (void) when; (void) msg;
+
+    /* Do not resume sessions not authenticated by a CA */
+    if (incoming && priv->verified)
+        gnutls_SessionSave(priv);
+    return 0;
+}
+
 static vlc_tls_t *gnutls_ClientSessionOpen(vlc_tls_client_t *crd,
                                            vlc_tls_t *sk, const char *hostname,
                                            const char *const *alpn)
 {
+    vlc_tls_client_sys_t *sys = crd->sys;
     vlc_tls_gnutls_t *priv = gnutls_SessionOpen(VLC_OBJECT(crd), GNUTLS_CLIENT,
-                                                crd->sys, sk, alpn);
+                                                sys->x509, sk, alpn);
     if (priv == NULL)
         return NULL;
 
@@ -392,25 +508,29 @@ static vlc_tls_t *gnutls_ClientSessionOpen(vlc_tls_client_t *crd,
         gnutls_server_name_set (session, GNUTLS_NAME_DNS,
                                 hostname, strlen (hostname));
 
+    priv->client = sys;
+    gnutls_handshake_set_hook_function(session,
+                                       GNUTLS_HANDSHAKE_NEW_SESSION_TICKET,
+                                       GNUTLS_HOOK_POST, gnutls_TicketHook);
     return &priv->tls;
 }
 
-static int gnutls_ClientHandshake(vlc_tls_t *tls,
-                                  const char *host, const char *service,
-                                  char **restrict alp)
+/**
+ * Authenticates the server of a client session.
+ *
+ * @return 0 if the server certificate is authenticated by a trusted CA,
+ * 1 if its key was accepted by the user, now or before, -1 otherwise.
+ */
+static int gnutls_ClientVerify(vlc_tls_gnutls_t *priv,
+                               const char *host, const char *service)
 {
-    vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
     vlc_object_t *obj = priv->obj;
 
-    int val = gnutls_Handshake(tls, alp);
-    if (val)
-        return val;
-
     /* certificates chain verification */
     gnutls_session_t session = priv->session;
     unsigned status;
 
-    val = gnutls_certificate_verify_peers3 (session, host, &status);
+    int val = gnutls_certificate_verify_peers3 (session, host, &status);
     if (val)
     {
         msg_Err(obj, "Certificate verification error: %s",
@@ -457,7 +577,7 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
     {
         case 0:
             msg_Dbg(obj, "certificate key match for %s", host);
-            return 0;
+            return 1;
         case GNUTLS_E_NO_CERTIFICATE_FOUND:
             msg_Dbg(obj, "no known certificates for %s", host);
             msg = N_("However, the security certificate presented by the "
@@ -521,19 +641,76 @@ static int gnutls_ClientHandshake(vlc_tls_t *tls,
         default:
             goto error;
     }
-    return 0;
+    return 1;
 
 error:
-    if (alp != NULL)
-        free(*alp);
     return -1;
 }
 
+static int gnutls_ClientHandshake(vlc_tls_t *tls,
+                                  const char *host, const char *service,
+                                  char **restrict alp)
+{
+    vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
+    vlc_tls_client_sys_t *sys = priv->client;
+    gnutls_session_t session = priv->session;
+
+    if (!priv->started && host != NULL)
+    {   /* Try to resume a previous session with the same server */
+        priv->key = gnutls_SessionKey(host, service);
+        if (likely(priv->key != NULL))
+        {
+            vlc_mutex_lock(&sys->lock);
+            unsigned i = gnutls_SessionFind(sys, priv->key);
+            if (i < sys->count)
+                gnutls_session_set_data(session, sys->cache[i].data.data,
+                                        sys->cache[i].data.size);
+            vlc_mutex_unlock(&sys->lock);
+        }
+    }
+    priv->started = true;
+
+    int val = gnutls_Handshake(tls, alp);
+    if (val)
+        return val;
+
+    /* Only sessions with servers authenticated by a CA are ever cached, so a
+     * resumed session needs no further verification. Keys accepted by the
+     * user may expire, so those sessions are verified on every handshake. */
+    if (gnutls_session_is_resumed(session))
+        msg_Dbg(priv->obj, "TLS session resumed");
+    else
+    {
+        val = gnutls_ClientVerify(priv, host, service);
+        if (val < 0)
+        {
+            if (alp != NULL)
+                free(*alp);
+            return -1;
+        }
+        if (val > 0)
+            return 0;
+    }
+
+    priv->verified = true;
+
+    /* With TLS 1.3, session tickets come after the handshake. */
+    if (gnutls_protocol_get_version(session) != GNUTLS_TLS1_3)
+        gnutls_SessionSave(priv);
+    return 0;
+}
+
 static void gnutls_ClientDestroy(vlc_tls_client_t *crd)
 {
-    gnutls_certificate_credentials_t x509 = crd->sys;
+    vlc_tls_client_sys_t *sys = crd->sys;
 
-    gnutls_certificate_free_credentials(x509);
+    for (unsigned i = 0; i < sys->count; i++)
+    {
+        free(sys->cache[i].key);
+        gnutls_free(sys->cache[i].data.data);
+    }
+    gnutls_certificate_free_credentials(sys->x509);
+    free(sys);
 }
 
 static const struct vlc_tls_client_operations gnutls_ClientOps =
@@ -552,11 +729,16 @@ static int OpenClient(vlc_tls_client_t *crd)
 
     gnutls_Banner(VLC_OBJECT(crd));
 
+    vlc_tls_client_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
     int val = gnutls_certificate_allocate_credentials (&x509);
     if (val != 0)
     {
         msg_Err (crd, "cannot allocate credentials: %s",
                  gnutls_strerror (val));
+        free(sys);
         return VLC_EGENERIC;
     }
 
@@ -586,8 +768,12 @@ static int OpenClient(vlc_tls_client_t *crd)
     gnutls_certificate_set_verify_flags (x509,
                                          GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT);
 
+    sys->x509 = x509;
+    vlc_mutex_init(&sys->lock);
+    sys->count = 0;
+
     crd->ops = &gnutls_ClientOps;
-    crd->sys = x509;
+    crd->sys = sys;
     return VLC_SUCCESS;
 }
 
@@ -599,6 +785,7 @@ typedef struct vlc_tls_creds_sys
 {
     gnutls_certificate_credentials_t x509_cred;
     gnutls_dh_params_t dh_params;
+    gnutls_datum_t ticket_key; /**< session tickets encryption key */
 } vlc_tls_creds_sys_t;
 
 /**
@@ -611,7 +798,12 @@ static vlc_tls_t *gnutls_ServerSessionOpen(vlc_tls_server_t *crd,
     vlc_tls_creds_sys_t *sys = crd->sys;
     vlc_tls_gnutls_t *priv = gnutls_SessionOpen(VLC_OBJECT(crd), GNUTLS_SERVER,
                                                 sys->x509_cred, sk, alpn);
-    return (priv != NULL) ? &priv->tls : NULL;
+    if (priv == NULL)
+        return NULL;
+
+    if (sys->ticket_key.data != NULL)
+        gnutls_session_ticket_enable_server(priv->session, &sys->ticket_key);
+    return &priv->tls;
 }
 
 static void gnutls_ServerDestroy(vlc_tls_server_t *crd)
@@ -621,6 +813,11 @@ static void gnutls_ServerDestroy(vlc_tls_server_t *crd)
     /* all sessions depending on the server are now deinitialized */
     gnutls_certificate_free_credentials(sys->x509_cred);
     gnutls_dh_params_deinit(sys->dh_params);
+    if (sys->ticket_key.data != NULL)
+    {
+        gnutls_memset(sys->ticket_key.data, 0, sys->ticket_key.size);
+        gnutls_free(sys->ticket_key.data);
+    }
     free(sys);
 }
 
@@ -711,6 +908,10 @@ static int OpenServer(vlc_tls_server_t *crd, const char *cert, const char *key)
 
     msg_Dbg (crd, "ciphers parameters loaded");
 
+    /* Let clients resume their sessions */
+    if (gnutls_session_ticket_key_generate(&sys->ticket_key) != 0)
+        sys->ticket_key.data = NULL;
+
     crd->ops = &gnutls_ServerOps;
     crd->sys = sys;
     return VLC_SUCCESS;
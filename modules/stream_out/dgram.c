@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * dgram.c: batched and paced datagram transmission
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+#include <vlc_network.h>
+
+#include "dgram.h"
+
+bool sout_dgram_Add(struct sout_dgram_batch *b, const struct iovec *iov,
+                    unsigned iovlen)
+{
+    if (b->count >= SOUT_DGRAM_BATCH_MAX
+     || iovlen > SOUT_DGRAM_IOV_MAX - b->iovc)
+        return false;
+
+    size_t len = 0;
+
+    for (unsigned i = 0; i < iovlen; i++)
+        len += iov[i].iov_len;
+
+    b->dgv[b->count].iov = b->iovc;
+    b->dgv[b->count].iovlen = iovlen;
+    b->dgv[b->count].len = len;
+    memcpy(b->iov + b->iovc, iov, iovlen * sizeof (*iov));
+    b->count++;
+    b->iovc += iovlen;
+    b->bytes += len;
+    return true;
+}
+
+int sout_dgram_Send(int fd, struct sout_dgram_batch *b, unsigned first)
+{
+    unsigned i = first;
+
+    assert(first < b->count);
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgv[SOUT_DGRAM_BATCH_MAX];
+
+    for (unsigned j = i; j < b->count; j++)
+        msgv[j] = (struct mmsghdr) {
+            .msg_hdr = {
+                .msg_iov = b->iov + b->dgv[j].iov,
+                .msg_iovlen = b->dgv[j].iovlen,
+            },
+        };
+
+    /* The kernel stops at the first failing datagram, which is reported
+     * by the next call. */
+    while (i < b->count) {
+        int val = sendmmsg(fd, msgv + i, b->count - i, 0);
+
+        if (val < 0)
+            break;
+        i += val;
+    }
+#else
+    while (i < b->count) {
+        struct msghdr hdr = {
+            .msg_iov = b->iov + b->dgv[i].iov,
+            .msg_iovlen = b->dgv[i].iovlen,
+        };
+
+        if (sendmsg(fd, &hdr, 0) < 0)
+            break;
+        i++;
+    }
+#endif
+    return (i > first) ? (int)(i - first) : -1;
+}
+
+void sout_pacer_Init(struct sout_pacer *p, size_t depth)
+{
+    p->rate = 0.;
+    p->tokens = depth;
+    p->depth = depth;
+    p->last = VLC_TICK_INVALID;
+}
+
+void sout_pacer_Learn(struct sout_pacer *p, size_t bytes, vlc_tick_t duration)
+{
+    if (duration <= 0 || duration > VLC_TICK_FROM_SEC(10))
+        return; /* discontinuity */
+
+    /* Keep some headroom so that the output never lags behind the mux */
+    double rate = 1.05 * bytes / duration;
+
+    /* Follow increases immediately, decreases slowly */
+    if (rate > p->rate)
+        p->rate = rate;
+    else
+        p->rate += (rate - p->rate) / 8.;
+}
+
+vlc_tick_t sout_pacer_Schedule(struct sout_pacer *p, size_t bytes)
+{
+    vlc_tick_t now = vlc_tick_now();
+
+    if (p->rate <= 0.) {
+        p->last = now;
+        return now;
+    }
+
+    if (p->last != VLC_TICK_INVALID) {
+        p->tokens += (now - p->last) * p->rate;
+        if (p->tokens > p->depth)
+            p->tokens = p->depth;
+    }
+    p->last = now;
+    p->tokens -= bytes;
+
+    if (p->tokens < 0.) {
+        vlc_tick_t delay = (vlc_tick_t)(-p->tokens / p->rate) + 1;
+
+        /* Never stall the output on a bogus estimate */
+        if (delay > VLC_TICK_FROM_MS(100))
+            delay = VLC_TICK_FROM_MS(100);
+
+        p->last += delay;
+        p->tokens = 0.;
+    }
+    return p->last;
+}
@@ -0,0 +1,101 @@
+/*****************************************************************************
+ * dgram.h: batched and paced datagram transmission
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SOUT_DGRAM_H
+#define VLC_SOUT_DGRAM_H
+
+#include <vlc_network.h>
+
+#define SOUT_DGRAM_BATCH_MAX 64
+#define SOUT_DGRAM_IOV_MAX   1024
+
+/**
+ * Datagrams queued for transmission with as few system calls as possible
+ * (one sendmmsg() per destination where available).
+ */
+struct sout_dgram_batch
+{
+    unsigned count; /**< queued datagrams */
+    unsigned iovc; /**< used I/O vectors */
+    size_t bytes; /**< total queued bytes */
+    struct
+    {
+        unsigned iov; /**< index of the first vector */
+        unsigned iovlen;
+        size_t len;
+    } dgv[SOUT_DGRAM_BATCH_MAX];
+    struct iovec iov[SOUT_DGRAM_IOV_MAX];
+};
+
+static inline void sout_dgram_Reset(struct sout_dgram_batch *b)
+{
+    b->count = 0;
+    b->iovc = 0;
+    b->bytes = 0;
+}
+
+/**
+ * Queues one datagram gathered from several buffers.
+ *
+ * \retval false the batch is full, nothing was queued
+ */
+bool sout_dgram_Add(struct sout_dgram_batch *, const struct iovec *iov,
+                    unsigned iovlen);
+
+/**
+ * Sends the queued datagrams to a connected socket, starting from the given
+ * index, with as few system calls as possible.
+ *
+ * Sending stops at the first datagram that fails.
+ *
+ * \return the number of datagrams sent (at least one),
+ *         or -1 (with errno set) if the first datagram could not be sent
+ */
+int sout_dgram_Send(int fd, struct sout_dgram_batch *, unsigned first);
+
+/**
+ * Token bucket pacing output datagrams to the rate of the muxed stream.
+ *
+ * The rate is learnt from the byte counts and the time stamp span (derived
+ * from the PCR by the mux) of the written data, so that bursts written at
+ * once by the mux are smoothed out over their duration.
+ */
+struct sout_pacer
+{
+    double rate; /**< bytes per tick, 0 if unknown */
+    double tokens; /**< available bytes */
+    size_t depth; /**< bucket size (maximum burst) */
+    vlc_tick_t last; /**< last refill date */
+};
+
+void sout_pacer_Init(struct sout_pacer *, size_t depth);
+
+/** Updates the rate estimate from bytes spanning the given duration. */
+void sout_pacer_Learn(struct sout_pacer *, size_t bytes, vlc_tick_t duration);
+
+/**
+ * Accounts for bytes about to be sent.
+ *
+ * \return the date until which to wait before sending them, so as not to
+ *         exceed the rate (in the past if they can be sent right away)
+ */
+vlc_tick_t sout_pacer_Schedule(struct sout_pacer *, size_t bytes);
+
+#endif
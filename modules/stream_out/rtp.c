@@ -51,6 +51,7 @@
 
 #include "rtp.h"
 #include "sdp_helper.h"
+#include "dgram.h"
 
 #include <sys/types.h>
 #include <unistd.h>
@@ -1325,40 +1326,110 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
-{
 #ifdef _WIN32
 # define ENOBUFS      WSAENOBUFS
 # define EAGAIN       WSAEWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
+
+/* Maximum number of due packets sent at once to each sink */
+#define RTP_SEND_BATCH 32
+
+/**
+ * Sends a batch of packets to one sink.
+ * @return false if the connection is broken
+ */
+static bool SendBatch( int fd, struct sout_dgram_batch *batch )
+{
+    bool retried = false;
+
+    for( unsigned i = 0; i < batch->count; )
+    {
+        int val = sout_dgram_Send( fd, batch, i );
+        if( val > 0 )
+        {
+            i += val;
+            retried = false;
+            continue;
+        }
+
+        if( !retried
+         && net_errno != EAGAIN && net_errno != EWOULDBLOCK
+         && net_errno != ENOBUFS && net_errno != ENOMEM )
+        {
+            int type;
+            getsockopt( fd, SOL_SOCKET, SO_TYPE,
+                        &type, &(socklen_t){ sizeof(type) });
+            if( type != SOCK_DGRAM )
+                return false; /* Broken connection */
+
+            /* ICMP soft error: ignore and retry */
+            retried = true;
+            continue;
+        }
+
+        /* Drop the packet */
+        i++;
+        retried = false;
+    }
+    return true;
+}
+
+static void* ThreadSend( void *data )
+{
     sout_stream_id_sys_t *id = data;
     vlc_tick_t i_caching = id->i_caching;
+    struct sout_dgram_batch batch;
     block_t *out;
 
     while ((out = vlc_queue_DequeueKillable(&id->queue, &id->dead)) != NULL)
     {
+        block_t *outv[RTP_SEND_BATCH];
+        unsigned outc = 0;
+
+        vlc_tick_wait (out->i_dts + i_caching);
+
+        /* Send the packets that are already due as well */
+        outv[outc++] = out;
+        vlc_queue_Lock(&id->queue);
+        vlc_tick_t now = vlc_tick_now();
+        const block_t *next;
+        while (outc < ARRAY_SIZE(outv)
+            && (next = vlc_queue_PeekUnlocked(&id->queue)) != NULL
+            && next->i_dts + i_caching <= now)
+            outv[outc++] = vlc_queue_DequeueUnlocked(&id->queue);
+        vlc_queue_Unlock(&id->queue);
+
+        sout_dgram_Reset( &batch );
+        unsigned sendc = 0;
+        for( unsigned i = 0; i < outc; i++ )
+        {
+            out = outv[i];
 #ifdef HAVE_SRTP
-        if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
-
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            if( val )
-            {
-                msg_Dbg( id->p_stream, "SRTP sending error: %s",
-                         vlc_strerror_c(val) );
-                block_Release( out );
-                continue;
+            if( id->srtp )
+            {   /* FIXME: this is awfully inefficient */
+                size_t len = out->i_buffer;
+                out = block_Realloc( out, 0, len + 10 );
+                out->i_buffer = len;
+
+                int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+                if( val )
+                {
+                    msg_Dbg( id->p_stream, "SRTP sending error: %s",
+                             vlc_strerror_c(val) );
+                    block_Release( out );
+                    continue;
+                }
+                out->i_buffer = len;
             }
-            out->i_buffer = len;
-        }
 #endif
-        vlc_tick_wait (out->i_dts + i_caching);
-
-        ssize_t len = out->i_buffer;
+            outv[sendc++] = out;
+            sout_dgram_Add( &batch, &(struct iovec){
+                .iov_base = out->p_buffer, .iov_len = out->i_buffer }, 1 );
+        }
+        outc = sendc;
+        if( outc == 0 )
+            continue;
 
         vlc_mutex_lock( &id->lock_sink );
         unsigned deadc = 0; /* How many dead sockets? */
@@ -1369,26 +1440,18 @@ static void* ThreadSend( void *data )
 #ifdef HAVE_SRTP
             if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+                for( unsigned j = 0; j < outc; j++ )
+                    SendRTCP( id->sinkv[i].rtcp, outv[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
-            {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
-            }
+            if( !SendBatch( id->sinkv[i].rtp_fd, &batch ) )
+                deadv[deadc++] = id->sinkv[i].rtp_fd;
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
+        id->i_seq_sent_next =
+            ntohs(((uint16_t *) outv[outc - 1]->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+
+        for( unsigned i = 0; i < outc; i++ )
+            block_Release( outv[i] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
@@ -0,0 +1,219 @@
+/**
+ * @file dgram.c
+ * @brief Loopback benchmark for batched and paced datagram transmission
+ */
+/*****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_network.h>
+#include "../dgram.h"
+
+#define DGRAM_SIZE  1316
+#define DGRAM_COUNT 50000
+
+struct receiver
+{
+    int fd;
+    unsigned received;
+    unsigned gaps;
+    vlc_tick_t max_gap; /* longest silence between two datagrams */
+};
+
+static void *Receiver(void *data)
+{
+    struct receiver *rcv = data;
+    uint8_t buf[DGRAM_SIZE * 2];
+    uint32_t expected = 0;
+    vlc_tick_t last = VLC_TICK_INVALID;
+
+    for (;;) {
+        struct pollfd ufd = { .fd = rcv->fd, .events = POLLIN };
+
+        if (poll(&ufd, 1, 200) <= 0)
+            break; /* sender done and queue drained */
+
+        ssize_t len = recv(rcv->fd, buf, sizeof (buf), 0);
+        if (len < 0)
+            continue;
+        assert(len == DGRAM_SIZE);
+
+        vlc_tick_t now = vlc_tick_now();
+        if (last != VLC_TICK_INVALID && now - last > rcv->max_gap)
+            rcv->max_gap = now - last;
+        last = now;
+
+        uint32_t seq = GetDWBE(buf);
+        if (seq != expected)
+            rcv->gaps += seq - expected;
+        expected = seq + 1;
+        rcv->received++;
+    }
+    return NULL;
+}
+
+static int OpenPair(int *restrict tx)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(rx >= 0);
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &(int){ 4 << 20 }, sizeof (int));
+    assert(bind(rx, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(getsockname(rx, (struct sockaddr *)&addr, &addrlen) == 0);
+
+    *tx = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(*tx >= 0);
+    assert(connect(*tx, (struct sockaddr *)&addr, addrlen) == 0);
+    return rx;
+}
+
+/* Sends count datagrams, split in 7 TS-sized vectors each like the UDP
+ * stream output does, with up to batch datagrams per call. */
+static vlc_tick_t Send(int fd, unsigned count, unsigned batch,
+                       struct sout_pacer *pacer)
+{
+    static uint8_t bufs[SOUT_DGRAM_BATCH_MAX][DGRAM_SIZE];
+    struct sout_dgram_batch b;
+    unsigned seq = 0;
+    vlc_tick_t start = vlc_tick_now();
+
+    memset(bufs, 0x47, sizeof (bufs));
+
+    while (seq < count) {
+        sout_dgram_Reset(&b);
+
+        while (b.count < batch && seq < count) {
+            struct iovec iov[7];
+
+            SetDWBE(bufs[b.count], seq++);
+            for (unsigned i = 0; i < ARRAY_SIZE(iov); i++) {
+                iov[i].iov_base = bufs[b.count] + i * 188;
+                iov[i].iov_len = 188;
+            }
+            assert(sout_dgram_Add(&b, iov, ARRAY_SIZE(iov)));
+        }
+        assert(b.bytes == b.count * DGRAM_SIZE);
+
+        if (pacer != NULL)
+            vlc_tick_wait(sout_pacer_Schedule(pacer, b.bytes));
+
+        for (unsigned i = 0; i < b.count;) {
+            int val = sout_dgram_Send(fd, &b, i);
+
+            if (val < 0) {
+                struct pollfd ufd = { .fd = fd, .events = POLLOUT };
+
+                /* Let the receiver catch up */
+                assert(errno == ENOBUFS || errno == EAGAIN);
+                poll(&ufd, 1, 1);
+                continue;
+            }
+            assert((unsigned)val <= b.count - i);
+            i += val;
+        }
+    }
+    return vlc_tick_now() - start;
+}
+
+static void Bench(unsigned batch)
+{
+    struct receiver rcv = { 0 };
+    int tx;
+    vlc_thread_t th;
+
+    rcv.fd = OpenPair(&tx);
+    assert(vlc_clone(&th, Receiver, &rcv, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    vlc_tick_t elapsed = Send(tx, DGRAM_COUNT, batch, NULL);
+
+    vlc_join(th, NULL);
+    net_Close(tx);
+    net_Close(rcv.fd);
+
+    double secs = secf_from_vlc_tick(elapsed > 0 ? elapsed : 1);
+    printf("batch %2u: %.0f pkt/s sent, %u/%u received\n",
+           batch, DGRAM_COUNT / secs, rcv.received, DGRAM_COUNT);
+    /* Loopback delivery does not reorder */
+    assert(rcv.received + rcv.gaps <= DGRAM_COUNT);
+    assert(rcv.received > 0);
+}
+
+static void TestPacing(void)
+{
+    const unsigned count = 400;
+    const unsigned burst = 4;
+    /* About 4 Mbit/s, that is 400 datagrams in one second */
+    const size_t rate = 400 * DGRAM_SIZE;
+    struct sout_pacer pacer;
+    struct receiver rcv = { 0 };
+    int tx;
+    vlc_thread_t th;
+
+    sout_pacer_Init(&pacer, burst * DGRAM_SIZE);
+    /* Muxer output of 1 second worth of data at once */
+    sout_pacer_Learn(&pacer, rate, VLC_TICK_FROM_SEC(1));
+
+    rcv.fd = OpenPair(&tx);
+    assert(vlc_clone(&th, Receiver, &rcv, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    vlc_tick_t elapsed = Send(tx, count, burst, &pacer);
+
+    vlc_join(th, NULL);
+    net_Close(tx);
+    net_Close(rcv.fd);
+
+    printf("paced: %u datagrams in %"PRId64" ms, longest gap %"PRId64" ms\n",
+           rcv.received, MS_FROM_VLC_TICK(elapsed),
+           MS_FROM_VLC_TICK(rcv.max_gap));
+
+    /* The first burst is free, the rest is spread at the stream rate
+     * (plus the headroom) instead of being sent at once. */
+    assert(elapsed >= VLC_TICK_FROM_MS(800));
+    assert(elapsed <= VLC_TICK_FROM_MS(2000));
+    assert(rcv.received == count);
+}
+
+int main(void)
+{
+    alarm(10);
+
+    TestPacing();
+    Bench(1);
+    Bench(8);
+    Bench(32);
+    Bench(SOUT_DGRAM_BATCH_MAX);
+    return 0;
+}
@@ -37,7 +37,9 @@
 
 #include <vlc_network.h>
 #include <vlc_memstream.h>
+#include <vlc_queue.h>
 #include "sdp_helper.h"
+#include "dgram.h"
 
 struct sout_stream_udp
 {
@@ -46,6 +48,15 @@ struct sout_stream_udp
     session_descriptor_t *sap;
     int fd;
     uint_fast16_t mtu;
+    unsigned batch_size;
+    bool paced;
+    struct sout_pacer pacer;
+    struct sout_dgram_batch batch;
+    /* Paced output is sent from its own thread, so as not to sleep in the
+     * muxer caller; the pacer is protected by the queue lock. */
+    vlc_queue_t queue;
+    bool dead;
+    vlc_thread_t thread;
 };
 
 static void *Add(sout_stream_t *stream, const es_format_t *fmt)
@@ -145,39 +156,89 @@ static int Control(sout_stream_t *stream, int query, va_list args)
     return VLC_SUCCESS;
 }
 
-static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
+static void AccessOutLearnRate(struct sout_stream_udp *sys,
+                               const block_t *block)
 {
-    struct sout_stream_udp *sys = access->p_sys;
+    /* The mux spreads its packets over time with the PCR */
+    vlc_tick_t start = block->i_dts, end = VLC_TICK_INVALID;
+    size_t bytes = 0;
+
+    for (; block != NULL; block = block->p_next) {
+        bytes += block->i_buffer;
+        if (block->i_dts != VLC_TICK_INVALID)
+            end = block->i_dts + block->i_length;
+    }
+
+    if (start != VLC_TICK_INVALID && end != VLC_TICK_INVALID)
+        sout_pacer_Learn(&sys->pacer, bytes, end - start);
+}
+
+static void AccessOutPace(struct sout_stream_udp *sys, size_t bytes)
+{
+    vlc_queue_t *queue = &sys->queue;
+
+    vlc_queue_Lock(queue);
+    vlc_tick_t deadline = sout_pacer_Schedule(&sys->pacer, bytes);
+
+    /* Wake-ups on new data are ignored, termination stops pacing */
+    while (!sys->dead
+        && vlc_cond_timedwait(&queue->wait, &queue->lock, deadline) == 0)
+        ;
+    vlc_queue_Unlock(queue);
+}
+
+static ssize_t AccessOutSend(struct sout_stream_udp *sys, block_t *block)
+{
+    struct sout_dgram_batch *batch = &sys->batch;
     ssize_t total = 0;
 
     while (block != NULL) {
-        struct iovec iov[16];
         block_t *unsent = block;
-        unsigned iovlen = 0;
-        size_t tosend = 0;
 
-        /* Count how many blocks to gather */
+        sout_dgram_Reset(batch);
+
+        /* Gather datagrams of up to MTU bytes each */
         do {
-            if (iovlen >= ARRAY_SIZE(iov))
-                break;
-            if (unsent->i_buffer + tosend > sys->mtu && likely(iovlen > 0))
+            struct iovec iov[16];
+            block_t *next = unsent;
+            unsigned iovlen = 0;
+            size_t tosend = 0;
+
+            /* Count how many blocks to gather */
+            do {
+                if (iovlen >= ARRAY_SIZE(iov))
+                    break;
+                if (next->i_buffer + tosend > sys->mtu && likely(iovlen > 0))
+                    break;
+
+                iov[iovlen].iov_base = next->p_buffer;
+                iov[iovlen].iov_len = next->i_buffer;
+                iovlen++;
+                tosend += next->i_buffer;
+                next = next->p_next;
+            } while (next != NULL);
+
+            if (!sout_dgram_Add(batch, iov, iovlen))
                 break;
+            unsent = next;
+        } while (unsent != NULL && batch->count < sys->batch_size);
 
-            iov[iovlen].iov_base = unsent->p_buffer;
-            iov[iovlen].iov_len = unsent->i_buffer;
-            iovlen++;
-            tosend += unsent->i_buffer;
-            unsent = unsent->p_next;
-        } while (unsent != NULL);
+        if (sys->paced)
+            AccessOutPace(sys, batch->bytes);
 
         /* Send */
-        struct msghdr hdr = { .msg_iov = iov, .msg_iovlen = iovlen };
-        int val = sendmsg(sys->fd, &hdr, 0);
+        total += batch->bytes;
 
-        if (val < 0)
-            msg_Err(access, "send error: %s", vlc_strerror_c(errno));
-        else
-            total += val;
+        for (unsigned i = 0; i < batch->count;) {
+            int val = sout_dgram_Send(sys->fd, batch, i);
+
+            if (val < 0) {
+                msg_Err(sys->access, "send error: %s", vlc_strerror_c(errno));
+                total -= batch->dgv[i].len;
+                val = 1;
+            }
+            i += val;
+        }
 
         /* Free */
         do {
@@ -191,6 +252,50 @@ static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
     return total;
 }
 
+static void *AccessOutThread(void *data)
+{
+    struct sout_stream_udp *sys = data;
+    vlc_queue_t *queue = &sys->queue;
+    block_t *block;
+
+    vlc_queue_Lock(queue);
+    for (;;) {
+        while (vlc_queue_IsEmpty(queue) && !sys->dead)
+            vlc_queue_Wait(queue);
+
+        /* Once killed, the remaining data is sent without pacing */
+        block = vlc_queue_DequeueAllUnlocked(queue);
+        if (block == NULL)
+            break;
+
+        vlc_queue_Unlock(queue);
+        AccessOutSend(sys, block);
+        vlc_queue_Lock(queue);
+    }
+    vlc_queue_Unlock(queue);
+    return NULL;
+}
+
+static ssize_t AccessOutWrite(sout_access_out_t *access, block_t *block)
+{
+    struct sout_stream_udp *sys = access->p_sys;
+
+    if (!sys->paced)
+        return AccessOutSend(sys, block);
+
+    if (block == NULL)
+        return 0;
+
+    size_t total;
+
+    block_ChainProperties(block, NULL, &total, NULL);
+    vlc_queue_Lock(&sys->queue);
+    AccessOutLearnRate(sys, block);
+    vlc_queue_EnqueueUnlocked(&sys->queue, block);
+    vlc_queue_Unlock(&sys->queue);
+    return total;
+}
+
 static void Close(vlc_object_t *obj)
 {
     sout_stream_t *stream = (sout_stream_t *)obj;
@@ -200,6 +305,10 @@ static void Close(vlc_object_t *obj)
         sout_AnnounceUnRegister(stream, sys->sap);
 
     sout_MuxDelete(sys->mux);
+    if (sys->paced) {
+        vlc_queue_Kill(&sys->queue, &sys->dead);
+        vlc_join(sys->thread, NULL);
+    }
     sout_AccessOutDelete(sys->access);
     net_Close(sys->fd);
     free(sys);
@@ -210,7 +319,7 @@ static const struct sout_stream_operations ops = {
 };
 
 static const char *const chain_options[] = {
-    "avformat", "dst", "sap", "name", "description", NULL
+    "avformat", "dst", "sap", "name", "description", "batch", "pace", NULL
 };
 
 #define DEFAULT_PORT 1234
@@ -308,6 +417,13 @@ static int Open(vlc_object_t *obj)
     sys->access = access;
     sys->fd = fd;
     sys->mtu = var_InheritInteger(stream, "mtu");
+    sys->batch_size = var_GetInteger(stream, SOUT_CFG_PREFIX "batch");
+    if (sys->batch_size < 1 || sys->batch_size > SOUT_DGRAM_BATCH_MAX)
+        sys->batch_size = SOUT_DGRAM_BATCH_MAX;
+    sys->paced = var_GetBool(stream, SOUT_CFG_PREFIX "pace");
+    sout_pacer_Init(&sys->pacer, sys->batch_size * sys->mtu);
+    vlc_queue_Init(&sys->queue, offsetof (block_t, p_next));
+    sys->dead = false;
 
     sout_mux_t *mux = sout_MuxNew(access, muxmod);
     if (mux == NULL) {
@@ -316,6 +432,15 @@ static int Open(vlc_object_t *obj)
     }
     sys->mux = mux;
 
+    if (sys->paced
+     && vlc_clone(&sys->thread, AccessOutThread, sys,
+                  VLC_THREAD_PRIORITY_OUTPUT)) {
+        sout_MuxDelete(mux);
+        block_ChainRelease(vlc_queue_DequeueAll(&sys->queue));
+        ret = VLC_ENOMEM;
+        goto error;
+    }
+
     if (var_GetBool(stream, SOUT_CFG_PREFIX "sap"))
         sys->sap = CreateSDP(VLC_OBJECT(stream), fd);
     else
@@ -346,6 +471,14 @@ error:
 #define DESC_TEXT N_("SAP description")
 #define DESC_LONGTEXT N_( \
     "Short description of the stream that will be announced with SAP.")
+#define BATCH_TEXT N_("Datagrams per system call")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams sent at once. This is also the largest " \
+    "burst when pacing.")
+#define PACE_TEXT N_("Pace output")
+#define PACE_LONGTEXT N_( \
+    "Spread datagrams evenly over time at the rate of the stream, rather " \
+    "than sending them in bursts as the muxer produces them.")
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -359,6 +492,9 @@ vlc_module_begin()
     add_bool(SOUT_CFG_PREFIX "sap", false, SAP_TEXT, SAP_LONGTEXT)
     add_string(SOUT_CFG_PREFIX "name", "", NAME_TEXT, NAME_LONGTEXT)
     add_string(SOUT_CFG_PREFIX "description", "", DESC_TEXT, DESC_LONGTEXT)
+    add_integer_with_range(SOUT_CFG_PREFIX "batch", SOUT_DGRAM_BATCH_MAX,
+                           1, SOUT_DGRAM_BATCH_MAX, BATCH_TEXT, BATCH_LONGTEXT)
+    add_bool(SOUT_CFG_PREFIX "pace", false, PACE_TEXT, PACE_LONGTEXT)
 
     set_callbacks(Open, Close)
 vlc_module_end()
@@ -138,6 +138,210 @@ static picture_t *BufferChainNew( filter_t *p_filter )
 
 #define CHAIN_LEVEL_MAX 2
 
+/*****************************************************************************
+ * Chroma planner
+ *****************************************************************************
+ * Converters do not advertise the chromas they handle, so the existence of
+ * an in -> middle -> out path is only known by loading its converters. The
+ * allowed middle chromas are thus tried by increasing estimated cost of the
+ * path, rather than in a fixed order, and the middle chroma which worked is
+ * remembered per (in, out) pair and tried first the next time.
+ *****************************************************************************/
+
+/* Costs are in 1/16th of byte per pixel */
+#define PLAN_COST_LOST_BIT      32 /* per bit of lost precision */
+#define PLAN_COST_LOST_CHROMA    8 /* per 1/16th of chroma sample lost */
+#define PLAN_COST_RGB_YUV       32 /* per RGB <-> YUV conversion */
+#define PLAN_COST_OPAQUE        64 /* bytes of an undescribed chroma */
+
+#define PLAN_CACHE_SIZE         16
+
+typedef struct
+{
+    unsigned bytes;  /* 1/16th of byte per pixel */
+    unsigned bits;   /* per component */
+    unsigned chroma; /* 1/16th of chroma sample per pixel */
+    bool     yuv;
+} plan_chroma_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    size_t      next;
+    struct
+    {
+        vlc_fourcc_t in;
+        vlc_fourcc_t out;
+        vlc_fourcc_t mid;
+    } entries[PLAN_CACHE_SIZE];
+} plan_cache = { .lock = VLC_STATIC_MUTEX, };
+
+static void PlanChroma( vlc_fourcc_t i_chroma, plan_chroma_t *p_plan )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( i_chroma );
+
+    p_plan->yuv = vlc_fourcc_IsYUV( i_chroma );
+    if( p_dsc == NULL || p_dsc->plane_count == 0 )
+    {
+        /* Opaque (hardware) chroma */
+        p_plan->bytes = PLAN_COST_OPAQUE;
+        p_plan->bits = 8;
+        p_plan->chroma = 16;
+        return;
+    }
+
+    p_plan->bytes = 0;
+    for( unsigned i = 0; i < p_dsc->plane_count; i++ )
+        p_plan->bytes += 16 * p_dsc->pixel_size *
+                         p_dsc->p[i].w.num * p_dsc->p[i].h.num /
+                         (p_dsc->p[i].w.den * p_dsc->p[i].h.den);
+
+    if( p_dsc->plane_count > 1 )
+    {
+        /* The chroma plane of semi-planar chromas holds both components */
+        const unsigned i_components = p_dsc->plane_count == 2 ? 2 : 1;
+
+        p_plan->bits = p_dsc->pixel_bits;
+        p_plan->chroma = 16 * p_dsc->p[1].w.num * p_dsc->p[1].h.num /
+                         (p_dsc->p[1].w.den * p_dsc->p[1].h.den * i_components);
+    }
+    else if( p_plan->yuv )
+    {
+        /* Packed YUV are mostly 4:2:2 */
+        p_plan->bits = p_dsc->pixel_bits / 2;
+        p_plan->chroma = 8;
+    }
+    else
+    {
+        p_plan->bits = p_dsc->pixel_bits / (p_dsc->pixel_bits % 3 ? 4 : 3);
+        p_plan->chroma = 16;
+    }
+}
+
+/* Estimated cost of the in -> mid -> out conversions */
+static unsigned PlanCost( const plan_chroma_t *p_in, const plan_chroma_t *p_mid,
+                          const plan_chroma_t *p_out )
+{
+    /* Bytes read and written by both conversions */
+    unsigned i_cost = p_in->bytes + 2 * p_mid->bytes + p_out->bytes;
+
+    /* Precision lost by the middle chroma only, the rest is unavoidable */
+    const unsigned i_bits = __MIN( p_in->bits, p_out->bits );
+    if( p_mid->bits < i_bits )
+        i_cost += (i_bits - p_mid->bits) * PLAN_COST_LOST_BIT;
+
+    const unsigned i_chroma = __MIN( p_in->chroma, p_out->chroma );
+    if( p_mid->chroma < i_chroma )
+        i_cost += (i_chroma - p_mid->chroma) * PLAN_COST_LOST_CHROMA;
+
+    if( p_in->yuv != p_mid->yuv )
+        i_cost += PLAN_COST_RGB_YUV;
+    if( p_mid->yuv != p_out->yuv )
+        i_cost += PLAN_COST_RGB_YUV;
+    return i_cost;
+}
+
+static vlc_fourcc_t PlanCacheGet( vlc_fourcc_t i_in, vlc_fourcc_t i_out )
+{
+    vlc_fourcc_t i_mid = 0;
+
+    vlc_mutex_lock( &plan_cache.lock );
+    for( size_t i = 0; i < PLAN_CACHE_SIZE; i++ )
+    {
+        if( plan_cache.entries[i].in == i_in &&
+            plan_cache.entries[i].out == i_out )
+        {
+            i_mid = plan_cache.entries[i].mid;
+            break;
+        }
+    }
+    vlc_mutex_unlock( &plan_cache.lock );
+    return i_mid;
+}
+
+static void PlanCachePut( vlc_fourcc_t i_in, vlc_fourcc_t i_out,
+                          vlc_fourcc_t i_mid )
+{
+    vlc_mutex_lock( &plan_cache.lock );
+    size_t i_slot = plan_cache.next;
+    for( size_t i = 0; i < PLAN_CACHE_SIZE; i++ )
+    {
+        if( plan_cache.entries[i].in == i_in &&
+            plan_cache.entries[i].out == i_out )
+        {
+            i_slot = i;
+            break;
+        }
+    }
+    if( i_slot == plan_cache.next )
+        plan_cache.next = (plan_cache.next + 1) % PLAN_CACHE_SIZE;
+
+    plan_cache.entries[i_slot].in = i_in;
+    plan_cache.entries[i_slot].out = i_out;
+    plan_cache.entries[i_slot].mid = i_mid;
+    vlc_mutex_unlock( &plan_cache.lock );
+}
+
+#define PLAN_MAX 16
+
+typedef struct
+{
+    size_t       i_count;
+    vlc_fourcc_t pi_chromas[PLAN_MAX];
+    unsigned     pi_costs[PLAN_MAX];
+} plan_t;
+
+/**
+ * Orders the allowed middle chromas from the cheapest to the most expensive
+ * path, with the cached one first.
+ */
+static void PlanMiddleChromas( filter_t *p_filter, bool b_use_cache,
+                               plan_t *p_plan )
+{
+    const vlc_fourcc_t i_in = p_filter->fmt_in.video.i_chroma;
+    const vlc_fourcc_t i_out = p_filter->fmt_out.video.i_chroma;
+    const vlc_fourcc_t *pi_allowed_chromas = get_allowed_chromas( p_filter );
+    const vlc_fourcc_t i_cached = b_use_cache ? PlanCacheGet( i_in, i_out ) : 0;
+    plan_chroma_t in, out;
+    unsigned pi_keys[PLAN_MAX];
+
+    PlanChroma( i_in, &in );
+    PlanChroma( i_out, &out );
+
+    p_plan->i_count = 0;
+    for( size_t i = 0; pi_allowed_chromas[i] && i < PLAN_MAX; i++ )
+    {
+        const vlc_fourcc_t i_chroma = pi_allowed_chromas[i];
+        if( i_chroma == p_filter->fmt_in.i_codec ||
+            i_chroma == p_filter->fmt_out.i_codec )
+            continue;
+
+        plan_chroma_t mid;
+        PlanChroma( i_chroma, &mid );
+        const unsigned i_cost = PlanCost( &in, &mid, &out );
+        const unsigned i_key = i_chroma == i_cached ? 0 : i_cost + 1;
+
+        /* Insertion sort, stable for equal costs */
+        size_t j = p_plan->i_count++;
+        for( ; j > 0 && pi_keys[j - 1] > i_key; j-- )
+        {
+            p_plan->pi_chromas[j] = p_plan->pi_chromas[j - 1];
+            p_plan->pi_costs[j] = p_plan->pi_costs[j - 1];
+            pi_keys[j] = pi_keys[j - 1];
+        }
+        p_plan->pi_chromas[j] = i_chroma;
+        p_plan->pi_costs[j] = i_cost;
+        pi_keys[j] = i_key;
+    }
+
+    for( size_t i = 0; i < p_plan->i_count; i++ )
+        msg_Dbg( p_filter, "Plan %4.4s -> %4.4s -> %4.4s: cost %u%s",
+                 (const char *)&i_in, (const char *)&p_plan->pi_chromas[i],
+                 (const char *)&i_out, p_plan->pi_costs[i],
+                 p_plan->pi_chromas[i] == i_cached ? " (cached)" : "" );
+}
+
 static vlc_decoder_device * HoldChainDecoderDevice(vlc_object_t *o, void *sys)
 {
     VLC_UNUSED(o);
@@ -333,15 +537,13 @@ static int BuildChromaChain( filter_t *p_filter )
 {
     es_format_t fmt_mid;
     int i_ret = VLC_EGENERIC;
+    plan_t plan;
 
-    /* Now try chroma format list */
-    const vlc_fourcc_t *pi_allowed_chromas = get_allowed_chromas( p_filter );
-    for( int i = 0; pi_allowed_chromas[i]; i++ )
+    /* Now try chroma format list, cheapest first */
+    PlanMiddleChromas( p_filter, true, &plan );
+    for( size_t i = 0; i < plan.i_count; i++ )
     {
-        const vlc_fourcc_t i_chroma = pi_allowed_chromas[i];
-        if( i_chroma == p_filter->fmt_in.i_codec ||
-            i_chroma == p_filter->fmt_out.i_codec )
-            continue;
+        const vlc_fourcc_t i_chroma = plan.pi_chromas[i];
 
         msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
                  (char*)&i_chroma );
@@ -358,7 +560,11 @@ static int BuildChromaChain( filter_t *p_filter )
         es_format_Clean( &fmt_mid );
 
         if( i_ret == VLC_SUCCESS )
+        {
+            PlanCachePut( p_filter->fmt_in.video.i_chroma,
+                          p_filter->fmt_out.video.i_chroma, i_chroma );
             break;
+        }
     }
 
     return i_ret;
@@ -377,17 +583,17 @@ static int BuildFilterChain( filter_t *p_filter )
     int i_ret = VLC_EGENERIC;
 
     filter_sys_t *p_sys = p_filter->p_sys;
+    plan_t plan;
 
-    /* Now try chroma format list */
-    const vlc_fourcc_t *pi_allowed_chromas = get_allowed_chromas( p_filter );
-    for( int i = 0; pi_allowed_chromas[i]; i++ )
+    /* Now try chroma format list, cheapest first. Whether the filter
+     * accepts a chroma does not only depend on the (in, out) pair, so no
+     * plan is cached. */
+    PlanMiddleChromas( p_filter, false, &plan );
+    for( size_t i = 0; i < plan.i_count; i++ )
     {
         filter_chain_Reset( p_sys->p_chain, &p_filter->fmt_in, p_filter->vctx_in, &p_filter->fmt_out );
 
-        const vlc_fourcc_t i_chroma = pi_allowed_chromas[i];
-        if( i_chroma == p_filter->fmt_in.i_codec ||
-            i_chroma == p_filter->fmt_out.i_codec )
-            continue;
+        const vlc_fourcc_t i_chroma = plan.pi_chromas[i];
 
         msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
                  (char*)&i_chroma );
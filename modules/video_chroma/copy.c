@@ -51,27 +51,58 @@ static void CopyPlane(uint8_t *dst, size_t dst_pitch,
 #define ASSERT_3PLANES ASSERT_2PLANES; \
     ASSERT_PLANE(2)
 
-int CopyInitCache(copy_cache_t *cache, unsigned width)
+static int CopyAllocCache(copy_cache_t *cache, unsigned width, unsigned count)
 {
 #ifdef CAN_COMPILE_SSE2
+    /* One cache buffer per band */
     cache->size = __MAX((width + 0x3f) & ~ 0x3f, 16384);
-    cache->buffer = aligned_alloc(64, cache->size);
+    cache->buffer = aligned_alloc(64, cache->size * count);
     if (!cache->buffer)
         return VLC_EGENERIC;
 #else
-    (void) cache; (void) width;
+    (void) cache; (void) width; (void) count;
 #endif
     return VLC_SUCCESS;
 }
 
+int CopyInitCache(copy_cache_t *cache, unsigned width)
+{
+    cache->slices = NULL;
+    return CopyAllocCache(cache, width, 1);
+}
+
+int CopyInitThreadedCache(copy_cache_t *cache, unsigned width,
+                          vlc_object_t *obj)
+{
+    cache->slices = vlc_slices_New(obj);
+    if (!cache->slices)
+        return VLC_EGENERIC;
+
+    const unsigned count = vlc_slices_Count(cache->slices);
+    if (count == 1)
+    {
+        vlc_slices_Delete(cache->slices);
+        cache->slices = NULL;
+    }
+
+    if (CopyAllocCache(cache, width, count))
+    {
+        if (cache->slices)
+            vlc_slices_Delete(cache->slices);
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
 void CopyCleanCache(copy_cache_t *cache)
 {
+    if (cache->slices)
+        vlc_slices_Delete(cache->slices);
+    cache->slices = NULL;
 #ifdef CAN_COMPILE_SSE2
     aligned_free(cache->buffer);
     cache->buffer = NULL;
     cache->size   = 0;
-#else
-    (void) cache;
 #endif
 }
 
@@ -130,6 +161,108 @@ void CopyCleanCache(copy_cache_t *cache)
 # define vlc_CPU_SSSE3() (0)
 # undef vlc_CPU_SSE2
 # define vlc_CPU_SSE2() (0)
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() (0)
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+/* Copy 32/128 bytes from srcp to dstp with the AVX2 registers */
+
+#define COPY32_SHIFTR(x) \
+    "vpsrlw "x", %%ymm1, %%ymm1\n"
+#define COPY32_SHIFTL(x) \
+    "vpsllw "x", %%ymm1, %%ymm1\n"
+
+#define COPY32_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        shiftstr                        \
+        store " %%ymm1,    0(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1")
+
+#define COPY128_SHIFTR(x) \
+    "vpsrlw "x", %%ymm1, %%ymm1\n" \
+    "vpsrlw "x", %%ymm2, %%ymm2\n" \
+    "vpsrlw "x", %%ymm3, %%ymm3\n" \
+    "vpsrlw "x", %%ymm4, %%ymm4\n"
+#define COPY128_SHIFTL(x) \
+    "vpsllw "x", %%ymm1, %%ymm1\n" \
+    "vpsllw "x", %%ymm2, %%ymm2\n" \
+    "vpsllw "x", %%ymm3, %%ymm3\n" \
+    "vpsllw "x", %%ymm4, %%ymm4\n"
+
+#define COPY128_S(dstp, srcp, load, store, shiftstr) \
+    asm volatile (                      \
+        load "  0(%[src]), %%ymm1\n"    \
+        load " 32(%[src]), %%ymm2\n"    \
+        load " 64(%[src]), %%ymm3\n"    \
+        load " 96(%[src]), %%ymm4\n"    \
+        shiftstr                        \
+        store " %%ymm1,    0(%[dst])\n" \
+        store " %%ymm2,   32(%[dst])\n" \
+        store " %%ymm3,   64(%[dst])\n" \
+        store " %%ymm4,   96(%[dst])\n" \
+        : : [dst]"r"(dstp), [src]"r"(srcp) : "memory", "xmm1", "xmm2", "xmm3", "xmm4")
+
+/* Same as CopyFromUswc(), with twice wider streaming loads */
+VLC_AVX
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height, int bitshift)
+{
+    asm volatile ("mfence");
+
+#define AVX2_USWC_COPY(shiftstr32, shiftstr128) \
+    for (unsigned y = 0; y < height; y++) { \
+        unsigned x = 0; \
+        if (width >= 64) { \
+            const unsigned unaligned = (-(uintptr_t)src) & 0x1f; \
+            if (unaligned) { \
+                COPY32_S(dst, src, "vmovdqu", "vmovdqu", shiftstr32); \
+                x = unaligned; \
+            } \
+            for (; x+127 < width; x += 128) \
+                COPY128_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu", shiftstr128); \
+            for (; x+31 < width; x += 32) \
+                COPY32_S(&dst[x], &src[x], "vmovntdqa", "vmovdqu", shiftstr32); \
+        } \
+        if (x < width) \
+            CopyPlane(&dst[x], dst_pitch - x, &src[x], src_pitch - x, 1, bitshift); \
+        src += src_pitch; \
+        dst += dst_pitch; \
+    }
+
+    switch (bitshift)
+    {
+        case 0:
+            AVX2_USWC_COPY("", "")
+            break;
+        case -6:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$6"), COPY128_SHIFTL("$6"))
+            break;
+        case 6:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$6"), COPY128_SHIFTR("$6"))
+            break;
+        case 2:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$2"), COPY128_SHIFTR("$2"))
+            break;
+        case -2:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$2"), COPY128_SHIFTL("$2"))
+            break;
+        case 4:
+            AVX2_USWC_COPY(COPY32_SHIFTR("$4"), COPY128_SHIFTR("$4"))
+            break;
+        case -4:
+            AVX2_USWC_COPY(COPY32_SHIFTL("$4"), COPY128_SHIFTL("$4"))
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+#undef AVX2_USWC_COPY
+
+    asm volatile ("mfence");
+    asm volatile ("vzeroupper");
+}
 #endif
 
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
@@ -143,6 +276,12 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
 {
     assert(((intptr_t)dst & 0x0f) == 0 && (dst_pitch & 0x0f) == 0);
 
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_CopyFromUswc(dst, dst_pitch, src, src_pitch,
+                                 width, height, bitshift);
+#endif
+
     asm volatile ("mfence");
 
 #define SSE_USWC_COPY(shiftstr16, shiftstr64) \
@@ -196,7 +335,7 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
             SSE_USWC_COPY(COPY16_SHIFTR("$4"), COPY64_SHIFTR("$4"))
             break;
         case -4:
-            SSE_USWC_COPY(COPY16_SHIFTL("$2"), COPY64_SHIFTL("$2"))
+            SSE_USWC_COPY(COPY16_SHIFTL("$4"), COPY64_SHIFTL("$4"))
             break;
         default:
             vlc_assert_unreachable();
@@ -659,11 +798,80 @@ void CopyPacked(picture_t *dst, const uint8_t *src, const size_t src_pitch,
                   height, 0);
 }
 
-void Copy420_SP_to_SP(picture_t *dst, const uint8_t *src[static 2],
-                      const size_t src_pitch[static 2], unsigned height,
-                      const copy_cache_t *cache)
+typedef void (*copy_sp_cb)(picture_t *, const uint8_t *[], const size_t [],
+                           unsigned, int, const copy_cache_t *);
+
+struct copy_bands
 {
-    ASSERT_2PLANES;
+    copy_sp_cb copy;
+    picture_t *dst;
+    const uint8_t **src;
+    const size_t *src_pitch;
+    int bitshift;
+    const copy_cache_t *cache;
+};
+
+static void CopyBand(void *opaque, const struct vlc_slice *slice)
+{
+    const struct copy_bands *bands = opaque;
+    const picture_t *dst = bands->dst;
+    const unsigned chroma_start = slice->start / 2;
+
+    /* The copy functions only use the planes of the destination */
+    picture_t band;
+    band.i_planes = dst->i_planes;
+    for (int i = 0; i < dst->i_planes; i++)
+    {
+        band.p[i] = dst->p[i];
+        band.p[i].p_pixels += (size_t)(i > 0 ? chroma_start : slice->start)
+                              * dst->p[i].i_pitch;
+    }
+
+    const uint8_t *src[2] = {
+        bands->src[0] + slice->start * bands->src_pitch[0],
+        bands->src[1] + chroma_start * bands->src_pitch[1],
+    };
+
+    copy_cache_t cache = { .slices = NULL };
+#ifdef CAN_COMPILE_SSE2
+    cache.size = bands->cache->size;
+    cache.buffer = bands->cache->buffer + slice->index * cache.size;
+#endif
+
+    bands->copy(&band, src, bands->src_pitch, slice->end - slice->start,
+                bands->bitshift, &cache);
+}
+
+/* Copies a semi-planar source, in parallel bands of even height if the cache
+ * was set up for it, each band using its own part of the cache buffer */
+static void CopySP(copy_sp_cb copy, picture_t *dst,
+                   const uint8_t *src[static 2],
+                   const size_t src_pitch[static 2], unsigned height,
+                   int bitshift, const copy_cache_t *cache)
+{
+    if (cache->slices == NULL)
+    {
+        copy(dst, src, src_pitch, height, bitshift, cache);
+        return;
+    }
+
+    struct copy_bands bands = {
+        .copy = copy,
+        .dst = dst,
+        .src = src,
+        .src_pitch = src_pitch,
+        .bitshift = bitshift,
+        .cache = cache,
+    };
+    vlc_slices_Run(cache->slices, height, 2, 0, CopyBand, &bands);
+}
+
+static void DoCopy420_SP_to_SP(picture_t *dst, const uint8_t *src[static 2],
+                               const size_t src_pitch[static 2],
+                               unsigned height, int bitshift,
+                               const copy_cache_t *cache)
+{
+    VLC_UNUSED(bitshift);
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_SP(dst, src, src_pitch, height, cache);
@@ -677,6 +885,14 @@ void Copy420_SP_to_SP(picture_t *dst, const uint8_t *src[static 2],
               src[1], src_pitch[1], (height+1)/2, 0);
 }
 
+void Copy420_SP_to_SP(picture_t *dst, const uint8_t *src[static 2],
+                      const size_t src_pitch[static 2], unsigned height,
+                      const copy_cache_t *cache)
+{
+    ASSERT_2PLANES;
+    CopySP(DoCopy420_SP_to_SP, dst, src, src_pitch, height, 0, cache);
+}
+
 #define SPLIT_PLANES(type, pitch_den) do { \
     size_t copy_pitch = __MIN(__MIN(src_pitch / pitch_den, dstu_pitch), dstv_pitch); \
     for (unsigned y = 0; y < height; y++) { \
@@ -736,11 +952,12 @@ static void SplitPlanes16(uint8_t *dstu, size_t dstu_pitch,
         SPLIT_PLANES_SHIFTL(uint16_t, 4, (-bitshift) & 0xf);
 }
 
-void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
-                     const size_t src_pitch[static 2], unsigned height,
-                     const copy_cache_t *cache)
+static void DoCopy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
+                              const size_t src_pitch[static 2],
+                              unsigned height, int bitshift,
+                              const copy_cache_t *cache)
 {
-    ASSERT_2PLANES;
+    VLC_UNUSED(bitshift);
 #ifdef CAN_COMPILE_SSE2
     if (vlc_CPU_SSE2())
         return SSE_Copy420_SP_to_P(dst, src, src_pitch, height, 1, 0, cache);
@@ -755,13 +972,19 @@ void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
                 src[1], src_pitch[1], (height+1)/2);
 }
 
-void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
-                        const size_t src_pitch[static 2], unsigned height,
-                        int bitshift, const copy_cache_t *cache)
+void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
+                     const size_t src_pitch[static 2], unsigned height,
+                     const copy_cache_t *cache)
 {
     ASSERT_2PLANES;
-    assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
+    CopySP(DoCopy420_SP_to_P, dst, src, src_pitch, height, 0, cache);
+}
 
+static void DoCopy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
+                                 const size_t src_pitch[static 2],
+                                 unsigned height, int bitshift,
+                                 const copy_cache_t *cache)
+{
 #ifdef CAN_COMPILE_SSE3
     if (vlc_CPU_SSSE3())
         return SSE_Copy420_SP_to_P(dst, src, src_pitch, height, 2, bitshift, cache);
@@ -776,6 +999,15 @@ void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
                   src[1], src_pitch[1], (height+1)/2, bitshift);
 }
 
+void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
+                        const size_t src_pitch[static 2], unsigned height,
+                        int bitshift, const copy_cache_t *cache)
+{
+    ASSERT_2PLANES;
+    assert(bitshift >= -6 && bitshift <= 6 && (bitshift % 2 == 0));
+    CopySP(DoCopy420_16_SP_to_P, dst, src, src_pitch, height, bitshift, cache);
+}
+
 #define INTERLEAVE_UV() do { \
     for ( unsigned int line = 0; line < copy_lines; line++ ) { \
         for ( unsigned int col = 0; col < copy_pitch; col++ ) { \
@@ -1102,9 +1334,55 @@ static picture_t *pic_new_unaligned(const video_format_t *fmt)
     return picture_NewFromResource(fmt, &rsc);
 }
 
+static void conv_run(const struct test_dst *test_dst, picture_t *dst,
+                     const picture_t *src, const copy_cache_t *cache)
+{
+    const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
+                                      src->p[U_PLANE].p_pixels,
+                                      src->p[V_PLANE].p_pixels };
+    const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
+                                       src->p[U_PLANE].i_pitch,
+                                       src->p[V_PLANE].i_pitch };
+
+    if (test_dst->bitshift == 0)
+        test_dst->conv(dst, src_planes, src_pitches,
+                       src->format.i_visible_height, cache);
+    else
+        test_dst->conv16(dst, src_planes, src_pitches,
+                         src->format.i_visible_height, test_dst->bitshift,
+                         cache);
+}
+
+static void bench(const struct test_dst *test_dst, picture_t *dst,
+                  const picture_t *src, const copy_cache_t *cache,
+                  const char *name)
+{
+    size_t size = 0;
+    for (int i = 0; i < src->i_planes; i++)
+        size += (size_t)src->p[i].i_pitch * src->p[i].i_lines;
+
+    unsigned count = 0;
+    vlc_tick_t start = vlc_tick_now();
+    vlc_tick_t elapsed;
+
+    do
+    {
+        conv_run(test_dst, dst, src, cache);
+        count++;
+        elapsed = vlc_tick_now() - start;
+    }
+    while (elapsed < VLC_TICK_FROM_MS(200));
+
+    fprintf(stderr, "bench: %u x %u %4.4s -> %4.4s %-8s %6.2f GB/s\n",
+            src->format.i_width, src->format.i_height,
+            (const char *) &src->format.i_chroma,
+            (const char *) &dst->format.i_chroma, name,
+            (double) count * size / secf_from_vlc_tick(elapsed) / 1e9);
+}
+
 int main(void)
 {
-    alarm(10);
+    alarm(30);
 
 #ifndef COPY_TEST_NOOPTIM
     if (!vlc_CPU_SSE2())
@@ -1114,6 +1392,12 @@ int main(void)
     }
 #endif
 
+    /* Force several bands, whatever the number of CPUs */
+    vlc_object_t *obj = (vlc_object_create)(NULL, sizeof (*obj));
+    assert(obj);
+    var_Create(obj, "filter-threads", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "filter-threads", 4);
+
     for (size_t i = 0; i < NB_CONVS; ++i)
     {
         const struct test_conv *conv = &convs[i];
@@ -1136,10 +1420,14 @@ int main(void)
             assert(src);
             piccheck(src, src_dsc, true);
 
-            copy_cache_t cache;
-            int ret = CopyInitCache(&cache, src->format.i_width
+            copy_cache_t caches[2];
+            int ret = CopyInitCache(&caches[0], src->format.i_width
                                     * src_dsc->pixel_size);
             assert(ret == VLC_SUCCESS);
+            ret = CopyInitThreadedCache(&caches[1], src->format.i_width
+                                        * src_dsc->pixel_size, obj);
+            assert(ret == VLC_SUCCESS);
+            assert(caches[1].slices != NULL);
 
             for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
             {
@@ -1149,35 +1437,35 @@ int main(void)
                     vlc_fourcc_GetChromaDescription(test_dst->chroma);
                 assert(dst_dsc);
                 fmt.i_chroma = test_dst->chroma;
-                picture_t *dst = picture_NewFromFormat(&fmt);
-                assert(dst);
-
-                const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
-                                                  src->p[U_PLANE].p_pixels,
-                                                  src->p[V_PLANE].p_pixels };
-                const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
-                                                   src->p[U_PLANE].i_pitch,
-                                                   src->p[V_PLANE].i_pitch };
-
-                fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s\n",
-                        size->i_width, size->i_height,
-                        size->i_visible_width, size->i_visible_height,
-                        (const char *) &src->format.i_chroma,
-                        (const char *) &dst->format.i_chroma);
-                if (test_dst->bitshift == 0)
-                    test_dst->conv(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, &cache);
-                else
-                    test_dst->conv16(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, test_dst->bitshift,
-                                   &cache);
-                piccheck(dst, dst_dsc, false);
-                picture_Release(dst);
+
+                for (size_t c = 0; c < ARRAY_SIZE(caches); ++c)
+                {
+                    picture_t *dst = picture_NewFromFormat(&fmt);
+                    assert(dst);
+
+                    fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s%s\n",
+                            size->i_width, size->i_height,
+                            size->i_visible_width, size->i_visible_height,
+                            (const char *) &src->format.i_chroma,
+                            (const char *) &dst->format.i_chroma,
+                            c > 0 ? " threaded" : "");
+                    conv_run(test_dst, dst, src, &caches[c]);
+                    piccheck(dst, dst_dsc, false);
+
+                    /* Throughput with the largest size, only the
+                     * semi-planar sources are copied in bands */
+                    if (j == NB_SIZES - 1 && (c == 0 || src->i_planes == 2))
+                        bench(test_dst, dst, src, &caches[c],
+                              c > 0 ? "threaded" : "");
+                    picture_Release(dst);
+                }
             }
             picture_Release(src);
-            CopyCleanCache(&cache);
+            for (size_t c = 0; c < ARRAY_SIZE(caches); ++c)
+                CopyCleanCache(&caches[c]);
         }
     }
+    vlc_object_delete(obj);
     return 0;
 }
 
@@ -24,6 +24,7 @@
 #define VLC_VIDEOCHROMA_COPY_H_
 
 #include <assert.h>
+#include <vlc_slices.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,12 +34,15 @@ typedef struct {
 # ifdef CAN_COMPILE_SSE2
     uint8_t *buffer;
     size_t  size;
-# else
-    char dummy;
 # endif
+    vlc_slices_t *slices;
 } copy_cache_t;
 
 int  CopyInitCache(copy_cache_t *cache, unsigned width);
+/* Same as CopyInitCache(), but the semi-planar sources are copied in parallel
+ * bands, as many as set by the "filter-threads" option of the object */
+int  CopyInitThreadedCache(copy_cache_t *cache, unsigned width,
+                           vlc_object_t *obj);
 void CopyCleanCache(copy_cache_t *cache);
 
 /* YUVY/RGB copies */
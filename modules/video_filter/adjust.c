@@ -37,6 +37,7 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_slices.h>
 #include "filter_picture.h"
 
 #include "adjust_sat_hue.h"
@@ -107,6 +108,7 @@ typedef struct
                                int, int );
     int (*pf_process_sat_hue_clip)( picture_t *, picture_t *, int, int,
                                     int, int, int );
+    vlc_slices_t *slices;
 } filter_sys_t;
 
 static int FloatCallback( vlc_object_t *obj, char const *varname,
@@ -175,6 +177,10 @@ static int Create( filter_t *p_filter )
             return VLC_EGENERIC;
     }
 
+    p_sys->slices = vlc_slices_New( p_filter );
+    if( p_sys->slices == NULL )
+        return VLC_ENOMEM;
+
     /* needed to get options passed in transcode using the
      * adjust{name=value} syntax */
     config_ChainParse( p_filter, "", ppsz_filter_options, p_filter->p_cfg );
@@ -214,68 +220,50 @@ static void Destroy( filter_t *p_filter )
     var_DelCallback( p_filter, "saturation", FloatCallback,
                      &p_sys->f_saturation );
     var_DelCallback( p_filter, "gamma", FloatCallback, &p_sys->f_gamma );
+    vlc_slices_Delete( p_sys->slices );
 }
 
 /*****************************************************************************
- * Run the filter on a Planar YUV picture
+ * Slice threading
  *****************************************************************************/
-static void FilterPlanar( filter_t *p_filter, picture_t *p_pic, picture_t *p_outpic )
+struct adjust_slices
 {
-    /* The full range will only be used for 10-bit */
-    int pi_luma[1024];
-    int pi_gamma[1024];
-
-    filter_sys_t *p_sys = p_filter->p_sys;
-
+    filter_sys_t *p_sys;
+    picture_t *p_pic;
+    picture_t *p_outpic;
+    const int *pi_luma;
     bool b_16bit;
-    float f_range;
-    switch( p_filter->fmt_in.video.i_chroma )
-    {
-        CASE_PLANAR_YUV10
-            b_16bit = true;
-            f_range = 1024.f;
-            break;
-        CASE_PLANAR_YUV9
-            b_16bit = true;
-            f_range = 512.f;
-            break;
-        default:
-            b_16bit = false;
-            f_range = 256.f;
-    }
-
-    const float f_max = f_range - 1.f;
-    const unsigned i_max = f_max;
-    const int i_range = f_range;
-    const unsigned i_size = i_range;
-    const unsigned i_mid = i_range >> 1;
-
-    /* Get variables */
-    int32_t i_cont = lroundf( atomic_load_explicit( &p_sys->f_contrast, memory_order_relaxed ) * f_max );
-    int32_t i_lum = lroundf( (atomic_load_explicit( &p_sys->f_brightness, memory_order_relaxed ) - 1.f) * f_max );
-    float f_hue = atomic_load_explicit( &p_sys->f_hue, memory_order_relaxed ) * (float)(M_PI / 180.);
-    int i_sat = (int)( atomic_load_explicit( &p_sys->f_saturation, memory_order_relaxed ) * f_range );
-    float f_gamma = 1.f / atomic_load_explicit( &p_sys->f_gamma, memory_order_relaxed );
-
-    /* Contrast is a fast but kludged function, so I put this gap to be
-     * cleaner :) */
-    i_lum += i_mid - i_cont / 2;
+    bool b_clip;
+    int i_sin, i_cos, i_sat, i_x, i_y;
+};
 
-    /* Fill the gamma lookup table */
-    for( unsigned i = 0 ; i < i_size; i++ )
-    {
-        pi_gamma[ i ] = VLC_CLIP( powf(i / f_max, f_gamma) * f_max, 0, i_max );
-    }
+/* Bands are aligned for the chroma planes of 4:1:0 pictures */
+#define SLICE_ALIGN 4
 
-    /* Fill the luma lookup table */
-    for( unsigned i = 0 ; i < i_size; i++ )
+/* Restricts a picture to the lines of a band, for the processing functions
+ * which only look at its format and planes */
+static void SliceView( const picture_t *p_pic, const struct vlc_slice *slice,
+                       picture_t *p_view )
+{
+    p_view->format = p_pic->format;
+    p_view->i_planes = p_pic->i_planes;
+    for( int i = 0; i < p_pic->i_planes; i++ )
     {
-        pi_luma[ i ] = pi_gamma[VLC_CLIP( (int)(i_lum + i_cont * i / i_range), 0, (int) i_max )];
+        const plane_t *p_plane = &p_pic->p[i];
+        struct vlc_slice band;
+
+        vlc_slice_Scale( slice, p_pic->p[0].i_visible_lines,
+                         p_plane->i_visible_lines, &band );
+        p_view->p[i] = *p_plane;
+        p_view->p[i].p_pixels += band.start * p_plane->i_pitch;
+        p_view->p[i].i_lines = p_view->p[i].i_visible_lines =
+            band.end - band.start;
     }
+}
 
-    /*
-     * Do the Y plane
-     */
+static void PlanarLuma( picture_t *p_pic, picture_t *p_outpic,
+                        const int *pi_luma, bool b_16bit )
+{
     if ( b_16bit )
     {
         uint16_t *p_in, *p_in_end, *p_line_end;
@@ -348,10 +336,97 @@ static void FilterPlanar( filter_t *p_filter, picture_t *p_pic, picture_t *p_out
                    - p_outpic->p[Y_PLANE].i_visible_pitch;
         }
     }
+}
+
+static void PlanarSlice( void *opaque, const struct vlc_slice *slice )
+{
+    const struct adjust_slices *slices = opaque;
+    filter_sys_t *p_sys = slices->p_sys;
+    picture_t pic, outpic;
+
+    SliceView( slices->p_pic, slice, &pic );
+    SliceView( slices->p_outpic, slice, &outpic );
+
+    /*
+     * Do the Y plane
+     */
+    PlanarLuma( &pic, &outpic, slices->pi_luma, slices->b_16bit );
 
     /*
      * Do the U and V planes
      */
+    /* Currently no errors are implemented in the function, if any are added
+     * check them here */
+    if ( slices->b_clip )
+        p_sys->pf_process_sat_hue_clip( &pic, &outpic, slices->i_sin,
+                                        slices->i_cos, slices->i_sat,
+                                        slices->i_x, slices->i_y );
+    else
+        p_sys->pf_process_sat_hue( &pic, &outpic, slices->i_sin,
+                                   slices->i_cos, slices->i_sat,
+                                   slices->i_x, slices->i_y );
+}
+
+/*****************************************************************************
+ * Run the filter on a Planar YUV picture
+ *****************************************************************************/
+static void FilterPlanar( filter_t *p_filter, picture_t *p_pic, picture_t *p_outpic )
+{
+    /* The full range will only be used for 10-bit */
+    int pi_luma[1024];
+    int pi_gamma[1024];
+
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    bool b_16bit;
+    float f_range;
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        CASE_PLANAR_YUV10
+            b_16bit = true;
+            f_range = 1024.f;
+            break;
+        CASE_PLANAR_YUV9
+            b_16bit = true;
+            f_range = 512.f;
+            break;
+        default:
+            b_16bit = false;
+            f_range = 256.f;
+    }
+
+    const float f_max = f_range - 1.f;
+    const unsigned i_max = f_max;
+    const int i_range = f_range;
+    const unsigned i_size = i_range;
+    const unsigned i_mid = i_range >> 1;
+
+    /* Get variables */
+    int32_t i_cont = lroundf( atomic_load_explicit( &p_sys->f_contrast, memory_order_relaxed ) * f_max );
+    int32_t i_lum = lroundf( (atomic_load_explicit( &p_sys->f_brightness, memory_order_relaxed ) - 1.f) * f_max );
+    float f_hue = atomic_load_explicit( &p_sys->f_hue, memory_order_relaxed ) * (float)(M_PI / 180.);
+    int i_sat = (int)( atomic_load_explicit( &p_sys->f_saturation, memory_order_relaxed ) * f_range );
+    float f_gamma = 1.f / atomic_load_explicit( &p_sys->f_gamma, memory_order_relaxed );
+
+    /* Contrast is a fast but kludged function, so I put this gap to be
+     * cleaner :) */
+    i_lum += i_mid - i_cont / 2;
+
+    /* Fill the gamma lookup table */
+    for( unsigned i = 0 ; i < i_size; i++ )
+    {
+        pi_gamma[ i ] = VLC_CLIP( powf(i / f_max, f_gamma) * f_max, 0, i_max );
+    }
+
+    /* Fill the luma lookup table */
+    for( unsigned i = 0 ; i < i_size; i++ )
+    {
+        pi_luma[ i ] = pi_gamma[VLC_CLIP( (int)(i_lum + i_cont * i / i_range), 0, (int) i_max )];
+    }
+
+    /*
+     * Hue and saturation of the U and V planes
+     */
 
     int i_sin = sinf(f_hue) * f_max;
     int i_cos = cosf(f_hue) * f_max;
@@ -360,37 +435,104 @@ static void FilterPlanar( filter_t *p_filter, picture_t *p_pic, picture_t *p_out
     int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
     int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
 
-    if ( i_sat > i_range )
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-    else
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
+    struct adjust_slices slices = {
+        .p_sys = p_sys, .p_pic = p_pic, .p_outpic = p_outpic,
+        .pi_luma = pi_luma, .b_16bit = b_16bit, .b_clip = i_sat > i_range,
+        .i_sin = i_sin, .i_cos = i_cos, .i_sat = i_sat, .i_x = i_x, .i_y = i_y,
+    };
+
+    vlc_slices_Run( p_sys->slices, p_outpic->p[Y_PLANE].i_visible_lines,
+                    SLICE_ALIGN, 0, PlanarSlice, &slices );
 }
 
 /*****************************************************************************
  * Run the filter on a Packed YUV picture
  *****************************************************************************/
+static void PackedLuma( picture_t *p_pic, picture_t *p_outpic,
+                        const int *pi_luma, int i_y_offset )
+{
+    uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
+    int i_pitch = p_pic->p->i_pitch;
+    int i_visible_pitch = p_pic->p->i_visible_pitch;
+
+    p_in = p_pic->p->p_pixels + i_y_offset;
+    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
+
+    p_out = p_outpic->p->p_pixels + i_y_offset;
+
+    for( ; p_in < p_in_end ; )
+    {
+        p_line_end = p_in + i_visible_pitch - 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            /* Do 8 pixels at a time */
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_line_end += 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_in += i_pitch - p_pic->p->i_visible_pitch;
+        p_out += i_pitch - p_outpic->p->i_visible_pitch;
+    }
+}
+
+struct adjust_packed_slices
+{
+    struct adjust_slices common;
+    int i_y_offset;
+};
+
+static void PackedSlice( void *opaque, const struct vlc_slice *slice )
+{
+    const struct adjust_packed_slices *packed = opaque;
+    const struct adjust_slices *slices = &packed->common;
+    filter_sys_t *p_sys = slices->p_sys;
+    picture_t pic, outpic;
+
+    SliceView( slices->p_pic, slice, &pic );
+    SliceView( slices->p_outpic, slice, &outpic );
+
+    /*
+     * Do the Y plane
+     */
+    PackedLuma( &pic, &outpic, slices->pi_luma, packed->i_y_offset );
+
+    /*
+     * Do the U and V planes
+     */
+    /* The chroma was checked by the caller, the functions cannot fail */
+    if ( slices->b_clip )
+        p_sys->pf_process_sat_hue_clip( &pic, &outpic, slices->i_sin,
+                                        slices->i_cos, slices->i_sat,
+                                        slices->i_x, slices->i_y );
+    else
+        p_sys->pf_process_sat_hue( &pic, &outpic, slices->i_sin,
+                                   slices->i_cos, slices->i_sat,
+                                   slices->i_x, slices->i_y );
+}
+
 static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 {
     int pi_luma[256];
     int pi_gamma[256];
 
     picture_t *p_outpic;
-    uint8_t *p_in, *p_in_end, *p_line_end;
-    uint8_t *p_out;
     int i_y_offset, i_u_offset, i_v_offset;
 
-    int i_pitch, i_visible_pitch;
-
     double  f_hue;
     double  f_gamma;
     int32_t i_cont, i_lum;
@@ -400,9 +542,6 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 
     if( !p_pic ) return NULL;
 
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
-
     if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
                              &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
     {
@@ -446,44 +585,7 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     }
 
     /*
-     * Do the Y plane
-     */
-
-    p_in = p_pic->p->p_pixels + i_y_offset;
-    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_y_offset;
-
-    for( ; p_in < p_in_end ; )
-    {
-        p_line_end = p_in + i_visible_pitch - 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            /* Do 8 pixels at a time */
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_line_end += 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_in += i_pitch - p_pic->p->i_visible_pitch;
-        p_out += i_pitch - p_outpic->p->i_visible_pitch;
-    }
-
-    /*
-     * Do the U and V planes
+     * Hue and saturation of the U and V planes
      */
 
     i_sin = sin(f_hue) * 256;
@@ -492,32 +594,18 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
     i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
 
-    if ( i_sat > 256 )
-    {
-        if ( p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                             i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
-    }
-    else
-    {
-        if ( p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
-    }
+    struct adjust_packed_slices slices = {
+        .common = {
+            .p_sys = p_sys, .p_pic = p_pic, .p_outpic = p_outpic,
+            .pi_luma = pi_luma, .b_16bit = false, .b_clip = i_sat > 256,
+            .i_sin = i_sin, .i_cos = i_cos, .i_sat = i_sat,
+            .i_x = i_x, .i_y = i_y,
+        },
+        .i_y_offset = i_y_offset,
+    };
+
+    vlc_slices_Run( p_sys->slices, p_outpic->p->i_visible_lines, 1, 0,
+                    PackedSlice, &slices );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
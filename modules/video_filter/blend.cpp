@@ -31,8 +31,15 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
 
+#if defined(__i386__) || defined(__x86_64__)
+# include <immintrin.h>
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -557,6 +564,451 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
     }
 }
 
+/*
+ * Span blenders of YUVA pictures
+ *
+ * The most common blendings, subtitles onto the decoded or displayed
+ * pictures, are done a line span at a time instead of a pixel at a time,
+ * with the same results as the generic Blend() above.
+ */
+namespace {
+
+struct blend_spans {
+    /* dst[i] blended with src[i] */
+    void (*luma)(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                 unsigned n, unsigned alpha);
+    /* dst[i] blended with src[2 * i] */
+    void (*chroma)(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                   unsigned n, unsigned alpha);
+    /* dst[2 * i] and dst[2 * i + 1] blended with src0[2 * i] and src1[2 * i] */
+    void (*chroma_interleaved)(uint8_t *dst, const uint8_t *src0,
+                               const uint8_t *src1, const uint8_t *srca,
+                               unsigned n, unsigned alpha);
+    /* 4-bytes dst[i] blended with the RGB conversion of y[i], u[i], v[i] */
+    void (*rgb32)(uint8_t *dst, const uint8_t *y, const uint8_t *u,
+                  const uint8_t *v, const uint8_t *srca, unsigned n,
+                  unsigned alpha, const unsigned offsets[3]);
+};
+
+static void BlendLumaC(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                       unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++) {
+        unsigned a = div255(alpha * srca[i]);
+        if (a > 0)
+            ::merge(&dst[i], src[i], a);
+    }
+}
+
+static void BlendChromaC(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                         unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++) {
+        unsigned a = div255(alpha * srca[2 * i]);
+        if (a > 0)
+            ::merge(&dst[i], src[2 * i], a);
+    }
+}
+
+static void BlendChromaInterleavedC(uint8_t *dst, const uint8_t *src0,
+                                    const uint8_t *src1, const uint8_t *srca,
+                                    unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++) {
+        unsigned a = div255(alpha * srca[2 * i]);
+        if (a > 0) {
+            ::merge(&dst[2 * i], src0[2 * i], a);
+            ::merge(&dst[2 * i + 1], src1[2 * i], a);
+        }
+    }
+}
+
+static void BlendRGB32C(uint8_t *dst, const uint8_t *y, const uint8_t *u,
+                        const uint8_t *v, const uint8_t *srca, unsigned n,
+                        unsigned alpha, const unsigned offsets[3])
+{
+    for (unsigned i = 0; i < n; i++) {
+        unsigned a = div255(alpha * srca[i]);
+        if (a > 0) {
+            int r, g, b;
+            yuv_to_rgb(&r, &g, &b, y[i], u[i], v[i]);
+            ::merge(&dst[4 * i + offsets[0]], r, a);
+            ::merge(&dst[4 * i + offsets[1]], g, a);
+            ::merge(&dst[4 * i + offsets[2]], b, a);
+        }
+    }
+}
+
+static const blend_spans blend_spans_c = {
+    BlendLumaC,
+    BlendChromaC,
+    BlendChromaInterleavedC,
+    BlendRGB32C,
+};
+
+/* yuv_to_rgb() coefficients */
+#define SPAN_FIX(x) ((int) ((x) * (1 << 10) + 0.5))
+static const int SPAN_FIX_Y     = SPAN_FIX(255.0/219.0);
+static const int SPAN_FIX_R_CR  = SPAN_FIX(1.40200*255.0/224.0);
+static const int SPAN_FIX_G_CB  = SPAN_FIX(0.34414*255.0/224.0);
+static const int SPAN_FIX_G_CR  = SPAN_FIX(0.71414*255.0/224.0);
+static const int SPAN_FIX_B_CB  = SPAN_FIX(1.77200*255.0/224.0);
+#undef SPAN_FIX
+
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef HAVE_SSE2_INTRINSICS
+namespace sse2 {
+#  define SPAN_TARGET __attribute__((__target__("sse2")))
+typedef __m128i vu8;
+typedef __m128i vu16;
+typedef __m128i vs16;
+static const unsigned vbytes = 16;
+
+SPAN_TARGET static inline vu8 vload(const uint8_t *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+SPAN_TARGET static inline void vstore(uint8_t *p, vu8 v)
+{
+    _mm_storeu_si128((__m128i *)p, v);
+}
+SPAN_TARGET static inline vu8 veven(vu8 a, vu8 b)
+{
+    const __m128i m = _mm_set1_epi16(0x00ff);
+    return _mm_packus_epi16(_mm_and_si128(a, m), _mm_and_si128(b, m));
+}
+SPAN_TARGET static inline vu8 vodd(vu8 a, vu8 b)
+{
+    return _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+SPAN_TARGET static inline vu8 vziplo(vu8 a, vu8 b) { return _mm_unpacklo_epi8(a, b); }
+SPAN_TARGET static inline vu8 vziphi(vu8 a, vu8 b) { return _mm_unpackhi_epi8(a, b); }
+SPAN_TARGET static inline vu8 vziplo16(vu8 a, vu8 b) { return _mm_unpacklo_epi16(a, b); }
+SPAN_TARGET static inline vu8 vziphi16(vu8 a, vu8 b) { return _mm_unpackhi_epi16(a, b); }
+SPAN_TARGET static inline vu16 vwidenlo(vu8 v)
+{
+    return _mm_unpacklo_epi8(v, _mm_setzero_si128());
+}
+SPAN_TARGET static inline vu16 vwidenhi(vu8 v)
+{
+    return _mm_unpackhi_epi8(v, _mm_setzero_si128());
+}
+SPAN_TARGET static inline vu8 vnarrow(vu16 lo, vu16 hi) { return _mm_packus_epi16(lo, hi); }
+SPAN_TARGET static inline vu8 vnarrow_s(vs16 lo, vs16 hi) { return _mm_packus_epi16(lo, hi); }
+SPAN_TARGET static inline vu16 vset16(int x) { return _mm_set1_epi16(x); }
+SPAN_TARGET static inline vu16 vadd16(vu16 a, vu16 b) { return _mm_add_epi16(a, b); }
+SPAN_TARGET static inline vu16 vsub16(vu16 a, vu16 b) { return _mm_sub_epi16(a, b); }
+SPAN_TARGET static inline vu16 vmul16(vu16 a, vu16 b) { return _mm_mullo_epi16(a, b); }
+SPAN_TARGET static inline vu16 vshr8(vu16 v) { return _mm_srli_epi16(v, 8); }
+SPAN_TARGET static inline vs16 vyuv(vu16 y, vu16 cb, vu16 cr, int kcb, int kcr)
+{
+    const __m128i ky = _mm_set1_epi32(SPAN_FIX_Y | (512 << 16));
+    const __m128i kc = _mm_set1_epi32((uint16_t)kcb | ((uint32_t)(uint16_t)kcr << 16));
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y, one), ky),
+                               _mm_madd_epi16(_mm_unpacklo_epi16(cb, cr), kc));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y, one), ky),
+                               _mm_madd_epi16(_mm_unpackhi_epi16(cb, cr), kc));
+    return _mm_packs_epi32(_mm_srai_epi32(lo, 10), _mm_srai_epi32(hi, 10));
+}
+SPAN_TARGET static inline bool vzero(vu8 v)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xffff;
+}
+
+#  include "blend_spans.h"
+#  undef SPAN_TARGET
+} // namespace sse2
+# endif
+
+# ifdef HAVE_AVX2_INTRINSICS
+namespace avx2 {
+#  define SPAN_TARGET __attribute__((__target__("avx2")))
+typedef __m256i vu8;
+typedef __m256i vu16;
+typedef __m256i vs16;
+static const unsigned vbytes = 32;
+
+/* The packing and unpacking instructions work on each 128-bits lane, the
+ * memory order of the bytes is restored where it matters */
+SPAN_TARGET static inline __m256i vinorder(__m256i v)
+{
+    return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+}
+SPAN_TARGET static inline vu8 vload(const uint8_t *p)
+{
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+SPAN_TARGET static inline void vstore(uint8_t *p, vu8 v)
+{
+    _mm256_storeu_si256((__m256i *)p, v);
+}
+SPAN_TARGET static inline vu8 veven(vu8 a, vu8 b)
+{
+    const __m256i m = _mm256_set1_epi16(0x00ff);
+    return vinorder(_mm256_packus_epi16(_mm256_and_si256(a, m),
+                                        _mm256_and_si256(b, m)));
+}
+SPAN_TARGET static inline vu8 vodd(vu8 a, vu8 b)
+{
+    return vinorder(_mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+                                        _mm256_srli_epi16(b, 8)));
+}
+SPAN_TARGET static inline vu8 vziplo(vu8 a, vu8 b)
+{
+    return _mm256_unpacklo_epi8(vinorder(a), vinorder(b));
+}
+SPAN_TARGET static inline vu8 vziphi(vu8 a, vu8 b)
+{
+    return _mm256_unpackhi_epi8(vinorder(a), vinorder(b));
+}
+SPAN_TARGET static inline vu8 vziplo16(vu8 a, vu8 b)
+{
+    return _mm256_unpacklo_epi16(vinorder(a), vinorder(b));
+}
+SPAN_TARGET static inline vu8 vziphi16(vu8 a, vu8 b)
+{
+    return _mm256_unpackhi_epi16(vinorder(a), vinorder(b));
+}
+SPAN_TARGET static inline vu16 vwidenlo(vu8 v)
+{
+    return _mm256_unpacklo_epi8(v, _mm256_setzero_si256());
+}
+SPAN_TARGET static inline vu16 vwidenhi(vu8 v)
+{
+    return _mm256_unpackhi_epi8(v, _mm256_setzero_si256());
+}
+SPAN_TARGET static inline vu8 vnarrow(vu16 lo, vu16 hi) { return _mm256_packus_epi16(lo, hi); }
+SPAN_TARGET static inline vu8 vnarrow_s(vs16 lo, vs16 hi) { return _mm256_packus_epi16(lo, hi); }
+SPAN_TARGET static inline vu16 vset16(int x) { return _mm256_set1_epi16(x); }
+SPAN_TARGET static inline vu16 vadd16(vu16 a, vu16 b) { return _mm256_add_epi16(a, b); }
+SPAN_TARGET static inline vu16 vsub16(vu16 a, vu16 b) { return _mm256_sub_epi16(a, b); }
+SPAN_TARGET static inline vu16 vmul16(vu16 a, vu16 b) { return _mm256_mullo_epi16(a, b); }
+SPAN_TARGET static inline vu16 vshr8(vu16 v) { return _mm256_srli_epi16(v, 8); }
+SPAN_TARGET static inline vs16 vyuv(vu16 y, vu16 cb, vu16 cr, int kcb, int kcr)
+{
+    const __m256i ky = _mm256_set1_epi32(SPAN_FIX_Y | (512 << 16));
+    const __m256i kc = _mm256_set1_epi32((uint16_t)kcb | ((uint32_t)(uint16_t)kcr << 16));
+    const __m256i one = _mm256_set1_epi16(1);
+    __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y, one), ky),
+                                  _mm256_madd_epi16(_mm256_unpacklo_epi16(cb, cr), kc));
+    __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y, one), ky),
+                                  _mm256_madd_epi16(_mm256_unpackhi_epi16(cb, cr), kc));
+    return _mm256_packs_epi32(_mm256_srai_epi32(lo, 10), _mm256_srai_epi32(hi, 10));
+}
+SPAN_TARGET static inline bool vzero(vu8 v)
+{
+    return _mm256_testz_si256(v, v);
+}
+
+#  include "blend_spans.h"
+#  undef SPAN_TARGET
+} // namespace avx2
+# endif
+
+#elif defined(__ARM_NEON)
+namespace neon {
+# define SPAN_TARGET
+typedef uint8x16_t vu8;
+typedef uint16x8_t vu16;
+typedef int16x8_t vs16;
+static const unsigned vbytes = 16;
+
+static inline vu8 vload(const uint8_t *p) { return vld1q_u8(p); }
+static inline void vstore(uint8_t *p, vu8 v) { vst1q_u8(p, v); }
+static inline vu8 veven(vu8 a, vu8 b) { return vuzpq_u8(a, b).val[0]; }
+static inline vu8 vodd(vu8 a, vu8 b) { return vuzpq_u8(a, b).val[1]; }
+static inline vu8 vziplo(vu8 a, vu8 b) { return vzipq_u8(a, b).val[0]; }
+static inline vu8 vziphi(vu8 a, vu8 b) { return vzipq_u8(a, b).val[1]; }
+static inline vu8 vziplo16(vu8 a, vu8 b)
+{
+    return vreinterpretq_u8_u16(vzipq_u16(vreinterpretq_u16_u8(a),
+                                          vreinterpretq_u16_u8(b)).val[0]);
+}
+static inline vu8 vziphi16(vu8 a, vu8 b)
+{
+    return vreinterpretq_u8_u16(vzipq_u16(vreinterpretq_u16_u8(a),
+                                          vreinterpretq_u16_u8(b)).val[1]);
+}
+static inline vu16 vwidenlo(vu8 v) { return vmovl_u8(vget_low_u8(v)); }
+static inline vu16 vwidenhi(vu8 v) { return vmovl_u8(vget_high_u8(v)); }
+static inline vu8 vnarrow(vu16 lo, vu16 hi)
+{
+    return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+}
+static inline vu8 vnarrow_s(vs16 lo, vs16 hi)
+{
+    return vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi));
+}
+static inline vu16 vset16(int x) { return vdupq_n_u16(x); }
+static inline vu16 vadd16(vu16 a, vu16 b) { return vaddq_u16(a, b); }
+static inline vu16 vsub16(vu16 a, vu16 b) { return vsubq_u16(a, b); }
+static inline vu16 vmul16(vu16 a, vu16 b) { return vmulq_u16(a, b); }
+static inline vu16 vshr8(vu16 v) { return vshrq_n_u16(v, 8); }
+static inline int16x4_t vyuv_half(int32x4_t acc)
+{
+    return vqmovn_s32(vshrq_n_s32(vaddq_s32(acc, vdupq_n_s32(512)), 10));
+}
+static inline vs16 vyuv(vu16 y, vu16 cb, vu16 cr, int kcb, int kcr)
+{
+    const int16x8_t ys = vreinterpretq_s16_u16(y);
+    const int16x8_t cbs = vreinterpretq_s16_u16(cb);
+    const int16x8_t crs = vreinterpretq_s16_u16(cr);
+    int32x4_t lo = vmull_n_s16(vget_low_s16(ys), SPAN_FIX_Y);
+    int32x4_t hi = vmull_n_s16(vget_high_s16(ys), SPAN_FIX_Y);
+
+    lo = vmlal_n_s16(lo, vget_low_s16(cbs), kcb);
+    lo = vmlal_n_s16(lo, vget_low_s16(crs), kcr);
+    hi = vmlal_n_s16(hi, vget_high_s16(cbs), kcb);
+    hi = vmlal_n_s16(hi, vget_high_s16(crs), kcr);
+    return vcombine_s16(vyuv_half(lo), vyuv_half(hi));
+}
+static inline bool vzero(vu8 v)
+{
+    const uint64x2_t q = vreinterpretq_u64_u8(v);
+    return (vgetq_lane_u64(q, 0) | vgetq_lane_u64(q, 1)) == 0;
+}
+
+# include "blend_spans.h"
+# undef SPAN_TARGET
+} // namespace neon
+#endif
+
+/* Fastest span blenders for the CPU */
+static const blend_spans *GetBlendSpans()
+{
+#if defined(__i386__) || defined(__x86_64__)
+# ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        return &avx2::blend_spans_simd;
+# endif
+# ifdef HAVE_SSE2_INTRINSICS
+    if (vlc_CPU_SSE2())
+        return &sse2::blend_spans_simd;
+# endif
+#elif defined(__ARM_NEON)
+    if (vlc_CPU_ARM_NEON())
+        return &neon::blend_spans_simd;
+#endif
+    return &blend_spans_c;
+}
+
+struct CSpanYUVA {
+    CSpanYUVA(const picture_t *picture, unsigned x, unsigned y)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = &picture->p[i].p_pixels[y * picture->p[i].i_pitch + x];
+        this->picture = picture;
+    }
+    void nextLine()
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] += picture->p[i].i_pitch;
+    }
+    const uint8_t *data[4];
+    const picture_t *picture;
+};
+
+template <bool swap_uv>
+void BlendSpansPlanar420(const blend_spans &spans,
+                         picture_t *dst, const video_format_t *,
+                         unsigned x, unsigned y,
+                         const CSpanYUVA &src_data,
+                         unsigned width, unsigned height, int alpha)
+{
+    CSpanYUVA src(src_data);
+    const plane_t *pu = &dst->p[swap_uv ? 2 : 1];
+    const plane_t *pv = &dst->p[swap_uv ? 1 : 2];
+    /* First pixel of the span with chroma samples */
+    const unsigned first = x % 2;
+    const unsigned chroma_width = (width - first + 1) / 2;
+
+    for (unsigned dy = 0; dy < height; dy++, y++) {
+        spans.luma(&dst->p[0].p_pixels[y * dst->p[0].i_pitch + x],
+                   src.data[0], src.data[3], width, alpha);
+
+        if ((y % 2) == 0 && width > first) {
+            spans.chroma(&pu->p_pixels[y / 2 * pu->i_pitch + (x + first) / 2],
+                         src.data[1] + first, src.data[3] + first,
+                         chroma_width, alpha);
+            spans.chroma(&pv->p_pixels[y / 2 * pv->i_pitch + (x + first) / 2],
+                         src.data[2] + first, src.data[3] + first,
+                         chroma_width, alpha);
+        }
+        src.nextLine();
+    }
+}
+
+template <bool swap_uv>
+void BlendSpansSemiPlanar(const blend_spans &spans,
+                          picture_t *dst, const video_format_t *,
+                          unsigned x, unsigned y,
+                          const CSpanYUVA &src_data,
+                          unsigned width, unsigned height, int alpha)
+{
+    CSpanYUVA src(src_data);
+    const plane_t *puv = &dst->p[1];
+    const unsigned first = x % 2;
+    const unsigned chroma_width = (width - first + 1) / 2;
+
+    for (unsigned dy = 0; dy < height; dy++, y++) {
+        spans.luma(&dst->p[0].p_pixels[y * dst->p[0].i_pitch + x],
+                   src.data[0], src.data[3], width, alpha);
+
+        if ((y % 2) == 0 && width > first)
+            spans.chroma_interleaved(&puv->p_pixels[y / 2 * puv->i_pitch + (x + first) / 2 * 2],
+                                     src.data[swap_uv ? 2 : 1] + first,
+                                     src.data[swap_uv ? 1 : 2] + first,
+                                     src.data[3] + first, chroma_width, alpha);
+        src.nextLine();
+    }
+}
+
+void BlendSpansRGB32(const blend_spans &spans,
+                     picture_t *dst, const video_format_t *fmt,
+                     unsigned x, unsigned y,
+                     const CSpanYUVA &src_data,
+                     unsigned width, unsigned height, int alpha)
+{
+    CSpanYUVA src(src_data);
+    int r, g, b;
+
+    if (GetPackedRgbIndexes(fmt, &r, &g, &b) != VLC_SUCCESS) {
+        r = 0;
+        g = 1;
+        b = 2;
+    }
+
+    const unsigned offsets[3] = { (unsigned)r, (unsigned)g, (unsigned)b };
+
+    for (unsigned dy = 0; dy < height; dy++, y++) {
+        spans.rgb32(&dst->p[0].p_pixels[y * dst->p[0].i_pitch + x * 4],
+                    src.data[0], src.data[1], src.data[2], src.data[3],
+                    width, alpha, offsets);
+        src.nextLine();
+    }
+}
+
+typedef void (*span_blend_function_t)(const blend_spans &spans,
+                                      picture_t *dst, const video_format_t *fmt,
+                                      unsigned x, unsigned y,
+                                      const CSpanYUVA &src,
+                                      unsigned width, unsigned height, int alpha);
+
+static const struct {
+    vlc_fourcc_t          dst;
+    span_blend_function_t blend;
+} span_blends[] = {
+    { VLC_CODEC_I420,  BlendSpansPlanar420<false> },
+    { VLC_CODEC_J420,  BlendSpansPlanar420<false> },
+    { VLC_CODEC_YV12,  BlendSpansPlanar420<true> },
+    { VLC_CODEC_NV12,  BlendSpansSemiPlanar<false> },
+    { VLC_CODEC_NV21,  BlendSpansSemiPlanar<true> },
+    { VLC_CODEC_RGB32, BlendSpansRGB32 },
+};
+
+} // namespace
+
 typedef void (*blend_function_t)(const CPicture &dst_data, const CPicture &src_data,
                                  unsigned width, unsigned height, int alpha);
 
@@ -637,10 +1089,12 @@ static const struct {
 };
 
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), span_blend(NULL), spans(NULL)
     {
     }
     blend_function_t blend;
+    span_blend_function_t span_blend;
+    const blend_spans *spans;
 };
 
 } // namespace
@@ -670,6 +1124,16 @@ static void DoBlend(filter_t *filter,
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
+    if (sys->span_blend != NULL) {
+        sys->span_blend(*sys->spans, dst, &filter->fmt_out.video,
+                        filter->fmt_out.video.i_x_offset + x_offset,
+                        filter->fmt_out.video.i_y_offset + y_offset,
+                        CSpanYUVA(src, filter->fmt_in.video.i_x_offset,
+                                  filter->fmt_in.video.i_y_offset),
+                        width, height, alpha);
+        return;
+    }
+
     sys->blend(CPicture(dst, &filter->fmt_out.video,
                         filter->fmt_out.video.i_x_offset + x_offset,
                         filter->fmt_out.video.i_y_offset + y_offset),
@@ -698,6 +1162,12 @@ static int Open(filter_t *filter)
         if (blends[i].src == src && blends[i].dst == dst)
             sys->blend = blends[i].blend;
     }
+    for (size_t i = 0; i < sizeof(span_blends) / sizeof(*span_blends); i++) {
+        if (src == VLC_CODEC_YUVA && span_blends[i].dst == dst) {
+            sys->span_blend = span_blends[i].blend;
+            sys->spans = GetBlendSpans();
+        }
+    }
 
     if (!sys->blend) {
        msg_Err(filter, "no matching alpha blending routine (chroma: %4.4s -> %4.4s)",
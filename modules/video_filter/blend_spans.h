@@ -0,0 +1,197 @@
+/*****************************************************************************
+ * blend_spans.h: vectorized YUVA span blenders
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by blend.cpp once per instruction set, inside a
+ * namespace providing SPAN_TARGET, vbytes, the vu8/vu16/vs16 types and the
+ * primitives below:
+ *
+ *  vload, vstore         unaligned vbytes bytes load and store
+ *  veven, vodd           even or odd bytes of a then b
+ *  vziplo, vziphi        interleaved bytes of the first or second halves
+ *  vziplo16, vziphi16    same as above, by 16-bits elements
+ *  vwidenlo, vwidenhi    zero-extension of the first or second halves
+ *  vnarrow, vnarrow_s    narrowing of two 16-bits vectors, saturating the
+ *                        signed version
+ *  vset16, vadd16, vsub16, vmul16, vshr8
+ *  vyuv                  (1192 * y + kcb * cb + kcr * cr + 512) >> 10
+ *  vzero                 whether all the bytes are zero
+ *
+ * Except for the interleaving and deinterleaving primitives, the elements
+ * order only needs to be preserved by the widening and narrowing pairs.
+ *
+ * The spans match the blend_spans_c ones bit for bit, which are also used
+ * for the pixels at the end of the spans.
+ */
+
+SPAN_TARGET static inline vu16 vdiv255(vu16 v)
+{
+    return vshr8(vadd16(vadd16(v, vshr8(v)), vset16(1)));
+}
+
+SPAN_TARGET static inline vu16 vmerge16(vu16 d, vu16 s, vu16 a)
+{
+    return vdiv255(vadd16(vmul16(vsub16(vset16(255), a), d), vmul16(s, a)));
+}
+
+/* Blends s onto d with the 8-bits alpha a */
+SPAN_TARGET static inline vu8 vblend(vu8 d, vu8 s, vu8 a)
+{
+    return vnarrow(vmerge16(vwidenlo(d), vwidenlo(s), vwidenlo(a)),
+                   vmerge16(vwidenhi(d), vwidenhi(s), vwidenhi(a)));
+}
+
+/* Scales the source alpha by the global alpha */
+SPAN_TARGET static inline vu8 valpha(vu8 a, unsigned alpha)
+{
+    const vu16 k = vset16(alpha);
+
+    return vnarrow(vdiv255(vmul16(vwidenlo(a), k)),
+                   vdiv255(vmul16(vwidenhi(a), k)));
+}
+
+SPAN_TARGET
+static void BlendLuma(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                      unsigned n, unsigned alpha)
+{
+    unsigned i = 0;
+
+    for (; i + vbytes <= n; i += vbytes) {
+        const vu8 a = valpha(vload(&srca[i]), alpha);
+
+        if (!vzero(a))
+            vstore(&dst[i], vblend(vload(&dst[i]), vload(&src[i]), a));
+    }
+    blend_spans_c.luma(&dst[i], &src[i], &srca[i], n - i, alpha);
+}
+
+SPAN_TARGET
+static void BlendChroma(uint8_t *dst, const uint8_t *src, const uint8_t *srca,
+                        unsigned n, unsigned alpha)
+{
+    unsigned i = 0;
+
+    /* The last source sample is at 2 * (n - 1), do not read beyond it */
+    for (; i + vbytes < n; i += vbytes) {
+        const uint8_t *s = &src[2 * i], *sa = &srca[2 * i];
+        const vu8 a = valpha(veven(vload(sa), vload(sa + vbytes)), alpha);
+
+        if (!vzero(a))
+            vstore(&dst[i], vblend(vload(&dst[i]),
+                                   veven(vload(s), vload(s + vbytes)), a));
+    }
+    blend_spans_c.chroma(&dst[i], &src[2 * i], &srca[2 * i], n - i, alpha);
+}
+
+SPAN_TARGET
+static void BlendChromaInterleaved(uint8_t *dst, const uint8_t *src0,
+                                   const uint8_t *src1, const uint8_t *srca,
+                                   unsigned n, unsigned alpha)
+{
+    unsigned i = 0;
+
+    for (; i + vbytes < n; i += vbytes) {
+        const uint8_t *s0 = &src0[2 * i], *s1 = &src1[2 * i];
+        const uint8_t *sa = &srca[2 * i];
+        const vu8 a = valpha(veven(vload(sa), vload(sa + vbytes)), alpha);
+
+        if (vzero(a))
+            continue;
+
+        uint8_t *d = &dst[2 * i];
+        const vu8 d0 = vload(d), d1 = vload(d + vbytes);
+        const vu8 c0 = vblend(veven(d0, d1), veven(vload(s0), vload(s0 + vbytes)), a);
+        const vu8 c1 = vblend(vodd(d0, d1), veven(vload(s1), vload(s1 + vbytes)), a);
+
+        vstore(d, vziplo(c0, c1));
+        vstore(d + vbytes, vziphi(c0, c1));
+    }
+    blend_spans_c.chroma_interleaved(&dst[2 * i], &src0[2 * i], &src1[2 * i],
+                                     &srca[2 * i], n - i, alpha);
+}
+
+/* Converts to RGB as yuv_to_rgb() does */
+SPAN_TARGET
+static inline void vrgb(vu8 *rgb, vu8 y, vu8 u, vu8 v)
+{
+    const vu16 y16 = vset16(16), c128 = vset16(128);
+    const vu16 ylo = vsub16(vwidenlo(y), y16), yhi = vsub16(vwidenhi(y), y16);
+    const vu16 ulo = vsub16(vwidenlo(u), c128), uhi = vsub16(vwidenhi(u), c128);
+    const vu16 vlo = vsub16(vwidenlo(v), c128), vhi = vsub16(vwidenhi(v), c128);
+
+    rgb[0] = vnarrow_s(vyuv(ylo, ulo, vlo, 0, SPAN_FIX_R_CR),
+                       vyuv(yhi, uhi, vhi, 0, SPAN_FIX_R_CR));
+    rgb[1] = vnarrow_s(vyuv(ylo, ulo, vlo, -SPAN_FIX_G_CB, -SPAN_FIX_G_CR),
+                       vyuv(yhi, uhi, vhi, -SPAN_FIX_G_CB, -SPAN_FIX_G_CR));
+    rgb[2] = vnarrow_s(vyuv(ylo, ulo, vlo, SPAN_FIX_B_CB, 0),
+                       vyuv(yhi, uhi, vhi, SPAN_FIX_B_CB, 0));
+}
+
+/* Packs 4 planes of bytes into vbytes / 4 pixels of 4 bytes, 4 times */
+SPAN_TARGET
+static inline void vpack4(vu8 *out, const vu8 *c)
+{
+    const vu8 lo01 = vziplo(c[0], c[1]), hi01 = vziphi(c[0], c[1]);
+    const vu8 lo23 = vziplo(c[2], c[3]), hi23 = vziphi(c[2], c[3]);
+
+    out[0] = vziplo16(lo01, lo23);
+    out[1] = vziphi16(lo01, lo23);
+    out[2] = vziplo16(hi01, hi23);
+    out[3] = vziphi16(hi01, hi23);
+}
+
+SPAN_TARGET
+static void BlendRGB32(uint8_t *dst, const uint8_t *y, const uint8_t *u,
+                       const uint8_t *v, const uint8_t *srca, unsigned n,
+                       unsigned alpha, const unsigned offsets[3])
+{
+    const vu8 zero = vnarrow(vset16(0), vset16(0));
+    unsigned i = 0;
+
+    for (; i + vbytes <= n; i += vbytes) {
+        const vu8 a = valpha(vload(&srca[i]), alpha);
+
+        if (vzero(a))
+            continue;
+
+        vu8 rgb[3], c[4] = { zero, zero, zero, zero }, ca[4] = { zero, zero, zero, zero };
+        vu8 s[4], sa[4];
+
+        vrgb(rgb, vload(&y[i]), vload(&u[i]), vload(&v[i]));
+        for (unsigned k = 0; k < 3; k++) {
+            c[offsets[k]] = rgb[k];
+            ca[offsets[k]] = a;
+        }
+        vpack4(s, c);
+        vpack4(sa, ca);
+
+        uint8_t *d = &dst[4 * i];
+        for (unsigned k = 0; k < 4; k++)
+            vstore(d + k * vbytes, vblend(vload(d + k * vbytes), s[k], sa[k]));
+    }
+    blend_spans_c.rgb32(&dst[4 * i], &y[i], &u[i], &v[i], &srca[i], n - i,
+                        alpha, offsets);
+}
+
+static const struct blend_spans blend_spans_simd = {
+    BlendLuma,
+    BlendChroma,
+    BlendChromaInterleaved,
+    BlendRGB32,
+};
@@ -56,17 +56,20 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
-#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
+#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto. " \
+    "A synthetic full HD picture is used if none is given.")
 
-#define BASE_CHROMA_TEXT N_("Chroma for the base image")
-#define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
+#define BASE_CHROMA_TEXT N_("Chromas for the base image")
+#define BASE_CHROMA_LONGTEXT N_("Comma separated list of the chromas which " \
+    "the base image will be loaded in")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
-#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
+#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image. " \
+    "A synthetic full HD subtitle-like picture is used if none is given.")
 
-#define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
-#define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
-                                 " in")
+#define BLEND_CHROMA_TEXT N_("Chromas for the blend image")
+#define BLEND_CHROMA_LONGTEXT N_("Comma separated list of the chromas which " \
+    "the blend image will be loaded in")
 
 #define CFG_PREFIX "blendbench-"
 
@@ -84,7 +87,7 @@ vlc_module_begin ()
     set_section( N_("Base image"), NULL )
     add_loadfile(CFG_PREFIX "base-image", NULL,
                  BASE_IMAGE_TEXT, BASE_IMAGE_LONGTEXT)
-    add_string( CFG_PREFIX "base-chroma", "I420", BASE_CHROMA_TEXT,
+    add_string( CFG_PREFIX "base-chroma", "I420,NV12,RV32", BASE_CHROMA_TEXT,
               BASE_CHROMA_LONGTEXT )
 
     set_section( N_("Blend image"), NULL )
@@ -101,6 +104,10 @@ static const char *const ppsz_filter_options[] = {
     "blend-chroma", NULL
 };
 
+/* Size of the synthetic pictures */
+#define SYNTH_WIDTH  1920
+#define SYNTH_HEIGHT 1080
+
 /*****************************************************************************
  * filter_sys_t: filter method descriptor
  *****************************************************************************/
@@ -109,37 +116,107 @@ typedef struct
     bool b_done;
     int i_loops, i_alpha;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
+    char *psz_base_image;
+    char *psz_blend_image;
 
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    char *psz_base_chromas;
+    char *psz_blend_chromas;
 } filter_sys_t;
 
-static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
-                                 vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
+static vlc_fourcc_t blendbench_ParseChroma( const char *psz_chroma )
+{
+    if( strlen( psz_chroma ) != 4 )
+        return 0;
+    return VLC_FOURCC( psz_chroma[0], psz_chroma[1], psz_chroma[2],
+                       psz_chroma[3] );
+}
+
+static picture_t *blendbench_LoadImage( vlc_object_t *p_this,
+                                        vlc_fourcc_t i_chroma,
+                                        const char *psz_file,
+                                        const char *psz_name )
 {
     image_handler_t *p_image;
     video_format_t fmt_out;
+    picture_t *p_pic;
 
     video_format_Init( &fmt_out, i_chroma );
 
     p_image = image_HandlerCreate( p_this );
-    *pp_pic = image_ReadUrl( p_image, psz_file, &fmt_out );
+    p_pic = image_ReadUrl( p_image, psz_file, &fmt_out );
     video_format_Clean( &fmt_out );
     image_HandlerDelete( p_image );
 
-    if( *pp_pic == NULL )
+    if( p_pic == NULL )
     {
         msg_Err( p_this, "Unable to load %s image", psz_name );
-        return VLC_EGENERIC;
+        return NULL;
     }
 
     msg_Dbg( p_this, "%s image has dim %d x %d (Y plane)", psz_name,
-             (*pp_pic)->p[Y_PLANE].i_visible_pitch,
-             (*pp_pic)->p[Y_PLANE].i_visible_lines );
+             p_pic->p[Y_PLANE].i_visible_pitch,
+             p_pic->p[Y_PLANE].i_visible_lines );
 
-    return VLC_SUCCESS;
+    return p_pic;
+}
+
+/* Mostly transparent with opaque and antialiased areas, as subtitles */
+static uint8_t blendbench_SynthAlpha( unsigned x, unsigned y )
+{
+    switch( (x / 64 + y / 16) % 4 )
+    {
+        case 0:
+        case 1:
+            return 0x00;
+        case 2:
+            return 0xff;
+        default:
+            return x * 4;
+    }
+}
+
+static picture_t *blendbench_SynthImage( vlc_object_t *p_this,
+                                         vlc_fourcc_t i_chroma,
+                                         const char *psz_name )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    fmt.i_width = fmt.i_visible_width = SYNTH_WIDTH;
+    fmt.i_height = fmt.i_visible_height = SYNTH_HEIGHT;
+    fmt.i_sar_num = fmt.i_sar_den = 1;
+    video_format_FixRgb( &fmt );
+
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    video_format_Clean( &fmt );
+    if( p_pic == NULL )
+    {
+        msg_Err( p_this, "Unable to create %s image", psz_name );
+        return NULL;
+    }
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        const bool b_alpha = i_chroma == VLC_CODEC_YUVA && i == A_PLANE;
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = b_alpha
+                    ? blendbench_SynthAlpha( x, y )
+                    : (uint8_t)(x + 2 * y + 64 * i);
+    }
+    return p_pic;
+}
+
+static picture_t *blendbench_GetImage( vlc_object_t *p_this,
+                                       vlc_fourcc_t i_chroma,
+                                       const char *psz_file,
+                                       const char *psz_name )
+{
+    if( psz_file != NULL && *psz_file != '\0' )
+        return blendbench_LoadImage( p_this, i_chroma, psz_file, psz_name );
+    return blendbench_SynthImage( p_this, i_chroma, psz_name );
 }
 
 static const struct vlc_filter_operations filter_ops =
@@ -153,8 +230,6 @@ static const struct vlc_filter_operations filter_ops =
 static int Create( filter_t *p_filter )
 {
     filter_sys_t *p_sys;
-    char *psz_temp, *psz_cmd;
-    int i_ret;
 
     /* Allocate structure */
     p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
@@ -175,38 +250,19 @@ static int Create( filter_t *p_filter )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
-
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
-        VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( VLC_OBJECT(p_filter), &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
-    {
-        free( p_sys );
-        return i_ret;
-    }
-
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = !psz_temp || strlen( psz_temp ) != 4
-        ? 0 : VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    i_ret = blendbench_LoadImage( VLC_OBJECT(p_filter), &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                                  psz_cmd, "Blend" );
-
-    free( psz_temp );
-    free( psz_cmd );
-
-    if( i_ret != VLC_SUCCESS )
+    p_sys->psz_base_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
+    p_sys->psz_base_chromas =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
+    p_sys->psz_blend_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
+    p_sys->psz_blend_chromas =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-chroma" );
+
+    if( p_sys->psz_base_chromas == NULL || p_sys->psz_blend_chromas == NULL )
     {
-        picture_Release( p_sys->p_base_image );
-        free( p_sys );
-
-        return VLC_EGENERIC;
+        Destroy( p_filter );
+        return VLC_ENOMEM;
     }
 
     return VLC_SUCCESS;
@@ -219,59 +275,120 @@ static void Destroy( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_base_chromas );
+    free( p_sys->psz_blend_image );
+    free( p_sys->psz_blend_chromas );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Bench: blends one image onto the other and reports the speed
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void Bench( filter_t *p_filter, picture_t *p_base, picture_t *p_blend )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
-
-    if( p_sys->b_done )
-        return p_pic;
-
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
-    if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
-    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
-    if( !p_blend->p_module )
+    const vlc_fourcc_t i_base = p_base->format.i_chroma;
+    const vlc_fourcc_t i_src = p_blend->format.i_chroma;
+    filter_t *p_blender;
+
+    p_blender = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_blender )
+        return;
+
+    p_blender->fmt_out.video = p_base->format;
+    p_blender->fmt_in.video = p_blend->format;
+    p_blender->p_module = module_need( p_blender, "video blending", NULL, false );
+    if( !p_blender->p_module )
     {
-        picture_Release( p_pic );
-        vlc_object_delete(p_blend);
-        return NULL;
+        msg_Warn( p_filter, "%4.4s -> %4.4s: no blending module",
+                  (const char *)&i_src, (const char *)&i_base );
+        vlc_object_delete(p_blender);
+        return;
     }
-    assert( p_blend->ops != NULL );
+    assert( p_blender->ops != NULL );
 
     vlc_tick_t time = vlc_tick_now();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        filter_Blend( p_blend, p_sys->p_base_image,
-                      0, 0, p_sys->p_blend_image, p_sys->i_alpha );
+        filter_Blend( p_blender, p_base, 0, 0, p_blend, p_sys->i_alpha );
     }
     time = vlc_tick_now() - time;
+    if( time <= 0 )
+        time = 1;
 
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              secf_from_vlc_tick(time) );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * CLOCK_FREQ,
-              (float) p_sys->i_loops / time * CLOCK_FREQ *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+    const double f_pixels = (double)
+        __MIN( p_blend->format.i_visible_width, p_base->format.i_visible_width ) *
+        __MIN( p_blend->format.i_visible_height, p_base->format.i_visible_height );
+    const double f_speed = (double) p_sys->i_loops / time * CLOCK_FREQ;
 
-    filter_Close( p_blend );
-    module_unneed( p_blend, p_blend->p_module );
+    msg_Dbg( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
+             secf_from_vlc_tick(time) );
+    msg_Info( p_filter, "%4.4s -> %4.4s: %.1f images/s, %.1f Mpixels/s",
+              (const char *)&i_src, (const char *)&i_base,
+              f_speed, f_speed * f_pixels / 1e6 );
 
-    vlc_object_delete(p_blend);
+    filter_Close( p_blender );
+    module_unneed( p_blender, p_blender->p_module );
+
+    vlc_object_delete(p_blender);
+}
 
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    char *psz_base_chromas, *psz_base_state, *psz_base;
+
+    if( p_sys->b_done )
+        return p_pic;
     p_sys->b_done = true;
+
+    psz_base_chromas = strdup( p_sys->psz_base_chromas );
+    if( psz_base_chromas == NULL )
+        return p_pic;
+
+    /* Every base chroma against every blend chroma */
+    for( psz_base = strtok_r( psz_base_chromas, ",", &psz_base_state );
+         psz_base != NULL;
+         psz_base = strtok_r( NULL, ",", &psz_base_state ) )
+    {
+        picture_t *p_base =
+            blendbench_GetImage( VLC_OBJECT(p_filter),
+                                 blendbench_ParseChroma( psz_base ),
+                                 p_sys->psz_base_image, "Base" );
+        if( p_base == NULL )
+            continue;
+
+        char *psz_blend_chromas = strdup( p_sys->psz_blend_chromas );
+        char *psz_blend_state, *psz_blend;
+
+        if( psz_blend_chromas == NULL )
+        {
+            picture_Release( p_base );
+            break;
+        }
+
+        for( psz_blend = strtok_r( psz_blend_chromas, ",", &psz_blend_state );
+             psz_blend != NULL;
+             psz_blend = strtok_r( NULL, ",", &psz_blend_state ) )
+        {
+            picture_t *p_blend =
+                blendbench_GetImage( VLC_OBJECT(p_filter),
+                                     blendbench_ParseChroma( psz_blend ),
+                                     p_sys->psz_blend_image, "Blend" );
+            if( p_blend == NULL )
+                continue;
+
+            Bench( p_filter, p_base, p_blend );
+            picture_Release( p_blend );
+        }
+        free( psz_blend_chromas );
+        picture_Release( p_base );
+    }
+    free( psz_base_chromas );
+
     return p_pic;
 }
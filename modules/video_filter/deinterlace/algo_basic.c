@@ -32,6 +32,7 @@
 #include <vlc_common.h>
 #include <vlc_picture.h>
 #include <vlc_filter.h>
+#include <vlc_slices.h>
 
 #include "merge.h"
 #include "deinterlace.h" /* definition of p_sys, needed for Merge() */
@@ -126,61 +127,78 @@ int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
 }
 
 /*****************************************************************************
- * RenderLinear: BOB with linear interpolation
+ * Slice threading of the merging algorithms
  *****************************************************************************/
 
-int RenderLinear( filter_t *p_filter,
-                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+struct merge_slices
 {
-    VLC_UNUSED(order);
-    int i_plane;
-
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
+    filter_sys_t *p_sys;
+    picture_t *p_outpic;
+    const picture_t *p_pic;
+    int i_field;
+};
+
+/* The bands are split on the output luma rows, aligned so that the chroma
+ * bands of 4:2:0 pictures hold whole row pairs too */
+#define MERGE_SLICE_ALIGN 4
+
+static void RenderMerged( filter_sys_t *p_sys, picture_t *p_outpic,
+                          const picture_t *p_pic, vlc_slice_cb cb, int i_field )
+{
+    struct merge_slices slices = {
+        .p_sys = p_sys, .p_outpic = p_outpic, .p_pic = p_pic,
+        .i_field = i_field,
+    };
 
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+    vlc_slices_Run( p_sys->slices, p_outpic->p[0].i_visible_lines,
+                    MERGE_SLICE_ALIGN, 0, cb, &slices );
+}
 
-            p_out += p_outpic->p[i_plane].i_pitch;
+/*****************************************************************************
+ * RenderLinear: BOB with linear interpolation
+ *****************************************************************************/
 
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+static void LinearSlice( void *opaque, const struct vlc_slice *slice )
+{
+    const struct merge_slices *slices = opaque;
+    filter_sys_t *p_sys = slices->p_sys;
+    const picture_t *p_pic = slices->p_pic;
+    picture_t *p_outpic = slices->p_outpic;
 
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
+    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    {
+        const plane_t *p_in = &p_pic->p[i_plane];
+        plane_t *p_out = &p_outpic->p[i_plane];
+        const unsigned i_lines = p_out->i_visible_lines;
+        struct vlc_slice band;
 
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+        vlc_slice_Scale( slice, p_outpic->p[0].i_visible_lines, i_lines,
+                         &band );
 
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
+        for( unsigned y = band.start; y < band.end; y++ )
         {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+            uint8_t *p_line = &p_out->p_pixels[y * p_out->i_pitch];
+            const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+            /* Lines of the field, and the first and last lines of the other
+             * one: simple copy. Others: mean of their neighbours. */
+            if( (int)(y % 2) == slices->i_field || y == 0 || y + 1 >= i_lines )
+                memcpy( p_line, p_src, p_in->i_pitch );
+            else
+                Merge( p_line, p_src - p_in->i_pitch, p_src + p_in->i_pitch,
+                       p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderLinear( filter_t *p_filter,
+                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+{
+    VLC_UNUSED(order);
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    RenderMerged( p_sys, p_outpic, p_pic, LinearSlice, i_field );
     return VLC_SUCCESS;
 }
 
@@ -188,34 +206,39 @@ int RenderLinear( filter_t *p_filter,
  * RenderMean: Half-resolution blender
  *****************************************************************************/
 
-int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void MeanSlice( void *opaque, const struct vlc_slice *slice )
 {
-    int i_plane;
+    const struct merge_slices *slices = opaque;
+    filter_sys_t *p_sys = slices->p_sys;
+    const picture_t *p_pic = slices->p_pic;
+    picture_t *p_outpic = slices->p_outpic;
 
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
+        const plane_t *p_in = &p_pic->p[i_plane];
+        plane_t *p_out = &p_outpic->p[i_plane];
+        struct vlc_slice band;
 
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        vlc_slice_Scale( slice, p_outpic->p[0].i_visible_lines,
+                         p_out->i_visible_lines, &band );
 
         /* All lines: mean value */
-        for( ; p_out < p_out_end ; )
+        for( unsigned y = band.start; y < band.end; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
+            const uint8_t *p_src = &p_in->p_pixels[2 * y * p_in->i_pitch];
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
+            Merge( &p_out->p_pixels[y * p_out->i_pitch], p_src,
+                   p_src + p_in->i_pitch, p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    RenderMerged( p_sys, p_outpic, p_pic, MeanSlice, 0 );
     return VLC_SUCCESS;
 }
 
@@ -223,37 +246,41 @@ int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
  * RenderBlend: Full-resolution blender
  *****************************************************************************/
 
-int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void BlendSlice( void *opaque, const struct vlc_slice *slice )
 {
-    int i_plane;
+    const struct merge_slices *slices = opaque;
+    filter_sys_t *p_sys = slices->p_sys;
+    const picture_t *p_pic = slices->p_pic;
+    picture_t *p_outpic = slices->p_outpic;
 
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
+        const plane_t *p_in = &p_pic->p[i_plane];
+        plane_t *p_out = &p_outpic->p[i_plane];
+        struct vlc_slice band;
 
-        /* First line: simple copy */
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        p_out += p_outpic->p[i_plane].i_pitch;
+        vlc_slice_Scale( slice, p_outpic->p[0].i_visible_lines,
+                         p_out->i_visible_lines, &band );
 
-        /* Remaining lines: mean value */
-        for( ; p_out < p_out_end ; )
+        for( unsigned y = band.start; y < band.end; y++ )
         {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in  += p_pic->p[i_plane].i_pitch;
+            uint8_t *p_line = &p_out->p_pixels[y * p_out->i_pitch];
+            const uint8_t *p_src = &p_in->p_pixels[y * p_in->i_pitch];
+
+            /* First line: simple copy. Remaining lines: mean value */
+            if( y == 0 )
+                memcpy( p_line, p_src, p_in->i_pitch );
+            else
+                Merge( p_line, p_src - p_in->i_pitch, p_src, p_in->i_pitch );
         }
     }
     EndMerge();
+}
+
+int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    RenderMerged( p_sys, p_outpic, p_pic, BlendSlice, 0 );
     return VLC_SUCCESS;
 }
@@ -32,6 +32,7 @@
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
 #include <vlc_filter.h>
+#include <vlc_slices.h>
 
 #include "deinterlace.h" /* filter_sys_t  */
 #include "common.h"      /* FFMIN3 et al. */
@@ -46,6 +47,81 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+/* Bands are split on the luma rows, aligned so that the chroma bands of
+ * 4:2:0 pictures hold the duplicated first and last lines along with their
+ * sources. Lines are interpolated from the input pictures only, so that the
+ * bands need no overlap. */
+#define YADIF_SLICE_ALIGN 4
+
+struct yadif_slices
+{
+    picture_t *p_dst;
+    const picture_t *p_prev, *p_cur, *p_next;
+    void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                   int w, int prefs, int mrefs, int parity, int mode);
+    int i_field;
+    int yadif_parity;
+};
+
+static void YadifSlice( void *opaque, const struct vlc_slice *slice )
+{
+    const struct yadif_slices *slices = opaque;
+    picture_t *p_dst = slices->p_dst;
+    const int i_field = slices->i_field;
+    const int yadif_parity = slices->yadif_parity;
+
+    for( int n = 0; n < p_dst->i_planes; n++ )
+    {
+        const plane_t *prevp = &slices->p_prev->p[n];
+        const plane_t *curp  = &slices->p_cur->p[n];
+        const plane_t *nextp = &slices->p_next->p[n];
+        plane_t *dstp        = &p_dst->p[n];
+        struct vlc_slice band;
+
+        vlc_slice_Scale( slice, p_dst->p[0].i_visible_lines,
+                         dstp->i_visible_lines, &band );
+
+        int y_start = __MAX( (int)band.start, 1 );
+        int y_end = __MIN( (int)band.end, dstp->i_visible_lines - 1 );
+
+        for( int y = y_start; y < y_end; y++ )
+        {
+            if( (y % 2) == i_field  ||  yadif_parity == 2 )
+            {
+                memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                            &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+            }
+            else
+            {
+                int mode;
+                /* Spatial checks only when enough data */
+                mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+                assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+                slices->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                                &prevp->p_pixels[y * prevp->i_pitch],
+                                &curp->p_pixels[y * curp->i_pitch],
+                                &nextp->p_pixels[y * nextp->i_pitch],
+                                dstp->i_visible_pitch,
+                                y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                                y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                                yadif_parity,
+                                mode );
+            }
+
+            /* We duplicate the first and last lines */
+            if( y == 1 )
+                memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+            else if( y == dstp->i_visible_lines - 2 )
+                memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                           &dstp->p_pixels[ y    * dstp->i_pitch],
+                           dstp->i_pitch);
+        }
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -109,65 +185,27 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     if( p_prev && p_cur && p_next )
     {
         /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        struct yadif_slices slices = {
+            .p_dst = p_dst,
+            .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .i_field = i_field, .yadif_parity = yadif_parity,
+        };
 
 #if defined(HAVE_X86ASM)
         if( vlc_CPU_SSSE3() )
-            filter = vlcpriv_yadif_filter_line_ssse3;
+            slices.filter = vlcpriv_yadif_filter_line_ssse3;
         else
         if( vlc_CPU_SSE2() )
-            filter = vlcpriv_yadif_filter_line_sse2;
+            slices.filter = vlcpriv_yadif_filter_line_sse2;
         else
 #endif
-            filter = yadif_filter_line_c;
+            slices.filter = yadif_filter_line_c;
 
         if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
-
-        for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
+            slices.filter = yadif_filter_line_c_16bit;
 
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+        vlc_slices_Run( p_sys->slices, p_dst->p[0].i_visible_lines,
+                        YADIF_SLICE_ALIGN, 0, YadifSlice, &slices );
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
@@ -477,8 +477,11 @@ int Mouse( filter_t *p_filter,
  */
 static void Close( filter_t *p_filter )
 {
+    filter_sys_t *p_sys = p_filter->p_sys;
+
     Flush( p_filter );
-    free( p_filter->p_sys );
+    vlc_slices_Delete( p_sys->slices );
+    free( p_sys );
 }
 
 static const struct vlc_filter_operations filter_ops = {
@@ -536,6 +539,12 @@ notsupp:
         return VLC_ENOMEM;
 
     p_sys->chroma = chroma;
+    p_sys->slices = vlc_slices_New( p_filter );
+    if( !p_sys->slices )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
 
     InitDeinterlacingContext( &p_sys->context );
 
@@ -546,6 +555,7 @@ notsupp:
     if (ret != VLC_SUCCESS)
     {
         free(psz_mode);
+        vlc_slices_Delete(p_sys->slices);
         free(p_sys);
         return ret;
     }
@@ -35,6 +35,7 @@
 #include <vlc_cpu.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_slices.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -100,6 +101,8 @@ typedef struct
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    size_t           buf_size; /* per slice */
+    vlc_slices_t     *slices;
 } filter_sys_t;
 
 static int Open(filter_t *filter)
@@ -116,6 +119,12 @@ static int Open(filter_t *filter)
     if (!sys)
         return VLC_ENOMEM;
 
+    sys->slices = vlc_slices_New(filter);
+    if (!sys->slices) {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+
     vlc_mutex_init(&sys->lock);
     sys->chroma   = chroma;
     sys->strength = var_CreateGetFloatCommand(filter,   CFG_PREFIX "strength");
@@ -154,9 +163,60 @@ static void Close(filter_t *filter)
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     aligned_free(sys->cfg.buf);
+    vlc_slices_Delete(sys->slices);
     free(sys);
 }
 
+struct gradfun_slices
+{
+    filter_sys_t *sys;
+    picture_t *src;
+    picture_t *dst;
+    int w[PICTURE_PLANE_MAX];
+    int h[PICTURE_PLANE_MAX];
+    int r[PICTURE_PLANE_MAX]; /* 0 if the plane is copied */
+};
+
+static void FilterSlice(void *opaque, const struct vlc_slice *slice)
+{
+    const struct gradfun_slices *slices = opaque;
+    filter_sys_t *sys = slices->sys;
+    uint16_t *buf = sys->cfg.buf + slice->index * sys->buf_size;
+
+    for (int i = 0; i < slices->dst->i_planes; i++) {
+        const plane_t *srcp = &slices->src->p[i];
+        plane_t       *dstp = &slices->dst->p[i];
+        int h = slices->h[i];
+        int r = slices->r[i];
+        struct vlc_slice band;
+
+        vlc_slice_Scale(slice, slices->h[0], h, &band);
+        if (band.start >= band.end)
+            continue;
+
+        if (r == 0) {
+            for (unsigned y = band.start; y < band.end; y++)
+                memcpy(&dstp->p_pixels[y * dstp->i_pitch],
+                       &srcp->p_pixels[y * srcp->i_pitch],
+                       __MIN(dstp->i_visible_pitch, srcp->i_visible_pitch));
+            continue;
+        }
+
+        /* The lines above and below the slice feed the blur, the plane
+         * filtering needs more than 2 radii */
+        int first = band.first;
+        int last  = __MIN(h, (int)band.end + r);
+        if (last - first <= 2 * r)
+            first = __MAX(0, last - 2 * r - 1) & ~7;
+
+        filter_plane(&sys->cfg, buf,
+                     &dstp->p_pixels[first * dstp->i_pitch],
+                     &srcp->p_pixels[first * srcp->i_pitch],
+                     slices->w[i], last - first, dstp->i_pitch, srcp->i_pitch,
+                     r, band.start - first, band.end - first);
+    }
+}
+
 static void Filter(filter_t *filter, picture_t *src, picture_t *dst)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -172,27 +232,44 @@ static void Filter(filter_t *filter, picture_t *src, picture_t *dst)
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
         cfg->radius = radius;
-        cfg->buf    = aligned_alloc(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
+        aligned_free(cfg->buf);
+        /* one buffer per slice, each 16 bytes aligned */
+        sys->buf_size = ((((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32 + 7) & ~7);
+        cfg->buf    = aligned_alloc(16, vlc_slices_Count(sys->slices) *
+                                        sys->buf_size * sizeof(*cfg->buf));
     }
 
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
+    struct gradfun_slices slices = { .sys = sys, .src = src, .dst = dst };
+    const vlc_chroma_description_t *chroma = sys->chroma;
+    unsigned align = 8, overlap = 0;
 
-        const vlc_chroma_description_t *chroma = sys->chroma;
+    for (int i = 0; i < dst->i_planes; i++) {
         int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
         int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
         int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
                  cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
         r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+
         if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+            slices.w[i] = w;
+            slices.h[i] = h;
+            slices.r[i] = r;
         } else {
-            plane_CopyPixels(dstp, srcp);
+            slices.h[i] = __MIN(src->p[i].i_visible_lines,
+                                dst->p[i].i_visible_lines);
+            slices.r[i] = 0;
         }
+
+        /* The dithering and the blur restart from lines multiple of 8 in
+         * every plane, at least a radius above the slice */
+        unsigned scale = chroma->p[i].h.den / chroma->p[i].h.num;
+        align   = __MAX(align, 8 * scale);
+        overlap = __MAX(overlap, ((slices.r[i] + 7) & ~7) * scale);
     }
+    overlap = (overlap + align - 1) / align * align;
+
+    vlc_slices_Run(sys->slices, slices.h[0], align, overlap,
+                   FilterSlice, &slices);
 }
 
 static int Callback(vlc_object_t *object, char const *cmd,
@@ -32,6 +32,7 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_slices.h>
 #include "filter_picture.h"
 
 
@@ -81,6 +82,10 @@ static const char *const filter_options[] = {
     "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", NULL
 };
 
+/* Lines above each slice run through the spatial low pass to prime its
+ * vertical state. The temporal only filter needs none. */
+#define SLICE_OVERLAP 16
+
 /*****************************************************************************
  * filter_sys_t
  *****************************************************************************/
@@ -88,6 +93,8 @@ typedef struct
 {
     const vlc_chroma_description_t *chroma;
     int w[3], h[3];
+    int wmax;
+    vlc_slices_t *slices;
 
     struct vf_priv_s cfg;
     bool   b_recalc_coefs;
@@ -134,8 +141,17 @@ static int Open(filter_t *filter)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
+    sys->wmax = wmax;
+    sys->slices = vlc_slices_New(filter);
+    if (!sys->slices) {
+        free(sys);
+        return VLC_ENOMEM;
+    }
+    /* one line per slice */
+    cfg->Line = vlc_alloc(vlc_slices_Count(sys->slices),
+                          wmax*sizeof(unsigned int));
     if (!cfg->Line) {
+        vlc_slices_Delete(sys->slices);
         free(sys);
         return VLC_ENOMEM;
     }
@@ -184,12 +200,46 @@ static void Close(filter_t *filter)
         free(cfg->Frame[i]);
     }
     free(cfg->Line);
+    vlc_slices_Delete(sys->slices);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+struct denoise_slices
+{
+    filter_sys_t *sys;
+    picture_t *src;
+    picture_t *dst;
+};
+
+static void DenoiseSlice(void *opaque, const struct vlc_slice *slice)
+{
+    const struct denoise_slices *slices = opaque;
+    filter_sys_t *sys = slices->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    unsigned int *line = &cfg->Line[slice->index * sys->wmax];
+
+    for (int i = 0; i < 3; ++i) {
+        const plane_t *srcp = &slices->src->p[i];
+        plane_t *dstp = &slices->dst->p[i];
+        int *spat = cfg->Coefs[i ? 2 : 0];
+        int *temp = cfg->Coefs[i ? 3 : 1];
+        struct vlc_slice band;
+
+        vlc_slice_Scale(slice, sys->h[0], sys->h[i], &band);
+        if (band.start >= band.end)
+            continue;
+
+        deNoise(&srcp->p_pixels[band.first * srcp->i_pitch],
+                &dstp->p_pixels[band.first * dstp->i_pitch],
+                line, &cfg->Frame[i][band.first * sys->w[i]], sys->w[i],
+                band.start - band.first, band.end - band.first,
+                srcp->i_pitch, dstp->i_pitch, spat, spat, temp);
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -219,32 +269,21 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
-    {
-        picture_Release( src );
-        picture_Release( dst );
-        return NULL;
+    for (int i = 0; i < 3; ++i) {
+        if (!deNoiseInit(src->p[i].p_pixels, &cfg->Frame[i],
+                         sys->w[i], sys->h[i], src->p[i].i_pitch)) {
+            picture_Release( src );
+            picture_Release( dst );
+            return NULL;
+        }
     }
 
+    struct denoise_slices slices = { .sys = sys, .src = src, .dst = dst };
+    bool spatial = cfg->Coefs[0][0] || cfg->Coefs[2][0];
+
+    vlc_slices_Run(sys->slices, sys->h[0], 2, spatial ? SLICE_OVERLAP : 0,
+                   DenoiseSlice, &slices);
+
     return CopyInfoAndRelease(dst, src);
 }
 
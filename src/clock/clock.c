@@ -528,6 +528,11 @@ void vlc_clock_Reset(vlc_clock_t *clock)
     clock->reset(clock);
 }
 
+const char *vlc_clock_GetTrackId(const vlc_clock_t *clock)
+{
+    return clock->track_str_id;
+}
+
 vlc_tick_t vlc_clock_SetDelay(vlc_clock_t *clock, vlc_tick_t delay)
 {
     return clock->set_delay(clock, delay);
@@ -162,6 +162,13 @@ vlc_tick_t vlc_clock_UpdateVideo(vlc_clock_t *clock, vlc_tick_t system_now,
  */
 void vlc_clock_Reset(vlc_clock_t *clock);
 
+/**
+ * This function returns the identifier of the track of the clock
+ *
+ * @return the elementary stream identifier, or NULL if there is none
+ */
+const char *vlc_clock_GetTrackId(const vlc_clock_t *clock);
+
 /**
  * This functions change the clock delay
  *
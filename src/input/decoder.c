@@ -48,6 +48,7 @@
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
 #include "../clock/clock.h"
+#include "../misc/spsc_fifo.h"
 #include "input_internal.h"
 #include "decoder.h"
 #include "resource.h"
@@ -96,8 +97,13 @@ struct vlc_input_decoder_t
     vlc_meta_t     *p_description;
     atomic_int     reload;
 
-    /* fifo */
+    /* fifo: the input blocks go through the lock-free queue, or else the
+     * locked FIFO if the former is full (or the latter is not empty, to keep
+     * the blocks in order). The FIFO lock also protects the decoder thread
+     * control state, and the decoder thread sleeps on the queue. */
+    struct vlc_spsc_fifo *p_queue;
     block_fifo_t *p_fifo;
+    bool b_overflow; /* producer side only */
 
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
@@ -186,6 +192,9 @@ struct vlc_input_decoder_t
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((vlc_tick_t)(DEFAULT_PTS_DELAY * 30))
 
+/* Input blocks beyond this count go to the locked FIFO */
+#define DECODER_QUEUE_SIZE 1024
+
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION   VLC_TICK_FROM_MS(200)
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
@@ -1005,11 +1014,13 @@ static void DecoderPlayCc( vlc_input_decoder_t *p_owner, vlc_frame_t *p_cc,
 
         if( i_bitmap > 1 )
         {
-            block_FifoPut( p_ccowner->p_fifo, block_Duplicate(p_cc) );
+            vlc_frame_t *p_dup = block_Duplicate(p_cc);
+            if( p_dup != NULL )
+                vlc_input_decoder_Decode( p_ccowner, p_dup, false );
         }
         else
         {
-            block_FifoPut( p_ccowner->p_fifo, p_cc );
+            vlc_input_decoder_Decode( p_ccowner, p_cc, false );
             p_cc = NULL; /* was last dec */
         }
     }
@@ -1146,6 +1157,8 @@ static void ModuleThread_QueueVideo( decoder_t *p_dec, picture_t *p_pic )
     {
         vlc_tracer_TraceStreamPTS( tracer, "DEC", p_owner->psz_id,
                             "OUT", p_pic->date );
+        vlc_tracer_TraceSpanEnd( tracer, "decode", p_owner->psz_id,
+                                 p_pic->date );
     }
     int success = ModuleThread_PlayVideo( p_owner, p_pic );
 
@@ -1281,6 +1294,8 @@ static void ModuleThread_QueueAudio( decoder_t *p_dec, vlc_frame_t *p_aout_buf )
     {
         vlc_tracer_TraceStreamDTS( tracer, "DEC", p_owner->psz_id, "OUT",
                             p_aout_buf->i_pts, p_aout_buf->i_dts );
+        vlc_tracer_TraceSpanEnd( tracer, "decode", p_owner->psz_id,
+                                 p_aout_buf->i_pts );
     }
     int success = ModuleThread_PlayAudio( p_owner, p_aout_buf );
 
@@ -1325,6 +1340,8 @@ static void ModuleThread_QueueSpu( decoder_t *p_dec, subpicture_t *p_spu )
     {
         vlc_tracer_TraceStreamPTS( tracer, "DEC", p_owner->psz_id,
                             "OUT", p_spu->i_start );
+        vlc_tracer_TraceSpanEnd( tracer, "decode", p_owner->psz_id,
+                                 p_spu->i_start );
     }
 
     /* The vout must be created from a previous decoder_NewSubpicture call. */
@@ -1356,6 +1373,8 @@ static void DecoderThread_DecodeBlock( vlc_input_decoder_t *p_owner, vlc_frame_t
     {
         vlc_tracer_TraceStreamDTS( tracer, "DEC", p_owner->psz_id, "IN",
                             frame->i_pts, frame->i_dts );
+        vlc_tracer_TraceSpanBegin( tracer, "decode", p_owner->psz_id,
+                                   frame->i_pts );
     }
 
     int ret = p_dec->pf_decode( p_dec, frame );
@@ -1640,6 +1659,39 @@ static void DecoderThread_ChangeDelay( vlc_input_decoder_t *p_owner, vlc_tick_t
     }
 }
 
+/* Sleeps until a block is queued or the control state changes */
+static void DecoderThread_Wait( vlc_input_decoder_t *p_owner, unsigned seq )
+{
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    vlc_spsc_fifo_Wait( p_owner->p_queue, seq );
+    vlc_fifo_Lock( p_owner->p_fifo );
+}
+
+/* Releases an input frame discarded before decoding */
+static void DecoderDiscardFrame( void *opaque, vlc_frame_t *frame )
+{
+    vlc_input_decoder_t *p_owner = opaque;
+    struct vlc_tracer *tracer = vlc_object_get_tracer( &p_owner->dec.obj );
+
+    if ( tracer != NULL )
+        vlc_tracer_TraceSpanEnd( tracer, "fifo", p_owner->psz_id,
+                                 frame->i_pts );
+    block_Release( frame );
+}
+
+static void DecoderDiscardChain( vlc_input_decoder_t *p_owner,
+                                 vlc_frame_t *chain )
+{
+    while( chain != NULL )
+    {
+        vlc_frame_t *next = chain->p_next;
+
+        chain->p_next = NULL;
+        DecoderDiscardFrame( p_owner, chain );
+        chain = next;
+    }
+}
+
 /**
  * The decoding main loop
  *
@@ -1657,6 +1709,9 @@ static void *DecoderThread( void *p_data )
 
     while( !p_owner->aborting )
     {
+        /* Any wake-up from now on interrupts the next wait */
+        unsigned seq = vlc_spsc_fifo_GetSequence( p_owner->p_queue );
+
         if( p_owner->flushing )
         {   /* Flush before/regardless of pause. We do not want to resume just
              * for the sake of flushing (glitches could otherwise happen). */
@@ -1725,21 +1780,24 @@ static void *DecoderThread( void *p_data )
         {   /* Wait for resumption from pause */
             p_owner->b_idle = true;
             vlc_cond_signal( &p_owner->wait_acknowledge );
-            vlc_fifo_Wait( p_owner->p_fifo );
+            DecoderThread_Wait( p_owner, seq );
             p_owner->b_idle = false;
             continue;
         }
 
         vlc_cond_signal( &p_owner->wait_fifo );
 
-        vlc_frame_t *frame = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        /* The overflow FIFO only contains blocks newer than the queue */
+        vlc_frame_t *frame = vlc_spsc_fifo_Pop( p_owner->p_queue );
+        if( frame == NULL )
+            frame = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
         if( frame == NULL )
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
                 p_owner->b_idle = true;
                 vlc_cond_signal( &p_owner->wait_acknowledge );
-                vlc_fifo_Wait( p_owner->p_fifo );
+                DecoderThread_Wait( p_owner, seq );
                 p_owner->b_idle = false;
                 continue;
             }
@@ -1749,6 +1807,14 @@ static void *DecoderThread( void *p_data )
 
         vlc_fifo_Unlock( p_owner->p_fifo );
 
+        if( frame != NULL )
+        {
+            struct vlc_tracer *tracer = vlc_object_get_tracer( &p_owner->dec.obj );
+            if ( tracer != NULL )
+                vlc_tracer_TraceSpanEnd( tracer, "fifo", p_owner->psz_id,
+                                         frame->i_pts );
+        }
+
         DecoderThread_ProcessInput( p_owner, frame );
 
         if( frame == NULL && p_owner->dec.fmt_in.i_cat == AUDIO_ES )
@@ -1880,12 +1946,21 @@ CreateDecoder( vlc_object_t *p_parent, const es_format_t *fmt,
     es_format_Init( &p_owner->fmt, fmt->i_cat, 0 );
 
     /* decoder fifo */
+    p_owner->p_queue = vlc_spsc_fifo_New( DECODER_QUEUE_SIZE );
+    if( unlikely(p_owner->p_queue == NULL) )
+    {
+        vlc_object_delete(p_dec);
+        return NULL;
+    }
+    vlc_spsc_fifo_SetDiscard( p_owner->p_queue, DecoderDiscardFrame, p_owner );
     p_owner->p_fifo = block_FifoNew();
     if( unlikely(p_owner->p_fifo == NULL) )
     {
+        vlc_spsc_fifo_Delete( p_owner->p_queue );
         vlc_object_delete(p_dec);
         return NULL;
     }
+    p_owner->b_overflow = false;
 
     vlc_mutex_init( &p_owner->lock );
     vlc_mutex_init( &p_owner->mouse_lock );
@@ -1991,6 +2066,10 @@ static void DeleteDecoder( vlc_input_decoder_t *p_owner, enum es_format_category
         vlc_video_context_Release( p_owner->vctx );
 
     /* Free all packets still in the decoder fifo. */
+    vlc_spsc_fifo_Delete( p_owner->p_queue );
+    vlc_fifo_Lock( p_owner->p_fifo );
+    DecoderDiscardChain( p_owner, vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    vlc_fifo_Unlock( p_owner->p_fifo );
     block_FifoRelease( p_owner->p_fifo );
 
     /* Cleanup */
@@ -2192,7 +2271,7 @@ void vlc_input_decoder_Delete( vlc_input_decoder_t *p_owner )
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->aborting = true;
     p_owner->flushing = true;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_spsc_fifo_Signal( p_owner->p_queue );
     vlc_fifo_Unlock( p_owner->p_fifo );
 
     /* Make sure we aren't waiting/decoding anymore */
@@ -2254,17 +2333,31 @@ void vlc_input_decoder_Delete( vlc_input_decoder_t *p_owner )
 void vlc_input_decoder_Decode( vlc_input_decoder_t *p_owner, vlc_frame_t *frame,
                                bool b_do_pace )
 {
-    vlc_fifo_Lock( p_owner->p_fifo );
+    struct vlc_spsc_fifo *p_queue = p_owner->p_queue;
+    /* The locked FIFO is empty unless overflowing, so there is no need to
+     * lock it in the common case. */
+    bool b_locked = p_owner->b_overflow;
+
+    if( b_locked )
+        vlc_fifo_Lock( p_owner->p_fifo );
+
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
         /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        size_t i_bytes = vlc_spsc_fifo_GetBytes( p_queue );
+        if( b_locked )
+            i_bytes += vlc_fifo_GetBytes( p_owner->p_fifo );
+
+        if( i_bytes > 400*1024*1024 )
         {
             msg_Warn( &p_owner->dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            vlc_spsc_fifo_Flush( p_queue );
+            if( b_locked )
+                DecoderDiscardChain( p_owner,
+                                     vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
             frame->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
     }
@@ -2273,12 +2366,41 @@ void vlc_input_decoder_Decode( vlc_input_decoder_t *p_owner, vlc_frame_t *frame,
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        if( !b_locked && vlc_spsc_fifo_GetCount( p_queue ) >= 10 )
+        {
+            vlc_fifo_Lock( p_owner->p_fifo );
+            b_locked = true;
+        }
+        /* The decoder thread dequeues with the FIFO lock held */
+        while( b_locked && vlc_spsc_fifo_GetCount( p_queue )
+                         + vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, frame );
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    struct vlc_tracer *tracer = vlc_object_get_tracer( &p_owner->dec.obj );
+    if ( tracer != NULL )
+        vlc_tracer_TraceSpanBegin( tracer, "fifo", p_owner->psz_id,
+                                   frame->i_pts );
+
+    /* The decoder thread only dequeues from the locked FIFO once the queue
+     * is empty: stop overflowing once the locked FIFO is empty. */
+    if( p_owner->b_overflow && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        p_owner->b_overflow = false;
+
+    if( p_owner->b_overflow || !vlc_spsc_fifo_Push( p_queue, frame ) )
+    {
+        if( !b_locked )
+        {
+            vlc_fifo_Lock( p_owner->p_fifo );
+            b_locked = true;
+        }
+        vlc_fifo_QueueUnlocked( p_owner->p_fifo, frame );
+        p_owner->b_overflow = true;
+        vlc_spsc_fifo_Signal( p_queue );
+    }
+
+    if( b_locked )
+        vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
 bool vlc_input_decoder_IsEmpty( vlc_input_decoder_t * p_owner )
@@ -2286,7 +2408,8 @@ bool vlc_input_decoder_IsEmpty( vlc_input_decoder_t * p_owner )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
+    if( vlc_spsc_fifo_GetCount( p_owner->p_queue ) > 0
+     || !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
         return false;
@@ -2324,7 +2447,7 @@ void vlc_input_decoder_Drain( vlc_input_decoder_t *p_owner )
 {
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->b_draining = true;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_spsc_fifo_Signal( p_owner->p_queue );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2339,7 +2462,8 @@ void vlc_input_decoder_Flush( vlc_input_decoder_t *p_owner )
     vlc_fifo_Lock( p_owner->p_fifo );
 
     /* Empty the fifo */
-    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    vlc_spsc_fifo_Flush( p_owner->p_queue );
+    DecoderDiscardChain( p_owner, vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2353,7 +2477,7 @@ void vlc_input_decoder_Flush( vlc_input_decoder_t *p_owner )
      && p_owner->frames_countdown == 0 )
         p_owner->frames_countdown++;
 
-    vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_spsc_fifo_Signal( p_owner->p_queue );
 
     vlc_fifo_Unlock( p_owner->p_fifo );
 
@@ -2486,7 +2610,7 @@ void vlc_input_decoder_ChangePause( vlc_input_decoder_t *p_owner,
     p_owner->paused = b_paused;
     p_owner->pause_date = i_date;
     p_owner->frames_countdown = 0;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_spsc_fifo_Signal( p_owner->p_queue );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2538,7 +2662,8 @@ void vlc_input_decoder_Wait( vlc_input_decoder_t *p_owner )
         if( p_owner->paused )
             break;
         vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo )
+         && vlc_spsc_fifo_GetCount( p_owner->p_queue ) == 0 )
         {
             msg_Err( &p_owner->dec, "buffer deadlock prevented" );
             vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2558,7 +2683,7 @@ void vlc_input_decoder_FrameNext( vlc_input_decoder_t *p_owner,
 
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->frames_countdown++;
-    vlc_fifo_Signal( p_owner->p_fifo );
+    vlc_spsc_fifo_Signal( p_owner->p_queue );
     vlc_fifo_Unlock( p_owner->p_fifo );
 
     vlc_mutex_lock( &p_owner->lock );
@@ -2603,7 +2728,8 @@ void vlc_input_decoder_GetStatus( vlc_input_decoder_t *p_owner,
 
 size_t vlc_input_decoder_GetFifoSize( vlc_input_decoder_t *p_owner )
 {
-    return block_FifoSize( p_owner->p_fifo );
+    return vlc_spsc_fifo_GetBytes( p_owner->p_queue )
+         + block_FifoSize( p_owner->p_fifo );
 }
 
 static bool DecoderHasVbi( decoder_t *dec )
@@ -2913,7 +2913,11 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     {
         vlc_tracer_TraceStreamDTS( tracer, "DEMUX", es->id.str_id, "OUT",
                             p_block->i_pts, p_block->i_dts);
+        vlc_tracer_TraceSpanBegin( tracer, "send", es->id.str_id,
+                                   p_block->i_pts );
     }
+    /* The block belongs to the decoder once sent */
+    const vlc_tick_t i_pts = p_block->i_pts;
 
     struct input_stats *stats = input_priv(p_input)->stats;
     if( stats != NULL )
@@ -2964,6 +2968,8 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     {
         block_Release( p_block );
         vlc_mutex_unlock( &p_sys->lock );
+        if ( tracer != NULL )
+            vlc_tracer_TraceSpanEnd( tracer, "send", es->id.str_id, i_pts );
         return VLC_SUCCESS;
     }
 
@@ -2991,6 +2997,8 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
     }
     vlc_input_decoder_Decode( es->p_dec, p_block,
                               input_priv(p_input)->b_out_pace_control );
+    if ( tracer != NULL )
+        vlc_tracer_TraceSpanEnd( tracer, "send", es->id.str_id, i_pts );
 
     struct vlc_input_decoder_status status;
     vlc_input_decoder_GetStatus( es->p_dec, &status );
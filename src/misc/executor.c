@@ -24,28 +24,43 @@
 
 #include <vlc_executor.h>
 
+#include <stdatomic.h>
+
 #include <vlc_atomic.h>
 #include <vlc_list.h>
 #include <vlc_threads.h>
 #include "libvlc.h"
 
+#define PRIORITY_COUNT (VLC_EXECUTOR_PRIORITY_HIGH + 1)
+
 /**
  * An executor can spawn several threads.
  *
- * This structure contains the data specific to one thread.
+ * This structure contains the data specific to one thread, including its own
+ * queue of runnables. Idle threads steal runnables from the other queues.
  */
 struct vlc_executor_thread {
-    /** Node of vlc_executor.threads list */
-    struct vlc_list node;
-
     /** The executor owning the thread */
     vlc_executor_t *owner;
 
     /** The system thread */
     vlc_thread_t thread;
 
-    /** The current task executed by the thread, NULL if none */
-    struct vlc_runnable *current_task;
+    /** Protects the queues and the statistics below */
+    vlc_mutex_t lock;
+
+    /** Queues of vlc_runnable, one per priority */
+    struct vlc_list queues[PRIORITY_COUNT];
+
+    /** Number of queued runnables, readable without the lock as a hint */
+    atomic_uint pending;
+
+    /* Statistics of the runnables queued on this thread */
+    uint64_t started;
+    uint64_t stolen;
+    uint64_t canceled;
+    vlc_tick_t wait_total;
+    vlc_tick_t wait_max;
 };
 
 /**
@@ -53,118 +68,206 @@ struct vlc_executor_thread {
  * header).
  */
 struct vlc_executor {
+    /** Protects thread creation, idle waits and closing */
     vlc_mutex_t lock;
 
     /** Maximum number of threads to run the tasks */
     unsigned max_threads;
 
-    /** List of active vlc_executor_thread */
-    struct vlc_list threads;
+    /** Thread count, the threads array is initialized up to that */
+    atomic_uint nthreads;
 
-    /** Thread count (in a separate field to quickly compare to max_threads) */
-    unsigned nthreads;
+    /** Round-robin index of the queue for tasks submitted from outside */
+    atomic_uint next;
+
+    /** Number of threads waiting for tasks */
+    atomic_uint idle;
 
     /* Number of tasks requested but not finished. */
-    unsigned unfinished;
+    atomic_size_t unfinished;
+
+    /* Number of queued tasks, and its maximum */
+    atomic_size_t queued;
+    atomic_size_t max_queued;
 
     /** Wait for the executor to be idle (i.e. unfinished == 0) */
     vlc_cond_t idle_wait;
 
-    /** Queue of vlc_runnable */
-    struct vlc_list queue;
-
-    /** Wait for the queue to be non-empty */
+    /** Wait for a queue to be non-empty */
     vlc_cond_t queue_wait;
 
     /** True if executor deletion is requested */
     bool closing;
+
+    struct vlc_executor_thread threads[];
 };
 
+/** The executor thread running the current task, if any */
+static thread_local struct vlc_executor_thread *current_thread;
+
 static void
-QueuePush(vlc_executor_t *executor, struct vlc_runnable *runnable)
+QueuePush(struct vlc_executor_thread *thread, struct vlc_runnable *runnable,
+          enum vlc_executor_priority priority)
 {
-    vlc_mutex_assert(&executor->lock);
+    vlc_mutex_lock(&thread->lock);
+    vlc_list_append(&runnable->node, &thread->queues[priority]);
+    atomic_store_explicit(&thread->pending,
+        atomic_load_explicit(&thread->pending, memory_order_relaxed) + 1,
+        memory_order_relaxed);
+    vlc_mutex_unlock(&thread->lock);
+}
+
+static void
+QueueRemove(struct vlc_executor_thread *thread, struct vlc_runnable *runnable)
+{
+    vlc_mutex_assert(&thread->lock);
+
+    vlc_list_remove(&runnable->node);
 
-    vlc_list_append(&runnable->node, &executor->queue);
-    vlc_cond_signal(&executor->queue_wait);
+    /* Set links to NULL to know that it has been dequeued in
+     * vlc_executor_Cancel() */
+    runnable->node.prev = runnable->node.next = NULL;
+
+    atomic_store_explicit(&thread->pending,
+        atomic_load_explicit(&thread->pending, memory_order_relaxed) - 1,
+        memory_order_relaxed);
 }
 
+/* Takes the first runnable of the highest priority from a queue */
 static struct vlc_runnable *
-QueueTake(vlc_executor_t *executor)
+QueueTake(struct vlc_executor_thread *victim, bool steal)
 {
-    vlc_mutex_assert(&executor->lock);
+    if (atomic_load_explicit(&victim->pending, memory_order_relaxed) == 0)
+        return NULL;
 
-    while (!executor->closing && vlc_list_is_empty(&executor->queue))
-        vlc_cond_wait(&executor->queue_wait, &executor->lock);
+    struct vlc_runnable *runnable = NULL;
 
-    if (executor->closing)
-        return NULL;
+    vlc_mutex_lock(&victim->lock);
+    for (int i = PRIORITY_COUNT - 1; i >= 0 && runnable == NULL; i--)
+        runnable = vlc_list_first_entry_or_null(&victim->queues[i],
+                                                struct vlc_runnable, node);
 
-    struct vlc_runnable *runnable =
-        vlc_list_first_entry_or_null(&executor->queue, struct vlc_runnable,
-                                     node);
-    assert(runnable);
-    vlc_list_remove(&runnable->node);
+    if (runnable != NULL)
+    {
+        vlc_tick_t wait = vlc_tick_now() - runnable->date;
+
+        QueueRemove(victim, runnable);
+        victim->started++;
+        if (steal)
+            victim->stolen++;
+        victim->wait_total += wait;
+        if (wait > victim->wait_max)
+            victim->wait_max = wait;
+    }
+    vlc_mutex_unlock(&victim->lock);
+    return runnable;
+}
 
-    /* Set links to NULL to know that it has been taken by a thread in
-     * vlc_executor_Cancel() */
-    runnable->node.prev = runnable->node.next = NULL;
+/* Takes a runnable from the thread queue, or else from another queue */
+static struct vlc_runnable *
+Take(vlc_executor_t *executor, struct vlc_executor_thread *thread)
+{
+    struct vlc_runnable *runnable = QueueTake(thread, false);
+
+    if (runnable == NULL)
+    {
+        unsigned n = atomic_load_explicit(&executor->nthreads,
+                                          memory_order_acquire);
+        unsigned self = thread - executor->threads;
+
+        for (unsigned i = 1; i < n && runnable == NULL; i++)
+            runnable = QueueTake(&executor->threads[(self + i) % n], true);
+    }
 
+    if (runnable != NULL)
+        atomic_fetch_sub_explicit(&executor->queued, 1, memory_order_relaxed);
     return runnable;
 }
 
+static void
+Complete(vlc_executor_t *executor)
+{
+    size_t unfinished = atomic_fetch_sub_explicit(&executor->unfinished, 1,
+                                                  memory_order_acq_rel);
+    assert(unfinished > 0);
+    if (unfinished == 1)
+    {
+        vlc_mutex_lock(&executor->lock);
+        vlc_cond_broadcast(&executor->idle_wait);
+        vlc_mutex_unlock(&executor->lock);
+    }
+}
+
 static void *
 ThreadRun(void *userdata)
 {
     struct vlc_executor_thread *thread = userdata;
     vlc_executor_t *executor = thread->owner;
 
-    vlc_mutex_lock(&executor->lock);
+    current_thread = thread;
 
-    struct vlc_runnable *runnable;
-    /* When the executor is closing, QueueTake() returns NULL */
-    while ((runnable = QueueTake(executor)))
+    for (;;)
     {
-        thread->current_task = runnable;
-        vlc_mutex_unlock(&executor->lock);
-
-        /* Execute the user-provided runnable, without the executor lock */
+        struct vlc_runnable *runnable = Take(executor, thread);
+
+        if (runnable == NULL)
+        {
+            vlc_mutex_lock(&executor->lock);
+            /* Announce the wait before checking the queues again, so that
+             * a concurrent submitter either sees it or is seen */
+            atomic_fetch_add(&executor->idle, 1);
+            /* Pairs with the fence in vlc_executor_SubmitPriority(): the
+             * pending counters are read after the idle count is published */
+            atomic_thread_fence(memory_order_seq_cst);
+
+            while (!executor->closing
+                && (runnable = Take(executor, thread)) == NULL)
+                vlc_cond_wait(&executor->queue_wait, &executor->lock);
+
+            atomic_fetch_sub(&executor->idle, 1);
+            vlc_mutex_unlock(&executor->lock);
+
+            /* When the executor is closing, there are no tasks left */
+            if (runnable == NULL)
+                break;
+        }
+
+        /* Execute the user-provided runnable, without any lock */
         runnable->run(runnable->userdata);
 
-        vlc_mutex_lock(&executor->lock);
-        thread->current_task = NULL;
-
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        Complete(executor);
     }
 
-    vlc_mutex_unlock(&executor->lock);
-
     return NULL;
 }
 
 static int
 SpawnThread(vlc_executor_t *executor)
 {
-    assert(executor->nthreads < executor->max_threads);
+    vlc_mutex_assert(&executor->lock);
+
+    unsigned n = atomic_load_explicit(&executor->nthreads,
+                                      memory_order_relaxed);
+    assert(n < executor->max_threads);
 
-    struct vlc_executor_thread *thread = malloc(sizeof(*thread));
-    if (!thread)
-        return VLC_ENOMEM;
+    struct vlc_executor_thread *thread = &executor->threads[n];
 
     thread->owner = executor;
-    thread->current_task = NULL;
+    vlc_mutex_init(&thread->lock);
+    for (size_t i = 0; i < ARRAY_SIZE(thread->queues); i++)
+        vlc_list_init(&thread->queues[i]);
+    atomic_init(&thread->pending, 0);
+    thread->started = 0;
+    thread->stolen = 0;
+    thread->canceled = 0;
+    thread->wait_total = 0;
+    thread->wait_max = 0;
 
     if (vlc_clone(&thread->thread, ThreadRun, thread, VLC_THREAD_PRIORITY_LOW))
-    {
-        free(thread);
         return VLC_EGENERIC;
-    }
 
-    executor->nthreads++;
-    vlc_list_append(&thread->node, &executor->threads);
+    /* Publish the queue to the submitters and the other threads */
+    atomic_store_explicit(&executor->nthreads, n + 1, memory_order_release);
 
     return VLC_SUCCESS;
 }
@@ -173,18 +276,20 @@ vlc_executor_t *
 vlc_executor_New(unsigned max_threads)
 {
     assert(max_threads);
-    vlc_executor_t *executor = malloc(sizeof(*executor));
+    vlc_executor_t *executor =
+        malloc(sizeof(*executor) + max_threads * sizeof(executor->threads[0]));
     if (!executor)
         return NULL;
 
     vlc_mutex_init(&executor->lock);
 
     executor->max_threads = max_threads;
-    executor->nthreads = 0;
-    executor->unfinished = 0;
-
-    vlc_list_init(&executor->threads);
-    vlc_list_init(&executor->queue);
+    atomic_init(&executor->nthreads, 0);
+    atomic_init(&executor->next, 0);
+    atomic_init(&executor->idle, 0);
+    atomic_init(&executor->unfinished, 0);
+    atomic_init(&executor->queued, 0);
+    atomic_init(&executor->max_queued, 0);
 
     vlc_cond_init(&executor->idle_wait);
     vlc_cond_init(&executor->queue_wait);
@@ -192,7 +297,9 @@ vlc_executor_New(unsigned max_threads)
     executor->closing = false;
 
     /* Create one thread on init so that vlc_executor_Submit() may never fail */
+    vlc_mutex_lock(&executor->lock);
     int ret = SpawnThread(executor);
+    vlc_mutex_unlock(&executor->lock);
     if (ret != VLC_SUCCESS)
     {
         free(executor);
@@ -203,26 +310,81 @@ vlc_executor_New(unsigned max_threads)
 }
 
 void
-vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable)
+vlc_executor_SubmitPriority(vlc_executor_t *executor,
+                            struct vlc_runnable *runnable,
+                            enum vlc_executor_priority priority)
 {
-    vlc_mutex_lock(&executor->lock);
+    assert(priority < PRIORITY_COUNT);
 
-    assert(!executor->closing);
+    unsigned nthreads = atomic_load_explicit(&executor->nthreads,
+                                             memory_order_acquire);
+    struct vlc_executor_thread *thread = current_thread;
 
-    QueuePush(executor, runnable);
+    /* Tasks submitted from a task are queued on the same thread (as they
+     * likely share data), others are spread over the threads */
+    if (thread == NULL || thread->owner != executor)
+    {
+        unsigned i = atomic_fetch_add_explicit(&executor->next, 1,
+                                               memory_order_relaxed);
+        thread = &executor->threads[i % nthreads];
+    }
 
-    if (++executor->unfinished > executor->nthreads
-            && executor->nthreads < executor->max_threads)
-        /* If it fails, this is not an error, there is at least one thread */
-        SpawnThread(executor);
+    runnable->queue = thread;
+    runnable->date = vlc_tick_now();
 
-    vlc_mutex_unlock(&executor->lock);
+    size_t queued = atomic_fetch_add_explicit(&executor->queued, 1,
+                                              memory_order_relaxed) + 1;
+    size_t max_queued = atomic_load_explicit(&executor->max_queued,
+                                             memory_order_relaxed);
+    while (queued > max_queued
+        && !atomic_compare_exchange_weak_explicit(&executor->max_queued,
+                                                  &max_queued, queued,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed));
+
+    size_t unfinished = atomic_fetch_add_explicit(&executor->unfinished, 1,
+                                                  memory_order_relaxed) + 1;
+
+    QueuePush(thread, runnable, priority);
+
+    if (unfinished > nthreads && nthreads < executor->max_threads)
+    {
+        vlc_mutex_lock(&executor->lock);
+        assert(!executor->closing);
+        if (atomic_load_explicit(&executor->nthreads, memory_order_relaxed)
+                < executor->max_threads)
+            /* If it fails, this is not an error, there is at least one
+             * thread */
+            SpawnThread(executor);
+        vlc_mutex_unlock(&executor->lock);
+    }
+
+    /* Wake up a thread if any is waiting (see ThreadRun()). The fence
+     * orders the pending counter store before the idle count load: either
+     * this sees the idle thread, or the thread sees the queued runnable. */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&executor->idle) > 0)
+    {
+        vlc_mutex_lock(&executor->lock);
+        vlc_cond_signal(&executor->queue_wait);
+        vlc_mutex_unlock(&executor->lock);
+    }
+}
+
+void
+vlc_executor_Submit(vlc_executor_t *executor, struct vlc_runnable *runnable)
+{
+    vlc_executor_SubmitPriority(executor, runnable,
+                                VLC_EXECUTOR_PRIORITY_NORMAL);
 }
 
 bool
 vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
 {
-    vlc_mutex_lock(&executor->lock);
+    struct vlc_executor_thread *thread = runnable->queue;
+
+    assert(thread->owner == executor);
+    vlc_mutex_lock(&thread->lock);
 
     /* Either both prev and next are set, either both are NULL */
     assert(!runnable->node.prev == !runnable->node.next);
@@ -230,15 +392,17 @@ vlc_executor_Cancel(vlc_executor_t *executor, struct vlc_runnable *runnable)
     bool in_queue = runnable->node.prev;
     if (in_queue)
     {
-        vlc_list_remove(&runnable->node);
-
-        assert(executor->unfinished > 0);
-        --executor->unfinished;
-        if (!executor->unfinished)
-            vlc_cond_signal(&executor->idle_wait);
+        QueueRemove(thread, runnable);
+        thread->canceled++;
     }
 
-    vlc_mutex_unlock(&executor->lock);
+    vlc_mutex_unlock(&thread->lock);
+
+    if (in_queue)
+    {
+        atomic_fetch_sub_explicit(&executor->queued, 1, memory_order_relaxed);
+        Complete(executor);
+    }
 
     return in_queue;
 }
@@ -247,11 +411,44 @@ void
 vlc_executor_WaitIdle(vlc_executor_t *executor)
 {
     vlc_mutex_lock(&executor->lock);
-    while (executor->unfinished)
+    while (atomic_load_explicit(&executor->unfinished, memory_order_acquire))
         vlc_cond_wait(&executor->idle_wait, &executor->lock);
     vlc_mutex_unlock(&executor->lock);
 }
 
+void
+vlc_executor_GetStats(vlc_executor_t *executor,
+                      struct vlc_executor_stats *stats)
+{
+    unsigned n = atomic_load_explicit(&executor->nthreads,
+                                      memory_order_acquire);
+
+    stats->threads = n;
+    stats->queued = atomic_load_explicit(&executor->queued,
+                                         memory_order_relaxed);
+    stats->max_queued = atomic_load_explicit(&executor->max_queued,
+                                             memory_order_relaxed);
+    stats->started = 0;
+    stats->stolen = 0;
+    stats->canceled = 0;
+    stats->wait_total = 0;
+    stats->wait_max = 0;
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        struct vlc_executor_thread *thread = &executor->threads[i];
+
+        vlc_mutex_lock(&thread->lock);
+        stats->started += thread->started;
+        stats->stolen += thread->stolen;
+        stats->canceled += thread->canceled;
+        stats->wait_total += thread->wait_total;
+        if (thread->wait_max > stats->wait_max)
+            stats->wait_max = thread->wait_max;
+        vlc_mutex_unlock(&thread->lock);
+    }
+}
+
 void
 vlc_executor_Delete(vlc_executor_t *executor)
 {
@@ -260,29 +457,26 @@ vlc_executor_Delete(vlc_executor_t *executor)
     executor->closing = true;
 
     /* All the tasks must be canceled on delete */
-    assert(vlc_list_is_empty(&executor->queue));
+    assert(atomic_load(&executor->queued) == 0);
 
     vlc_mutex_unlock(&executor->lock);
 
     /* "closing" is now true, this will wake up threads */
     vlc_cond_broadcast(&executor->queue_wait);
 
-    /* The threads list may not be written at this point, so it is safe to read
-     * it without mutex locked (the mutex must be released to join the
-     * threads). */
+    /* No threads may be spawned at this point, so it is safe to read the
+     * thread count without mutex locked (the mutex must be released to join
+     * the threads). */
 
-    struct vlc_executor_thread *thread;
-    vlc_list_foreach(thread, &executor->threads, node)
-    {
-        vlc_join(thread->thread, NULL);
-        free(thread);
-    }
+    unsigned n = atomic_load(&executor->nthreads);
+    for (unsigned i = 0; i < n; i++)
+        vlc_join(executor->threads[i].thread, NULL);
 
-    /* The queue must still be empty (no runnable submitted a new runnable) */
-    assert(vlc_list_is_empty(&executor->queue));
+    /* The queues must still be empty (no runnable submitted a new runnable) */
+    assert(atomic_load(&executor->queued) == 0);
 
     /* There are no tasks anymore */
-    assert(!executor->unfinished);
+    assert(!atomic_load(&executor->unfinished));
 
     free(executor);
 }
@@ -88,6 +88,28 @@ bool picture_fifo_IsEmpty(picture_fifo_t *fifo)
 
     return empty;
 }
+void picture_fifo_Extract(picture_fifo_t *fifo, vlc_tick_t date,
+                          bool flush_before, vlc_picture_chain_t *flush_chain)
+{
+    picture_t *picture;
+
+    vlc_mutex_lock(&fifo->lock);
+    vlc_picture_chain_t filter_chain;
+    vlc_picture_chain_GetAndClear(&fifo->pics, &filter_chain);
+
+    while ( !vlc_picture_chain_IsEmpty( &filter_chain ) ) {
+        picture = vlc_picture_chain_PopFront( &filter_chain );
+
+        if (date == VLC_TICK_INVALID ||
+            ( flush_before && picture->date <= date) ||
+            (!flush_before && picture->date >= date))
+            vlc_picture_chain_Append( flush_chain, picture );
+        else
+            PictureFifoPush(fifo, picture);
+    }
+    vlc_mutex_unlock(&fifo->lock);
+}
+
 void picture_fifo_Flush(picture_fifo_t *fifo, vlc_tick_t date, bool flush_before)
 {
     picture_t *picture;
@@ -95,25 +117,7 @@ void picture_fifo_Flush(picture_fifo_t *fifo, vlc_tick_t date, bool flush_before
     vlc_picture_chain_t flush_chain;
 
     vlc_picture_chain_Init(&flush_chain);
-
-    vlc_mutex_lock(&fifo->lock);
-    if (date == VLC_TICK_INVALID)
-        vlc_picture_chain_GetAndClear(&fifo->pics, &flush_chain);
-    else {
-        vlc_picture_chain_t filter_chain;
-        vlc_picture_chain_GetAndClear(&fifo->pics, &filter_chain);
-
-        while ( !vlc_picture_chain_IsEmpty( &filter_chain ) ) {
-            picture = vlc_picture_chain_PopFront( &filter_chain );
-
-            if (( flush_before && picture->date <= date) ||
-                (!flush_before && picture->date >= date))
-                vlc_picture_chain_Append( &flush_chain, picture );
-            else
-                PictureFifoPush(fifo, picture);
-        }
-    }
-    vlc_mutex_unlock(&fifo->lock);
+    picture_fifo_Extract(fifo, date, flush_before, &flush_chain);
 
     while ((picture = vlc_picture_chain_PopFront(&flush_chain)) != NULL)
         picture_Release(picture);
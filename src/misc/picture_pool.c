@@ -35,16 +35,19 @@
 #include <vlc_atomic.h>
 #include "picture.h"
 
-#define POOL_MAX (CHAR_BIT * sizeof (unsigned long long))
+#define POOL_WORD_BITS (CHAR_BIT * sizeof (unsigned long long))
+#define POOL_WORDS 4
+#define POOL_MAX (POOL_WORDS * POOL_WORD_BITS)
 
 static_assert ((POOL_MAX & (POOL_MAX - 1)) == 0, "Not a power of two");
 
 struct picture_pool_t {
-    vlc_mutex_t lock;
-    vlc_cond_t  wait;
-
-    bool               canceled;
-    unsigned long long available;
+    /* One bit per free picture */
+    atomic_ullong      available[POOL_WORDS];
+    /* Incremented to wake up the picture_pool_Wait() callers */
+    atomic_uint        wakeup;
+    atomic_uint        waiters;
+    atomic_bool        canceled;
     vlc_atomic_rc_t    refs;
     unsigned short     picture_count;
     picture_t  *picture[];
@@ -65,6 +68,15 @@ void picture_pool_Release(picture_pool_t *pool)
     picture_pool_Destroy(pool);
 }
 
+static void picture_pool_Wakeup(picture_pool_t *pool, bool all)
+{
+    atomic_fetch_add(&pool->wakeup, 1);
+    if (all)
+        vlc_atomic_notify_all(&pool->wakeup);
+    else
+        vlc_atomic_notify_one(&pool->wakeup);
+}
+
 static void picture_pool_ReleaseClone(picture_t *clone)
 {
     picture_priv_t *priv = (picture_priv_t *)clone;
@@ -72,14 +84,19 @@ static void picture_pool_ReleaseClone(picture_t *clone)
     picture_pool_t *pool = (void *)(sys & ~(POOL_MAX - 1));
     unsigned offset = sys & (POOL_MAX - 1);
     picture_t *picture = pool->picture[offset];
+    unsigned long long bit = 1ULL << (offset % POOL_WORD_BITS);
 
     picture_Release(picture);
 
-    vlc_mutex_lock(&pool->lock);
-    assert(!(pool->available & (1ULL << offset)));
-    pool->available |= 1ULL << offset;
-    vlc_cond_signal(&pool->wait);
-    vlc_mutex_unlock(&pool->lock);
+    unsigned long long prev =
+        atomic_fetch_or(&pool->available[offset / POOL_WORD_BITS], bit);
+    assert(!(prev & bit));
+    VLC_UNUSED(prev);
+
+    /* A waiter registers before looking for a free picture: either it finds
+     * this one, or it is counted here and woken up. */
+    if (atomic_load(&pool->waiters) > 0)
+        picture_pool_Wakeup(pool, false);
 
     picture_pool_Destroy(pool);
 }
@@ -99,6 +116,28 @@ static picture_t *picture_pool_ClonePicture(picture_pool_t *pool,
     return clone;
 }
 
+/* Allocates a free picture, returns its offset or -1 if none is free */
+static int picture_pool_Take(picture_pool_t *pool)
+{
+    for (unsigned w = 0; w < POOL_WORDS; w++)
+    {
+        atomic_ullong *word = &pool->available[w];
+        unsigned long long available = atomic_load(word);
+
+        while (available != 0)
+        {
+            unsigned long long bit = 1ULL << ctz(available);
+
+            if (atomic_compare_exchange_weak_explicit(word, &available,
+                                                      available & ~bit,
+                                                      memory_order_acquire,
+                                                      memory_order_relaxed))
+                return w * POOL_WORD_BITS + ctz(bit);
+        }
+    }
+    return -1;
+}
+
 picture_pool_t *picture_pool_New(unsigned count, picture_t *const *tab)
 {
     if (unlikely(count > POOL_MAX))
@@ -112,16 +151,21 @@ picture_pool_t *picture_pool_New(unsigned count, picture_t *const *tab)
     if (unlikely(pool == NULL))
         return NULL;
 
-    vlc_mutex_init(&pool->lock);
-    vlc_cond_init(&pool->wait);
-    if (count == POOL_MAX)
-        pool->available = ~0ULL;
-    else
-        pool->available = (1ULL << count) - 1;
+    for (unsigned w = 0; w < POOL_WORDS; w++)
+    {
+        unsigned bits = count - __MIN(count, w * POOL_WORD_BITS);
+
+        if (bits >= POOL_WORD_BITS)
+            atomic_init(&pool->available[w], ~0ULL);
+        else
+            atomic_init(&pool->available[w], (1ULL << bits) - 1);
+    }
+    atomic_init(&pool->wakeup, 0);
+    atomic_init(&pool->waiters, 0);
+    atomic_init(&pool->canceled, false);
     vlc_atomic_rc_init(&pool->refs);
     pool->picture_count = count;
     memcpy(pool->picture, tab, count * sizeof (picture_t *));
-    pool->canceled = false;
     return pool;
 }
 
@@ -180,61 +224,57 @@ error:
 
 picture_t *picture_pool_Get(picture_pool_t *pool)
 {
-    unsigned long long available;
-
-    vlc_mutex_lock(&pool->lock);
     assert(vlc_atomic_rc_get(&pool->refs) > 0);
-    available = pool->available;
 
-    while (available != 0)
-    {
-        int i = ctz(available);
-
-        if (unlikely(pool->canceled))
-            break;
-
-        pool->available &= ~(1ULL << i);
-        vlc_mutex_unlock(&pool->lock);
-        available &= ~(1ULL << i);
+    if (unlikely(atomic_load(&pool->canceled)))
+        return NULL;
 
-        return picture_pool_ClonePicture(pool, i);
-    }
+    int i = picture_pool_Take(pool);
+    if (i < 0)
+        return NULL;
 
-    vlc_mutex_unlock(&pool->lock);
-    return NULL;
+    return picture_pool_ClonePicture(pool, i);
 }
 
 picture_t *picture_pool_Wait(picture_pool_t *pool)
 {
-    vlc_mutex_lock(&pool->lock);
     assert(vlc_atomic_rc_get(&pool->refs) > 0);
 
-    while (pool->available == 0)
+    int i;
+
+    atomic_fetch_add(&pool->waiters, 1);
+    for (;;)
     {
-        if (pool->canceled)
+        unsigned wakeup = atomic_load(&pool->wakeup);
+
+        if (atomic_load(&pool->canceled))
         {
-            vlc_mutex_unlock(&pool->lock);
-            return NULL;
+            i = -1;
+            break;
         }
-        vlc_cond_wait(&pool->wait, &pool->lock);
+
+        i = picture_pool_Take(pool);
+        if (i >= 0)
+            break;
+
+        /* Returns at once if a picture was released since the load */
+        vlc_atomic_wait(&pool->wakeup, wakeup);
     }
+    atomic_fetch_sub(&pool->waiters, 1);
 
-    int i = ctz(pool->available);
-    pool->available &= ~(1ULL << i);
-    vlc_mutex_unlock(&pool->lock);
+    if (i < 0)
+        return NULL;
 
     return picture_pool_ClonePicture(pool, i);
 }
 
 void picture_pool_Cancel(picture_pool_t *pool, bool canceled)
 {
-    vlc_mutex_lock(&pool->lock);
     assert(vlc_atomic_rc_get(&pool->refs) > 0);
 
-    pool->canceled = canceled;
+    atomic_store(&pool->canceled, canceled);
     if (canceled)
-        vlc_cond_broadcast(&pool->wait);
-    vlc_mutex_unlock(&pool->lock);
+        picture_pool_Wakeup(pool, true);
 }
 
 unsigned picture_pool_GetSize(const picture_pool_t *pool)
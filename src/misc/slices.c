@@ -0,0 +1,217 @@
+/*****************************************************************************
+ * misc/slices.c: slice threading for picture processing
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_executor.h>
+#include <vlc_slices.h>
+#include <vlc_variables.h>
+
+#define SLICES_MAX 64
+
+/* Worker pool shared by all the contexts, created by the first one */
+static struct
+{
+    vlc_mutex_t lock;
+    vlc_executor_t *executor;
+    unsigned refs;
+} pool = { VLC_STATIC_MUTEX, NULL, 0 };
+
+struct vlc_slices
+{
+    unsigned count;
+
+    /* Current run */
+    vlc_slice_cb cb;
+    void *opaque;
+    unsigned rows;
+    unsigned height;
+    unsigned overlap;
+    unsigned bands;
+    atomic_uint next;
+    atomic_uint pending; /* helpers not returned yet */
+
+    struct vlc_runnable helpers[];
+};
+
+static vlc_executor_t *PoolHold(void)
+{
+    vlc_mutex_lock(&pool.lock);
+    if (pool.executor == NULL)
+        /* Threads are only spawned when there are runnables for them */
+        pool.executor = vlc_executor_New(SLICES_MAX - 1);
+    if (pool.executor != NULL)
+        pool.refs++;
+    vlc_mutex_unlock(&pool.lock);
+    return pool.executor;
+}
+
+static void PoolRelease(void)
+{
+    vlc_executor_t *executor = NULL;
+
+    vlc_mutex_lock(&pool.lock);
+    assert(pool.refs > 0);
+    if (--pool.refs == 0)
+    {
+        executor = pool.executor;
+        pool.executor = NULL;
+    }
+    vlc_mutex_unlock(&pool.lock);
+
+    if (executor != NULL)
+        vlc_executor_Delete(executor);
+}
+
+#undef vlc_slices_New
+vlc_slices_t *vlc_slices_New(vlc_object_t *obj)
+{
+    int64_t threads = var_InheritInteger(obj, "filter-threads");
+    unsigned count = threads > 0 ? threads : vlc_GetCPUCount();
+
+    count = VLC_CLIP(count, 1, SLICES_MAX);
+
+    /* Without a pool, all bands run on the calling thread */
+    if (count > 1 && PoolHold() == NULL)
+        count = 1;
+
+    vlc_slices_t *slices =
+        malloc(sizeof (*slices) + (count - 1) * sizeof (slices->helpers[0]));
+    if (unlikely(slices == NULL))
+    {
+        if (count > 1)
+            PoolRelease();
+        return NULL;
+    }
+
+    slices->count = count;
+    atomic_init(&slices->next, 0);
+    atomic_init(&slices->pending, 0);
+    msg_Dbg(obj, "using %u slice threads", count);
+    return slices;
+}
+
+void vlc_slices_Delete(vlc_slices_t *slices)
+{
+    if (slices->count > 1)
+        PoolRelease();
+    free(slices);
+}
+
+unsigned vlc_slices_Count(const vlc_slices_t *slices)
+{
+    return slices->count;
+}
+
+/* Processes bands until none is left */
+static void RunBands(vlc_slices_t *slices)
+{
+    unsigned i;
+
+    while ((i = atomic_fetch_add_explicit(&slices->next, 1,
+                                          memory_order_relaxed))
+            < slices->bands)
+    {
+        struct vlc_slice slice = {
+            .index = i,
+            .start = i * slices->height,
+        };
+
+        slice.end = __MIN(slice.start + slices->height, slices->rows);
+        slice.first = slice.start > slices->overlap
+                    ? slice.start - slices->overlap : 0;
+        slices->cb(slices->opaque, &slice);
+    }
+}
+
+static void RunHelper(void *data)
+{
+    vlc_slices_t *slices = data;
+
+    RunBands(slices);
+
+    if (atomic_fetch_sub_explicit(&slices->pending, 1,
+                                  memory_order_acq_rel) == 1)
+        vlc_atomic_notify_one(&slices->pending);
+}
+
+void vlc_slices_Run(vlc_slices_t *slices, unsigned rows, unsigned align,
+                    unsigned overlap, vlc_slice_cb cb, void *opaque)
+{
+    assert(align > 0);
+
+    if (rows == 0)
+        return;
+
+    unsigned height = (rows + slices->count - 1) / slices->count;
+    height = (height + align - 1) / align * align;
+
+    slices->cb = cb;
+    slices->opaque = opaque;
+    slices->rows = rows;
+    slices->height = height;
+    slices->overlap = overlap;
+    slices->bands = (rows + height - 1) / height;
+    atomic_store_explicit(&slices->next, 0, memory_order_relaxed);
+
+    unsigned helpers = slices->bands - 1;
+    if (helpers > 0)
+    {
+        vlc_executor_t *executor = pool.executor;
+
+        atomic_store_explicit(&slices->pending, helpers, memory_order_relaxed);
+        for (unsigned i = 0; i < helpers; i++)
+        {
+            slices->helpers[i].run = RunHelper;
+            slices->helpers[i].userdata = slices;
+            vlc_executor_SubmitPriority(executor, &slices->helpers[i],
+                                        VLC_EXECUTOR_PRIORITY_HIGH);
+        }
+
+        RunBands(slices);
+
+        /* The bands are all taken, drop the helpers which did not start */
+        unsigned canceled = 0;
+        for (unsigned i = 0; i < helpers; i++)
+            if (vlc_executor_Cancel(executor, &slices->helpers[i]))
+                canceled++;
+
+        unsigned pending = atomic_fetch_sub_explicit(&slices->pending,
+                                                     canceled,
+                                                     memory_order_acq_rel)
+                         - canceled;
+        while (pending != 0)
+        {
+            vlc_atomic_wait(&slices->pending, pending);
+            pending = atomic_load_explicit(&slices->pending,
+                                           memory_order_acquire);
+        }
+    }
+    else
+        RunBands(slices);
+}
@@ -0,0 +1,228 @@
+/*****************************************************************************
+ * spsc_fifo.c: lock-free single producer, single consumer block queue
+ *****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_block.h>
+#include "spsc_fifo.h"
+
+/* Keeps the fields written by either side on distinct cache lines */
+#define CACHE_LINE 64
+
+/*
+ * Positions are free-running counters, the slot index being the position
+ * modulo the (power of two) size. All differences of positions are thus
+ * computed in modular arithmetic.
+ */
+struct vlc_spsc_fifo
+{
+    /* Written by the consumer */
+    atomic_size_t tail; /**< position of the oldest block */
+    atomic_size_t out_bytes; /**< total bytes dequeued */
+    atomic_bool waiting; /**< the consumer is (about to be) sleeping */
+    char pad1[CACHE_LINE];
+
+    /* Written by the producer */
+    atomic_size_t head; /**< position of the next block */
+    atomic_size_t in_bytes; /**< total bytes queued */
+    atomic_size_t discard; /**< blocks before this position are flushed */
+    atomic_size_t discard_bytes; /**< total bytes queued as of the flush */
+    atomic_uint seq; /**< wake-up sequence number */
+    char pad2[CACHE_LINE];
+
+    void (*release)(void *, block_t *); /**< discarded blocks callback */
+    void *opaque;
+    size_t mask;
+    block_t *slots[];
+};
+
+struct vlc_spsc_fifo *vlc_spsc_fifo_New(size_t size)
+{
+    size_t count = 2;
+
+    while (count < size)
+        count *= 2;
+
+    struct vlc_spsc_fifo *fifo = malloc(sizeof (*fifo)
+                                        + count * sizeof (fifo->slots[0]));
+    if (unlikely(fifo == NULL))
+        return NULL;
+
+    atomic_init(&fifo->tail, 0);
+    atomic_init(&fifo->out_bytes, 0);
+    atomic_init(&fifo->waiting, false);
+    atomic_init(&fifo->head, 0);
+    atomic_init(&fifo->in_bytes, 0);
+    atomic_init(&fifo->discard, 0);
+    atomic_init(&fifo->discard_bytes, 0);
+    atomic_init(&fifo->seq, 0);
+    fifo->release = NULL;
+    fifo->opaque = NULL;
+    fifo->mask = count - 1;
+    return fifo;
+}
+
+void vlc_spsc_fifo_SetDiscard(struct vlc_spsc_fifo *fifo,
+                              void (*discard)(void *, block_t *),
+                              void *opaque)
+{
+    fifo->release = discard;
+    fifo->opaque = opaque;
+}
+
+static void vlc_spsc_fifo_Discard(struct vlc_spsc_fifo *fifo, block_t *block)
+{
+    if (fifo->release != NULL)
+        fifo->release(fifo->opaque, block);
+    else
+        block_Release(block);
+}
+
+void vlc_spsc_fifo_Delete(struct vlc_spsc_fifo *fifo)
+{
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+
+    while (tail != head)
+        vlc_spsc_fifo_Discard(fifo, fifo->slots[tail++ & fifo->mask]);
+    free(fifo);
+}
+
+/* Wakes the consumer up if it sleeps, after a change of sequence number */
+static void vlc_spsc_fifo_Wake(struct vlc_spsc_fifo *fifo)
+{
+    /* Pairs with the fence in vlc_spsc_fifo_Wait(): either the consumer sees
+     * the new sequence number, or we see it waiting. */
+    atomic_thread_fence(memory_order_seq_cst);
+    /* Only the first wake-up makes a system call, if the producer queues
+     * several blocks before the consumer gets to run. */
+    if (atomic_load_explicit(&fifo->waiting, memory_order_relaxed)
+     && atomic_exchange_explicit(&fifo->waiting, false, memory_order_relaxed))
+        vlc_atomic_notify_one(&fifo->seq);
+}
+
+bool vlc_spsc_fifo_Push(struct vlc_spsc_fifo *fifo, block_t *block)
+{
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_acquire);
+
+    assert(block->p_next == NULL);
+
+    if (head - tail > fifo->mask)
+        return false; /* full */
+
+    size_t bytes = atomic_load_explicit(&fifo->in_bytes, memory_order_relaxed);
+
+    fifo->slots[head & fifo->mask] = block;
+    atomic_store_explicit(&fifo->in_bytes, bytes + block->i_buffer,
+                          memory_order_release);
+    atomic_store_explicit(&fifo->head, head + 1, memory_order_release);
+
+    atomic_fetch_add_explicit(&fifo->seq, 1, memory_order_release);
+    vlc_spsc_fifo_Wake(fifo);
+    return true;
+}
+
+block_t *vlc_spsc_fifo_Pop(struct vlc_spsc_fifo *fifo)
+{
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+    size_t discard = atomic_load_explicit(&fifo->discard, memory_order_acquire);
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_acquire);
+    size_t bytes = atomic_load_explicit(&fifo->out_bytes,
+                                        memory_order_relaxed);
+    block_t *block = NULL;
+
+    /* Release the flushed blocks, unless they were dequeued already */
+    if (discard - tail <= head - tail)
+        while (tail != discard)
+        {
+            block_t *flushed = fifo->slots[tail++ & fifo->mask];
+
+            bytes += flushed->i_buffer;
+            vlc_spsc_fifo_Discard(fifo, flushed);
+        }
+
+    if (tail != head)
+    {
+        block = fifo->slots[tail++ & fifo->mask];
+        bytes += block->i_buffer;
+    }
+
+    atomic_store_explicit(&fifo->out_bytes, bytes, memory_order_release);
+    atomic_store_explicit(&fifo->tail, tail, memory_order_release);
+    return block;
+}
+
+void vlc_spsc_fifo_Flush(struct vlc_spsc_fifo *fifo)
+{
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+    size_t bytes = atomic_load_explicit(&fifo->in_bytes, memory_order_relaxed);
+
+    atomic_store_explicit(&fifo->discard_bytes, bytes, memory_order_release);
+    atomic_store_explicit(&fifo->discard, head, memory_order_release);
+}
+
+size_t vlc_spsc_fifo_GetCount(const struct vlc_spsc_fifo *fifo)
+{
+    /* Load the head last, so that it is not behind the other positions.
+     * Likewise for the byte counters below. */
+    size_t tail = atomic_load_explicit(&fifo->tail, memory_order_acquire);
+    size_t discard = atomic_load_explicit(&fifo->discard, memory_order_acquire);
+    size_t head = atomic_load_explicit(&fifo->head, memory_order_acquire);
+
+    return __MIN(head - tail, head - discard);
+}
+
+size_t vlc_spsc_fifo_GetBytes(const struct vlc_spsc_fifo *fifo)
+{
+    size_t out = atomic_load_explicit(&fifo->out_bytes, memory_order_acquire);
+    size_t discard = atomic_load_explicit(&fifo->discard_bytes,
+                                          memory_order_acquire);
+    size_t in = atomic_load_explicit(&fifo->in_bytes, memory_order_acquire);
+
+    return __MIN(in - out, in - discard);
+}
+
+unsigned vlc_spsc_fifo_GetSequence(const struct vlc_spsc_fifo *fifo)
+{
+    return atomic_load_explicit(&fifo->seq, memory_order_acquire);
+}
+
+void vlc_spsc_fifo_Wait(struct vlc_spsc_fifo *fifo, unsigned seq)
+{
+    atomic_store_explicit(&fifo->waiting, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    vlc_atomic_wait(&fifo->seq, seq);
+    atomic_store_explicit(&fifo->waiting, false, memory_order_relaxed);
+}
+
+void vlc_spsc_fifo_Signal(struct vlc_spsc_fifo *fifo)
+{
+    atomic_fetch_add_explicit(&fifo->seq, 1, memory_order_release);
+    vlc_spsc_fifo_Wake(fifo);
+}
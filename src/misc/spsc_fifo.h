@@ -0,0 +1,138 @@
+/**
+ * \file spsc_fifo.h Single producer, single consumer block queue
+ */
+/*****************************************************************************
+ * Copyright © 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SPSC_FIFO_H_
+#define VLC_SPSC_FIFO_H_
+
+/**
+ * \defgroup spsc_fifo Lock-free block queue
+ * \ingroup block
+ *
+ * Bounded queue of blocks between one producer thread and one consumer
+ * thread. Queuing and dequeuing take no locks. The consumer sleeps on a
+ * sequence counter, futex-style, and the producer only makes a system call
+ * to wake it up if it is actually sleeping.
+ *
+ * The producer and consumer sides need not always run on the same threads,
+ * but calls to each side must be serialised.
+ *
+ * @{
+ */
+
+struct vlc_spsc_fifo;
+
+/**
+ * Creates a queue.
+ *
+ * \param size maximum number of blocks in the queue (rounded up to a power
+ *             of two)
+ * \return the queue, or NULL on memory error
+ */
+struct vlc_spsc_fifo *vlc_spsc_fifo_New(size_t size);
+
+/**
+ * Destroys a queue.
+ *
+ * Blocks still in the queue are released.
+ */
+void vlc_spsc_fifo_Delete(struct vlc_spsc_fifo *fifo);
+
+/**
+ * Sets the function releasing discarded blocks.
+ *
+ * Flushed blocks, and blocks still in the queue when it is destroyed, are
+ * passed to this function instead of block_Release(), on the consumer side.
+ * This must be called before the queue is used.
+ */
+void vlc_spsc_fifo_SetDiscard(struct vlc_spsc_fifo *fifo,
+                              void (*discard)(void *, block_t *),
+                              void *opaque);
+
+/**
+ * Queues a block (producer side).
+ *
+ * \param block a single block (not a chain)
+ * \retval true the block was queued
+ * \retval false the queue is full, the block still belongs to the caller
+ */
+bool vlc_spsc_fifo_Push(struct vlc_spsc_fifo *fifo, block_t *block);
+
+/**
+ * Dequeues a block (consumer side).
+ *
+ * \return the oldest block in the queue, or NULL if the queue is empty
+ */
+block_t *vlc_spsc_fifo_Pop(struct vlc_spsc_fifo *fifo);
+
+/**
+ * Discards all queued blocks.
+ *
+ * The blocks are released by the consumer side, on its next dequeue.
+ * Blocks queued after this call are not discarded. This can be called from
+ * any thread, although blocks queued concurrently may or may not be
+ * discarded.
+ */
+void vlc_spsc_fifo_Flush(struct vlc_spsc_fifo *fifo);
+
+/**
+ * Counts the queued blocks.
+ *
+ * This can be called from any thread. The value is only exact from the
+ * producer or consumer side, if the other side is not running concurrently.
+ */
+size_t vlc_spsc_fifo_GetCount(const struct vlc_spsc_fifo *fifo);
+
+/**
+ * Counts the bytes of the queued blocks.
+ *
+ * Same as vlc_spsc_fifo_GetCount() but in bytes.
+ */
+size_t vlc_spsc_fifo_GetBytes(const struct vlc_spsc_fifo *fifo);
+
+/**
+ * Gets the wake-up sequence number (consumer side).
+ *
+ * This must be called before checking the queue and any other wake-up
+ * condition, and the result passed to vlc_spsc_fifo_Wait().
+ */
+unsigned vlc_spsc_fifo_GetSequence(const struct vlc_spsc_fifo *fifo);
+
+/**
+ * Waits for a block or a signal (consumer side).
+ *
+ * The thread sleeps unless a block was queued or vlc_spsc_fifo_Signal()
+ * was called since the sequence number was obtained. Spurious wake-ups can
+ * occur.
+ *
+ * \param seq sequence number from vlc_spsc_fifo_GetSequence()
+ */
+void vlc_spsc_fifo_Wait(struct vlc_spsc_fifo *fifo, unsigned seq);
+
+/**
+ * Wakes the consumer up.
+ *
+ * This can be called from any thread, typically after changing another
+ * wake-up condition of the consumer.
+ */
+void vlc_spsc_fifo_Signal(struct vlc_spsc_fifo *fifo);
+
+/** @} */
+#endif
@@ -42,6 +42,8 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
 #include "../libvlc.h"
 
 #include <string.h>
@@ -68,10 +70,43 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* Stream data segments shared by the clients */
+#define HTTPD_SEGMENT_SIZE 65536
+/* Maximum number of segments a client sends at once */
+#define HTTPD_CL_SEGMENTS 32
+
+/**
+ * Immutable piece of stream data, shared by all the clients of a stream.
+ *
+ * Data is only ever appended to the last segment, past the size that the
+ * clients have seen, so they can send it without holding the stream lock.
+ */
+typedef struct httpd_segment_t
+{
+    vlc_atomic_rc_t rc;
+    int64_t     i_pos;      /* stream position of the first byte */
+    size_t      i_size;     /* bytes of data, protected by the stream lock */
+    size_t      i_alloc;
+    uint8_t     p_data[];
+} httpd_segment_t;
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static void httpd_AppendData(httpd_stream_t *stream, const uint8_t *p_data,
+                             size_t i_data);
 
-/* each host run in his own thread */
+/* each worker runs its own event loop over a share of the host clients */
+typedef struct httpd_worker_t
+{
+    httpd_host_t *host;
+    vlc_thread_t thread;
+    vlc_interrupt_t *interrupt; /* to wake up for new clients, if needed */
+
+    vlc_mutex_t lock; /* protects the clients, taken before the host lock */
+    size_t client_count;
+    struct vlc_list clients;
+} httpd_worker_t;
+
+/* each host runs one or more worker threads */
 struct httpd_host_t
 {
     struct vlc_object_t obj;
@@ -85,7 +120,6 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
 
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
@@ -94,12 +128,15 @@ struct httpd_host_t
      * */
     struct vlc_list urls;
 
-    size_t client_count;
-    struct vlc_list clients;
     unsigned timeout_sec;
 
     /* TLS data */
     vlc_tls_server_t *p_tls;
+
+    /* the first worker accepts the connections and deals them in turn */
+    unsigned next_worker;
+    unsigned workerc;
+    httpd_worker_t workerv[];
 };
 
 
@@ -107,7 +144,6 @@ struct httpd_url_t
 {
     httpd_host_t *host;
     struct vlc_list node;
-    vlc_mutex_t lock;
 
     char      *psz_url;
     char      *psz_user;
@@ -161,6 +197,12 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* Stream data being sent, without copy, from the shared segments */
+    httpd_segment_t *seg_v[HTTPD_CL_SEGMENTS];
+    struct iovec    seg_iov[HTTPD_CL_SEGMENTS];
+    unsigned        seg_first;
+    unsigned        seg_count;
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -612,9 +654,11 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* shared segments, oldest first */
+    size_t      i_buffer_size;      /* bytes of data to keep */
+    size_t      i_buffer_used;      /* bytes allocated to segments */
+    httpd_segment_t **pp_segments;
+    size_t      i_segments;
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -623,57 +667,94 @@ struct httpd_stream_t
     httpd_header * p_http_headers;
 };
 
-static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
-                                 httpd_client_t *cl, httpd_message_t *answer,
-                                 const httpd_message_t *query)
+static void httpd_SegmentRelease(httpd_segment_t *seg)
 {
-    httpd_stream_t *stream = (httpd_stream_t*)p_sys;
+    if (vlc_atomic_rc_dec(&seg->rc))
+        free(seg);
+}
 
-    if (!answer || !query || !cl)
-        return VLC_SUCCESS;
+/* Hands the next stream data over to the client, by reference */
+static int httpd_StreamGrab(httpd_stream_t *stream, httpd_client_t *cl,
+                            httpd_message_t *answer)
+{
+    int64_t i_offset = answer->i_body_offset;
 
-    if (answer->i_body_offset > 0) {
-        int     i_pos;
+    if (i_offset >= stream->i_buffer_pos)
+        return VLC_EGENERIC;    /* wait, no data available */
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
+    if (cl->i_keyframe_wait_to_pass >= 0) {
+        if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            /* still waiting for the next keyframe */
+            return VLC_EGENERIC;
 
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
+        /* seek to the new keyframe */
+        i_offset = stream->i_last_keyframe_seen_pos;
+        cl->i_keyframe_wait_to_pass = -1;
+    }
 
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
-        }
+    assert(stream->i_segments > 0);
+    httpd_segment_t *const *segv = stream->pp_segments;
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+    if (i_offset < segv[0]->i_pos) {
+        /* this client isn't fast enough */
+        i_offset = stream->i_buffer_last_pos;
+        if (i_offset < segv[0]->i_pos)
+            i_offset = segv[0]->i_pos;
+    }
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+    /* Find the segment with the data */
+    size_t lo = 0, hi = stream->i_segments;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+        if (segv[mid]->i_pos <= i_offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+    assert(cl->seg_count == 0);
+    for (size_t i = lo; i < stream->i_segments; i++) {
+        httpd_segment_t *seg = segv[i];
+        size_t i_skip = i_offset - seg->i_pos;
 
-        /* using HTTPD_MSG_ANSWER -> data available */
-        answer->i_proto  = HTTPD_PROTO_HTTP;
-        answer->i_version= 0;
-        answer->i_type   = HTTPD_MSG_ANSWER;
+        if (cl->seg_count >= HTTPD_CL_SEGMENTS || seg->i_size <= i_skip)
+            break;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
+        vlc_atomic_rc_inc(&seg->rc);
+        cl->seg_v[cl->seg_count] = seg;
+        cl->seg_iov[cl->seg_count].iov_base = seg->p_data + i_skip;
+        cl->seg_iov[cl->seg_count].iov_len = seg->i_size - i_skip;
+        cl->seg_count++;
+        i_offset += seg->i_size - i_skip;
+    }
+
+    if (cl->seg_count == 0)
+        return VLC_EGENERIC;
+    cl->seg_first = 0;
 
-        answer->i_body_offset += i_write;
+    /* using HTTPD_MSG_ANSWER -> data available */
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 0;
+    answer->i_type   = HTTPD_MSG_ANSWER;
+    answer->i_body_offset = i_offset;
+    return VLC_SUCCESS;
+}
 
+static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
+                                 httpd_client_t *cl, httpd_message_t *answer,
+                                 const httpd_message_t *query)
+{
+    httpd_stream_t *stream = (httpd_stream_t*)p_sys;
+
+    if (!answer || !query || !cl)
         return VLC_SUCCESS;
+
+    if (answer->i_body_offset > 0) {
+        vlc_mutex_lock(&stream->lock);
+        int ret = httpd_StreamGrab(stream, cl, answer);
+        vlc_mutex_unlock(&stream->lock);
+        return ret;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
@@ -757,7 +838,6 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
         return NULL;
 
     stream->psz_mime = NULL;
-    stream->p_buffer = NULL;
 
     stream->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
     if (!stream->url)
@@ -773,11 +853,11 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
 
     stream->i_header = 0;
     stream->p_header = NULL;
-    stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-
-    stream->p_buffer = malloc(stream->i_buffer_size);
-    if (stream->p_buffer == NULL)
-        goto error;
+    stream->i_buffer_size = var_InheritInteger(host, "http-stream-buffer")
+                            * 1000;
+    stream->i_buffer_used = 0;
+    stream->pp_segments = NULL;
+    stream->i_segments = 0;
 
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
@@ -824,22 +904,69 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+static httpd_segment_t *httpd_SegmentNew(httpd_stream_t *stream, size_t size)
+{
+    httpd_segment_t **segv = realloc(stream->pp_segments,
+                                     (stream->i_segments + 1) * sizeof (*segv));
+    if (unlikely(segv == NULL))
+        return NULL;
+    stream->pp_segments = segv;
+
+    size = __MAX(size, HTTPD_SEGMENT_SIZE);
+
+    httpd_segment_t *seg = malloc(sizeof (*seg) + size);
+    if (unlikely(seg == NULL))
+        return NULL;
+
+    vlc_atomic_rc_init(&seg->rc);
+    seg->i_pos = stream->i_buffer_pos;
+    seg->i_size = 0;
+    seg->i_alloc = size;
+    segv[stream->i_segments++] = seg;
+    stream->i_buffer_used += size;
+    return seg;
+}
+
+static void httpd_AppendData(httpd_stream_t *stream, const uint8_t *p_data,
+                             size_t i_data)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
+    httpd_segment_t *seg = NULL;
+
+    if (stream->i_segments > 0)
+        seg = stream->pp_segments[stream->i_segments - 1];
+
+    while (i_data > 0) {
+        if (seg == NULL || seg->i_size == seg->i_alloc) {
+            seg = httpd_SegmentNew(stream, i_data);
+            if (unlikely(seg == NULL))
+                break; /* drop data */
+        }
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
+        size_t i_copy = __MIN(i_data, seg->i_alloc - seg->i_size);
 
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+        memcpy(&seg->p_data[seg->i_size], p_data, i_copy);
+        seg->i_size += i_copy;
+        stream->i_buffer_pos += i_copy;
+        p_data += i_copy;
+        i_data -= i_copy;
     }
 
-    stream->i_buffer_pos += i_data;
+    /* Forget the oldest data. Clients still sending it hold references. */
+    size_t i_drop = 0;
+
+    while (stream->i_segments - i_drop > 1
+        && stream->i_buffer_used - stream->pp_segments[i_drop]->i_alloc
+           >= stream->i_buffer_size) {
+        stream->i_buffer_used -= stream->pp_segments[i_drop]->i_alloc;
+        httpd_SegmentRelease(stream->pp_segments[i_drop]);
+        i_drop++;
+    }
+
+    if (i_drop > 0) {
+        stream->i_segments -= i_drop;
+        memmove(stream->pp_segments, stream->pp_segments + i_drop,
+                stream->i_segments * sizeof (*stream->pp_segments));
+    }
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
@@ -873,7 +1000,9 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     free(stream->p_http_headers);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    for (size_t i = 0; i < stream->i_segments; i++)
+        httpd_SegmentRelease(stream->pp_segments[i]);
+    free(stream->pp_segments);
     free(stream);
 }
 
@@ -927,6 +1056,20 @@ static struct httpd
     struct vlc_list hosts;
 } httpd = { VLC_STATIC_MUTEX, VLC_LIST_INITIALIZER(&httpd.hosts) };
 
+static void httpd_HostStop(httpd_host_t *host, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++)
+        vlc_cancel(host->workerv[i].thread);
+
+    for (unsigned i = 0; i < count; i++) {
+        httpd_worker_t *w = &host->workerv[i];
+
+        vlc_join(w->thread, NULL);
+        if (w->interrupt != NULL)
+            vlc_interrupt_destroy(w->interrupt);
+    }
+}
+
 static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                        const char *hostvar,
                                        const char *portvar,
@@ -935,6 +1078,10 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 {
     httpd_host_t *host;
     unsigned port = var_InheritInteger(p_this, portvar);
+    unsigned workerc = var_InheritInteger(p_this, "http-threads");
+
+    if (workerc < 1)
+        workerc = 1;
 
     /* to be sure to avoid multiple creation */
     vlc_mutex_lock(&httpd.mutex);
@@ -955,7 +1102,8 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     }
 
     /* create the new host */
-    host = (httpd_host_t *)vlc_custom_create(p_this, sizeof (*host),
+    host = (httpd_host_t *)vlc_custom_create(p_this, sizeof (*host)
+                                     + workerc * sizeof (host->workerv[0]),
                                               "http host");
     if (!host)
         goto error;
@@ -976,15 +1124,37 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     host->port     = port;
     vlc_list_init(&host->urls);
-    host->client_count = 0;
-    vlc_list_init(&host->clients);
     host->timeout_sec = timeout_sec;
     host->p_tls    = p_tls;
+    host->next_worker = 0;
+
+    /* create the threads */
+    for (host->workerc = 0; host->workerc < workerc; host->workerc++) {
+        httpd_worker_t *w = &host->workerv[host->workerc];
+
+        w->host = host;
+        vlc_mutex_init(&w->lock);
+        w->client_count = 0;
+        vlc_list_init(&w->clients);
+        /* the first worker accepts new clients by itself */
+        w->interrupt = NULL;
+        if (host->workerc > 0) {
+            w->interrupt = vlc_interrupt_create();
+            if (unlikely(w->interrupt == NULL))
+                break;
+        }
+
+        if (vlc_clone(&w->thread, httpd_HostThread, w,
+                      VLC_THREAD_PRIORITY_LOW)) {
+            if (w->interrupt != NULL)
+                vlc_interrupt_destroy(w->interrupt);
+            break;
+        }
+    }
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
+    if (host->workerc < workerc) {
         msg_Err(p_this, "cannot spawn http host thread");
+        httpd_HostStop(host, host->workerc);
         goto error;
     }
 
@@ -1021,15 +1191,15 @@ void httpd_HostDelete(httpd_host_t *host)
     }
 
     vlc_list_remove(&host->node);
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    httpd_HostStop(host, host->workerc);
 
     msg_Dbg(host, "HTTP host removed");
 
-    vlc_list_foreach(client, &host->clients, node) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(client);
-    }
+    for (unsigned i = 0; i < host->workerc; i++)
+        vlc_list_foreach(client, &host->workerv[i].clients, node) {
+            msg_Warn(host, "client still connected");
+            httpd_ClientDestroy(client);
+        }
 
     assert(vlc_list_is_empty(&host->urls));
     vlc_tls_ServerDelete(host->p_tls);
@@ -1065,8 +1235,6 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
 
     url->host = host;
 
-    vlc_mutex_init(&url->lock);
-
     url->psz_url = strdup(psz_url);
     if (url->psz_url == NULL)
         goto error;
@@ -1102,10 +1270,11 @@ error:
 int httpd_UrlCatch(httpd_url_t *url, int i_msg, httpd_callback_t cb,
                     httpd_callback_sys_t *p_sys)
 {
-    vlc_mutex_lock(&url->lock);
+    /* Serialized with the callbacks, called by the worker threads */
+    vlc_mutex_lock(&url->host->lock);
     url->catch[i_msg].cb   = cb;
     url->catch[i_msg].p_sys= p_sys;
-    vlc_mutex_unlock(&url->lock);
+    vlc_mutex_unlock(&url->host->lock);
 
     return VLC_SUCCESS;
 }
@@ -1118,22 +1287,29 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     vlc_list_remove(&url->node);
+    vlc_mutex_unlock(&host->lock);
 
-    free(url->psz_url);
-    free(url->psz_user);
-    free(url->psz_password);
+    /* No new clients can reach the URL anymore */
+    for (unsigned i = 0; i < host->workerc; i++) {
+        httpd_worker_t *w = &host->workerv[i];
 
-    vlc_list_foreach(client, &host->clients, node) {
-        if (client->url != url)
-            continue;
+        vlc_mutex_lock(&w->lock);
+        vlc_list_foreach(client, &w->clients, node) {
+            if (client->url != url)
+                continue;
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        host->client_count--;
-        httpd_ClientDestroy(client);
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            w->client_count--;
+            httpd_ClientDestroy(client);
+        }
+        vlc_mutex_unlock(&w->lock);
     }
+
+    free(url->psz_url);
+    free(url->psz_user);
+    free(url->psz_password);
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1218,6 +1394,8 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
 static void httpd_ClientDestroy(httpd_client_t *cl)
 {
     vlc_list_remove(&cl->node);
+    for (unsigned i = cl->seg_first; i < cl->seg_count; i++)
+        httpd_SegmentRelease(cl->seg_v[i]);
     vlc_tls_Close(cl->sock);
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
@@ -1240,6 +1418,8 @@ static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->seg_first = 0;
+    cl->seg_count = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1262,6 +1442,36 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
     return sock->ops->writev(sock, &iov, 1);
 }
 
+/* Sends the shared stream segments with gather I/O */
+static
+ssize_t httpd_NetSendSegments (httpd_client_t *cl)
+{
+    vlc_tls_t *sock = cl->sock;
+    ssize_t val = sock->ops->writev(sock, &cl->seg_iov[cl->seg_first],
+                                    cl->seg_count - cl->seg_first);
+    if (val <= 0)
+        return val;
+
+    size_t len = val;
+
+    while (len > 0) {
+        struct iovec *iov = &cl->seg_iov[cl->seg_first];
+
+        if (len < iov->iov_len) {
+            iov->iov_base = (uint8_t *)iov->iov_base + len;
+            iov->iov_len -= len;
+            break;
+        }
+
+        len -= iov->iov_len;
+        httpd_SegmentRelease(cl->seg_v[cl->seg_first++]);
+    }
+
+    if (cl->seg_first == cl->seg_count)
+        cl->seg_first = cl->seg_count = 0;
+    return val;
+}
+
 
 static const struct
 {
@@ -1605,8 +1815,13 @@ static int httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
+    const bool b_segments = cl->seg_count > 0;
+
+    if (b_segments)
+        i_len = httpd_NetSendSegments(cl);
+    else
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
 
     if (i_len < 0) {
 #if defined(_WIN32)
@@ -1621,19 +1836,27 @@ static int httpd_ClientSend(httpd_client_t *cl)
         return 0;
     }
 
-    cl->i_buffer += i_len;
+    if (!b_segments)
+        cl->i_buffer += i_len;
+    else if (cl->seg_count > 0)
+        return 0; /* more stream data to send */
 
     if (cl->i_buffer >= cl->i_buffer_size) {
         if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
             /* catch more body data */
+            httpd_host_t *host = cl->url->host;
             int     i_msg = cl->query.i_type;
             int64_t i_offset = cl->answer.i_body_offset;
 
             httpd_MsgClean(&cl->answer);
             cl->answer.i_body_offset = i_offset;
 
-            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                                     &cl->answer, &cl->query);
+            /* URL callbacks are serialized across worker threads */
+            vlc_mutex_lock(&host->lock);
+            if (cl->url->catch[i_msg].cb != NULL)
+                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                                         &cl->answer, &cl->query);
+            vlc_mutex_unlock(&host->lock);
         }
 
         if (cl->answer.i_body > 0) {
@@ -1645,7 +1868,7 @@ static int httpd_ClientSend(httpd_client_t *cl)
 
             cl->answer.i_body = 0;
             cl->answer.p_body = NULL;
-        } else /* send finished */
+        } else if (cl->seg_count == 0) /* send finished */
             cl->i_state = HTTPD_CLIENT_SEND_DONE;
     }
     return 0;
@@ -1702,24 +1925,48 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* hands a new client over to the next worker */
+static void httpd_HostDispatch(httpd_host_t *host, httpd_client_t *cl,
+                               vlc_tick_t now)
+{
+    httpd_worker_t *w = &host->workerv[host->next_worker];
+
+    host->next_worker = (host->next_worker + 1) % host->workerc;
+
+    cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
+
+    vlc_mutex_lock(&w->lock);
+    w->client_count++;
+    vlc_list_append(&cl->node, &w->clients);
+    vlc_mutex_unlock(&w->lock);
+
+    if (w->interrupt != NULL)
+        vlc_interrupt_raise(w->interrupt);
+}
+
+static void httpdLoop(httpd_worker_t *w)
 {
-    struct pollfd ufd[host->nfd + host->client_count];
+    httpd_host_t *host = w->host;
+    /* only the first worker listens */
+    const unsigned lfd = (w == host->workerv) ? host->nfd : 0;
+
+    vlc_mutex_lock(&w->lock);
+
+    struct pollfd ufd[lfd + w->client_count + 1]; /* never zero-sized */
     unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
+    for (nfd = 0; nfd < lfd; nfd++) {
         ufd[nfd].fd = host->fds[nfd];
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
     }
 
-    vlc_mutex_lock(&host->lock);
     /* add all socket that should be read/write and close dead connection */
     vlc_tick_t now = vlc_tick_now();
     int delay = -1;
     httpd_client_t *cl;
 
     int canc = vlc_savecancel();
-    vlc_list_foreach(cl, &host->clients, node) {
+    vlc_list_foreach(cl, &w->clients, node) {
         int val = -1;
 
         switch (cl->i_state) {
@@ -1737,7 +1984,7 @@ static void httpdLoop(httpd_host_t *host)
 
         if (cl->i_state == HTTPD_CLIENT_DEAD
          || (host->timeout_sec > 0 && cl->i_timeout_date < now)) {
-            host->client_count--;
+            w->client_count--;
             httpd_ClientDestroy(cl);
             continue;
         }
@@ -1849,6 +2096,7 @@ static void httpdLoop(httpd_host_t *host)
                         bool b_auth_failed = false;
 
                         /* Search the url and trigger callbacks */
+                        vlc_mutex_lock(&host->lock);
                         vlc_list_foreach(url, &host->urls, node) {
                             if (strcmp(url->psz_url, query->psz_url))
                                 continue;
@@ -1876,6 +2124,7 @@ static void httpdLoop(httpd_host_t *host)
                             if (!cl->url)
                                 cl->url = url;
                         }
+                        vlc_mutex_unlock(&host->lock);
 
                         if (answer) {
                             answer->i_proto  = query->i_proto;
@@ -1958,8 +2207,11 @@ static void httpdLoop(httpd_host_t *host)
                 httpd_MsgInit(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
+                vlc_mutex_lock(&host->lock);
+                if (cl->url->catch[i_msg].cb != NULL)
+                    cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                            &cl->answer, &cl->query);
+                vlc_mutex_unlock(&host->lock);
                 if (cl->answer.i_type != HTTPD_MSG_NONE) {
                     /* we have new data, so re-enter send mode */
                     cl->i_buffer      = 0;
@@ -1976,28 +2228,31 @@ static void httpdLoop(httpd_host_t *host)
 
         if (pufd->events != 0)
             nfd++;
+        /* the state changed, go on without waiting */
+        else if (cl->i_state != HTTPD_CLIENT_WAITING)
+            delay = 0;
         /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
         else if (delay != 0)
             delay = 20;
     }
-    vlc_mutex_unlock(&host->lock);
+    vlc_mutex_unlock(&w->lock);
     vlc_restorecancel(canc);
 
-    while (poll(ufd, nfd, delay) < 0)
+    /* Other workers are interrupted when they get new clients */
+    if (vlc_poll_i11e(ufd, nfd, delay) < 0)
     {
         if (errno != EINTR)
             msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+        return;
     }
 
     canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
 
     /* Handle client sockets */
     now = vlc_tick_now();
-    nfd = host->nfd;
 
     /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
+    for (nfd = 0; nfd < lfd; nfd++) {
         int fd = ufd[nfd].fd;
 
         assert (fd == host->fds[nfd]);
@@ -2044,21 +2299,20 @@ static void httpdLoop(httpd_host_t *host)
         if (host->p_tls != NULL)
             cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
 
-        cl->i_timeout_date = now + VLC_TICK_FROM_SEC(host->timeout_sec);
-        host->client_count++;
-        vlc_list_append(&cl->node, &host->clients);
+        httpd_HostDispatch(host, cl, now);
     }
 
-    vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 }
 
 static void* httpd_HostThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *w = data;
+
+    vlc_interrupt_set(w->interrupt);
 
-    while (atomic_load_explicit(&host->ref, memory_order_relaxed) > 0)
-        httpdLoop(host);
+    while (atomic_load_explicit(&w->host->ref, memory_order_relaxed) > 0)
+        httpdLoop(w);
     return NULL;
 }
 
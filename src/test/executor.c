@@ -25,6 +25,8 @@
 #undef NDEBUG
 
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
 
 #include <vlc_common.h>
 #include <vlc_executor.h>
@@ -271,6 +273,260 @@ static void test_task_chain(void)
         assert(array[i] == 2 * i);
 }
 
+struct blocker
+{
+    vlc_mutex_t lock;
+    vlc_cond_t cond;
+    bool started;
+    bool released;
+};
+
+static void RunBlocker(void *userdata)
+{
+    struct blocker *blocker = userdata;
+
+    vlc_mutex_lock(&blocker->lock);
+    blocker->started = true;
+    vlc_cond_signal(&blocker->cond);
+    while (!blocker->released)
+        vlc_cond_wait(&blocker->cond, &blocker->lock);
+    vlc_mutex_unlock(&blocker->lock);
+}
+
+struct order
+{
+    int *log;
+    int *count;
+    int value;
+};
+
+static void RunOrder(void *userdata)
+{
+    struct order *order = userdata;
+
+    /* Single executor thread, no need for locking */
+    order->log[(*order->count)++] = order->value;
+}
+
+static void test_priority(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(1);
+    assert(executor);
+
+    struct blocker blocker;
+    vlc_mutex_init(&blocker.lock);
+    vlc_cond_init(&blocker.cond);
+    blocker.started = blocker.released = false;
+
+    struct vlc_runnable block = {
+        .run = RunBlocker,
+        .userdata = &blocker,
+    };
+    vlc_executor_Submit(executor, &block);
+
+    /* Make sure the only thread is busy before queuing */
+    vlc_mutex_lock(&blocker.lock);
+    while (!blocker.started)
+        vlc_cond_wait(&blocker.cond, &blocker.lock);
+    vlc_mutex_unlock(&blocker.lock);
+
+    static const enum vlc_executor_priority priorities[] = {
+        VLC_EXECUTOR_PRIORITY_LOW, VLC_EXECUTOR_PRIORITY_NORMAL,
+        VLC_EXECUTOR_PRIORITY_HIGH, VLC_EXECUTOR_PRIORITY_LOW,
+        VLC_EXECUTOR_PRIORITY_HIGH, VLC_EXECUTOR_PRIORITY_NORMAL,
+    };
+    /* Highest priority first, then submission order */
+    static const int expected[] = { 2, 4, 1, 5, 0, 3 };
+
+    int log[ARRAY_SIZE(priorities)];
+    int count = 0;
+    struct order orders[ARRAY_SIZE(priorities)];
+    struct vlc_runnable runnables[ARRAY_SIZE(priorities)];
+
+    for (size_t i = 0; i < ARRAY_SIZE(priorities); ++i)
+    {
+        orders[i].log = log;
+        orders[i].count = &count;
+        orders[i].value = i;
+        runnables[i].run = RunOrder;
+        runnables[i].userdata = &orders[i];
+        vlc_executor_SubmitPriority(executor, &runnables[i], priorities[i]);
+    }
+
+    struct vlc_executor_stats stats;
+    vlc_executor_GetStats(executor, &stats);
+    assert(stats.threads == 1);
+    assert(stats.queued == ARRAY_SIZE(priorities));
+
+    vlc_mutex_lock(&blocker.lock);
+    blocker.released = true;
+    vlc_cond_signal(&blocker.cond);
+    vlc_mutex_unlock(&blocker.lock);
+
+    vlc_executor_WaitIdle(executor);
+
+    assert(count == ARRAY_SIZE(expected));
+    for (size_t i = 0; i < ARRAY_SIZE(expected); ++i)
+        assert(log[i] == expected[i]);
+
+    vlc_executor_GetStats(executor, &stats);
+    assert(stats.queued == 0);
+    assert(stats.max_queued == ARRAY_SIZE(priorities));
+    assert(stats.started == ARRAY_SIZE(priorities) + 1);
+    assert(stats.canceled == 0);
+    assert(stats.wait_max >= 0 && stats.wait_total >= stats.wait_max);
+
+    vlc_executor_Delete(executor);
+}
+
+#define IDLE_PRODUCERS 8
+#define IDLE_ROUNDS 2000 /* per producer */
+
+struct idle_producer
+{
+    vlc_thread_t thread;
+    vlc_executor_t *executor;
+    vlc_sem_t done;
+};
+
+static void RunPost(void *userdata)
+{
+    struct idle_producer *producer = userdata;
+
+    vlc_sem_post(&producer->done);
+}
+
+/* Each producer waits for its task before submitting the next one, so that
+ * the executor threads keep going idle while tasks are submitted */
+static void *RunIdleProducer(void *userdata)
+{
+    struct idle_producer *producer = userdata;
+    struct vlc_runnable runnable = {
+        .run = RunPost,
+        .userdata = producer,
+    };
+
+    for (int i = 0; i < IDLE_ROUNDS; ++i)
+    {
+        vlc_executor_Submit(producer->executor, &runnable);
+
+        /* A lost wakeup leaves the task queued */
+        int ret = vlc_sem_timedwait(&producer->done,
+                                    vlc_tick_now() + VLC_TICK_FROM_SEC(5));
+        assert(ret == 0);
+    }
+    return NULL;
+}
+
+static void test_idle_wakeup(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(4);
+    assert(executor);
+
+    struct idle_producer producers[IDLE_PRODUCERS];
+
+    for (int i = 0; i < IDLE_PRODUCERS; ++i)
+    {
+        producers[i].executor = executor;
+        vlc_sem_init(&producers[i].done, 0);
+        int ret = vlc_clone(&producers[i].thread, RunIdleProducer,
+                            &producers[i], VLC_THREAD_PRIORITY_LOW);
+        assert(ret == 0);
+    }
+
+    for (int i = 0; i < IDLE_PRODUCERS; ++i)
+        vlc_join(producers[i].thread, NULL);
+
+    vlc_executor_WaitIdle(executor);
+
+    struct vlc_executor_stats stats;
+    vlc_executor_GetStats(executor, &stats);
+    assert(stats.started == IDLE_PRODUCERS * IDLE_ROUNDS);
+    assert(stats.queued == 0);
+
+    vlc_executor_Delete(executor);
+}
+
+static void RunNothing(void *userdata)
+{
+    atomic_uint *counter = userdata;
+
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+#define BENCH_PRODUCERS 4
+#define BENCH_TASKS 20000 /* per producer */
+
+struct producer
+{
+    vlc_thread_t thread;
+    vlc_executor_t *executor;
+    struct vlc_runnable *runnables;
+    atomic_uint *counter;
+};
+
+static void *RunProducer(void *userdata)
+{
+    struct producer *producer = userdata;
+
+    for (int i = 0; i < BENCH_TASKS; ++i)
+    {
+        struct vlc_runnable *runnable = &producer->runnables[i];
+        runnable->run = RunNothing;
+        runnable->userdata = producer->counter;
+        vlc_executor_Submit(producer->executor, runnable);
+    }
+    return NULL;
+}
+
+/* Many producers submitting tiny tasks to many threads */
+static void bench_contention(unsigned threads)
+{
+    vlc_executor_t *executor = vlc_executor_New(threads);
+    assert(executor);
+
+    struct vlc_runnable *runnables =
+        malloc(BENCH_PRODUCERS * BENCH_TASKS * sizeof(*runnables));
+    assert(runnables);
+
+    atomic_uint counter = 0;
+    struct producer producers[BENCH_PRODUCERS];
+    vlc_tick_t start = vlc_tick_now();
+
+    for (int i = 0; i < BENCH_PRODUCERS; ++i)
+    {
+        producers[i].executor = executor;
+        producers[i].runnables = runnables + i * BENCH_TASKS;
+        producers[i].counter = &counter;
+        int ret = vlc_clone(&producers[i].thread, RunProducer, &producers[i],
+                            VLC_THREAD_PRIORITY_LOW);
+        assert(ret == 0);
+    }
+
+    for (int i = 0; i < BENCH_PRODUCERS; ++i)
+        vlc_join(producers[i].thread, NULL);
+    vlc_executor_WaitIdle(executor);
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    assert(atomic_load(&counter) == BENCH_PRODUCERS * BENCH_TASKS);
+
+    struct vlc_executor_stats stats;
+    vlc_executor_GetStats(executor, &stats);
+    assert(stats.started == BENCH_PRODUCERS * BENCH_TASKS);
+
+    printf("%u threads: %8.0f tasks/s, max depth %5zu, "
+           "mean wait %6"PRId64" us, max wait %6"PRId64" us, %4.1f%% stolen\n",
+           stats.threads,
+           BENCH_PRODUCERS * BENCH_TASKS / secf_from_vlc_tick(elapsed + 1),
+           stats.max_queued,
+           US_FROM_VLC_TICK(stats.wait_total / stats.started),
+           US_FROM_VLC_TICK(stats.wait_max),
+           100. * stats.stolen / stats.started);
+
+    vlc_executor_Delete(executor);
+    free(runnables);
+}
+
 int main(void)
 {
     test_single_runnable();
@@ -278,5 +534,10 @@ int main(void)
     test_blocking_delete();
     test_cancel();
     test_task_chain();
+    test_priority();
+    test_idle_wakeup();
+
+    for (unsigned threads = 1; threads <= 8; threads *= 2)
+        bench_contention(threads);
     return 0;
 }
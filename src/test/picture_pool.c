@@ -29,8 +29,13 @@
 #include <vlc_common.h>
 #include <vlc_es.h>
 #include <vlc_picture_pool.h>
+#include <vlc_threads.h>
+#include <vlc_tick.h>
 
 #define PICTURES 10
+#define LARGE_PICTURES 200
+#define STRESS_THREADS 4
+#define STRESS_LOOPS 20000
 
 const char vlc_module_name[] = "test_picture_pool";
 
@@ -108,6 +113,87 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+/* More pictures than fit in a single word of the available bitmap */
+static void test_large(void)
+{
+    static picture_t *pics[LARGE_PICTURES];
+
+    pool = picture_pool_NewFromFormat(&fmt, LARGE_PICTURES);
+    assert(pool != NULL);
+
+    for (unsigned i = 0; i < LARGE_PICTURES; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+        for (unsigned j = 0; j < i; j++)
+            assert(pics[j]->p[0].p_pixels != pics[i]->p[0].p_pixels);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    for (unsigned i = 0; i < LARGE_PICTURES; i += 3) {
+        void *plane = pics[i]->p[0].p_pixels;
+
+        picture_Release(pics[i]);
+        pics[i] = picture_pool_Wait(pool);
+        assert(pics[i] != NULL);
+        assert(pics[i]->p[0].p_pixels == plane);
+    }
+
+    for (unsigned i = 0; i < LARGE_PICTURES; i++)
+        picture_Release(pics[i]);
+    picture_pool_Release(pool);
+}
+
+/* Each thread holds two pictures at a time, with just enough pictures for
+ * all the threads to make progress, so that they often wait for another. */
+static void *Stress(void *data)
+{
+    picture_pool_t *p = data;
+
+    for (unsigned i = 0; i < STRESS_LOOPS; i++) {
+        picture_t *a = picture_pool_Wait(p);
+        picture_t *b = (i & 1) ? picture_pool_Get(p) : picture_pool_Wait(p);
+
+        assert(a != NULL);
+        assert(a != b);
+        picture_Release(a);
+        if (b != NULL)
+            picture_Release(b);
+    }
+    return NULL;
+}
+
+static void test_stress(unsigned threads)
+{
+    const unsigned count = threads + 1;
+    vlc_thread_t th[STRESS_THREADS];
+    picture_t *pics[STRESS_THREADS + 1];
+
+    pool = picture_pool_NewFromFormat(&fmt, count);
+    assert(pool != NULL);
+
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < threads; i++)
+        assert(vlc_clone(&th[i], Stress, pool, VLC_THREAD_PRIORITY_LOW) == 0);
+    for (unsigned i = 0; i < threads; i++)
+        vlc_join(th[i], NULL);
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    /* All the pictures are back in the pool */
+    for (unsigned i = 0; i < count; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(pics[i]);
+    picture_pool_Release(pool);
+
+    printf("%u threads: %10.0f pictures/s\n", threads,
+           threads * STRESS_LOOPS * 2 / secf_from_vlc_tick(elapsed + 1));
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -123,6 +209,10 @@ int main(void)
 
     test(false);
     test(true);
+    test_large();
+
+    for (unsigned threads = 1; threads <= STRESS_THREADS; threads *= 2)
+        test_stress(threads);
 
     return 0;
 }
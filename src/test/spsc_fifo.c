@@ -0,0 +1,272 @@
+/*****************************************************************************
+ * src/test/spsc_fifo.c: lock-free block queue test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_tick.h>
+#include "../misc/spsc_fifo.h"
+
+#define BENCH_BLOCKS   64 /* in flight */
+#define BENCH_MESSAGES 500000
+
+static block_t *NewBlock(size_t size, vlc_tick_t seq)
+{
+    block_t *block = block_Alloc(size);
+    assert(block != NULL);
+    block->i_dts = seq;
+    return block;
+}
+
+static void test_basic(void)
+{
+    struct vlc_spsc_fifo *fifo = vlc_spsc_fifo_New(3);
+    assert(fifo != NULL);
+    assert(vlc_spsc_fifo_Pop(fifo) == NULL);
+
+    /* The size is rounded up to 4 */
+    for (unsigned i = 0; i < 4; i++)
+        assert(vlc_spsc_fifo_Push(fifo, NewBlock(10 * (i + 1), i)));
+
+    block_t *extra = NewBlock(100, 4);
+    assert(!vlc_spsc_fifo_Push(fifo, extra));
+    assert(vlc_spsc_fifo_GetCount(fifo) == 4);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 100);
+
+    block_t *block = vlc_spsc_fifo_Pop(fifo);
+    assert(block != NULL && block->i_dts == 0);
+    block_Release(block);
+    assert(vlc_spsc_fifo_GetCount(fifo) == 3);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 90);
+
+    /* Flushed blocks are gone, later ones are not */
+    vlc_spsc_fifo_Flush(fifo);
+    assert(vlc_spsc_fifo_GetCount(fifo) == 0);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 0);
+    /* Flushed blocks still take room until dequeued */
+    assert(vlc_spsc_fifo_Push(fifo, extra));
+    assert(vlc_spsc_fifo_GetCount(fifo) == 1);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 100);
+
+    block = vlc_spsc_fifo_Pop(fifo);
+    assert(block == extra);
+    block_Release(block);
+    assert(vlc_spsc_fifo_Pop(fifo) == NULL);
+    assert(vlc_spsc_fifo_GetCount(fifo) == 0);
+    assert(vlc_spsc_fifo_GetBytes(fifo) == 0);
+
+    /* Flushing a consumed queue has no effects */
+    vlc_spsc_fifo_Flush(fifo);
+    assert(vlc_spsc_fifo_Push(fifo, NewBlock(1, 5)));
+    assert(vlc_spsc_fifo_GetCount(fifo) == 1);
+
+    /* Pending blocks are released with the queue */
+    vlc_spsc_fifo_Delete(fifo);
+}
+
+static void Discard(void *opaque, block_t *block)
+{
+    unsigned *count = opaque;
+
+    (*count)++;
+    block_Release(block);
+}
+
+static void test_discard(void)
+{
+    struct vlc_spsc_fifo *fifo = vlc_spsc_fifo_New(4);
+    unsigned count = 0;
+
+    assert(fifo != NULL);
+    vlc_spsc_fifo_SetDiscard(fifo, Discard, &count);
+
+    /* Flushed blocks are discarded on the next dequeue */
+    assert(vlc_spsc_fifo_Push(fifo, NewBlock(1, 0)));
+    assert(vlc_spsc_fifo_Push(fifo, NewBlock(1, 1)));
+    vlc_spsc_fifo_Flush(fifo);
+    assert(count == 0);
+    assert(vlc_spsc_fifo_Pop(fifo) == NULL);
+    assert(count == 2);
+
+    /* And so are the pending blocks on deletion */
+    assert(vlc_spsc_fifo_Push(fifo, NewBlock(1, 2)));
+    vlc_spsc_fifo_Delete(fifo);
+    assert(count == 3);
+}
+
+static void test_signal(void)
+{
+    struct vlc_spsc_fifo *fifo = vlc_spsc_fifo_New(4);
+    assert(fifo != NULL);
+
+    /* A wake-up before the wait is not lost */
+    unsigned seq = vlc_spsc_fifo_GetSequence(fifo);
+    vlc_spsc_fifo_Signal(fifo);
+    vlc_spsc_fifo_Wait(fifo, seq);
+
+    seq = vlc_spsc_fifo_GetSequence(fifo);
+    assert(vlc_spsc_fifo_Push(fifo, NewBlock(0, 0)));
+    vlc_spsc_fifo_Wait(fifo, seq);
+    vlc_spsc_fifo_Delete(fifo);
+}
+
+/* Dequeues a block, waiting for it if needed */
+static block_t *PopWait(struct vlc_spsc_fifo *fifo)
+{
+    for (;;)
+    {
+        unsigned seq = vlc_spsc_fifo_GetSequence(fifo);
+        block_t *block = vlc_spsc_fifo_Pop(fifo);
+
+        if (block != NULL)
+            return block;
+        vlc_spsc_fifo_Wait(fifo, seq);
+    }
+}
+
+/*
+ * The benchmark cycles a few blocks between a producer and a consumer thread,
+ * through a data queue and a return queue, so that either thread waits for
+ * the other whenever it gets ahead.
+ */
+struct bench
+{
+    struct vlc_spsc_fifo *data, *free;
+    block_fifo_t *locked_data, *locked_free;
+};
+
+static void *RunConsumer(void *opaque)
+{
+    struct bench *b = opaque;
+
+    for (vlc_tick_t seq = 0; seq < BENCH_MESSAGES; seq++)
+    {
+        block_t *block = PopWait(b->data);
+
+        assert(block->i_dts == seq);
+        assert(vlc_spsc_fifo_Push(b->free, block));
+    }
+    return NULL;
+}
+
+static void *RunLockedConsumer(void *opaque)
+{
+    struct bench *b = opaque;
+
+    for (vlc_tick_t seq = 0; seq < BENCH_MESSAGES; seq++)
+    {
+        block_t *block = vlc_fifo_Get(b->locked_data);
+
+        assert(block->i_dts == seq);
+        vlc_fifo_Put(b->locked_free, block);
+    }
+    return NULL;
+}
+
+static vlc_tick_t bench_spsc(void)
+{
+    struct bench b;
+    vlc_thread_t th;
+
+    b.data = vlc_spsc_fifo_New(BENCH_BLOCKS);
+    b.free = vlc_spsc_fifo_New(BENCH_BLOCKS);
+    assert(b.data != NULL && b.free != NULL);
+    for (unsigned i = 0; i < BENCH_BLOCKS; i++)
+        assert(vlc_spsc_fifo_Push(b.free, NewBlock(188, 0)));
+
+    vlc_tick_t start = vlc_tick_now();
+    assert(vlc_clone(&th, RunConsumer, &b, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (vlc_tick_t seq = 0; seq < BENCH_MESSAGES; seq++)
+    {
+        block_t *block = PopWait(b.free);
+
+        block->i_dts = seq;
+        /* There are fewer blocks than room in the queue */
+        assert(vlc_spsc_fifo_Push(b.data, block));
+    }
+    vlc_join(th, NULL);
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    assert(vlc_spsc_fifo_GetCount(b.data) == 0);
+    assert(vlc_spsc_fifo_GetCount(b.free) == BENCH_BLOCKS);
+    assert(vlc_spsc_fifo_GetBytes(b.free) == BENCH_BLOCKS * 188);
+    vlc_spsc_fifo_Delete(b.data);
+    vlc_spsc_fifo_Delete(b.free);
+    return elapsed;
+}
+
+static vlc_tick_t bench_locked(void)
+{
+    struct bench b;
+    vlc_thread_t th;
+
+    b.locked_data = vlc_fifo_New();
+    b.locked_free = vlc_fifo_New();
+    assert(b.locked_data != NULL && b.locked_free != NULL);
+    for (unsigned i = 0; i < BENCH_BLOCKS; i++)
+        vlc_fifo_Put(b.locked_free, NewBlock(188, 0));
+
+    vlc_tick_t start = vlc_tick_now();
+    assert(vlc_clone(&th, RunLockedConsumer, &b, VLC_THREAD_PRIORITY_LOW) == 0);
+
+    for (vlc_tick_t seq = 0; seq < BENCH_MESSAGES; seq++)
+    {
+        block_t *block = vlc_fifo_Get(b.locked_free);
+
+        block->i_dts = seq;
+        vlc_fifo_Put(b.locked_data, block);
+    }
+    vlc_join(th, NULL);
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    vlc_fifo_Delete(b.locked_data);
+    vlc_fifo_Delete(b.locked_free);
+    return elapsed;
+}
+
+static void bench(const char *name, vlc_tick_t (*run)(void))
+{
+    vlc_tick_t elapsed = run();
+
+    printf("%-8s %10.0f blocks/s\n", name,
+           BENCH_MESSAGES / secf_from_vlc_tick(elapsed + 1));
+}
+
+int main(void)
+{
+    test_basic();
+    test_discard();
+    test_signal();
+
+    bench("locked", bench_locked);
+    bench("spsc", bench_spsc);
+    return 0;
+}
@@ -31,6 +31,10 @@ typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
     atomic_uint late;
+
+    /* Subpicture regions pictures cache, not reset */
+    atomic_uint spu_cache_hits;
+    atomic_uint spu_cache_misses;
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
@@ -38,6 +42,8 @@ static inline void vout_statistic_Init(vout_statistic_t *stat)
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
     atomic_init(&stat->late, 0);
+    atomic_init(&stat->spu_cache_hits, 0);
+    atomic_init(&stat->spu_cache_misses, 0);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -73,4 +79,22 @@ static inline void vout_statistic_AddLate(vout_statistic_t *stat, int late)
     atomic_fetch_add_explicit(&stat->late, late, memory_order_relaxed);
 }
 
+static inline void vout_statistic_AddSpuCache(vout_statistic_t *stat,
+                                              unsigned hits, unsigned misses)
+{
+    atomic_fetch_add_explicit(&stat->spu_cache_hits, hits,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat->spu_cache_misses, misses,
+                              memory_order_relaxed);
+}
+
+static inline void vout_statistic_GetSpuCache(vout_statistic_t *stat,
+                                              unsigned *restrict hits,
+                                              unsigned *restrict misses)
+{
+    *hits = atomic_load_explicit(&stat->spu_cache_hits, memory_order_relaxed);
+    *misses = atomic_load_explicit(&stat->spu_cache_misses,
+                                   memory_order_relaxed);
+}
+
 #endif
@@ -49,6 +49,7 @@
 #include <vlc_plugin.h>
 #include <vlc_codec.h>
 #include <vlc_atomic.h>
+#include <vlc_tracer.h>
 
 #include <libvlc.h>
 #include "vout_private.h"
@@ -362,6 +363,19 @@ picture_t *vout_GetPicture(vout_thread_t *vout)
     return picture;
 }
 
+/* Traces a stage of the pictures of the track of the vout */
+static void TraceSpan(vout_thread_sys_t *sys, const char *span,
+                      const char *phase, vlc_tick_t pts)
+{
+    struct vlc_tracer *tracer = vlc_object_get_tracer(VLC_OBJECT(&sys->obj));
+    if (tracer == NULL || sys->clock == NULL)
+        return;
+
+    const char *id = vlc_clock_GetTrackId(sys->clock);
+    if (id != NULL)
+        vlc_tracer_TraceSpan(tracer, span, phase, id, pts);
+}
+
 /**
  * It gives to the vout a picture to be displayed.
  *
@@ -375,6 +389,7 @@ void vout_PutPicture(vout_thread_t *vout, picture_t *picture)
     vout_thread_sys_t *sys = VOUT_THREAD_TO_SYS(vout);
     assert(!sys->dummy);
     assert( !picture_HasChainedPics( picture ) );
+    TraceSpan(sys, "vout_fifo", "begin", picture->date);
     picture_fifo_Push(sys->decoder_fifo, picture);
     vout_control_Wake(&sys->control);
 }
@@ -895,6 +910,7 @@ static picture_t *PreparePicture(vout_thread_sys_t *vout, bool reuse_decoded,
             decoded = picture_fifo_Pop(sys->decoder_fifo);
 
             if (decoded) {
+                TraceSpan(sys, "vout_fifo", "end", decoded->date);
                 if (is_late_dropped && !decoded->b_force)
                 {
                     const vlc_tick_t system_now = vlc_tick_now();
@@ -937,9 +953,11 @@ static picture_t *PreparePicture(vout_thread_sys_t *vout, bool reuse_decoded,
         sys->displayed.timestamp     = decoded->date;
         sys->displayed.is_interlaced = !decoded->b_progressive;
 
+        TraceSpan(sys, "filter", "begin", sys->displayed.timestamp);
         vout_chrono_Start(&sys->chrono.static_filter);
         picture = filter_chain_VideoFilter(sys->filter.chain_static, sys->displayed.decoded);
         vout_chrono_Stop(&sys->chrono.static_filter);
+        TraceSpan(sys, "filter", "end", sys->displayed.timestamp);
     }
 
     vlc_mutex_unlock(&sys->filter.lock);
@@ -1121,6 +1139,12 @@ static int PrerenderPicture(vout_thread_sys_t *sys, picture_t *filtered,
                                       vd->source, system_now,
                                       render_subtitle_date,
                                       do_snapshot, vd->info.can_scale_spu);
+    if (sys->spu) {
+        unsigned hits, misses;
+
+        spu_GetResetCacheStatistic(sys->spu, &hits, &misses);
+        vout_statistic_AddSpuCache(&sys->statistic, hits, misses);
+    }
     /*
      * Perform rendering
      *
@@ -1199,10 +1223,15 @@ static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
     vout_display_t *vd = sys->display;
 
     vout_chrono_Start(&sys->chrono.render);
+    const vlc_tick_t date = sys->displayed.current->date;
+    TraceSpan(sys, "prepare", "begin", date);
 
     picture_t *filtered = FilterPictureInteractive(sys);
     if (!filtered)
+    {
+        TraceSpan(sys, "prepare", "end", date);
         return VLC_EGENERIC;
+    }
 
     vlc_mutex_lock(&sys->display_lock);
 
@@ -1212,6 +1241,7 @@ static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
     if (ret != VLC_SUCCESS)
     {
         vlc_mutex_unlock(&sys->display_lock);
+        TraceSpan(sys, "prepare", "end", date);
         return ret;
     }
 
@@ -1235,6 +1265,8 @@ static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
         vd->ops->prepare(vd, todisplay, subpic, system_pts);
 
     vout_chrono_Stop(&sys->chrono.render);
+    TraceSpan(sys, "prepare", "end", date);
+    TraceSpan(sys, "display", "begin", pts);
 
     system_now = vlc_tick_now();
     if (!render_now)
@@ -1290,6 +1322,7 @@ static int RenderPicture(vout_thread_sys_t *sys, bool render_now)
 
     /* Display the direct buffer returned by vout_RenderPicture */
     vout_display_Display(vd, todisplay);
+    TraceSpan(sys, "display", "end", pts);
     vlc_mutex_unlock(&sys->display_lock);
 
     picture_Release(todisplay);
@@ -1472,7 +1505,16 @@ static void vout_FlushUnlocked(vout_thread_sys_t *vout, bool below,
         }
     }
 
-    picture_fifo_Flush(sys->decoder_fifo, date, below);
+    vlc_picture_chain_t flushed;
+    vlc_picture_chain_Init(&flushed);
+    picture_fifo_Extract(sys->decoder_fifo, date, below, &flushed);
+
+    picture_t *picture;
+    while ((picture = vlc_picture_chain_PopFront(&flushed)) != NULL)
+    {
+        TraceSpan(sys, "vout_fifo", "end", picture->date);
+        picture_Release(picture);
+    }
 
     vlc_mutex_lock(&sys->display_lock);
     if (sys->display != NULL)
@@ -1755,6 +1797,13 @@ static void vout_ReleaseDisplay(vout_thread_sys_t *vout)
     if (sys->spu_blend != NULL)
         filter_DeleteBlend(sys->spu_blend);
 
+    unsigned spu_hits, spu_misses;
+    vout_statistic_GetSpuCache(&sys->statistic, &spu_hits, &spu_misses);
+    if (spu_hits + spu_misses > 0)
+        msg_Dbg(&vout->obj, "subpicture regions cache: %u hits, %u misses "
+                "(%.1f%% hit rate)", spu_hits, spu_misses,
+                100. * spu_hits / (spu_hits + spu_misses));
+
     /* Destroy the rendering display */
     if (sys->private.display_pool != NULL)
         vout_FlushUnlocked(vout, true, VLC_TICK_MAX);
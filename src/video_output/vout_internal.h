@@ -180,6 +180,8 @@ void spu_SetClockDelay(spu_t *spu, size_t channel_id, vlc_tick_t delay);
 void spu_SetClockRate(spu_t *spu, size_t channel_id, float rate);
 void spu_ChangeChannelOrderMargin(spu_t *, enum vlc_vout_order, int);
 void spu_SetHighlight(spu_t *, const vlc_spu_highlight_t*);
+void spu_GetResetCacheStatistic(spu_t *, unsigned *restrict hits,
+                                unsigned *restrict misses);
 
 /**
  * This function will (un)pause the display of pictures.
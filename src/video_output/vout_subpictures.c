@@ -75,6 +75,26 @@ struct spu_channel {
 
 typedef struct VLC_VECTOR(struct spu_channel) spu_channel_vector;
 typedef struct VLC_VECTOR(subpicture_t *) spu_prerender_vector;
+
+/* Scaled and/or converted region picture */
+typedef struct {
+    /* Key */
+    const subpicture_t *subpic;
+    const subpicture_region_t *region;
+    picture_t *source;          /* held, so that it cannot be recycled */
+    int scale_w;
+    int scale_h;
+    unsigned width;
+    unsigned height;
+    vlc_fourcc_t chroma;
+    bool has_palette;
+    video_palette_t palette;    /* for YUVP sources */
+    /* */
+    picture_t *picture;
+    uint64_t last_render;
+} spu_region_cache_entry_t;
+
+typedef struct VLC_VECTOR(spu_region_cache_entry_t) spu_region_cache_vector;
 #define SPU_CHROMALIST_COUNT 8
 
 struct spu_private_t {
@@ -129,6 +149,15 @@ struct spu_private_t {
         bool            live;
     } prerender;
 
+    /* Region pictures cache, protected by lock */
+    struct
+    {
+        spu_region_cache_vector entries;
+        uint64_t        render;     /**< render counter */
+        unsigned        hits;
+        unsigned        misses;
+    } cache;
+
     /* */
     vlc_tick_t          last_sort_date;
     vout_thread_t       *vout;
@@ -781,6 +810,129 @@ spu_SelectSubpictures(spu_t *spu, vlc_tick_t system_now,
 
 
 
+/*****************************************************************************
+ * Region pictures cache
+ *
+ * The scaled and converted pictures of the regions are kept as long as they
+ * are rendered, so that unchanged regions are not scaled nor converted again.
+ *****************************************************************************/
+static void spu_region_cache_entry_Clean(spu_region_cache_entry_t *entry)
+{
+    picture_Release(entry->source);
+    picture_Release(entry->picture);
+}
+
+static bool spu_region_cache_entry_Match(const spu_region_cache_entry_t *entry,
+                                         const subpicture_t *subpic,
+                                         const subpicture_region_t *region,
+                                         spu_scale_t scale,
+                                         unsigned width, unsigned height,
+                                         vlc_fourcc_t chroma)
+{
+    if (entry->subpic != subpic || entry->region != region ||
+        entry->source != region->p_picture ||
+        entry->scale_w != scale.w || entry->scale_h != scale.h ||
+        entry->width != width || entry->height != height ||
+        entry->chroma != chroma)
+        return false;
+
+    /* The palette may be forced after the region creation */
+    const video_palette_t *palette = region->fmt.i_chroma == VLC_CODEC_YUVP ?
+                                     region->fmt.p_palette : NULL;
+    if (palette == NULL)
+        return !entry->has_palette;
+    return entry->has_palette &&
+           entry->palette.i_entries == palette->i_entries &&
+           memcmp(entry->palette.palette, palette->palette,
+                  palette->i_entries * sizeof(palette->palette[0])) == 0;
+}
+
+static picture_t *SpuRegionCacheGet(spu_private_t *sys,
+                                    const subpicture_t *subpic,
+                                    const subpicture_region_t *region,
+                                    spu_scale_t scale,
+                                    unsigned width, unsigned height,
+                                    vlc_fourcc_t chroma)
+{
+    for (size_t i = 0; i < sys->cache.entries.size; i++) {
+        spu_region_cache_entry_t *entry = &sys->cache.entries.data[i];
+
+        if (spu_region_cache_entry_Match(entry, subpic, region, scale,
+                                         width, height, chroma)) {
+            entry->last_render = sys->cache.render;
+            sys->cache.hits++;
+            return entry->picture;
+        }
+    }
+    sys->cache.misses++;
+    return NULL;
+}
+
+/* The cache takes the ownership of the picture */
+static void SpuRegionCachePut(spu_private_t *sys,
+                              const subpicture_t *subpic,
+                              const subpicture_region_t *region,
+                              spu_scale_t scale,
+                              unsigned width, unsigned height,
+                              vlc_fourcc_t chroma, picture_t *picture)
+{
+    spu_region_cache_entry_t entry = {
+        .subpic = subpic,
+        .region = region,
+        .source = picture_Hold(region->p_picture),
+        .scale_w = scale.w,
+        .scale_h = scale.h,
+        .width = width,
+        .height = height,
+        .chroma = chroma,
+        .has_palette = false,
+        .picture = picture,
+        .last_render = sys->cache.render,
+    };
+
+    if (region->fmt.i_chroma == VLC_CODEC_YUVP && region->fmt.p_palette) {
+        entry.has_palette = true;
+        entry.palette = *region->fmt.p_palette;
+    }
+
+    /* Drop any previous version of the same region */
+    for (size_t i = 0; i < sys->cache.entries.size; i++) {
+        spu_region_cache_entry_t *old = &sys->cache.entries.data[i];
+
+        if (old->subpic == subpic && old->region == region) {
+            spu_region_cache_entry_Clean(old);
+            *old = entry;
+            return;
+        }
+    }
+
+    if (!vlc_vector_push(&sys->cache.entries, entry))
+        spu_region_cache_entry_Clean(&entry);
+}
+
+/* Drops the pictures of the regions that were not part of the last render */
+static void SpuRegionCacheExpire(spu_private_t *sys)
+{
+    size_t kept = 0;
+
+    for (size_t i = 0; i < sys->cache.entries.size; i++) {
+        spu_region_cache_entry_t *entry = &sys->cache.entries.data[i];
+
+        if (entry->last_render == sys->cache.render)
+            sys->cache.entries.data[kept++] = *entry;
+        else
+            spu_region_cache_entry_Clean(entry);
+    }
+    sys->cache.entries.size = kept;
+}
+
+static void SpuRegionCacheClear(spu_private_t *sys)
+{
+    for (size_t i = 0; i < sys->cache.entries.size; i++)
+        spu_region_cache_entry_Clean(&sys->cache.entries.data[i]);
+    vlc_vector_clear(&sys->cache.entries);
+}
+
 /**
  * It will transform the provided region into another region suitable for rendering.
  */
@@ -958,31 +1110,13 @@ static void SpuRenderRegion(spu_t *spu,
         const unsigned dst_width  = spu_scale_w(region->fmt.i_visible_width,  scale_size);
         const unsigned dst_height = spu_scale_h(region->fmt.i_visible_height, scale_size);
 
-        /* Destroy the cache if unusable */
-        if (region->p_private) {
-            subpicture_region_private_t *private = region->p_private;
-            bool is_changed = false;
-
-            /* Check resize changes */
-            if (dst_width  != private->fmt.i_visible_width ||
-                dst_height != private->fmt.i_visible_height)
-                is_changed = true;
-
-            /* Check forced palette changes */
-            if (changed_palette)
-                is_changed = true;
-
-            if (convert_chroma && private->fmt.i_chroma != chroma_list[0])
-                is_changed = true;
-
-            if (is_changed) {
-                subpicture_region_private_Delete(private);
-                region->p_private = NULL;
-            }
-        }
+        const vlc_fourcc_t cache_chroma = chroma_list[0];
+        picture_t *cached = SpuRegionCacheGet(sys, subpic, region, scale_size,
+                                              dst_width, dst_height,
+                                              cache_chroma);
 
         /* Scale if needed into cache */
-        if (!region->p_private && dst_width > 0 && dst_height > 0) {
+        if (!cached && dst_width > 0 && dst_height > 0) {
             filter_t *scale = sys->scale;
 
             picture_t *picture = region->p_picture;
@@ -1037,23 +1171,17 @@ static void SpuRenderRegion(spu_t *spu,
 
             /* */
             if (picture) {
-                region->p_private = subpicture_region_private_New(&picture->format);
-                if (region->p_private) {
-                    region->p_private->p_picture = picture;
-                    if (!region->p_private->p_picture) {
-                        subpicture_region_private_Delete(region->p_private);
-                        region->p_private = NULL;
-                    }
-                } else {
-                    picture_Release(picture);
-                }
+                cached = picture;
+                SpuRegionCachePut(sys, subpic, region, scale_size,
+                                  dst_width, dst_height, cache_chroma,
+                                  picture);
             }
         }
 
         /* And use the scaled picture */
-        if (region->p_private) {
-            region_fmt     = region->p_private->fmt;
-            region_picture = region->p_private->p_picture;
+        if (cached) {
+            region_fmt     = cached->format;
+            region_picture = cached;
         }
     }
 
@@ -1601,6 +1729,8 @@ static void spu_Cleanup(spu_t *spu)
 
     vlc_vector_destroy(&sys->channels);
 
+    SpuRegionCacheClear(sys);
+
     vlc_vector_clear(&sys->prerender.vector);
     video_format_Clean(&sys->prerender.fmtdst);
     video_format_Clean(&sys->prerender.fmtsrc);
@@ -1658,6 +1788,11 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
     /* Initialize private fields */
     vlc_mutex_init(&sys->lock);
 
+    vlc_vector_init(&sys->cache.entries);
+    sys->cache.render = 0;
+    sys->cache.hits = 0;
+    sys->cache.misses = 0;
+
     sys->margin = var_InheritInteger(spu, "sub-margin");
     sys->secondary_margin = var_InheritInteger(spu, "secondary-sub-margin");
 
@@ -1951,12 +2086,15 @@ subpicture_t *spu_Render(spu_t *spu,
 
     size_t subpicture_count;
 
+    sys->cache.render++;
+
     /* Get an array of subpictures to render */
     spu_render_entry_t *subpicture_array =
         spu_SelectSubpictures(spu, system_now, render_subtitle_date,
                              ignore_osd, &subpicture_count);
     if (!subpicture_array)
     {
+        SpuRegionCacheExpire(sys);
         vlc_mutex_unlock(&sys->lock);
         return NULL;
     }
@@ -1994,11 +2132,25 @@ subpicture_t *spu_Render(spu_t *spu,
                                                 render_subtitle_date,
                                                 external_scale);
     free(subpicture_array);
+    SpuRegionCacheExpire(sys);
     vlc_mutex_unlock(&sys->lock);
 
     return render;
 }
 
+void spu_GetResetCacheStatistic(spu_t *spu, unsigned *restrict hits,
+                                unsigned *restrict misses)
+{
+    spu_private_t *sys = spu->p;
+
+    vlc_mutex_lock(&sys->lock);
+    *hits = sys->cache.hits;
+    *misses = sys->cache.misses;
+    sys->cache.hits = 0;
+    sys->cache.misses = 0;
+    vlc_mutex_unlock(&sys->lock);
+}
+
 ssize_t spu_RegisterChannelInternal(spu_t *spu, vlc_clock_t *clock,
                                     enum vlc_vout_order *order)
 {
@@ -0,0 +1,197 @@
+/*****************************************************************************
+ * file.c: file access output test and recording benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_sout.h>
+#include <vlc_fs.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include "../../libvlc/test.h"
+
+#define TS_SIZE      188
+#define CHAIN_LENGTH 64 /* TS packets per muxer write */
+#define CHAIN_COUNT  1500 /* about 18 MB */
+
+static vlc_object_t *parent;
+
+static uint8_t Pattern( size_t i_offset )
+{
+    return (i_offset * 7 + (i_offset >> 9)) & 0xff;
+}
+
+/* Builds a muxer-like chain of TS packets, with some empty blocks */
+static block_t * MakeChain( size_t *pi_offset )
+{
+    block_t *p_chain = NULL;
+    block_t **pp_last = &p_chain;
+
+    for( unsigned i = 0; i < CHAIN_LENGTH; i++ )
+    {
+        block_t *p_block = block_Alloc( (i % 16 == 15) ? 0 : TS_SIZE );
+        assert( p_block );
+        for( size_t j = 0; j < p_block->i_buffer; j++ )
+            p_block->p_buffer[j] = Pattern( (*pi_offset)++ );
+        block_ChainLastAppend( &pp_last, p_block );
+    }
+    return p_chain;
+}
+
+/* Number of write system calls so far, if the OS tells */
+static unsigned long WriteSyscalls( void )
+{
+    unsigned long i_count = 0;
+    FILE *p_file = fopen( "/proc/self/io", "r" );
+    if( p_file == NULL )
+        return 0;
+
+    char psz_line[64];
+    while( fgets( psz_line, sizeof(psz_line), p_file ) )
+        if( sscanf( psz_line, "syscw: %lu", &i_count ) == 1 )
+            break;
+    fclose( p_file );
+    return i_count;
+}
+
+static void CheckFile( const char *psz_path, size_t i_size )
+{
+    int fd = vlc_open( psz_path, O_RDONLY );
+    assert( fd != -1 );
+    uint8_t *p = malloc( i_size + 1 );
+    assert( p );
+    size_t i_read = 0;
+    ssize_t val;
+    while( (val = read( fd, p + i_read, i_size + 1 - i_read )) > 0 )
+        i_read += val;
+    assert( i_read == i_size );
+    for( size_t i = 0; i < i_size; i++ )
+        assert( p[i] == Pattern( i ) );
+    free( p );
+    vlc_close( fd );
+}
+
+static void Report( const char *psz_mode, size_t i_size, vlc_tick_t elapsed,
+                    unsigned long i_syscalls )
+{
+    double secs = secf_from_vlc_tick( elapsed ) + 1e-9;
+    printf( "%-16s %8.1f MB/s %10.0f syscalls/s %6.2f KiB/syscall\n",
+            psz_mode, i_size / secs / 1e6, i_syscalls / secs,
+            i_syscalls ? i_size / 1024. / i_syscalls : 0. );
+}
+
+/* One write() per block, as the file output used to do */
+static void BenchPerBlock( const char *psz_path )
+{
+    int fd = vlc_open( psz_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    assert( fd != -1 );
+    size_t i_offset = 0;
+    unsigned long i_syscalls = WriteSyscalls();
+    vlc_tick_t start = vlc_tick_now();
+
+    for( unsigned i = 0; i < CHAIN_COUNT; i++ )
+    {
+        block_t *p_chain = MakeChain( &i_offset );
+        for( block_t *b = p_chain; b; b = b->p_next )
+            assert( write( fd, b->p_buffer, b->i_buffer ) == (ssize_t)b->i_buffer );
+        block_ChainRelease( p_chain );
+    }
+    vlc_close( fd );
+
+    Report( "per block", i_offset, vlc_tick_now() - start,
+            WriteSyscalls() - i_syscalls );
+    CheckFile( psz_path, i_offset );
+}
+
+static void Bench( const char *psz_access, const char *psz_path )
+{
+    sout_access_out_t *p_access = sout_AccessOutNew( parent, psz_access,
+                                                     psz_path );
+    assert( p_access );
+    size_t i_offset = 0;
+    unsigned long i_syscalls = WriteSyscalls();
+    vlc_tick_t start = vlc_tick_now();
+
+    for( unsigned i = 0; i < CHAIN_COUNT; i++ )
+    {
+        size_t i_chain = i_offset;
+        block_t *p_chain = MakeChain( &i_offset );
+        assert( sout_AccessOutWrite( p_access, p_chain )
+                == (ssize_t)(i_offset - i_chain) );
+    }
+    sout_AccessOutDelete( p_access );
+
+    Report( psz_access, i_offset, vlc_tick_now() - start,
+            WriteSyscalls() - i_syscalls );
+    CheckFile( psz_path, i_offset );
+}
+
+/* Muxers rewrite their headers at the end */
+static void TestSeek( const char *psz_access, const char *psz_path )
+{
+    sout_access_out_t *p_access = sout_AccessOutNew( parent, psz_access,
+                                                     psz_path );
+    assert( p_access );
+    size_t i_offset = 0;
+
+    for( unsigned i = 0; i < 100; i++ )
+        sout_AccessOutWrite( p_access, MakeChain( &i_offset ) );
+
+    const size_t i_size = i_offset;
+    i_offset = 0;
+    assert( sout_AccessOutSeek( p_access, 0 ) == 0 );
+    sout_AccessOutWrite( p_access, MakeChain( &i_offset ) );
+    sout_AccessOutDelete( p_access );
+
+    CheckFile( psz_path, i_size );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( 0, NULL );
+    assert( vlc != NULL );
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    const char *psz_tmpdir = getenv( "TMPDIR" );
+    char *psz_path;
+    if( asprintf( &psz_path, "%s/vlc-test-file-%u.ts",
+                  psz_tmpdir ? psz_tmpdir : "/tmp", (unsigned) getpid() ) < 0 )
+        abort();
+
+    TestSeek( "file", psz_path );
+    TestSeek( "file{direct}", psz_path );
+
+    BenchPerBlock( psz_path );
+    Bench( "file", psz_path );
+    Bench( "file{direct}", psz_path );
+
+    vlc_unlink( psz_path );
+    free( psz_path );
+    libvlc_release( vlc );
+    return 0;
+}
@@ -0,0 +1,306 @@
+/*****************************************************************************
+ * ts_batch.c: MPEG TS batched packet reader test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_stream.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/demux/mpeg/ts_batch.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include "../../libvlc/test.h"
+
+#define PID_COUNT    24
+#define PACKET_COUNT 40000
+
+const char vlc_module_name[] = "test_ts_batch";
+
+static vlc_object_t *parent;
+
+/* Builds a TS with PID_COUNT interleaved PIDs, optionally preceded by a
+ * m2ts style 4 bytes header, and with garbage injected at i_garbage */
+static uint8_t * MakeTS( unsigned i_packet_size, unsigned i_header,
+                         size_t i_garbage, size_t *pi_size )
+{
+    const size_t i_size = (size_t) PACKET_COUNT * i_packet_size + 77;
+    uint8_t *p = malloc( i_size );
+    assert( p );
+    uint8_t *q = p;
+    unsigned cc[PID_COUNT] = { 0 };
+
+    for( unsigned i = 0; i < PACKET_COUNT; i++ )
+    {
+        if( i == i_garbage )
+        {
+            memset( q, 0xA5, 77 );
+            q += 77;
+        }
+        const unsigned pid = 0x100 + (i * 7) % PID_COUNT;
+        memset( q, 0, i_header );
+        SetDWBE( q, i );
+        uint8_t *pkt = q + i_header;
+        pkt[0] = 0x47;
+        pkt[1] = pid >> 8;
+        pkt[2] = pid & 0xff;
+        pkt[3] = 0x10 | (cc[pid - 0x100]++ & 0x0f);
+        for( unsigned j = 4; j < i_packet_size - i_header; j++ )
+            pkt[j] = (i + j) & 0xff;
+        pkt[4] = i >> 8; /* keep payload packet specific */
+        pkt[5] = i & 0xff;
+        q += i_packet_size;
+    }
+    *pi_size = q - p;
+    return p;
+}
+
+static stream_t * OpenTS( uint8_t *p, size_t i_size )
+{
+    stream_t *s = vlc_stream_MemoryNew( parent, p, i_size, true );
+    assert( s );
+    return s;
+}
+
+static block_t * ReadOne( stream_t *s, unsigned i_packet_size, unsigned i_header )
+{
+    block_t *p_pkt = vlc_stream_Block( s, i_packet_size );
+    if( p_pkt == NULL || p_pkt->i_buffer < i_packet_size )
+    {
+        if( p_pkt )
+            block_Release( p_pkt );
+        return NULL;
+    }
+    p_pkt->p_buffer += i_header;
+    p_pkt->i_buffer -= i_header;
+    return p_pkt;
+}
+
+static void CheckPacket( const block_t *p_pkt, unsigned i, unsigned i_len )
+{
+    assert( p_pkt->i_buffer == i_len );
+    assert( p_pkt->p_buffer[0] == 0x47 );
+    assert( p_pkt->p_buffer[4] == ((i >> 8) & 0xff) );
+    assert( p_pkt->p_buffer[5] == (i & 0xff) );
+    const unsigned pid = ((p_pkt->p_buffer[1] & 0x1f) << 8) | p_pkt->p_buffer[2];
+    assert( pid == 0x100 + (i * 7) % PID_COUNT );
+}
+
+static void TestConformance( unsigned i_packet_size, unsigned i_header,
+                             unsigned i_count, size_t i_garbage )
+{
+    size_t i_size;
+    uint8_t *p = MakeTS( i_packet_size, i_header, i_garbage, &i_size );
+    stream_t *s = OpenTS( p, i_size );
+
+    ts_batch_reader_t batch;
+    ts_batch_Init( &batch, i_count, i_packet_size, i_header );
+
+    /* Keep a few packets alive across buffer refills */
+    block_t *held = NULL;
+    block_t **pp_held = &held;
+    unsigned i = 0;
+    block_t *p_pkt;
+    while( (p_pkt = ts_batch_Read( &batch, parent, s )) )
+    {
+        CheckPacket( p_pkt, i, i_packet_size - i_header );
+        /* in place processing must not leak into neighbours */
+        p_pkt->p_buffer[p_pkt->i_buffer - 1] = 0x00;
+        if( i % 97 == 0 )
+            block_ChainLastAppend( &pp_held, p_pkt );
+        else
+            block_Release( p_pkt );
+        i++;
+    }
+    /* garbage is skipped without losing the following packets */
+    assert( i == PACKET_COUNT );
+
+    ts_batch_Clean( &batch );
+    for( block_t *b = held; b; b = b->p_next )
+        assert( b->p_buffer[0] == 0x47 );
+    block_ChainRelease( held );
+
+    /* Tell accounts for read ahead data, and seeking flushes it */
+    ts_batch_Init( &batch, i_count, i_packet_size, i_header );
+    assert( vlc_stream_Seek( s, 0 ) == VLC_SUCCESS );
+    p_pkt = ts_batch_Read( &batch, parent, s );
+    assert( p_pkt );
+    block_Release( p_pkt );
+    assert( vlc_stream_Tell( s ) - ts_batch_Pending( &batch ) == i_packet_size );
+    ts_batch_Flush( &batch );
+    assert( vlc_stream_Seek( s, (uint64_t) 5 * i_packet_size ) == VLC_SUCCESS );
+    p_pkt = ts_batch_Read( &batch, parent, s );
+    assert( p_pkt );
+    CheckPacket( p_pkt, 5, i_packet_size - i_header );
+    block_Release( p_pkt );
+    ts_batch_Clean( &batch );
+
+    vlc_stream_Delete( s );
+    free( p );
+}
+
+struct held
+{
+    block_t  *p_chain;
+    block_t **pp_last;
+    unsigned  i_detach;
+};
+
+static void DetachHeld( void *opaque )
+{
+    struct held *h = opaque;
+
+    h->i_detach++;
+    for( block_t **pp = &h->p_chain; *pp; pp = &(*pp)->p_next )
+    {
+        block_t *p_next = (*pp)->p_next;
+        (*pp)->p_next = NULL;
+        *pp = ts_batch_Detach( *pp );
+        (*pp)->p_next = p_next;
+        h->pp_last = &(*pp)->p_next;
+    }
+}
+
+static void TestDetach( unsigned i_packet_size, unsigned i_header,
+                        unsigned i_count )
+{
+    size_t i_size;
+    uint8_t *p = MakeTS( i_packet_size, i_header, SIZE_MAX, &i_size );
+    stream_t *s = OpenTS( p, i_size );
+
+    struct held h = { .p_chain = NULL, .i_detach = 0 };
+    h.pp_last = &h.p_chain;
+
+    ts_batch_reader_t batch;
+    ts_batch_Init( &batch, i_count, i_packet_size, i_header );
+    batch.pf_detach = DetachHeld;
+    batch.p_detach_opaque = &h;
+
+    unsigned i = 0;
+    block_t *p_pkt;
+    while( (p_pkt = ts_batch_Read( &batch, parent, s )) )
+    {
+        assert( ts_batch_IsView( p_pkt ) );
+        if( i % 97 == 0 )
+        {
+            p_pkt->i_dts = VLC_TICK_0 + i;
+            block_ChainLastAppend( &h.pp_last, p_pkt );
+        }
+        else
+            block_Release( p_pkt );
+        i++;
+    }
+    assert( i == PACKET_COUNT );
+    /* the owner is only asked when packets are still held */
+    assert( h.i_detach > 0 );
+    ts_batch_Clean( &batch );
+
+    /* packets outlive the reader, as copies of their own */
+    i = 0;
+    for( block_t *b = h.p_chain; b; b = b->p_next, i += 97 )
+    {
+        if( b->p_next == NULL && ts_batch_IsView( b ) )
+            break; /* held after the last refill */
+        assert( !ts_batch_IsView( b ) );
+        assert( ts_batch_Detach( b ) == b );
+        assert( b->i_dts == VLC_TICK_0 + i );
+        CheckPacket( b, i, i_packet_size - i_header );
+    }
+    block_ChainRelease( h.p_chain );
+
+    vlc_stream_Delete( s );
+    free( p );
+}
+
+static void Bench( unsigned i_packet_size, unsigned i_header, unsigned i_count )
+{
+    size_t i_size;
+    uint8_t *p = MakeTS( i_packet_size, i_header, SIZE_MAX, &i_size );
+    const unsigned i_loops = 4;
+    unsigned i_pkts = 0;
+
+    vlc_tick_t start = vlc_tick_now();
+    for( unsigned l = 0; l < i_loops; l++ )
+    {
+        stream_t *s = OpenTS( p, i_size );
+        block_t *p_pkt;
+        if( i_count > 1 )
+        {
+            ts_batch_reader_t batch;
+            ts_batch_Init( &batch, i_count, i_packet_size, i_header );
+            while( (p_pkt = ts_batch_Read( &batch, parent, s )) )
+            {
+                i_pkts++;
+                block_Release( p_pkt );
+            }
+            ts_batch_Clean( &batch );
+        }
+        else
+        {
+            while( (p_pkt = ReadOne( s, i_packet_size, i_header )) )
+            {
+                i_pkts++;
+                block_Release( p_pkt );
+            }
+        }
+        vlc_stream_Delete( s );
+    }
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    assert( i_pkts == i_loops * PACKET_COUNT );
+
+    double secs = secf_from_vlc_tick( elapsed ) + 1e-9;
+    printf( "packet size %u, batch %4u: %8.2f Mpkt/s %8.1f MB/s\n",
+            i_packet_size, i_count, i_pkts / secs / 1e6,
+            (double) i_loops * i_size / secs / 1e6 );
+    free( p );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( 0, NULL );
+    assert( vlc != NULL );
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    static const unsigned counts[] = { 1, 2, 7, 64, 1024 };
+    for( size_t i = 0; i < ARRAY_SIZE(counts); i++ )
+    {
+        TestConformance( 188, 0, counts[i], SIZE_MAX );
+        TestConformance( 192, 4, counts[i], SIZE_MAX );
+        TestConformance( 204, 0, counts[i], SIZE_MAX );
+        TestConformance( 188, 0, counts[i], 1234 );
+        TestConformance( 192, 4, counts[i], 3 );
+    }
+    TestDetach( 188, 0, 64 );
+    TestDetach( 192, 4, TS_BATCH_DEFAULT );
+
+    Bench( 188, 0, 1 );
+    Bench( 188, 0, 16 );
+    Bench( 188, 0, TS_BATCH_DEFAULT );
+    Bench( 188, 0, 256 );
+    Bench( 192, 4, 1 );
+    Bench( 192, 4, TS_BATCH_DEFAULT );
+
+    libvlc_release( vlc );
+    return 0;
+}
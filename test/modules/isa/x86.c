@@ -0,0 +1,684 @@
+/*****************************************************************************
+ * x86.c: x86 SIMD kernels conformance test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <float.h>
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_aout_volume.h>
+#include <vlc_block.h>
+#include <vlc_cpu.h>
+#include <vlc_es.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include "../../libvlc/test.h"
+
+const char vlc_module_name[] = "test_isa_x86";
+
+static vlc_object_t *parent;
+
+static bool CPU_C( void )
+{
+    return true;
+}
+
+static bool CPU_SSE4_1( void )
+{
+    return vlc_CPU_SSE4_1();
+}
+
+static bool CPU_AVX2( void )
+{
+    return vlc_CPU_AVX2();
+}
+
+/* Each SIMD module is compared with the C module of the same capability */
+static const struct isa
+{
+    const char *suffix;
+    bool (*capable)(void);
+} isas[] = {
+    { "sse4", CPU_SSE4_1 },
+    { "avx2", CPU_AVX2 },
+};
+
+static uint32_t seed = 0x1234567;
+
+static uint32_t Random( void )
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static void Bench( const char *kernel, const char *module, unsigned units,
+                   const char *unit, void (*run)(void *), void *opaque )
+{
+    unsigned count = 0;
+    vlc_tick_t start = vlc_tick_now();
+    vlc_tick_t elapsed;
+
+    do
+    {
+        run( opaque );
+        count++;
+        elapsed = vlc_tick_now() - start;
+    }
+    while( count < 2 || elapsed < VLC_TICK_FROM_MS(60) );
+
+    double secs = secf_from_vlc_tick( elapsed ) + 1e-9;
+    printf( "%-28s %-28s %9.1f %s/s\n", kernel, module,
+            count * (double)units / secs / 1e6, unit );
+}
+
+/*
+ * Audio volume
+ */
+struct volume
+{
+    audio_volume_t *obj;
+    module_t *module;
+};
+
+static bool VolumeOpen( struct volume *v, const char *name, vlc_fourcc_t fmt )
+{
+    v->obj = vlc_object_create( parent, sizeof (*v->obj) );
+    assert( v->obj != NULL );
+    v->obj->format = fmt;
+    v->module = module_need( v->obj, "audio volume", name, true );
+    if( v->module == NULL )
+    {
+        vlc_object_delete( v->obj );
+        return false;
+    }
+    return true;
+}
+
+static void VolumeClose( struct volume *v )
+{
+    module_unneed( v->obj, v->module );
+    vlc_object_delete( v->obj );
+}
+
+static block_t *MakeSamples( vlc_fourcc_t fmt, size_t n )
+{
+    block_t *block = block_Alloc( n * aout_BitsPerSample( fmt ) / 8 );
+    assert( block != NULL );
+
+    for( size_t i = 0; i < n; i++ )
+    {
+        int32_t r = (int32_t)Random() - (1 << 23);
+
+        switch( fmt )
+        {
+            case VLC_CODEC_FL32:
+                ((float *)block->p_buffer)[i] = r / (float)(1 << 23);
+                break;
+            case VLC_CODEC_FL64:
+                ((double *)block->p_buffer)[i] = r / (double)(1 << 23);
+                break;
+            case VLC_CODEC_S16N:
+                ((int16_t *)block->p_buffer)[i] = r >> 8;
+                break;
+        }
+    }
+    return block;
+}
+
+static const vlc_fourcc_t volume_formats[] = {
+    VLC_CODEC_FL32, VLC_CODEC_FL64, VLC_CODEC_S16N,
+};
+
+static const char *VolumeReference( vlc_fourcc_t fmt )
+{
+    return (fmt == VLC_CODEC_S16N) ? "integer_mixer" : "float_mixer";
+}
+
+static void TestVolume( vlc_fourcc_t fmt, const char *name )
+{
+    static const float gains[] = { 0.f, .25f, .7f, 1.f, 1.5f, 3.3f, 200.f };
+    struct volume ref, simd;
+
+    if( !VolumeOpen( &simd, name, fmt ) )
+        return;
+    if( !VolumeOpen( &ref, VolumeReference( fmt ), fmt ) )
+        abort();
+
+    for( size_t i = 0; i < ARRAY_SIZE(gains); i++ )
+    {
+        block_t *a = MakeSamples( fmt, 1001 );
+        block_t *b = block_Duplicate( a );
+        assert( b != NULL );
+
+        ref.obj->amplify( ref.obj, a, gains[i] );
+        simd.obj->amplify( simd.obj, b, gains[i] );
+        assert( a->i_buffer == b->i_buffer );
+        assert( memcmp( a->p_buffer, b->p_buffer, a->i_buffer ) == 0 );
+        block_Release( a );
+        block_Release( b );
+    }
+
+    printf( "%-28s %-28s bit exact\n", "volume", name );
+    VolumeClose( &ref );
+    VolumeClose( &simd );
+}
+
+struct volume_bench
+{
+    struct volume *volume;
+    block_t *block;
+};
+
+static void RunVolume( void *opaque )
+{
+    struct volume_bench *b = opaque;
+
+    b->volume->obj->amplify( b->volume->obj, b->block, .9f );
+}
+
+static void BenchVolume( vlc_fourcc_t fmt, const char *name )
+{
+    struct volume v;
+    char kernel[32];
+
+    if( !VolumeOpen( &v, name, fmt ) )
+        return;
+
+    struct volume_bench b = { &v, MakeSamples( fmt, 1 << 16 ) };
+
+    snprintf( kernel, sizeof (kernel), "volume %4.4s", (const char *)&fmt );
+    Bench( kernel, name, 1 << 16, "Msamples", RunVolume, &b );
+    block_Release( b.block );
+    VolumeClose( &v );
+}
+
+/*
+ * Channel mixer
+ */
+static const struct layout
+{
+    uint32_t in;
+    uint32_t out;
+} layouts[] = {
+    { AOUT_CHANS_7_1, AOUT_CHANS_2_0 },
+    { AOUT_CHANS_7_0, AOUT_CHAN_CENTER },
+    { AOUT_CHANS_7_1, AOUT_CHANS_4_0 },
+    { AOUT_CHANS_6_1_MIDDLE, AOUT_CHANS_2_0 },
+    { AOUT_CHANS_5_1, AOUT_CHANS_2_0 },
+    { AOUT_CHANS_5_0_MIDDLE, AOUT_CHAN_CENTER },
+    { AOUT_CHANS_5_1, AOUT_CHANS_4_0 },
+    { AOUT_CHANS_4_CENTER_REAR, AOUT_CHANS_2_0 },
+    { AOUT_CHANS_4_CENTER_REAR, AOUT_CHAN_CENTER },
+    { AOUT_CHANS_3_0, AOUT_CHANS_2_0 },
+    { AOUT_CHANS_3_0, AOUT_CHAN_CENTER },
+    { AOUT_CHANS_2_0, AOUT_CHAN_CENTER },
+};
+
+struct converter
+{
+    filter_t *filter;
+    module_t *module;
+};
+
+static void SetupAudio( es_format_t *fmt, uint32_t channels )
+{
+    es_format_Init( fmt, AUDIO_ES, VLC_CODEC_FL32 );
+    fmt->audio.i_format = VLC_CODEC_FL32;
+    fmt->audio.i_rate = 48000;
+    fmt->audio.i_physical_channels = channels;
+    aout_FormatPrepare( &fmt->audio );
+}
+
+static bool ConverterOpen( struct converter *c, const char *capability,
+                           const char *name, const es_format_t *in,
+                           const es_format_t *out )
+{
+    c->filter = vlc_object_create( parent, sizeof (*c->filter) );
+    assert( c->filter != NULL );
+    es_format_Copy( &c->filter->fmt_in, in );
+    es_format_Copy( &c->filter->fmt_out, out );
+    c->module = module_need( c->filter, capability, name, true );
+    if( c->module == NULL )
+    {
+        es_format_Clean( &c->filter->fmt_in );
+        es_format_Clean( &c->filter->fmt_out );
+        vlc_object_delete( c->filter );
+        return false;
+    }
+    return true;
+}
+
+static void ConverterClose( struct converter *c )
+{
+    if( c->filter->ops->close != NULL )
+        c->filter->ops->close( c->filter );
+    module_unneed( c->filter, c->module );
+    es_format_Clean( &c->filter->fmt_in );
+    es_format_Clean( &c->filter->fmt_out );
+    vlc_object_delete( c->filter );
+}
+
+static bool MixerOpen( struct converter *c, const char *name,
+                       const struct layout *layout )
+{
+    es_format_t in, out;
+
+    SetupAudio( &in, layout->in );
+    SetupAudio( &out, layout->out );
+    return ConverterOpen( c, "audio converter", name, &in, &out );
+}
+
+static block_t *MakeFrames( const struct layout *layout, unsigned frames )
+{
+    block_t *block = MakeSamples( VLC_CODEC_FL32,
+                                  frames * vlc_popcount( layout->in ) );
+    block->i_nb_samples = frames;
+    return block;
+}
+
+static void TestMixer( const struct layout *layout, const char *name )
+{
+    struct converter ref, simd;
+    float maxdiff = 0.f;
+
+    if( !MixerOpen( &simd, name, layout ) )
+        return;
+    if( !MixerOpen( &ref, "simple_channel_mixer", layout ) )
+        abort();
+
+    static const unsigned frames[] = { 1, 7, 1001 };
+    for( size_t i = 0; i < ARRAY_SIZE(frames); i++ )
+    {
+        block_t *in = MakeFrames( layout, frames[i] );
+        block_t *a = ref.filter->ops->filter_audio( ref.filter,
+                                                     block_Duplicate( in ) );
+        block_t *b = simd.filter->ops->filter_audio( simd.filter, in );
+
+        assert( a != NULL && b != NULL );
+        assert( a->i_buffer == b->i_buffer );
+        assert( a->i_nb_samples == b->i_nb_samples );
+
+        const float *fa = (const float *)a->p_buffer;
+        const float *fb = (const float *)b->p_buffer;
+        for( size_t j = 0; j < a->i_buffer / sizeof (float); j++ )
+        {
+            float diff = fabsf( fa[j] - fb[j] ) / fmaxf( 1.f, fabsf( fa[j] ) );
+            if( diff > maxdiff )
+                maxdiff = diff;
+        }
+        block_Release( a );
+        block_Release( b );
+    }
+
+    /* The C version may be reassociated by the compiler */
+    assert( maxdiff <= 4 * FLT_EPSILON );
+    printf( "%-28s %-28s %u to %u channels max diff %g\n", "channel mixer",
+            name, vlc_popcount( layout->in ), vlc_popcount( layout->out ),
+            maxdiff );
+    ConverterClose( &ref );
+    ConverterClose( &simd );
+}
+
+struct mixer_bench
+{
+    struct converter *converter;
+    block_t *block;
+};
+
+static void RunMixer( void *opaque )
+{
+    struct mixer_bench *b = opaque;
+    filter_t *filter = b->converter->filter;
+
+    block_Release( filter->ops->filter_audio( filter,
+                                              block_Duplicate( b->block ) ) );
+}
+
+static void BenchMixer( const struct layout *layout, const char *name )
+{
+    struct converter c;
+    char kernel[32];
+
+    if( !MixerOpen( &c, name, layout ) )
+        return;
+
+    struct mixer_bench b = { &c, MakeFrames( layout, 1 << 14 ) };
+
+    snprintf( kernel, sizeof (kernel), "mixer %u to %u",
+              vlc_popcount( layout->in ), vlc_popcount( layout->out ) );
+    Bench( kernel, name, 1 << 14, "Mframes", RunMixer, &b );
+    block_Release( b.block );
+    ConverterClose( &c );
+}
+
+/*
+ * Video chroma conversions
+ */
+static const struct chroma
+{
+    const char *module;
+    const char *reference;
+    vlc_fourcc_t in;
+    vlc_fourcc_t out;
+    uint32_t masks[3];
+} chromas[] = {
+    { "chroma_yuv", "i420_yuy2", VLC_CODEC_I420, VLC_CODEC_YUYV, { 0 } },
+    { "chroma_yuv", "i420_yuy2", VLC_CODEC_I420, VLC_CODEC_YVYU, { 0 } },
+    { "chroma_yuv", "i420_yuy2", VLC_CODEC_I420, VLC_CODEC_UYVY, { 0 } },
+    { "chroma_yuv", "i422_yuy2", VLC_CODEC_I422, VLC_CODEC_YUYV, { 0 } },
+    { "chroma_yuv", "i422_yuy2", VLC_CODEC_I422, VLC_CODEC_YVYU, { 0 } },
+    { "chroma_yuv", "i422_yuy2", VLC_CODEC_I422, VLC_CODEC_UYVY, { 0 } },
+    { "chroma_yuv", "yuy2_i422", VLC_CODEC_YUYV, VLC_CODEC_I422, { 0 } },
+    { "chroma_yuv", "yuy2_i422", VLC_CODEC_YVYU, VLC_CODEC_I422, { 0 } },
+    { "chroma_yuv", "yuy2_i422", VLC_CODEC_UYVY, VLC_CODEC_I422, { 0 } },
+    { "chroma_yuv", "i420_nv12", VLC_CODEC_NV12, VLC_CODEC_I420, { 0 } },
+    { "chroma_yuv", "i420_nv12", VLC_CODEC_NV12, VLC_CODEC_YV12, { 0 } },
+    { "yuv_rgb", "i420_rgb", VLC_CODEC_I420, VLC_CODEC_RGB32,
+      { 0x00ff0000, 0x0000ff00, 0x000000ff } },
+    { "yuv_rgb", "i420_rgb", VLC_CODEC_I420, VLC_CODEC_RGB32,
+      { 0x000000ff, 0x0000ff00, 0x00ff0000 } },
+    { "yuv_rgb", "i420_rgb", VLC_CODEC_YV12, VLC_CODEC_RGB32,
+      { 0xff000000, 0x00ff0000, 0x0000ff00 } },
+    { "yuv_rgb", "i420_rgb", VLC_CODEC_I420, VLC_CODEC_RGB16,
+      { 0xf800, 0x07e0, 0x001f } },
+    { "yuv_rgb", "i420_rgb", VLC_CODEC_I420, VLC_CODEC_RGB15,
+      { 0x7c00, 0x03e0, 0x001f } },
+};
+
+static void SetupVideo( es_format_t *fmt, vlc_fourcc_t chroma,
+                        const uint32_t *masks, unsigned width,
+                        unsigned height )
+{
+    es_format_Init( fmt, VIDEO_ES, chroma );
+    video_format_Setup( &fmt->video, chroma, width, height, width, height,
+                        1, 1 );
+    if( masks != NULL )
+    {
+        fmt->video.i_rmask = masks[0];
+        fmt->video.i_gmask = masks[1];
+        fmt->video.i_bmask = masks[2];
+    }
+}
+
+static bool ChromaOpen( struct converter *c, const char *name,
+                        const struct chroma *chroma, unsigned width,
+                        unsigned height )
+{
+    es_format_t in, out;
+
+    SetupVideo( &in, chroma->in, NULL, width, height );
+    SetupVideo( &out, chroma->out, chroma->masks, width, height );
+    return ConverterOpen( c, "video converter", name, &in, &out );
+}
+
+/* Samples in the nominal video range: the lookup tables of the C RGB
+ * conversion do not cover all the out of range luma and chroma pairs */
+static picture_t *MakePicture( const video_format_t *fmt )
+{
+    picture_t *pic = picture_NewFromFormat( fmt );
+    assert( pic != NULL );
+
+    for( int i = 0; i < pic->i_planes; i++ )
+    {
+        plane_t *p = &pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = 16 + Random() % 220;
+    }
+    return pic;
+}
+
+static bool SamePicture( const picture_t *a, const picture_t *b )
+{
+    if( a->i_planes != b->i_planes )
+        return false;
+
+    for( int i = 0; i < a->i_planes; i++ )
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+
+        for( int y = 0; y < pa->i_visible_lines; y++ )
+            if( memcmp( &pa->p_pixels[y * pa->i_pitch],
+                        &pb->p_pixels[y * pb->i_pitch],
+                        pa->i_visible_pitch ) )
+                return false;
+    }
+    return true;
+}
+
+static void TestChroma( const struct chroma *chroma, const char *name,
+                        unsigned width, unsigned height )
+{
+    struct converter ref, simd;
+
+    if( !ChromaOpen( &simd, name, chroma, width, height ) )
+        return;
+    if( !ChromaOpen( &ref, chroma->reference, chroma, width, height ) )
+        abort();
+
+    picture_t *in = MakePicture( &ref.filter->fmt_in.video );
+    picture_Hold( in );
+
+    picture_t *a = ref.filter->ops->filter_video( ref.filter, in );
+    picture_t *b = simd.filter->ops->filter_video( simd.filter, in );
+
+    assert( a != NULL && b != NULL );
+    assert( SamePicture( a, b ) );
+    picture_Release( a );
+    picture_Release( b );
+
+    printf( "%4.4s to %4.4s %4ux%-4u      %-28s bit exact\n",
+            (const char *)&chroma->in, (const char *)&chroma->out,
+            width, height, name );
+    ConverterClose( &ref );
+    ConverterClose( &simd );
+}
+
+/* No C module converts NV12 nor NV21 to RGB: the reference is the I420
+ * conversion of the deinterleaved picture */
+static const struct chroma semiplanars[] = {
+    { "yuv_rgb", "i420_rgb", VLC_CODEC_NV12, VLC_CODEC_RGB32,
+      { 0x000000ff, 0x0000ff00, 0x00ff0000 } },
+    { "yuv_rgb", "i420_rgb", VLC_CODEC_NV21, VLC_CODEC_RGB32,
+      { 0x00ff0000, 0x0000ff00, 0x000000ff } },
+};
+
+static void TestSemiPlanar( const struct chroma *chroma, const char *name,
+                            unsigned width, unsigned height )
+{
+    struct chroma planar = *chroma;
+    struct converter ref, simd;
+
+    planar.in = VLC_CODEC_I420;
+    if( !ChromaOpen( &simd, name, chroma, width, height ) )
+        return;
+    if( !ChromaOpen( &ref, chroma->reference, &planar, width, height ) )
+        abort();
+
+    picture_t *in = MakePicture( &simd.filter->fmt_in.video );
+    picture_t *in420 = picture_NewFromFormat( &ref.filter->fmt_in.video );
+    assert( in420 != NULL );
+
+    const bool swapped = chroma->in == VLC_CODEC_NV21;
+    plane_t *uv = &in->p[1];
+
+    plane_CopyPixels( &in420->p[Y_PLANE], &in->p[Y_PLANE] );
+    for( int y = 0; y < uv->i_visible_lines; y++ )
+        for( int x = 0; x < uv->i_visible_pitch / 2; x++ )
+        {
+            const uint8_t *c = &uv->p_pixels[y * uv->i_pitch + 2 * x];
+
+            in420->p[U_PLANE].p_pixels[y * in420->p[U_PLANE].i_pitch + x] =
+                c[swapped];
+            in420->p[V_PLANE].p_pixels[y * in420->p[V_PLANE].i_pitch + x] =
+                c[!swapped];
+        }
+
+    picture_t *a = ref.filter->ops->filter_video( ref.filter, in420 );
+    picture_t *b = simd.filter->ops->filter_video( simd.filter, in );
+
+    assert( a != NULL && b != NULL );
+    assert( SamePicture( a, b ) );
+    picture_Release( a );
+    picture_Release( b );
+
+    printf( "%4.4s to %4.4s %4ux%-4u      %-28s bit exact\n",
+            (const char *)&chroma->in, (const char *)&chroma->out,
+            width, height, name );
+    ConverterClose( &ref );
+    ConverterClose( &simd );
+}
+
+struct chroma_bench
+{
+    struct converter *converter;
+    picture_t *picture;
+};
+
+static void RunChroma( void *opaque )
+{
+    struct chroma_bench *b = opaque;
+    filter_t *filter = b->converter->filter;
+
+    picture_Release( filter->ops->filter_video( filter,
+                                                picture_Hold( b->picture ) ) );
+}
+
+static void BenchChroma( const struct chroma *chroma, const char *name )
+{
+    struct converter c;
+    char kernel[32];
+
+    if( !ChromaOpen( &c, name, chroma, 1920, 1080 ) )
+        return;
+
+    struct chroma_bench b = { &c, MakePicture( &c.filter->fmt_in.video ) };
+
+    snprintf( kernel, sizeof (kernel), "%4.4s to %4.4s",
+              (const char *)&chroma->in, (const char *)&chroma->out );
+    Bench( kernel, name, 1920 * 1080, "Mpixels", RunChroma, &b );
+    picture_Release( b.picture );
+    ConverterClose( &c );
+}
+
+int main( void )
+{
+    test_init();
+
+    if( !vlc_CPU_SSE4_1() )
+        return 77;
+
+    libvlc_instance_t *vlc = libvlc_new( 0, NULL );
+    assert( vlc != NULL );
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    char name[32];
+
+    for( size_t i = 0; i < ARRAY_SIZE(isas); i++ )
+    {
+        if( !isas[i].capable() )
+            continue;
+
+        for( size_t j = 0; j < ARRAY_SIZE(volume_formats); j++ )
+        {
+            snprintf( name, sizeof (name), "volume_%s", isas[i].suffix );
+            TestVolume( volume_formats[j], name );
+        }
+
+        snprintf( name, sizeof (name), "simple_channel_mixer_%s",
+                  isas[i].suffix );
+        for( size_t j = 0; j < ARRAY_SIZE(layouts); j++ )
+            TestMixer( &layouts[j], name );
+
+        for( size_t j = 0; j < ARRAY_SIZE(chromas); j++ )
+        {
+            snprintf( name, sizeof (name), "%s_%s", chromas[j].module,
+                      isas[i].suffix );
+            TestChroma( &chromas[j], name, 640, 360 );
+            TestChroma( &chromas[j], name, 638, 362 );
+        }
+
+        for( size_t j = 0; j < ARRAY_SIZE(semiplanars); j++ )
+        {
+            snprintf( name, sizeof (name), "%s_%s", semiplanars[j].module,
+                      isas[i].suffix );
+            TestSemiPlanar( &semiplanars[j], name, 640, 360 );
+            TestSemiPlanar( &semiplanars[j], name, 638, 362 );
+        }
+    }
+
+    /* Throughput of the C module, then of each instruction set */
+    static const struct isa c_isa = { NULL, CPU_C };
+
+    for( size_t j = 0; j < ARRAY_SIZE(volume_formats); j++ )
+        for( size_t i = 0; i <= ARRAY_SIZE(isas); i++ )
+        {
+            const struct isa *isa = i ? &isas[i - 1] : &c_isa;
+
+            if( !isa->capable() )
+                continue;
+            if( isa->suffix != NULL )
+                snprintf( name, sizeof (name), "volume_%s", isa->suffix );
+            else
+                strcpy( name, VolumeReference( volume_formats[j] ) );
+            BenchVolume( volume_formats[j], name );
+        }
+
+    for( size_t j = 0; j < 2; j++ )
+        for( size_t i = 0; i <= ARRAY_SIZE(isas); i++ )
+        {
+            const struct isa *isa = i ? &isas[i - 1] : &c_isa;
+
+            if( !isa->capable() )
+                continue;
+            if( isa->suffix != NULL )
+                snprintf( name, sizeof (name), "simple_channel_mixer_%s",
+                          isa->suffix );
+            else
+                strcpy( name, "simple_channel_mixer" );
+            BenchMixer( &layouts[j * 4], name );
+        }
+
+    for( size_t j = 0; j < ARRAY_SIZE(chromas); j += 3 )
+        for( size_t i = 0; i <= ARRAY_SIZE(isas); i++ )
+        {
+            const struct isa *isa = i ? &isas[i - 1] : &c_isa;
+
+            if( !isa->capable() )
+                continue;
+            if( isa->suffix != NULL )
+                snprintf( name, sizeof (name), "%s_%s", chromas[j].module,
+                          isa->suffix );
+            else
+                strcpy( name, chromas[j].reference );
+            BenchChroma( &chromas[j], name );
+        }
+
+    libvlc_release( vlc );
+    return 0;
+}
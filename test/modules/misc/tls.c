@@ -82,10 +82,59 @@ error:
     return NULL;
 }
 
-static vlc_tls_t *securepair(vlc_thread_t *th,
-                             const char *const salpnv[],
-                             const char *const calpnv[],
-                             char **restrict alp)
+/* Client transport counting the received bytes */
+struct counter
+{
+    vlc_tls_t tls;
+    size_t received;
+};
+
+static int counter_get_fd(vlc_tls_t *tls, short *events)
+{
+    return vlc_tls_GetPollFD(tls->p, events);
+}
+
+static ssize_t counter_readv(vlc_tls_t *tls, struct iovec *iov, unsigned len)
+{
+    struct counter *c = container_of(tls, struct counter, tls);
+    ssize_t val = tls->p->ops->readv(tls->p, iov, len);
+
+    if (val > 0)
+        c->received += val;
+    return val;
+}
+
+static ssize_t counter_writev(vlc_tls_t *tls, const struct iovec *iov,
+                              unsigned len)
+{
+    return tls->p->ops->writev(tls->p, iov, len);
+}
+
+static int counter_shutdown(vlc_tls_t *tls, bool duplex)
+{
+    return vlc_tls_Shutdown(tls->p, duplex);
+}
+
+static void counter_close(vlc_tls_t *tls)
+{
+    free(container_of(tls, struct counter, tls));
+}
+
+static const struct vlc_tls_operations counter_ops =
+{
+    counter_get_fd,
+    counter_readv,
+    counter_writev,
+    counter_shutdown,
+    counter_close,
+};
+
+static vlc_tls_t *securepair_with(vlc_thread_t *th,
+                                  vlc_tls_client_t *creds,
+                                  const char *const salpnv[],
+                                  const char *const calpnv[],
+                                  char **restrict alp,
+                                  size_t *restrict received)
 {
     vlc_tls_t *socks[2];
     vlc_tls_t *server, *client;
@@ -100,18 +149,34 @@ static vlc_tls_t *securepair(vlc_thread_t *th,
     val = vlc_clone(th, tls_echo, server, VLC_THREAD_PRIORITY_LOW);
     assert(val == 0);
 
-    client = vlc_tls_ClientSessionCreate(client_creds, socks[1],
+    struct counter *counter = malloc(sizeof (*counter));
+    assert(counter != NULL);
+    counter->tls.ops = &counter_ops;
+    counter->tls.p = socks[1];
+    counter->received = 0;
+
+    client = vlc_tls_ClientSessionCreate(creds, &counter->tls,
                                          "localhost", "vlc-tls-test",
                                          calpnv, alp);
     if (client == NULL)
     {
-        vlc_tls_SessionDelete(socks[1]);
+        vlc_tls_Close(&counter->tls);
         vlc_join(*th, NULL);
         return NULL;
     }
+    if (received != NULL)
+        *received = counter->received;
     return client;
 }
 
+static vlc_tls_t *securepair(vlc_thread_t *th,
+                             const char *const salpnv[],
+                             const char *const calpnv[],
+                             char **restrict alp)
+{
+    return securepair_with(th, client_creds, salpnv, calpnv, alp, NULL);
+}
+
 #define CERTDIR SRCDIR "/samples/certs"
 #define CERTFILE CERTDIR "/certkey.pem"
 
@@ -290,6 +355,36 @@ int main(void)
     vlc_tls_Close(tls);
     vlc_join(th, NULL);
 
+    vlc_tls_ClientDelete(client_creds);
+
+    /* Test session resumption, with credentials of its own so that the
+     * other tests always go through certificate verification */
+    size_t full, resumed;
+
+    client_creds = vlc_tls_ClientCreate(obj);
+    assert(client_creds != NULL);
+
+    tls = securepair_with(&th, client_creds, alpn, alpn, NULL, &full);
+    assert(tls != NULL);
+    /* Receive the session ticket (sent after the handshake in TLS 1.3) */
+    val = vlc_tls_Write(tls, "Hello", 5);
+    assert(val == 5);
+    val = vlc_tls_Read(tls, buf, 5, true);
+    assert(val == 5);
+    val = vlc_tls_Shutdown(tls, false);
+    assert(val == 0);
+    vlc_join(th, NULL);
+    vlc_tls_Close(tls);
+
+    /* The resumed handshake does not carry the server certificate */
+    tls = securepair_with(&th, client_creds, alpn, alpn, NULL, &resumed);
+    assert(tls != NULL);
+    fprintf(stderr, "Handshake received %zu bytes, %zu bytes resumed.\n",
+            full, resumed);
+    assert(resumed + 512 < full);
+    vlc_tls_Close(tls);
+    vlc_join(th, NULL);
+
     vlc_tls_ClientDelete(client_creds);
     vlc_tls_ServerDelete(server_creds);
     libvlc_release(vlc);
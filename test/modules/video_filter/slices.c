@@ -0,0 +1,270 @@
+/*****************************************************************************
+ * slices.c: slice threaded video filters test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+#include <vlc_variables.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include "../../libvlc/test.h"
+
+#define FRAME_COUNT 6
+
+const char vlc_module_name[] = "test_slices";
+
+static vlc_object_t *parent;
+
+static const char *const filters[] = {
+    "deinterlace{mode=linear}",
+    "deinterlace{mode=blend}",
+    "deinterlace{mode=yadif}",
+    "deinterlace{mode=yadif2x}",
+    "hqdn3d{luma-spat=0,chroma-spat=0}",
+    "hqdn3d",
+    "gradfun",
+    "adjust{contrast=1.2,hue=30,saturation=1.5,gamma=1.3}",
+};
+
+/* Filters whose slices are primed, instead of being exactly computed */
+static bool IsApproximate( const char *filter )
+{
+    return !strcmp( filter, "hqdn3d" );
+}
+
+/* Gradients with some noise and a moving bar, so that the denoisers,
+ * the debanding and the deinterlacers all have something to do */
+static picture_t *MakePicture( unsigned width, unsigned height, unsigned n )
+{
+    video_format_t fmt;
+    video_format_Setup( &fmt, VLC_CODEC_I420, width, height, width, height,
+                        1, 1 );
+    picture_t *pic = picture_NewFromFormat( &fmt );
+    assert( pic != NULL );
+
+    uint32_t seed = 0x1234567 + n;
+    for( int i = 0; i < pic->i_planes; i++ )
+    {
+        plane_t *p = &pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+        {
+            uint8_t *line = &p->p_pixels[y * p->i_pitch];
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                seed = seed * 1103515245 + 12345;
+                int v = i ? 128 + (x - y) / 8 : (x + y) / 16 + 16;
+                if( (unsigned)(x - n * 8) % p->i_pitch < 24 )
+                    v = 235;
+                line[x] = VLC_CLIP( v + (int)((seed >> 16) & 3), 0, 255 );
+            }
+        }
+    }
+    pic->date = VLC_TICK_0 + n * VLC_TICK_FROM_MS(40);
+    pic->b_progressive = false;
+    pic->b_top_field_first = true;
+    pic->i_nb_fields = 2;
+    return pic;
+}
+
+struct run
+{
+    vlc_object_t *obj;
+    filter_chain_t *chain;
+};
+
+static void RunOpen( struct run *run, const char *filter, unsigned threads,
+                     unsigned width, unsigned height )
+{
+    run->obj = vlc_object_create( parent, sizeof (*run->obj) );
+    assert( run->obj != NULL );
+    var_Create( run->obj, "filter-threads", VLC_VAR_INTEGER );
+    var_SetInteger( run->obj, "filter-threads", threads );
+
+    es_format_t fmt;
+    es_format_Init( &fmt, VIDEO_ES, VLC_CODEC_I420 );
+    video_format_Setup( &fmt.video, VLC_CODEC_I420, width, height,
+                        width, height, 1, 1 );
+    fmt.video.i_frame_rate = 25;
+    fmt.video.i_frame_rate_base = 1;
+
+    run->chain = filter_chain_NewVideo( run->obj, true, NULL );
+    assert( run->chain != NULL );
+    filter_chain_Reset( run->chain, &fmt, NULL, &fmt );
+    int ret = filter_chain_AppendFromString( run->chain, filter );
+    if( ret != 1 )
+    {
+        fprintf( stderr, "cannot load %s\n", filter );
+        abort();
+    }
+    es_format_Clean( &fmt );
+}
+
+static void RunClose( struct run *run )
+{
+    filter_chain_Delete( run->chain );
+    vlc_object_delete( run->obj );
+}
+
+/* Filters a picture, returns the number of output pictures */
+static unsigned RunFilter( struct run *run, picture_t *in,
+                           picture_t **out, unsigned max )
+{
+    unsigned count = 0;
+    picture_t *pic = filter_chain_VideoFilter( run->chain, in );
+
+    while( pic != NULL )
+    {
+        if( out != NULL && count < max )
+            out[count] = pic;
+        else
+            picture_Release( pic );
+        count++;
+        pic = filter_chain_VideoFilter( run->chain, NULL );
+    }
+    return count;
+}
+
+static bool SamePicture( const picture_t *a, const picture_t *b, int *maxdiff )
+{
+    bool same = true;
+
+    for( int i = 0; i < a->i_planes; i++ )
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+        for( int y = 0; y < pa->i_visible_lines; y++ )
+        {
+            const uint8_t *la = &pa->p_pixels[y * pa->i_pitch];
+            const uint8_t *lb = &pb->p_pixels[y * pb->i_pitch];
+            for( int x = 0; x < pa->i_visible_pitch; x++ )
+            {
+                int diff = abs( la[x] - lb[x] );
+                if( diff > *maxdiff )
+                    *maxdiff = diff;
+                same &= diff == 0;
+            }
+        }
+    }
+    return same;
+}
+
+/* Compares the output of a single thread with the one of several bands */
+static void TestConformance( const char *filter, unsigned width,
+                             unsigned height )
+{
+    struct run single, sliced;
+    int maxdiff = 0;
+
+    RunOpen( &single, filter, 1, width, height );
+    RunOpen( &sliced, filter, 5, width, height );
+
+    for( unsigned n = 0; n < FRAME_COUNT; n++ )
+    {
+        picture_t *a[2], *b[2];
+        unsigned ca = RunFilter( &single, MakePicture( width, height, n ), a, 2 );
+        unsigned cb = RunFilter( &sliced, MakePicture( width, height, n ), b, 2 );
+
+        assert( ca == cb && ca <= 2 );
+        for( unsigned i = 0; i < ca; i++ )
+        {
+            bool same = SamePicture( a[i], b[i], &maxdiff );
+            assert( same || IsApproximate( filter ) );
+            picture_Release( a[i] );
+            picture_Release( b[i] );
+        }
+    }
+
+    /* The primed vertical state converges within the overlap */
+    assert( maxdiff <= 2 );
+    printf( "%-54s %4ux%-4u max diff %d\n", filter, width, height, maxdiff );
+
+    RunClose( &single );
+    RunClose( &sliced );
+}
+
+static void Bench( const char *filter, unsigned width, unsigned height,
+                   unsigned threads )
+{
+    struct run run;
+    picture_t *frames[FRAME_COUNT];
+    unsigned count = 0, outputs = 0;
+
+    for( unsigned n = 0; n < FRAME_COUNT; n++ )
+        frames[n] = MakePicture( width, height, n );
+
+    RunOpen( &run, filter, threads, width, height );
+
+    /* At least two frames, or about 150ms */
+    vlc_tick_t start = vlc_tick_now();
+    vlc_tick_t elapsed;
+    do
+    {
+        picture_t *pic = picture_Clone( frames[count % FRAME_COUNT] );
+        assert( pic != NULL );
+        picture_Copy( pic, frames[count % FRAME_COUNT] );
+        pic->date = VLC_TICK_0 + count * VLC_TICK_FROM_MS(40);
+        outputs += RunFilter( &run, pic, NULL, 0 );
+        count++;
+        elapsed = vlc_tick_now() - start;
+    }
+    while( count < 2 || elapsed < VLC_TICK_FROM_MS(150) );
+
+    RunClose( &run );
+    for( unsigned n = 0; n < FRAME_COUNT; n++ )
+        picture_Release( frames[n] );
+
+    double secs = secf_from_vlc_tick( elapsed ) + 1e-9;
+    printf( "%-54s %4ux%-4u %2u threads: %8.1f fps\n", filter, width, height,
+            threads, outputs / secs );
+}
+
+int main( void )
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new( 0, NULL );
+    assert( vlc != NULL );
+    parent = VLC_OBJECT(vlc->p_libvlc_int);
+
+    for( size_t i = 0; i < ARRAY_SIZE(filters); i++ )
+    {
+        TestConformance( filters[i], 720, 576 );
+        TestConformance( filters[i], 638, 362 );
+    }
+
+    unsigned cpus = vlc_GetCPUCount();
+    for( size_t i = 0; i < ARRAY_SIZE(filters); i++ )
+    {
+        Bench( filters[i], 1920, 1080, 1 );
+        if( cpus > 1 )
+            Bench( filters[i], 1920, 1080, cpus );
+        Bench( filters[i], 3840, 2160, 1 );
+        if( cpus > 1 )
+            Bench( filters[i], 3840, 2160, cpus );
+    }
+
+    libvlc_release( vlc );
+    return 0;
+}
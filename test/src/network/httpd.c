@@ -0,0 +1,334 @@
+/*****************************************************************************
+ * httpd.c: HTTP server streaming test and multi-client load test
+ *****************************************************************************
+ * Copyright (C) 2024 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <time.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+#include <vlc_network.h>
+
+#include "../../../lib/libvlc_internal.h"
+
+#include "../../libvlc/test.h"
+
+#define TS_SIZE     188
+#define SEND_SIZE   (TS_SIZE * 64)
+#define SEND_COUNT  1500 /* about 18 MB */
+#define CONNECTORS  4
+#define CONNECT_TIME VLC_TICK_FROM_MS(200)
+
+static unsigned port;
+
+struct client
+{
+    vlc_thread_t thread;
+    uint64_t bytes;
+    uint32_t packets;
+    unsigned resyncs; /* skips to the live edge */
+    double cpu; /* seconds */
+};
+
+static double ThreadCPU(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+    return 0.;
+}
+
+static double ProcessCPU(void)
+{
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+    return 0.;
+}
+
+static const uint8_t magic[4] = { 0x47, 0x00, 0x00, 0x00 };
+
+/* Finds the next packet start, if any, or a partial one at the end */
+static size_t Resync(const uint8_t *pkt, size_t len)
+{
+    for (size_t i = 1; i < len; i++)
+        if (!memcmp(pkt + i, magic, __MIN(len - i, sizeof (magic))))
+            return i;
+    return len;
+}
+
+static void *Client(void *data)
+{
+    struct client *c = data;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(connect(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+
+    static const char req[] = "GET /stream HTTP/1.0\r\n\r\n";
+    assert(send(fd, req, sizeof (req) - 1, 0) == sizeof (req) - 1);
+
+    /* Skip the response header */
+    char hdr[4] = { 0 };
+    do {
+        memmove(hdr, hdr + 1, 3);
+        assert(recv(fd, hdr + 3, 1, 0) == 1);
+    } while (memcmp(hdr, "\r\n\r\n", 4));
+
+    uint8_t pkt[TS_SIZE];
+    size_t fill = 0;
+    uint32_t last = 0;
+    ssize_t val;
+
+    while ((val = recv(fd, pkt + fill, sizeof (pkt) - fill, 0)) > 0) {
+        c->bytes += val;
+        fill += val;
+        if (fill < sizeof (pkt))
+            continue;
+
+        /* A client too slow for the stream is moved to the live edge, which
+         * may cut a packet short. Packets are in order nevertheless. */
+        if (memcmp(pkt, magic, sizeof (magic))) {
+            size_t skip = Resync(pkt, fill);
+
+            memmove(pkt, pkt + skip, fill - skip);
+            fill -= skip;
+            c->resyncs++;
+            continue;
+        }
+
+        uint32_t seq = GetDWBE(pkt + 4);
+        assert(seq > last);
+        last = seq;
+        c->packets++;
+        fill = 0;
+    }
+
+    c->cpu = ThreadCPU();
+    vlc_close(fd);
+    return NULL;
+}
+
+/* Creates an HTTP host with the given number of threads */
+static httpd_host_t *HostNew(vlc_object_t *parent, unsigned threads,
+                             vlc_object_t **objp)
+{
+    vlc_object_t *obj = vlc_object_create(parent, sizeof (*obj));
+    assert(obj != NULL);
+    var_Create(obj, "http-threads", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "http-threads", threads);
+
+    httpd_host_t *host = vlc_http_HostNew(obj);
+    assert(host != NULL);
+    *objp = obj;
+    return host;
+}
+
+static void Run(vlc_object_t *parent, unsigned threads, unsigned clientc)
+{
+    vlc_object_t *obj;
+    httpd_host_t *host = HostNew(parent, threads, &obj);
+    httpd_stream_t *stream = httpd_StreamNew(host, "/stream", "video/MP2T",
+                                             NULL, NULL);
+    assert(stream != NULL);
+
+    struct client *clientv = calloc(clientc, sizeof (*clientv));
+    assert(clientv != NULL);
+
+    for (unsigned i = 0; i < clientc; i++)
+        assert(vlc_clone(&clientv[i].thread, Client, &clientv[i],
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+
+    /* Let the clients connect before streaming */
+    vlc_tick_wait(vlc_tick_now() + VLC_TICK_FROM_MS(100));
+
+    block_t *block = block_Alloc(SEND_SIZE);
+    assert(block != NULL);
+    uint32_t seq = 0;
+    double feed_cpu = ThreadCPU();
+    double cpu = ProcessCPU();
+    vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned i = 0; i < SEND_COUNT; i++) {
+        for (size_t j = 0; j < SEND_SIZE; j += TS_SIZE) {
+            memset(block->p_buffer + j, 0xff, TS_SIZE);
+            memcpy(block->p_buffer + j, magic, sizeof (magic));
+            SetDWBE(block->p_buffer + j + 4, ++seq);
+        }
+        httpd_StreamSend(stream, block);
+        /* About 50 MB/s */
+        if (i % 16 == 15)
+            vlc_tick_wait(start + (i + 1) * VLC_TICK_FROM_US(250));
+    }
+    block_Release(block);
+
+    /* Let the clients drain, then close them */
+    vlc_tick_wait(vlc_tick_now() + VLC_TICK_FROM_MS(200));
+    feed_cpu = ThreadCPU() - feed_cpu;
+    httpd_StreamDelete(stream);
+
+    uint64_t bytes = 0;
+    unsigned resyncs = 0;
+    double client_cpu = 0.;
+
+    for (unsigned i = 0; i < clientc; i++) {
+        vlc_join(clientv[i].thread, NULL);
+        bytes += clientv[i].bytes;
+        resyncs += clientv[i].resyncs;
+        client_cpu += clientv[i].cpu;
+        assert(clientv[i].packets > 0);
+    }
+
+    double secs = secf_from_vlc_tick(vlc_tick_now() - start);
+    double server_cpu = ProcessCPU() - cpu - client_cpu - feed_cpu;
+
+    printf("%u threads, %2u clients: %7.1f MB/s egress, %5.1f%% received, %u skips, "
+           "server CPU %6.3f s, %7.1f us per client per MB\n",
+           threads, clientc, bytes / secs / 1e6,
+           100. * bytes / ((double)clientc * SEND_COUNT * SEND_SIZE), resyncs,
+           server_cpu, server_cpu * 1e6 / clientc
+                           / ((double)SEND_COUNT * SEND_SIZE / 1e6));
+
+    free(clientv);
+    httpd_HostDelete(host);
+    vlc_object_delete(obj);
+}
+
+static int Fill(httpd_file_sys_t *sys, httpd_file_t *file, uint8_t *request,
+                uint8_t **datap, int *lenp)
+{
+    static const char page[] = "<html><body>Hello</body></html>";
+
+    (void) sys; (void) file; (void) request;
+    *datap = malloc(sizeof (page) - 1);
+    assert(*datap != NULL);
+    memcpy(*datap, page, sizeof (page) - 1);
+    *lenp = sizeof (page) - 1;
+    return VLC_SUCCESS;
+}
+
+struct connector
+{
+    vlc_thread_t thread;
+    vlc_tick_t deadline;
+    unsigned count;
+};
+
+/* Fetches a small page over and over, one connection per request */
+static void *Connector(void *data)
+{
+    struct connector *c = data;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    static const char req[] = "GET /page HTTP/1.0\r\n\r\n";
+
+    while (vlc_tick_now() < c->deadline) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(fd >= 0);
+        assert(connect(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+        assert(send(fd, req, sizeof (req) - 1, 0) == sizeof (req) - 1);
+
+        char buf[1024];
+        size_t len = 0;
+        ssize_t val;
+
+        while ((val = recv(fd, buf, sizeof (buf), 0)) > 0)
+            len += val;
+        assert(len > 0);
+        vlc_close(fd);
+        c->count++;
+    }
+    return NULL;
+}
+
+static void Connect(vlc_object_t *parent, unsigned threads)
+{
+    vlc_object_t *obj;
+    httpd_host_t *host = HostNew(parent, threads, &obj);
+    httpd_file_t *file = httpd_FileNew(host, "/page", "text/html", NULL, NULL,
+                                       Fill, NULL);
+    assert(file != NULL);
+
+    struct connector connv[CONNECTORS];
+    vlc_tick_t start = vlc_tick_now();
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < CONNECTORS; i++) {
+        connv[i].deadline = start + CONNECT_TIME;
+        connv[i].count = 0;
+        assert(vlc_clone(&connv[i].thread, Connector, &connv[i],
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+    }
+
+    for (unsigned i = 0; i < CONNECTORS; i++) {
+        vlc_join(connv[i].thread, NULL);
+        count += connv[i].count;
+    }
+
+    double secs = secf_from_vlc_tick(vlc_tick_now() - start);
+
+    printf("%u threads: %7.0f connections/s\n", threads, count / secs);
+    assert(count > 0);
+
+    httpd_FileDelete(file);
+    httpd_HostDelete(host);
+    vlc_object_delete(obj);
+}
+
+int main(void)
+{
+    test_init();
+
+    port = 20000 + (getpid() % 20000);
+
+    char portarg[32];
+    snprintf(portarg, sizeof (portarg), "--http-port=%u", port);
+
+    const char *argv[] = { "--http-host=127.0.0.1", portarg };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    Run(obj, 1, 1);
+    Run(obj, 1, 8);
+
+    for (unsigned threads = 1; threads <= 8; threads *= 2) {
+        Run(obj, threads, 32);
+        Connect(obj, threads);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}